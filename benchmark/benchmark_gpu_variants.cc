@@ -0,0 +1,146 @@
+#include <scaler/gpu/opengl_texture_scaler.hh>
+#include <scaler/gpu/shader_variant.hh>
+#include <scaler/algorithm_capabilities.hh>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Shares the hidden SDL window and GL context setup with the GPU tests
+#include "../test/gpu_test_context.hh"
+
+using namespace scaler;
+
+// GPU time of generic shaders against variants with the input and output
+// sizes baked in. The gain depends on how much the driver folds, so this is
+// reported here rather than asserted in the unit tests.
+
+namespace {
+    GLuint upload_pattern(int width, int height) {
+        std::vector<std::uint8_t> rgba(static_cast<size_t>(width * height * 4));
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const size_t i = static_cast<size_t>(y * width + x) * 4;
+                const bool line = (x + y) % 4 == 0 || x == height - 1 - y;
+                rgba[i] = line ? 250 : static_cast<std::uint8_t>(x * 9);
+                rgba[i + 1] = line ? 30 : static_cast<std::uint8_t>((y / 2) * 25);
+                rgba[i + 2] = static_cast<std::uint8_t>((x ^ y) & 1 ? 200 : 60);
+                rgba[i + 3] = 255;
+            }
+        }
+
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+
+    // Average milliseconds per draw, measured with a GL_TIME_ELAPSED query.
+    // One untimed draw first so compilation is not counted.
+    double gpu_milliseconds(gpu::opengl_texture_scaler& scaler, GLuint input, int width, int height,
+                            algorithm algo, int factor, int runs) {
+        GLuint output = gpu::opengl_texture_scaler::create_output_texture(width * factor, height * factor);
+        scaler.scale_texture_to_texture(input, width, height, output, width * factor, height * factor, algo);
+
+        GLuint query;
+        glGenQueries(1, &query);
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        for (int i = 0; i < runs; ++i) {
+            scaler.scale_texture_to_texture(input, width, height, output, width * factor, height * factor, algo);
+        }
+        glEndQuery(GL_TIME_ELAPSED);
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+        glDeleteQueries(1, &query);
+        glDeleteTextures(1, &output);
+        return static_cast<double>(nanoseconds) / 1e6 / runs;
+    }
+
+    struct benchmark_case {
+        algorithm algo;
+        int factor;
+    };
+}
+
+int main(int argc, char* argv[]) {
+    int runs = 50;
+    int width = 320;
+    int height = 200;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-q" || arg == "--quick") runs = 10;
+        else if ((arg == "-r" || arg == "--runs") && i + 1 < argc) {
+            runs = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--size" && i + 2 < argc) {
+            width = std::max(1, std::atoi(argv[++i]));
+            height = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "-h" || arg == "--help") {
+            std::cout << "Usage: " << argv[0] << " [options]\n"
+                      << "Options:\n"
+                      << "  -q, --quick           Quick benchmark (10 draws per variant)\n"
+                      << "  -r, --runs N          Draws timed per variant (default 50)\n"
+                      << "  --size W H            Input size (default 320 200)\n"
+                      << "  -h, --help            Show this help\n";
+            return 0;
+        }
+    }
+
+    if (!scaler::test::gpu_context::ensure_context()) {
+        std::cerr << "No OpenGL context available" << std::endl;
+        return 1;
+    }
+
+    const benchmark_case cases[] = {
+        {algorithm::Scale, 3},
+        {algorithm::AAScale, 4},
+        {algorithm::OmniScale, 4},
+    };
+
+    std::cout << "GPU shader variants, " << width << "x" << height << " input, "
+              << runs << " draws each\n\n"
+              << std::left << std::setw(14) << "Algorithm" << std::setw(8) << "Scale"
+              << std::right << std::setw(14) << "Generic ms" << std::setw(16) << "Specialized ms"
+              << std::setw(10) << "Ratio" << "\n"
+              << std::string(62, '-') << "\n";
+
+    {
+        gpu::opengl_texture_scaler scaler;
+        GLuint input = upload_pattern(width, height);
+
+        for (const auto& c : cases) {
+            if (!gpu::opengl_texture_scaler::is_scale_supported(c.algo, static_cast<float>(c.factor))) {
+                continue;
+            }
+
+            scaler.set_shader_variants({});
+            const double generic = gpu_milliseconds(scaler, input, width, height, c.algo, c.factor, runs);
+            scaler.set_shader_variants({true, false, gpu::gamma_mode::none});
+            const double specialized = gpu_milliseconds(scaler, input, width, height, c.algo, c.factor, runs);
+
+            std::cout << std::left << std::setw(14) << algorithm_capabilities::get_algorithm_name(c.algo)
+                      << std::setw(8) << (std::to_string(c.factor) + "x")
+                      << std::right << std::fixed << std::setprecision(3)
+                      << std::setw(14) << generic << std::setw(16) << specialized
+                      << std::setw(10) << std::setprecision(2)
+                      << (specialized > 0.0 ? generic / specialized : 0.0) << "\n";
+        }
+
+        glDeleteTextures(1, &input);
+    }
+
+    scaler::test::gpu_context::cleanup();
+    return 0;
+}
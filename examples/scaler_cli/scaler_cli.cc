@@ -5,10 +5,14 @@
 #include <cctype>
 #include <iomanip>
 #include <chrono>
+#include <cmath>
+#include <cstring>
 
 #include "stb_image_wrapper.hh"
 #include <scaler/unified_scaler.hh>
 #include <scaler/algorithm_capabilities.hh>
+#include <scaler/io/animation.hh>
+#include <scaler/io/streaming_scaler.hh>
 
 using namespace scaler;
 
@@ -23,7 +27,18 @@ using namespace scaler;
  *   -l, --list              List available algorithms
  *   -i, --info              Show information about algorithms
  *   -q, --quality <1-100>   JPEG output quality (default: 95)
+ *   -z, --level <0-9>       PNG compression level (default: 6)
+ *   -j, --threads <n>       PNG compression / animation frame threads, 0 = all cores (default: 0)
+ *       --no-stream         Decode the whole PNG into memory instead of streaming rows
  *   -h, --help              Show this help message
+ *
+ * Besides the formats stb handles, QOI (.qoi) and uncompressed raw (.raw)
+ * files are read and written natively. Between PNG, QOI and raw files at an
+ * integral scale the image is streamed: rows are decoded, scaled and
+ * encoded band by band, so memory use is proportional to the image width.
+ * Animated GIF and APNG input written to .gif, .png or .apng is scaled
+ * frame by frame, several frames in parallel, into an animation; .gif
+ * output takes the palette-keeping algorithms (nearest, epx, eagle, scale).
  */
 
 struct Options {
@@ -32,6 +47,9 @@ struct Options {
     algorithm algo = algorithm::Bilinear;
     float scale_factor = 2.0f;
     int jpeg_quality = 95;
+    int png_level = 6;
+    unsigned png_threads = 0;
+    bool no_stream = false;
     bool list_algorithms = false;
     bool show_info = false;
 };
@@ -44,6 +62,40 @@ std::string to_lower(const std::string& str) {
     return result;
 }
 
+// Check whether a file can be streamed row by row (.png, .qoi, .raw)
+bool is_stream_file(const std::string& name) {
+    return io::image_file_format_of(name) != io::image_file_format::unknown;
+}
+
+// Load an image, decoding QOI and raw files natively and everything else with stb
+stb_image load_image(const std::string& name) {
+    const auto format = io::image_file_format_of(name);
+    if (format != io::image_file_format::qoi && format != io::image_file_format::raw) {
+        return stb_image(name.c_str());
+    }
+    const io::packed_image packed = format == io::image_file_format::qoi ? io::load_qoi(name)
+                                                                         : io::load_raw(name);
+    stb_image image(packed.width(), packed.height(), packed.channels());
+    std::memcpy(image.data(), packed.data(), packed.row_bytes() * packed.height());
+    return image;
+}
+
+// Save an image, encoding QOI and raw files natively and everything else with stb
+bool save_image(const stb_image& image, const std::string& name, int quality) {
+    const auto format = io::image_file_format_of(name);
+    if (format != io::image_file_format::qoi && format != io::image_file_format::raw) {
+        return image.save(name.c_str(), quality);
+    }
+    io::packed_image packed(image.width(), image.height(), image.channels());
+    std::memcpy(packed.data(), image.data(), packed.row_bytes() * packed.height());
+    if (format == io::image_file_format::qoi) {
+        io::save_qoi(name, packed);
+    } else {
+        io::save_raw(name, packed);
+    }
+    return true;
+}
+
 // Parse algorithm name from string
 algorithm parse_algorithm(const std::string& name) {
     std::string lower_name = to_lower(name);
@@ -86,6 +138,9 @@ void print_help(const char* program_name) {
     std::cout << "  -l, --list              List available algorithms\n";
     std::cout << "  -i, --info              Show information about algorithms\n";
     std::cout << "  -q, --quality <1-100>   JPEG output quality (default: 95)\n";
+    std::cout << "  -z, --level <0-9>       PNG compression level (default: 6)\n";
+    std::cout << "  -j, --threads <n>       PNG compression / animation frame threads, 0 = all cores (default: 0)\n";
+    std::cout << "      --no-stream         Load the whole PNG into memory (no row streaming)\n";
     std::cout << "  -h, --help              Show this help message\n\n";
     std::cout << "Supported algorithms:\n";
     std::cout << "  nearest    - Nearest neighbor (fast, pixelated)\n";
@@ -104,6 +159,7 @@ void print_help(const char* program_name) {
     std::cout << "  " << program_name << " input.png output.png -a epx\n";
     std::cout << "  " << program_name << " input.jpg output.jpg -s 3.5 -a bilinear\n";
     std::cout << "  " << program_name << " input.png output.jpg -a hq -s 4 -q 90\n";
+    std::cout << "  " << program_name << " sprite.gif sprite_3x.png -a xbr -s 3\n";
 }
 
 // List all available algorithms and their supported scales
@@ -220,6 +276,25 @@ Options parse_arguments(int argc, char* argv[]) {
             if (opts.jpeg_quality < 1 || opts.jpeg_quality > 100) {
                 throw std::runtime_error("Quality must be between 1 and 100");
             }
+        } else if (arg == "-z" || arg == "--level") {
+            if (++i >= argc) {
+                throw std::runtime_error("Missing compression level");
+            }
+            opts.png_level = std::stoi(argv[i]);
+            if (opts.png_level < 0 || opts.png_level > 9) {
+                throw std::runtime_error("Compression level must be between 0 and 9");
+            }
+        } else if (arg == "-j" || arg == "--threads") {
+            if (++i >= argc) {
+                throw std::runtime_error("Missing thread count");
+            }
+            const int threads = std::stoi(argv[i]);
+            if (threads < 0) {
+                throw std::runtime_error("Thread count must not be negative");
+            }
+            opts.png_threads = static_cast<unsigned>(threads);
+        } else if (arg == "--no-stream") {
+            opts.no_stream = true;
         } else if (arg[0] == '-') {
             throw std::runtime_error("Unknown option: " + arg);
         } else {
@@ -264,9 +339,68 @@ int main(int argc, char* argv[]) {
             return 0;
         }
 
+        const float whole_scale = std::round(opts.scale_factor);
+
+        // Animated GIF/APNG: decode, scale and encode frame by frame
+        if (io::animation_file_format_of(opts.output_file) != io::animation_file_format::unknown &&
+            io::is_animated_file(opts.input_file)) {
+            if (std::abs(whole_scale - opts.scale_factor) >= 1e-6f ||
+                !scaler_capabilities::is_scale_supported(opts.algo, whole_scale)) {
+                std::cerr << "Error: animations need an integral scale supported by "
+                          << scaler_capabilities::get_algorithm_name(opts.algo) << "\n";
+                return 1;
+            }
+            if (io::animation_file_format_of(opts.output_file) == io::animation_file_format::gif &&
+                !io::keeps_palette(opts.algo)) {
+                std::cerr << "Error: " << scaler_capabilities::get_algorithm_name(opts.algo)
+                          << " blends colors beyond a GIF palette; use nearest, epx, eagle or scale,"
+                          << " or write APNG (.png)\n";
+                return 1;
+            }
+            std::cout << "Scaling animation " << opts.input_file << " -> " << opts.output_file << " with "
+                      << scaler_capabilities::get_algorithm_name(opts.algo) << " at " << whole_scale << "x...\n";
+
+            auto start = std::chrono::high_resolution_clock::now();
+            const auto stats = io::scale_animation_file(opts.input_file, opts.output_file, opts.algo,
+                                                        static_cast<int>(whole_scale), opts.png_level,
+                                                        opts.png_threads);
+            auto end = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+            std::cout << stats.frames << " frames in " << duration.count() << " ms ("
+                      << stats.rows_reused << " of " << stats.rows_scaled + stats.rows_reused
+                      << " rows reused from the previous frame)\n";
+            std::cout << "Success!\n";
+            return 0;
+        }
+
+        // PNG/QOI/raw at an integral scale: stream rows instead of loading the image
+        if (!opts.no_stream && is_stream_file(opts.input_file) && is_stream_file(opts.output_file) &&
+            std::abs(whole_scale - opts.scale_factor) < 1e-6f &&
+            scaler_capabilities::is_scale_supported(opts.algo, whole_scale)) {
+            try {
+                std::cout << "Streaming " << opts.input_file << " -> " << opts.output_file << " with "
+                          << scaler_capabilities::get_algorithm_name(opts.algo)
+                          << " at " << whole_scale << "x...\n";
+
+                auto start = std::chrono::high_resolution_clock::now();
+                io::scale_image_file(opts.input_file, opts.output_file, opts.algo,
+                                   static_cast<int>(whole_scale), opts.png_level, 32, opts.png_threads);
+                auto end = std::chrono::high_resolution_clock::now();
+                auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+                std::cout << "Decode, scale and encode completed in " << duration.count() << " ms\n";
+                std::cout << "Success!\n";
+                return 0;
+            } catch (const io::png_error& e) {
+                // Interlaced input cannot be streamed; decode it as a whole instead
+                std::cout << "Streaming not possible (" << e.what() << "), loading whole image\n";
+            }
+        }
+
         // Load input image
         std::cout << "Loading image: " << opts.input_file << "\n";
-        stb_image input(opts.input_file.c_str());
+        stb_image input = load_image(opts.input_file);
 
         std::cout << "Input size: " << input.width() << "x" << input.height()
                   << " (" << input.channels() << " channels)\n";
@@ -305,7 +439,7 @@ int main(int argc, char* argv[]) {
 
         // Save output image
         std::cout << "Saving image: " << opts.output_file << "\n";
-        if (!output.save(opts.output_file.c_str(), opts.jpeg_quality)) {
+        if (!save_image(output, opts.output_file, opts.jpeg_quality)) {
             std::cerr << "Error: Failed to save output image\n";
             return 1;
         }
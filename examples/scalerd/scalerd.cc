@@ -0,0 +1,122 @@
+#include <iostream>
+#include <string>
+#include <csignal>
+#include <cstdlib>
+#include <stdexcept>
+
+#include <scaler/ipc/scaler_server.hh>
+
+using namespace scaler;
+
+/**
+ * scalerd - shared scaling service for local processes
+ *
+ * Usage: scalerd [options]
+ *
+ * Options:
+ *   -s, --socket <path>     Socket path (default: $XDG_RUNTIME_DIR/scalerd.sock)
+ *   -j, --threads <n>       Worker threads, 0 = all cores (default: 0)
+ *   -b, --batch <n>         Requests per worker batch (default: 8)
+ *   -h, --help              Show this help message
+ *
+ * Clients connect with scaler::ipc::scaler_client and exchange frames
+ * through shared memory; see include/scaler/ipc/scaler_client.hh.
+ */
+
+struct Options {
+    std::string socket_path;
+    ipc::server_options server;
+};
+
+namespace {
+    ipc::scaler_server* g_server = nullptr;
+
+    void handle_signal(int) {
+        if (g_server != nullptr) {
+            g_server->stop();
+        }
+    }
+}
+
+// Default socket location: the per-user runtime directory if there is one
+std::string default_socket_path() {
+    const char* runtime_dir = std::getenv("XDG_RUNTIME_DIR");
+    return std::string(runtime_dir != nullptr ? runtime_dir : "/tmp") + "/scalerd.sock";
+}
+
+// Print help message
+void print_help(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [options]\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  -s, --socket <path>     Socket path (default: " << default_socket_path() << ")\n";
+    std::cout << "  -j, --threads <n>       Worker threads, 0 = all cores (default: 0)\n";
+    std::cout << "  -b, --batch <n>         Requests per worker batch (default: 8)\n";
+    std::cout << "  -h, --help              Show this help message\n";
+}
+
+// Parse command-line arguments
+Options parse_arguments(int argc, char* argv[]) {
+    Options opts;
+    opts.socket_path = default_socket_path();
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            print_help(argv[0]);
+            std::exit(0);
+        } else if (arg == "-s" || arg == "--socket") {
+            if (++i >= argc) {
+                throw std::runtime_error("Missing socket path");
+            }
+            opts.socket_path = argv[i];
+        } else if (arg == "-j" || arg == "--threads") {
+            if (++i >= argc) {
+                throw std::runtime_error("Missing thread count");
+            }
+            const int threads = std::stoi(argv[i]);
+            if (threads < 0) {
+                throw std::runtime_error("Thread count must not be negative");
+            }
+            opts.server.threads = static_cast<unsigned>(threads);
+        } else if (arg == "-b" || arg == "--batch") {
+            if (++i >= argc) {
+                throw std::runtime_error("Missing batch size");
+            }
+            const int batch = std::stoi(argv[i]);
+            if (batch < 1) {
+                throw std::runtime_error("Batch size must be at least 1");
+            }
+            opts.server.max_batch = static_cast<size_t>(batch);
+        } else {
+            throw std::runtime_error("Unknown option: " + arg);
+        }
+    }
+
+    return opts;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        Options opts = parse_arguments(argc, argv);
+
+        ipc::scaler_server server(opts.socket_path, opts.server);
+        g_server = &server;
+        std::signal(SIGINT, handle_signal);
+        std::signal(SIGTERM, handle_signal);
+
+        std::cout << "scalerd listening on " << server.socket_path()
+                  << " with " << server.threads() << " worker threads\n";
+        server.run();
+        g_server = nullptr;
+
+        const auto stats = server.stats();
+        std::cout << "Served " << stats.requests << " requests from " << stats.clients_accepted
+                  << " clients in " << stats.batches << " batches (" << stats.failures << " failed)\n";
+        return 0;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        std::cerr << "Try '" << argv[0] << " --help' for usage information\n";
+        return 1;
+    }
+}
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <scaler/algorithm.hh>
+#include <scaler/auto_tuner.hh>
+#include <scaler/in_place.hh>
+#include <scaler/unified_scaler.hh>
+#include <scaler/cpu/band_parallel.hh>
+#include <scaler/io/packed_image.hh>
+#include <scaler/io/streaming_scaler.hh>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Differential testing of scaler variants against the scalar reference
+ *
+ * Every way the library can produce a scaled image other than the plain
+ * serial unified_scaler call is a variant: preallocated output, the
+ * band-parallel path, the row-streaming scaler and so on. A variant must
+ * be bit-exact with the reference for every algorithm and integral scale.
+ * New fast paths (SIMD kernels, lookup tables, region skips) register
+ * themselves in variants() and are then covered by both the libFuzzer
+ * target and the random driver.
+ */
+namespace scaler::fuzz {
+
+    using image = io::packed_image;
+    using pixel = image::pixel_type;
+
+    /**
+     * One generated input: image, algorithm, scale and the knobs variants split work by
+     */
+    struct fuzz_case {
+        algorithm algo = algorithm::Nearest;
+        int scale = 2;
+        /// Threads of the band-parallel variant
+        unsigned threads = 2;
+        /// Band height of the band-parallel and streaming variants
+        size_t band_rows = 1;
+        image input{1, 1};
+    };
+
+    /// Header bytes consumed before the palette and pixels
+    inline constexpr size_t case_header_bytes = 7;
+    inline constexpr size_t max_palette = 8;
+    inline constexpr size_t max_dimension = 40;
+
+    /**
+     * Decode a case from arbitrary bytes
+     *
+     * Layout: algorithm, scale (among the algorithm's integral scales),
+     * width, height, palette size, threads, band rows, 8 RGB palette
+     * entries, then one palette index per pixel.
+     * Pixels past the end of the data use palette entry 0, so short inputs
+     * still give whole images. Small palettes make the flat areas and
+     * equal-neighbour patterns the pixel-art scalers branch on.
+     *
+     * @return nullopt if data is shorter than header and palette
+     */
+    inline std::optional <fuzz_case> decode_case(const std::uint8_t* data, size_t size) {
+        if (size < case_header_bytes + max_palette * 3) {
+            return std::nullopt;
+        }
+
+        const auto algorithms = scaler_capabilities::get_all_algorithms();
+        fuzz_case result;
+        result.algo = algorithms[data[0] % algorithms.size()];
+        std::vector <int> scales;
+        for (int scale : {2, 3, 4}) {
+            if (scaler_capabilities::is_scale_supported(result.algo, static_cast<float>(scale))) {
+                scales.push_back(scale);
+            }
+        }
+        result.scale = scales[data[1] % scales.size()];
+
+        const size_t width = 1 + data[2] % max_dimension;
+        const size_t height = 1 + data[3] % max_dimension;
+        const size_t palette_size = 1 + data[4] % max_palette;
+        result.threads = 2 + data[5] % 3u;
+        result.band_rows = 1 + data[6] % 16u;
+
+        const std::uint8_t* palette = data + case_header_bytes;
+        const std::uint8_t* indices = palette + max_palette * 3;
+        const size_t index_count = size - case_header_bytes - max_palette * 3;
+
+        result.input = image(width, height);
+        for (size_t i = 0; i < width * height; ++i) {
+            const size_t entry = i < index_count ? indices[i] % palette_size : 0;
+            const std::uint8_t* rgb = palette + entry * 3;
+            result.input.set_pixel(i % width, i / width, {rgb[0], rgb[1], rgb[2]});
+        }
+        return result;
+    }
+
+    /**
+     * A way of scaling that must match the reference bit for bit
+     */
+    struct variant {
+        std::string name;
+        std::function <image(const fuzz_case&)> run;
+    };
+
+    namespace detail {
+
+        /**
+         * Feeds an in-memory image to scale_rows() one row at a time
+         */
+        class image_row_source {
+            public:
+                explicit image_row_source(const image& source)
+                    : source_(source) {
+                }
+
+                [[nodiscard]] size_t width() const { return source_.width(); }
+                [[nodiscard]] size_t height() const { return source_.height(); }
+
+                bool read_row(std::uint8_t* rgb) {
+                    if (next_ >= source_.height()) {
+                        return false;
+                    }
+                    std::memcpy(rgb, source_.row(next_++), source_.row_bytes());
+                    return true;
+                }
+
+            private:
+                const image& source_;
+                size_t next_ = 0;
+        };
+
+        inline image output_for(const fuzz_case& c) {
+            const auto factor = static_cast<size_t>(c.scale);
+            return image(c.input.width() * factor, c.input.height() * factor);
+        }
+
+    } // namespace detail
+
+    /**
+     * The variants under test; add new fast paths here
+     */
+    inline std::vector <variant>& variants() {
+        static std::vector <variant> registry = {
+            {"preallocated", [](const fuzz_case& c) {
+                image output = detail::output_for(c);
+                unified_scaler <image, image>::scale(c.input, output, c.algo);
+                return output;
+            }},
+            {"band-parallel", [](const fuzz_case& c) {
+                image output = detail::output_for(c);
+                scaler::detail::band_parallel_scale(
+                    c.input, output, static_cast<size_t>(c.scale), band_halo_rows(c.algo),
+                    scaler::detail::band_plan{c.threads, c.band_rows},
+                    [&c](const band_view <image>& band, image& band_output) {
+                        unified_scaler <band_view <image>, image>::scale(band, band_output, c.algo);
+                    });
+                return output;
+            }},
+            {"streaming", [](const fuzz_case& c) {
+                image output = detail::output_for(c);
+                detail::image_row_source source(c.input);
+                size_t y = 0;
+                io::scale_rows(source, c.algo, c.scale, [&](const std::uint8_t* row) {
+                    std::memcpy(output.row(y++), row, output.row_bytes());
+                }, c.band_rows);
+                return output;
+            }},
+            {"in-place", [](const fuzz_case& c) {
+                image output = detail::output_for(c);
+                for (size_t y = 0; y < c.input.height(); ++y) {
+                    std::memcpy(output.row(y), c.input.row(y), c.input.row_bytes());
+                }
+                scale_in_place(output, c.input.width(), c.input.height(), c.algo, c.band_rows);
+                return output;
+            }},
+        };
+        return registry;
+    }
+
+    /**
+     * Serial unified_scaler output, never split by the auto-tuner
+     */
+    inline image reference_scale(const fuzz_case& c) {
+        auto_tuner::instance().set_enabled(false);
+        return unified_scaler <image, image>::scale(c.input, c.algo, static_cast<float>(c.scale));
+    }
+
+    /**
+     * First difference between a variant and the reference
+     */
+    struct mismatch {
+        std::string variant;
+        std::string detail;
+    };
+
+    inline std::optional <mismatch> compare(const std::string& name, const image& expected, const image& actual) {
+        if (actual.width() != expected.width() || actual.height() != expected.height()) {
+            return mismatch{name, "size " + std::to_string(actual.width()) + "x" + std::to_string(actual.height()) +
+                                  ", expected " + std::to_string(expected.width()) + "x" +
+                                  std::to_string(expected.height())};
+        }
+        for (size_t y = 0; y < expected.height(); ++y) {
+            if (std::memcmp(actual.row(y), expected.row(y), expected.row_bytes()) == 0) {
+                continue;
+            }
+            for (size_t x = 0; x < expected.width(); ++x) {
+                const pixel a = actual.get_pixel(x, y);
+                const pixel e = expected.get_pixel(x, y);
+                if (!(a == e)) {
+                    return mismatch{name, "pixel (" + std::to_string(x) + ", " + std::to_string(y) + ") is " +
+                                          std::to_string(a.x) + "," + std::to_string(a.y) + "," +
+                                          std::to_string(a.z) + ", expected " + std::to_string(e.x) + "," +
+                                          std::to_string(e.y) + "," + std::to_string(e.z)};
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * Run every variant on one case
+     * @return the first variant that differs from the reference or throws
+     */
+    inline std::optional <mismatch> check_case(const fuzz_case& c) {
+        const image expected = reference_scale(c);
+        for (const variant& v : variants()) {
+            try {
+                if (auto failure = compare(v.name, expected, v.run(c))) {
+                    return failure;
+                }
+            } catch (const std::exception& e) {
+                return mismatch{v.name, std::string("threw: ") + e.what()};
+            }
+        }
+        return std::nullopt;
+    }
+
+    inline void describe(std::ostream& out, const fuzz_case& c, const mismatch& failure) {
+        out << "variant '" << failure.variant << "' differs from the reference for "
+            << scaler_capabilities::get_algorithm_name(c.algo) << " " << c.scale << "x on a "
+            << c.input.width() << "x" << c.input.height() << " image (threads " << c.threads
+            << ", band rows " << c.band_rows << "): " << failure.detail << "\n";
+    }
+
+} // namespace scaler::fuzz
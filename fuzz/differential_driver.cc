@@ -0,0 +1,160 @@
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "differential.hh"
+
+using namespace scaler;
+
+/**
+ * differential_driver - random differential testing without libFuzzer
+ *
+ * Usage: differential_driver [options] [case files...]
+ *
+ * Options:
+ *   -n, --iterations <n>    Random cases to run (default: 1000)
+ *   -s, --seed <n>          Random seed (default: random)
+ *   -o, --output <dir>      Where failing cases are written (default: .)
+ *   -h, --help              Show this help message
+ *
+ * Case files (e.g. written by a previous failure, or libFuzzer crash
+ * files) are replayed instead of generating random cases.
+ */
+
+struct Options {
+    unsigned long iterations = 1000;
+    std::uint64_t seed = std::random_device{}();
+    std::string output_dir = ".";
+    std::vector<std::string> files;
+};
+
+// Print help message
+void print_help(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [options] [case files...]\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  -n, --iterations <n>    Random cases to run (default: 1000)\n";
+    std::cout << "  -s, --seed <n>          Random seed (default: random)\n";
+    std::cout << "  -o, --output <dir>      Where failing cases are written (default: .)\n";
+    std::cout << "  -h, --help              Show this help message\n";
+}
+
+// Parse command-line arguments
+Options parse_arguments(int argc, char* argv[]) {
+    Options opts;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            print_help(argv[0]);
+            std::exit(0);
+        } else if (arg == "-n" || arg == "--iterations") {
+            if (++i >= argc) {
+                throw std::runtime_error("Missing iteration count");
+            }
+            opts.iterations = std::stoul(argv[i]);
+        } else if (arg == "-s" || arg == "--seed") {
+            if (++i >= argc) {
+                throw std::runtime_error("Missing seed");
+            }
+            opts.seed = std::stoull(argv[i]);
+        } else if (arg == "-o" || arg == "--output") {
+            if (++i >= argc) {
+                throw std::runtime_error("Missing output directory");
+            }
+            opts.output_dir = argv[i];
+        } else if (!arg.empty() && arg[0] == '-') {
+            throw std::runtime_error("Unknown option: " + arg);
+        } else {
+            opts.files.push_back(arg);
+        }
+    }
+
+    return opts;
+}
+
+// Case bytes shaped like pixel art: mostly runs of the same palette index
+std::vector<std::uint8_t> random_case(std::mt19937_64& rng) {
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<std::uint8_t> data(fuzz::case_header_bytes + fuzz::max_palette * 3);
+    for (auto& b : data) {
+        b = static_cast<std::uint8_t>(byte(rng));
+    }
+
+    const size_t pixels = fuzz::max_dimension * fuzz::max_dimension;
+    std::uint8_t index = 0;
+    for (size_t i = 0; i < pixels; ++i) {
+        if (byte(rng) < 64) {
+            index = static_cast<std::uint8_t>(byte(rng));
+        }
+        data.push_back(index);
+    }
+    return data;
+}
+
+// Run one case; on failure report it and keep its bytes for replay
+bool run_case(const std::vector<std::uint8_t>& data, const std::string& failure_path) {
+    const auto fuzz_case = fuzz::decode_case(data.data(), data.size());
+    if (!fuzz_case) {
+        return true;
+    }
+    const auto failure = fuzz::check_case(*fuzz_case);
+    if (!failure) {
+        return true;
+    }
+
+    fuzz::describe(std::cerr, *fuzz_case, *failure);
+    if (!failure_path.empty()) {
+        std::ofstream out(failure_path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        std::cerr << "case written to " << failure_path << "\n";
+    }
+    return false;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        Options opts = parse_arguments(argc, argv);
+        unsigned long failures = 0;
+
+        if (!opts.files.empty()) {
+            for (const auto& file : opts.files) {
+                std::ifstream in(file, std::ios::binary);
+                if (!in) {
+                    throw std::runtime_error("Cannot open " + file);
+                }
+                const std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(in)),
+                                                     std::istreambuf_iterator<char>());
+                if (!run_case(data, "")) {
+                    ++failures;
+                }
+            }
+            std::cout << opts.files.size() << " cases replayed, " << failures << " failed\n";
+            return failures == 0 ? 0 : 1;
+        }
+
+        std::cout << "Checking " << fuzz::variants().size() << " variants, seed " << opts.seed << "\n";
+        std::mt19937_64 rng(opts.seed);
+        for (unsigned long i = 0; i < opts.iterations; ++i) {
+            const auto data = random_case(rng);
+            const std::string path = opts.output_dir + "/differential-" + std::to_string(opts.seed) +
+                                     "-" + std::to_string(i) + ".bin";
+            if (!run_case(data, path)) {
+                ++failures;
+            }
+        }
+
+        std::cout << opts.iterations << " cases, " << failures << " failed\n";
+        return failures == 0 ? 0 : 1;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        std::cerr << "Try '" << argv[0] << " --help' for usage information\n";
+        return 1;
+    }
+}
@@ -0,0 +1,23 @@
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+#include "differential.hh"
+
+/**
+ * libFuzzer target: every registered variant must match the reference
+ *
+ * Build with clang and -fsanitize=fuzzer (SCALER_BUILD_FUZZERS=ON does
+ * this), then run e.g. ./fuzz_differential -max_len=2048 corpus/
+ */
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, size_t size) {
+    const auto fuzz_case = scaler::fuzz::decode_case(data, size);
+    if (!fuzz_case) {
+        return 0;
+    }
+    if (const auto failure = scaler::fuzz::check_case(*fuzz_case)) {
+        scaler::fuzz::describe(std::cerr, *fuzz_case, *failure);
+        std::abort();
+    }
+    return 0;
+}
@@ -0,0 +1,706 @@
+/**
+ * @file auto_tuner.hh
+ * @brief Per-machine tuning of band-parallel CPU scaling
+ *
+ * unified_scaler::scale() can split integral scales into horizontal bands
+ * scaled on several threads (see cpu/band_parallel.hh). Whether that pays
+ * off, and with how many threads and how tall the bands should be, depends
+ * on the core count and cache sizes of the machine, so the choice is
+ * measured rather than guessed: the auto-tuner microbenchmarks candidate
+ * configurations per algorithm, scale and image size class and keeps the
+ * winners in a small profile file keyed by CPU model.
+ *
+ * The tuner publishes this CPU's results as an immutable table that
+ * unified_scaler reads with one atomic load per integral scale; without an
+ * entry for the call, it scales serially as before. The first integral
+ * scale of the process creates the tuner and reads the profile, unless the
+ * application has already set one up through load(), set_profile_path()
+ * or tune(). Tuning runs either explicitly (tune(), retune()) or, when
+ * auto-tuning is switched on, the first time a configuration is used.
+ *
+ * The profile lives at $SCALER_TUNING_PROFILE if set, otherwise at
+ * $XDG_CACHE_HOME/scaler/tuning.profile (~/.cache/scaler/tuning.profile).
+ * SCALER_AUTOTUNE is read when the tuner is created: 1 enables tuning on
+ * first use and 0 makes unified_scaler ignore the profile entirely.
+ *
+ * @example
+ * @code
+ * // Results tuned on earlier runs are picked up by the first scale; to
+ * // read them up front instead
+ * auto& tuner = scaler::auto_tuner::instance();
+ * tuner.load();
+ *
+ * // Tune the configurations an application uses, once per machine
+ * tuner.tune(scaler::algorithm::HQ, 3, scaler::size_class::medium);
+ *
+ * // Ship a profile to identical hosts
+ * std::ofstream out("fleet.profile");
+ * tuner.export_profile(out);
+ * @endcode
+ */
+#pragma once
+
+#include <scaler/algorithm.hh>
+#include <scaler/unified_scaler.hh>
+#include <scaler/image.hh>
+#include <scaler/cpu/band_parallel.hh>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
+
+namespace scaler {
+
+    inline const char* size_class_name(size_class size) {
+        switch (size) {
+            case size_class::small:
+                return "small";
+            case size_class::medium:
+                return "medium";
+            case size_class::large:
+                return "large";
+        }
+        return "large";
+    }
+
+    /**
+     * What a tuning result applies to
+     */
+    struct tuning_key {
+        algorithm algo = algorithm::Nearest;
+        int scale = 2;
+        size_class size = size_class::small;
+
+        bool operator<(const tuning_key& other) const {
+            return std::tie(algo, scale, size) < std::tie(other.algo, other.scale, other.size);
+        }
+
+        bool operator==(const tuning_key& other) const {
+            return algo == other.algo && scale == other.scale && size == other.size;
+        }
+    };
+
+    /**
+     * The winning configuration for a tuning_key
+     */
+    struct tuned_config {
+        /// Threads including the caller; 1 = serial
+        unsigned threads = 1;
+        /// Input rows per band when threads > 1
+        size_t band_rows = 0;
+        /// Measured throughput in output megapixels per second
+        double mpixels_per_second = 0.0;
+    };
+
+    /**
+     * Human-readable CPU model and hardware thread count; profiles are keyed by it
+     */
+    inline std::string current_cpu_model() {
+        std::string model;
+#if defined(__linux__)
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        std::string line;
+        while (model.empty() && std::getline(cpuinfo, line)) {
+            if (line.compare(0, 10, "model name") == 0 || line.compare(0, 9, "Processor") == 0) {
+                const auto colon = line.find(':');
+                if (colon != std::string::npos) {
+                    model = line.substr(line.find_first_not_of(" \t", colon + 1));
+                }
+            }
+        }
+#elif defined(__APPLE__)
+        char brand[256] = {};
+        size_t size = sizeof(brand);
+        if (sysctlbyname("machdep.cpu.brand_string", brand, &size, nullptr, 0) == 0) {
+            model = brand;
+        }
+#endif
+        if (model.empty()) {
+            model = "unknown cpu";
+        }
+        return model + " x" + std::to_string(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    /**
+     * Tuning results for any number of CPU models
+     *
+     * The file format is one tab-separated line per entry:
+     * cpu model, algorithm name, scale, size class, threads, band rows and
+     * measured throughput. Lines starting with '#' are comments.
+     */
+    class tuning_profile {
+        public:
+            [[nodiscard]] const tuned_config* find(const std::string& cpu, const tuning_key& key) const {
+                const auto it = entries_.find({cpu, key});
+                return it != entries_.end() ? &it->second : nullptr;
+            }
+
+            void set(const std::string& cpu, const tuning_key& key, const tuned_config& config) {
+                entries_[{cpu, key}] = config;
+            }
+
+            /**
+             * Keys tuned for one CPU model
+             */
+            [[nodiscard]] std::vector <tuning_key> keys(const std::string& cpu) const {
+                std::vector <tuning_key> result;
+                for (const auto& [id, config] : entries_) {
+                    if (id.first == cpu) {
+                        result.push_back(id.second);
+                    }
+                }
+                return result;
+            }
+
+            /**
+             * Take over all entries of other, replacing ours for the same keys
+             */
+            void merge(const tuning_profile& other) {
+                for (const auto& [id, config] : other.entries_) {
+                    entries_[id] = config;
+                }
+            }
+
+            /**
+             * Drop all entries of one CPU model
+             */
+            void erase(const std::string& cpu) {
+                for (auto it = entries_.begin(); it != entries_.end();) {
+                    it = it->first.first == cpu ? entries_.erase(it) : std::next(it);
+                }
+            }
+
+            [[nodiscard]] size_t size() const { return entries_.size(); }
+            [[nodiscard]] bool empty() const { return entries_.empty(); }
+            void clear() { entries_.clear(); }
+
+            /**
+             * Add the entries of a profile file
+             * @throws std::invalid_argument for a malformed line
+             */
+            void read(std::istream& in) {
+                std::string line;
+                size_t line_number = 0;
+                while (std::getline(in, line)) {
+                    ++line_number;
+                    if (line.empty() || line[0] == '#') {
+                        continue;
+                    }
+
+                    std::vector <std::string> fields;
+                    std::istringstream stream(line);
+                    for (std::string field; std::getline(stream, field, '\t');) {
+                        fields.push_back(field);
+                    }
+
+                    tuning_key key;
+                    tuned_config config;
+                    if (fields.size() != 7 || !parse_algorithm(fields[1], key.algo) ||
+                        !parse_size_class(fields[3], key.size) ||
+                        !parse_number(fields[2], key.scale) || !parse_number(fields[4], config.threads) ||
+                        !parse_number(fields[5], config.band_rows) ||
+                        !parse_number(fields[6], config.mpixels_per_second) ||
+                        key.scale < 1 || config.threads < 1) {
+                        throw std::invalid_argument("tuning profile line " + std::to_string(line_number) +
+                                                    " is malformed: " + line);
+                    }
+                    set(fields[0], key, config);
+                }
+            }
+
+            void write(std::ostream& out) const {
+                out << "# scaler tuning profile\n";
+                out << "# cpu\talgorithm\tscale\tsize\tthreads\tband_rows\tmpixels_per_second\n";
+                for (const auto& [id, config] : entries_) {
+                    out << id.first << '\t'
+                        << scaler_capabilities::get_algorithm_name(id.second.algo) << '\t'
+                        << id.second.scale << '\t'
+                        << size_class_name(id.second.size) << '\t'
+                        << config.threads << '\t'
+                        << config.band_rows << '\t'
+                        << config.mpixels_per_second << '\n';
+                }
+            }
+
+        private:
+            static bool parse_algorithm(const std::string& name, algorithm& algo) {
+                for (algorithm candidate : scaler_capabilities::get_all_algorithms()) {
+                    if (scaler_capabilities::get_algorithm_name(candidate) == name) {
+                        algo = candidate;
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            static bool parse_size_class(const std::string& name, size_class& size) {
+                for (size_class candidate : {size_class::small, size_class::medium, size_class::large}) {
+                    if (name == size_class_name(candidate)) {
+                        size = candidate;
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            template<typename T>
+            static bool parse_number(const std::string& text, T& value) {
+                std::istringstream stream(text);
+                stream >> value;
+                return !stream.fail() && stream.eof();
+            }
+
+            std::map <std::pair <std::string, tuning_key>, tuned_config> entries_;
+    };
+
+    namespace detail {
+
+        /**
+         * RGB image the benchmarks scale
+         */
+        using tuning_image = image <vec3 <std::uint8_t>>;
+
+        /**
+         * Representative input for a size class: flat areas, edges and
+         * dithering like pixel art, so the pattern-matching scalers take
+         * their typical branches
+         */
+        inline tuning_image make_tuning_image(size_class size) {
+            size_t width = 256;
+            size_t height = 224;
+            if (size == size_class::medium) {
+                width = 640;
+                height = 480;
+            } else if (size == size_class::large) {
+                width = 1280;
+                height = 960;
+            }
+            // Only a strip is timed; throughput per row does not depend on the height
+            height = std::min <size_t>(height, 192);
+
+            tuning_image image(width, height);
+            for (size_t y = 0; y < height; ++y) {
+                for (size_t x = 0; x < width; ++x) {
+                    const size_t tile = (x / 8 + y / 8) % 4;
+                    const auto shade = static_cast<std::uint8_t>(tile * 64 + ((x ^ y) & 1) * 24);
+                    image.set_pixel(x, y, {shade, static_cast<std::uint8_t>(x / 4 * 16),
+                                           static_cast<std::uint8_t>(y / 6 * 32)});
+                }
+            }
+            return image;
+        }
+
+        inline std::string default_tuning_profile_path() {
+            if (const char* path = std::getenv("SCALER_TUNING_PROFILE"); path != nullptr && *path != '\0') {
+                return path;
+            }
+#if defined(_WIN32)
+            const char* cache = std::getenv("LOCALAPPDATA");
+            return std::string(cache != nullptr ? cache : ".") + "\\scaler\\tuning.profile";
+#else
+            if (const char* cache = std::getenv("XDG_CACHE_HOME"); cache != nullptr && *cache != '\0') {
+                return std::string(cache) + "/scaler/tuning.profile";
+            }
+            const char* home = std::getenv("HOME");
+            return std::string(home != nullptr ? home : ".") + "/.cache/scaler/tuning.profile";
+#endif
+        }
+
+    } // namespace detail
+
+    /**
+     * Process-wide tuner and profile, published to unified_scaler
+     *
+     * All members are thread-safe.
+     */
+    class auto_tuner {
+        public:
+            static auto_tuner& instance() {
+                static auto_tuner tuner;
+                return tuner;
+            }
+
+            auto_tuner(const auto_tuner&) = delete;
+            auto_tuner& operator=(const auto_tuner&) = delete;
+
+            ~auto_tuner() {
+                detail::published_band_plans.store(nullptr, std::memory_order_release);
+            }
+
+            /**
+             * Whether unified_scaler consults the profile at all (default: on)
+             */
+            void set_enabled(bool enabled) {
+                std::lock_guard <std::mutex> lock(mutex_);
+                enabled_ = enabled;
+                publish();
+            }
+
+            [[nodiscard]] bool enabled() const { return enabled_; }
+
+            /**
+             * Whether a configuration without an entry is tuned the first time
+             * unified_scaler meets it (default: off, as tuning takes up to a
+             * second per configuration)
+             */
+            void set_auto_tune(bool auto_tune) {
+                std::lock_guard <std::mutex> lock(mutex_);
+                auto_tune_ = auto_tune;
+                publish();
+            }
+
+            [[nodiscard]] bool auto_tune() const { return auto_tune_; }
+
+            [[nodiscard]] const std::string& cpu_model() const { return cpu_model_; }
+
+            [[nodiscard]] std::string profile_path() const {
+                std::lock_guard <std::mutex> lock(mutex_);
+                return path_;
+            }
+
+            /**
+             * Switch to another profile file, replacing the tuning results in
+             * memory with its contents (none if it does not exist yet)
+             * @throws std::invalid_argument if the file is malformed
+             */
+            void set_profile_path(const std::string& path) {
+                tuning_profile loaded;
+                std::ifstream in(path);
+                if (in) {
+                    loaded.read(in);
+                }
+                std::lock_guard <std::mutex> lock(mutex_);
+                path_ = path;
+                profile_ = std::move(loaded);
+                loaded_ = true;
+                publish();
+            }
+
+            /**
+             * Read the profile at profile_path() and publish this CPU's
+             * results to unified_scaler
+             * @return false if there is no profile yet or it is damaged (a
+             *         damaged cache only costs a re-tune)
+             */
+            bool load() {
+                std::lock_guard <std::mutex> lock(mutex_);
+                return load_locked();
+            }
+
+            /**
+             * Tuning result for the current CPU, if there is one
+             */
+            [[nodiscard]] std::optional <tuned_config> lookup(const tuning_key& key) const {
+                std::lock_guard <std::mutex> lock(mutex_);
+                if (const tuned_config* config = profile_.find(cpu_model_, key)) {
+                    return *config;
+                }
+                return std::nullopt;
+            }
+
+            /**
+             * Benchmark the candidate configurations for key now, record the
+             * fastest and save the profile
+             *
+             * Candidates are serial scaling and every power-of-two thread
+             * count up to the hardware thread count, each with several band
+             * heights.
+             *
+             * @throws unsupported_scale_exception if algo does not support the scale
+             */
+            tuned_config tune(algorithm algo, int scale, size_class size) {
+                if (scale < 1 || !scaler_capabilities::is_scale_supported(algo, static_cast<float>(scale))) {
+                    throw unsupported_scale_exception(algo, static_cast<float>(scale),
+                                                      scaler_capabilities::get_supported_scales(algo));
+                }
+
+                std::lock_guard <std::mutex> tuning(tune_mutex_);
+                const tuned_config best = benchmark(algo, scale, size);
+                {
+                    std::lock_guard <std::mutex> lock(mutex_);
+                    // Saving must not drop results tuned on earlier runs
+                    if (!loaded_) {
+                        load_locked();
+                    }
+                    profile_.set(cpu_model_, {algo, scale, size}, best);
+                    publish();
+                }
+                save();
+                return best;
+            }
+
+            /**
+             * Benchmark every configuration tuned for this CPU again, e.g.
+             * after a BIOS, kernel or library update
+             */
+            void retune() {
+                std::vector <tuning_key> keys;
+                {
+                    std::lock_guard <std::mutex> lock(mutex_);
+                    keys = profile_.keys(cpu_model_);
+                }
+                for (const tuning_key& key : keys) {
+                    tune(key.algo, key.scale, key.size);
+                }
+            }
+
+            /**
+             * Forget all tuning results for this CPU
+             */
+            void reset() {
+                {
+                    std::lock_guard <std::mutex> lock(mutex_);
+                    profile_.erase(cpu_model_);
+                    publish();
+                }
+                save();
+            }
+
+            /**
+             * Write the whole profile, all CPU models included
+             */
+            void export_profile(std::ostream& out) const {
+                std::lock_guard <std::mutex> lock(mutex_);
+                profile_.write(out);
+            }
+
+            /**
+             * Merge a profile, e.g. one tuned on an identical host, and save
+             * @throws std::invalid_argument if it is malformed
+             */
+            void import_profile(std::istream& in) {
+                tuning_profile imported;
+                imported.read(in);
+                {
+                    std::lock_guard <std::mutex> lock(mutex_);
+                    profile_.merge(imported);
+                    publish();
+                }
+                save();
+            }
+
+            [[nodiscard]] tuning_profile profile() const {
+                std::lock_guard <std::mutex> lock(mutex_);
+                return profile_;
+            }
+
+            /**
+             * Write the profile to profile_path()
+             * @return false if the file cannot be written
+             */
+            bool save() const {
+                std::lock_guard <std::mutex> lock(mutex_);
+                std::error_code error;
+                const std::filesystem::path path(path_);
+                if (path.has_parent_path()) {
+                    std::filesystem::create_directories(path.parent_path(), error);
+                }
+
+                // Write a sibling file and rename, so concurrent readers never see half a profile
+                const std::string temporary = path_ + ".tmp";
+                {
+                    std::ofstream out(temporary, std::ios::trunc);
+                    if (!out) {
+                        return false;
+                    }
+                    profile_.write(out);
+                    if (!out) {
+                        return false;
+                    }
+                }
+                std::filesystem::rename(temporary, path, error);
+                return !error;
+            }
+
+            /**
+             * Band split unified_scaler uses for one call
+             */
+            [[nodiscard]] detail::band_plan plan(algorithm algo, float scale_factor, size_t width, size_t height) const {
+                return detail::tuned_band_plan(algo, scale_factor, width, height);
+            }
+
+        private:
+            auto_tuner()
+                : cpu_model_(current_cpu_model()),
+                  path_(detail::default_tuning_profile_path()) {
+                if (const char* mode = std::getenv("SCALER_AUTOTUNE"); mode != nullptr) {
+                    enabled_ = std::string(mode) != "0";
+                    auto_tune_ = std::string(mode) == "1";
+                }
+                publish();
+            }
+
+            // Called with mutex_ held
+            bool load_locked() {
+                loaded_ = true;
+                std::ifstream in(path_);
+                if (!in) {
+                    return false;
+                }
+                tuning_profile loaded;
+                try {
+                    loaded.read(in);
+                } catch (const std::invalid_argument&) {
+                    return false;
+                }
+                profile_ = std::move(loaded);
+                publish();
+                return true;
+            }
+
+            /**
+             * Replace the table unified_scaler reads with this CPU's results
+             *
+             * Called with mutex_ held. Superseded tables stay alive, as a
+             * scale on another thread may still be reading one; each is a
+             * few entries and only tuning or loading adds one.
+             */
+            void publish() {
+                auto table = std::make_unique <detail::band_plan_table>();
+                if (enabled_) {
+                    for (const tuning_key& key : profile_.keys(cpu_model_)) {
+                        const tuned_config* config = profile_.find(cpu_model_, key);
+                        table->entries.push_back({key.algo, key.scale, key.size,
+                                                  {config->threads, config->band_rows}});
+                    }
+                    if (auto_tune_) {
+                        table->on_miss = &tune_on_first_use;
+                    }
+                }
+                detail::published_band_plans.store(table.get(), std::memory_order_release);
+                published_.push_back(std::move(table));
+            }
+
+            // First integral scale of the process; keeps a profile the
+            // application set up before it
+            static void load_on_first_scale() {
+                auto_tuner& tuner = instance();
+                std::lock_guard <std::mutex> lock(tuner.mutex_);
+                if (!tuner.loaded_) {
+                    tuner.load_locked();
+                }
+            }
+
+            static detail::band_plan tune_on_first_use(algorithm algo, int scale, size_class size) {
+                auto_tuner& tuner = instance();
+                std::lock_guard <std::mutex> tuning(tuner.first_use_mutex_);
+                {
+                    std::lock_guard <std::mutex> lock(tuner.mutex_);
+                    if (!tuner.loaded_) {
+                        tuner.load_locked();
+                    }
+                }
+                std::optional <tuned_config> config = tuner.lookup({algo, scale, size});
+                if (!config) {
+                    config = tuner.tune(algo, scale, size);
+                }
+                return {config->threads, config->band_rows};
+            }
+
+            static double seconds_since(std::chrono::steady_clock::time_point start) {
+                return std::chrono::duration <double>(std::chrono::steady_clock::now() - start).count();
+            }
+
+            /// Timed runs per candidate, after one untimed warm-up run
+            static constexpr size_t timed_runs = 3;
+
+            // Median time of run(); every candidate is measured the same way
+            template<typename Run>
+            static double median_seconds(Run&& run) {
+                run();
+                std::array <double, timed_runs> times{};
+                for (double& time : times) {
+                    const auto start = std::chrono::steady_clock::now();
+                    run();
+                    time = seconds_since(start);
+                }
+                std::sort(times.begin(), times.end());
+                return times[timed_runs / 2];
+            }
+
+            static tuned_config benchmark(algorithm algo, int scale, size_class size) {
+                using image = detail::tuning_image;
+                using view = band_view <image>;
+                using whole_scaler = unified_scaler <view, image>;
+
+                const image input = detail::make_tuning_image(size);
+                const size_t factor = static_cast<size_t>(scale);
+                const size_t out_width = input.width() * factor;
+                const size_t out_height = input.height() * factor;
+                const double mpixels = static_cast<double>(out_width * out_height) / 1e6;
+                image output(out_width, out_height);
+
+                const view whole(input, 0, input.height());
+                const double serial = median_seconds([&] { whole_scaler::scale(whole, output, algo); });
+
+                tuned_config best;
+                double best_seconds = serial;
+                const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+                std::vector <unsigned> thread_counts;
+                for (unsigned threads = 2; threads < hardware; threads *= 2) {
+                    thread_counts.push_back(threads);
+                }
+                if (hardware > 1) {
+                    thread_counts.push_back(hardware);
+                }
+
+                for (unsigned threads : thread_counts) {
+                    for (size_t band_rows : {size_t{16}, size_t{32}, size_t{64}}) {
+                        const detail::band_plan candidate{threads, band_rows};
+                        const double elapsed = median_seconds([&] {
+                            detail::band_parallel_scale(input, output, factor, band_halo_rows(algo), candidate,
+                                                        [algo](const view& band, image& band_output) {
+                                                            whole_scaler::scale(band, band_output, algo);
+                                                        });
+                        });
+                        if (elapsed < best_seconds) {
+                            best_seconds = elapsed;
+                            best.threads = threads;
+                            best.band_rows = band_rows;
+                        }
+                    }
+                }
+
+                best.mpixels_per_second = best_seconds > 0.0 ? mpixels / best_seconds : 0.0;
+                return best;
+            }
+
+            const std::string cpu_model_;
+            std::atomic <bool> enabled_{true};
+            std::atomic <bool> auto_tune_{false};
+            mutable std::mutex mutex_;
+            std::mutex tune_mutex_;
+            std::mutex first_use_mutex_;
+            std::string path_;
+            tuning_profile profile_;
+            bool loaded_ = false;
+            std::vector <std::unique_ptr <const detail::band_plan_table>> published_;
+
+            // Hooks load_on_first_scale() into unified_scaler during static
+            // initialization, without creating the tuner
+            static inline const bool registered_ = (detail::band_plan_loader = &load_on_first_scale, true);
+    };
+
+} // namespace scaler
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <scaler/algorithm.hh>
+#include <scaler/image_base.hh>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace scaler {
+
+    /**
+     * Input rows above and below a band that an algorithm reads to produce
+     * the band's output rows exactly as a whole-image scale would
+     *
+     * Multi-pass variants (Scale 4x, AAScale 4x, xBR 3x/4x) are included, with
+     * one row of margin over the measured reach.
+     */
+    inline size_t band_halo_rows(algorithm algo) {
+        switch (algo) {
+            case algorithm::Nearest:
+                return 1;
+            case algorithm::Bilinear:
+            case algorithm::Trilinear:
+            case algorithm::EPX:
+            case algorithm::Eagle:
+            case algorithm::Scale:
+            case algorithm::AAScale:
+                return 2;
+            case algorithm::ScaleSFX:
+            case algorithm::Super2xSaI:
+            case algorithm::HQ:
+            case algorithm::OmniScale:
+                return 3;
+            case algorithm::xBR:
+                return 4;
+        }
+        return 4;
+    }
+
+    /**
+     * Rows [top, top + rows) of another input image, seen as an image of its own
+     */
+    template<typename InputImage>
+    class band_view : public input_image_base <band_view <InputImage>,
+                                               std::decay_t <decltype(std::declval <const InputImage&>().get_pixel(0, 0))>> {
+        public:
+            using pixel_type = std::decay_t <decltype(std::declval <const InputImage&>().get_pixel(0, 0))>;
+
+            band_view(const InputImage& image, size_t top, size_t rows)
+                : image_(image), top_(top), rows_(rows) {
+            }
+
+            [[nodiscard]] size_t width_impl() const { return image_.width(); }
+            [[nodiscard]] size_t height_impl() const { return rows_; }
+
+            [[nodiscard]] pixel_type get_pixel_impl(size_t x, size_t y) const {
+                return image_.get_pixel(x, y + top_);
+            }
+
+            [[nodiscard]] size_t top() const { return top_; }
+
+        private:
+            const InputImage& image_;
+            size_t top_;
+            size_t rows_;
+    };
+
+    /**
+     * Input image sizes that are tuned separately
+     *
+     * small: up to 256x256 (emulator frames), medium: up to 1024x1024,
+     * large: anything bigger.
+     */
+    enum class size_class {
+        small,
+        medium,
+        large
+    };
+
+    inline size_class classify_size(size_t width, size_t height) {
+        const size_t pixels = width * height;
+        if (pixels <= size_t{256} * 256) {
+            return size_class::small;
+        }
+        if (pixels <= size_t{1024} * 1024) {
+            return size_class::medium;
+        }
+        return size_class::large;
+    }
+
+    namespace detail {
+
+        /**
+         * How an integral scale is split across threads
+         */
+        struct band_plan {
+            /// Threads including the caller; 1 means scale the whole image serially
+            unsigned threads = 1;
+            /// Input rows per band
+            size_t band_rows = 0;
+        };
+
+        /**
+         * Band plans the auto-tuner published for this CPU
+         *
+         * A table is never modified once published. The tuner swaps in a new
+         * one and keeps the old ones alive, so readers need no lock.
+         */
+        struct band_plan_table {
+            struct entry {
+                algorithm algo;
+                int scale;
+                size_class size;
+                band_plan plan;
+            };
+
+            std::vector <entry> entries;
+            /// Plan for a configuration without an entry (tuning on first use), or null
+            band_plan (*on_miss)(algorithm algo, int scale, size_class size) = nullptr;
+
+            [[nodiscard]] const band_plan* find(algorithm algo, int scale, size_class size) const {
+                for (const entry& candidate : entries) {
+                    if (candidate.algo == algo && candidate.scale == scale && candidate.size == size) {
+                        return &candidate.plan;
+                    }
+                }
+                return nullptr;
+            }
+        };
+
+        inline std::atomic <const band_plan_table*> published_band_plans{nullptr};
+
+        /// Set by auto_tuner.hh: reads the profile and publishes the first table
+        inline void (*band_plan_loader)() = nullptr;
+
+        // Nothing published yet: let the auto-tuner load its profile, once per process
+        inline const band_plan_table* load_band_plans() {
+            static std::once_flag once;
+            if (band_plan_loader != nullptr) {
+                std::call_once(once, band_plan_loader);
+            }
+            return published_band_plans.load(std::memory_order_acquire);
+        }
+
+        /**
+         * Thread and band split for one scale call, as last published by the
+         * auto-tuner; a single thread when the call should run serially.
+         * Costs one atomic load unless tuning on first use is switched on;
+         * the first call of the process also loads the tuning profile.
+         */
+        inline band_plan tuned_band_plan(algorithm algo, float scale_factor, size_t width, size_t height) {
+            const band_plan_table* table = published_band_plans.load(std::memory_order_acquire);
+            if (table == nullptr) {
+                table = load_band_plans();
+            }
+            const auto scale = static_cast<int>(scale_factor);
+            if (table == nullptr || scale < 1 || static_cast<float>(scale) != scale_factor || height < 2) {
+                return {};
+            }
+
+            const size_class size = classify_size(width, height);
+            band_plan plan;
+            if (const band_plan* found = table->find(algo, scale, size)) {
+                plan = *found;
+            } else if (table->on_miss != nullptr) {
+                plan = table->on_miss(algo, scale, size);
+            }
+            if (plan.threads < 2 || plan.band_rows >= height) {
+                return {};
+            }
+            return plan;
+        }
+
+        template<typename T>
+        struct is_band_view : std::false_type {};
+
+        template<typename InputImage>
+        struct is_band_view <band_view <InputImage>> : std::true_type {};
+
+        template<typename OutputImage, typename = void>
+        struct has_readable_pixels : std::false_type {};
+
+        template<typename OutputImage>
+        struct has_readable_pixels <OutputImage,
+                                    std::void_t <decltype(std::declval <const OutputImage&>().get_pixel(0, 0))>>
+            : std::true_type {};
+
+        template<typename OutputImage, typename = void>
+        struct has_invalidate_border : std::false_type {};
+
+        template<typename OutputImage>
+        struct has_invalidate_border <OutputImage,
+                                      std::void_t <decltype(std::declval <OutputImage&>().invalidate_border())>>
+            : std::true_type {};
+
+        /**
+         * Band-parallel scaling needs a scratch OutputImage per band that can
+         * be read back. Band views themselves are never split again.
+         */
+        template<typename InputImage, typename OutputImage>
+        struct supports_band_parallel
+            : std::bool_constant <!is_band_view <InputImage>::value &&
+                                  has_readable_pixels <OutputImage>::value &&
+                                  std::is_constructible_v <OutputImage, size_t, size_t,
+                                                           const band_view <InputImage>&>> {};
+
+        /**
+         * Scale input into output band by band on plan.threads threads
+         *
+         * Each band is scaled together with halo context rows on either side
+         * into its own scratch image, so the result is identical to scaling
+         * the whole image; only the band's own output rows are copied out.
+         * Bands write disjoint output rows, so output needs no locking.
+         *
+         * @param scale_band Callable (const band_view<InputImage>&, OutputImage&)
+         *                   that scales a band into a scratch image of the
+         *                   band's size times factor
+         */
+        template<typename InputImage, typename OutputImage, typename ScaleBand>
+        void band_parallel_scale(const InputImage& input, OutputImage& output, size_t factor, size_t halo,
+                                 const band_plan& plan, ScaleBand&& scale_band) {
+            const size_t width = input.width();
+            const size_t height = input.height();
+            const size_t band_rows = std::max <size_t>(plan.band_rows, 1);
+            const size_t band_count = (height + band_rows - 1) / band_rows;
+            const auto threads = static_cast<unsigned>(std::min <size_t>(std::max(plan.threads, 1u), band_count));
+
+            // Outputs that track derived state (image's border) drop it here,
+            // once, rather than from every worker's first write
+            if constexpr (has_invalidate_border <OutputImage>::value) {
+                output.invalidate_border();
+            }
+
+            std::atomic <size_t> next_band{0};
+            std::exception_ptr failure;
+            std::mutex failure_mutex;
+
+            auto worker = [&] {
+                try {
+                    for (size_t band = next_band++; band < band_count; band = next_band++) {
+                        const size_t first = band * band_rows;
+                        const size_t last = std::min(height, first + band_rows);
+                        const size_t top = first > halo ? first - halo : 0;
+                        const size_t bottom = std::min(height, last + halo);
+
+                        const band_view <InputImage> view(input, top, bottom - top);
+                        OutputImage scaled(width * factor, (bottom - top) * factor, view);
+                        scale_band(view, scaled);
+
+                        for (size_t y = first * factor; y < last * factor; ++y) {
+                            const size_t band_y = y - top * factor;
+                            for (size_t x = 0; x < width * factor; ++x) {
+                                output.set_pixel(x, y, scaled.get_pixel(x, band_y));
+                            }
+                        }
+                    }
+                } catch (...) {
+                    std::lock_guard <std::mutex> lock(failure_mutex);
+                    if (!failure) {
+                        failure = std::current_exception();
+                    }
+                    next_band = band_count;
+                }
+            };
+
+            std::vector <std::thread> helpers;
+            helpers.reserve(threads - 1);
+            for (unsigned i = 1; i < threads; ++i) {
+                helpers.emplace_back(worker);
+            }
+            worker();
+            for (auto& helper : helpers) {
+                helper.join();
+            }
+
+            if (failure) {
+                std::rethrow_exception(failure);
+            }
+        }
+
+    } // namespace detail
+
+} // namespace scaler
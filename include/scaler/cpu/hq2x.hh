@@ -121,6 +121,175 @@ namespace scaler {
                    (w5_diff << 4) | (w6_diff << 5) | (w7_diff << 6) | (w8_diff << 7));
         }
 
+        /**
+         * The 2x2 output of HQ2x for the 3x3 neighbourhood w (w[4] is the
+         * centre), given its centre-to-neighbour differences
+         */
+        template<typename T>
+        void hq2x_blend(const std::array <T, 9>& w, uint8_t diffs, T& dst00, T& dst01, T& dst10, T& dst11) {
+            // Compute conditions corresponding to each set of 2x2 interpolation rules
+            const bool cond00 = (pattern_match(diffs, 0xbf, 0x37) || pattern_match(diffs, 0xdb, 0x13)) &&
+                                yuv_difference(w[1], w[5]);
+            const bool cond01 = (pattern_match(diffs, 0xdb, 0x49) || pattern_match(diffs, 0xef, 0x6d)) &&
+                                yuv_difference(w[7], w[3]);
+            const bool cond02 = (pattern_match(diffs, 0x6f, 0x2a) || pattern_match(diffs, 0x5b, 0x0a) ||
+                                 pattern_match(diffs, 0xbf, 0x3a) ||
+                                 pattern_match(diffs, 0xdf, 0x5a) || pattern_match(diffs, 0x9f, 0x8a) ||
+                                 pattern_match(diffs, 0xcf, 0x8a) ||
+                                 pattern_match(diffs, 0xef, 0x4e) || pattern_match(diffs, 0x3f, 0x0e) ||
+                                 pattern_match(diffs, 0xfb, 0x5a) ||
+                                 pattern_match(diffs, 0xbb, 0x8a) || pattern_match(diffs, 0x7f, 0x5a) ||
+                                 pattern_match(diffs, 0xaf, 0x8a) ||
+                                 pattern_match(diffs, 0xeb, 0x8a)) && yuv_difference(w[3], w[1]);
+            const bool cond03 = pattern_match(diffs, 0xdb, 0x49) || pattern_match(diffs, 0xef, 0x6d);
+            const bool cond04 = pattern_match(diffs, 0xbf, 0x37) || pattern_match(diffs, 0xdb, 0x13);
+            const bool cond05 = pattern_match(diffs, 0x1b, 0x03) || pattern_match(diffs, 0x4f, 0x43) ||
+                                pattern_match(diffs, 0x8b, 0x83) || pattern_match(diffs, 0x6b, 0x43);
+            const bool cond06 = pattern_match(diffs, 0x4b, 0x09) || pattern_match(diffs, 0x8b, 0x89) ||
+                                pattern_match(diffs, 0x1f, 0x19) || pattern_match(diffs, 0x3b, 0x19);
+            const bool cond07 = pattern_match(diffs, 0x0b, 0x08) || pattern_match(diffs, 0xf9, 0x68) ||
+                                pattern_match(diffs, 0xf3, 0x62) ||
+                                pattern_match(diffs, 0x6d, 0x6c) || pattern_match(diffs, 0x67, 0x66) ||
+                                pattern_match(diffs, 0x3d, 0x3c) ||
+                                pattern_match(diffs, 0x37, 0x36) || pattern_match(diffs, 0xf9, 0xf8) ||
+                                pattern_match(diffs, 0xdd, 0xdc) ||
+                                pattern_match(diffs, 0xf3, 0xf2) || pattern_match(diffs, 0xd7, 0xd6) ||
+                                pattern_match(diffs, 0xdd, 0x1c) ||
+                                pattern_match(diffs, 0xd7, 0x16) || pattern_match(diffs, 0x0b, 0x02);
+            const bool cond08 = (pattern_match(diffs, 0x0f, 0x0b) || pattern_match(diffs, 0x2b, 0x0b) ||
+                                 pattern_match(diffs, 0xfe, 0x4a) ||
+                                 pattern_match(diffs, 0xfe, 0x1a)) && yuv_difference(w[3], w[1]);
+            const bool cond09 = pattern_match(diffs, 0x2f, 0x2f);
+            const bool cond10 = pattern_match(diffs, 0x0a, 0x00);
+            const bool cond11 = pattern_match(diffs, 0x0b, 0x09);
+            const bool cond12 = pattern_match(diffs, 0x7e, 0x2a) || pattern_match(diffs, 0xef, 0xab);
+            const bool cond13 = pattern_match(diffs, 0xbf, 0x8f) || pattern_match(diffs, 0x7e, 0x0e);
+            const bool cond14 = pattern_match(diffs, 0x4f, 0x4b) || pattern_match(diffs, 0x9f, 0x1b) ||
+                                pattern_match(diffs, 0x2f, 0x0b) ||
+                                pattern_match(diffs, 0xbe, 0x0a) || pattern_match(diffs, 0xee, 0x0a) ||
+                                pattern_match(diffs, 0x7e, 0x0a) ||
+                                pattern_match(diffs, 0xeb, 0x4b) || pattern_match(diffs, 0x3b, 0x1b);
+            const bool cond15 = pattern_match(diffs, 0x0b, 0x03);
+
+            // Top-left pixel
+            if (cond00)
+                dst00 = interpolate2_pixels(w[4], 5, w[3], 3, 3);
+            else if (cond01)
+                dst00 = interpolate2_pixels(w[4], 5, w[1], 3, 3);
+            else if ((pattern_match(diffs, 0x0b, 0x0b) || pattern_match(diffs, 0xfe, 0x4a) ||
+                      pattern_match(diffs, 0xfe, 0x1a)) && yuv_difference(w[3], w[1]))
+                dst00 = w[4];
+            else if (cond02)
+                dst00 = interpolate2_pixels(w[4], 5, w[0], 3, 3);
+            else if (cond03)
+                dst00 = interpolate2_pixels(w[4], 3, w[3], 1, 2);
+            else if (cond04)
+                dst00 = interpolate2_pixels(w[4], 3, w[1], 1, 2);
+            else if (cond05)
+                dst00 = interpolate2_pixels(w[4], 5, w[3], 3, 3);
+            else if (cond06)
+                dst00 = interpolate2_pixels(w[4], 5, w[1], 3, 3);
+            else if (pattern_match(diffs, 0x0f, 0x0b) || pattern_match(diffs, 0x5e, 0x0a) ||
+                     pattern_match(diffs, 0x2b, 0x0b) || pattern_match(diffs, 0xbe, 0x0a) ||
+                     pattern_match(diffs, 0x7a, 0x0a) || pattern_match(diffs, 0xee, 0x0a))
+                dst00 = interpolate2_pixels(w[1], 1, w[3], 1, 1);
+            else if (cond07)
+                dst00 = interpolate2_pixels(w[4], 5, w[0], 3, 3);
+            else
+                dst00 = interpolate_3pixels(w[4], 2, w[1], 1, w[3], 1, 2);
+
+            // Top-right pixel
+            if (cond00)
+                dst01 = interpolate2_pixels(w[4], 7, w[5], 1, 3);
+            else if (cond01)
+                dst01 = interpolate2_pixels(w[4], 5, w[2], 3, 3);
+            else if (cond08)
+                dst01 = w[4];
+            else if (cond02)
+                dst01 = interpolate2_pixels(w[4], 7, w[1], 1, 3);
+            else if (cond03)
+                dst01 = interpolate2_pixels(w[4], 5, w[2], 3, 3);
+            else if (cond04)
+                dst01 = interpolate2_pixels(w[4], 3, w[1], 1, 2);
+            else if (cond05)
+                dst01 = interpolate2_pixels(w[4], 7, w[1], 1, 3);
+            else if (cond06)
+                dst01 = interpolate2_pixels(w[4], 5, w[1], 3, 3);
+            else if (cond09)
+                dst01 = w[4];
+            else if (cond10)
+                dst01 = interpolate2_pixels(w[1], 1, w[5], 1, 1);
+            else if (cond11)
+                dst01 = interpolate2_pixels(w[4], 5, w[2], 3, 3);
+            else if (cond07)
+                dst01 = interpolate2_pixels(w[4], 7, w[5], 1, 3);
+            else
+                dst01 = interpolate_3pixels(w[4], 2, w[1], 1, w[5], 1, 2);
+
+            // Bottom-left pixel
+            if (cond00)
+                dst10 = interpolate2_pixels(w[4], 5, w[3], 3, 3);
+            else if (cond01)
+                dst10 = interpolate2_pixels(w[4], 7, w[7], 1, 3);
+            else if (cond08)
+                dst10 = interpolate2_pixels(w[4], 7, w[3], 1, 3);
+            else if (cond02)
+                dst10 = w[4];
+            else if (cond03)
+                dst10 = interpolate2_pixels(w[4], 3, w[3], 1, 2);
+            else if (cond04)
+                dst10 = interpolate2_pixels(w[4], 5, w[6], 3, 3);
+            else if (cond05)
+                dst10 = interpolate2_pixels(w[4], 5, w[3], 3, 3);
+            else if (cond06)
+                dst10 = interpolate2_pixels(w[4], 7, w[3], 1, 3);
+            else if (cond12)
+                dst10 = interpolate2_pixels(w[3], 1, w[7], 1, 1);
+            else if (cond13)
+                dst10 = interpolate2_pixels(w[4], 5, w[6], 3, 3);
+            else if (cond14)
+                dst10 = w[4];
+            else if (cond07)
+                dst10 = interpolate2_pixels(w[4], 7, w[7], 1, 3);
+            else
+                dst10 = interpolate_3pixels(w[4], 2, w[3], 1, w[7], 1, 2);
+
+            // Bottom-right pixel
+            if (cond00)
+                dst11 = interpolate2_pixels(w[4], 7, w[5], 1, 3);
+            else if (cond01)
+                dst11 = interpolate2_pixels(w[4], 5, w[8], 3, 3);
+            else if (cond08)
+                dst11 = interpolate2_pixels(w[4], 7, w[5], 1, 3);
+            else if (cond02)
+                dst11 = interpolate2_pixels(w[4], 7, w[7], 1, 3);
+            else if (cond03)
+                dst11 = interpolate2_pixels(w[4], 5, w[8], 3, 3);
+            else if (cond04)
+                dst11 = interpolate2_pixels(w[4], 3, w[7], 1, 2);
+            else if (cond05)
+                dst11 = interpolate2_pixels(w[4], 7, w[7], 1, 3);
+            else if (cond06)
+                dst11 = interpolate2_pixels(w[4], 7, w[5], 1, 3);
+            else if (cond15)
+                dst11 = w[4];
+            else if (pattern_match(diffs, 0xf7, 0xf6) || pattern_match(diffs, 0x37, 0x36) ||
+                     pattern_match(diffs, 0x37, 0x16) || pattern_match(diffs, 0xdb, 0xd2) ||
+                     pattern_match(diffs, 0xf3, 0xf2) || pattern_match(diffs, 0xf9, 0xf8) ||
+                     pattern_match(diffs, 0x6d, 0x6c) || pattern_match(diffs, 0xf3, 0xf0))
+                dst11 = interpolate2_pixels(w[4], 5, w[8], 3, 3);
+            else if (pattern_match(diffs, 0xf7, 0xf7) || pattern_match(diffs, 0xff, 0xff) ||
+                     pattern_match(diffs, 0xfc, 0xf4) || pattern_match(diffs, 0xfb, 0xf3) ||
+                     pattern_match(diffs, 0xfb, 0xfb) || pattern_match(diffs, 0xfd, 0xfd) ||
+                     pattern_match(diffs, 0xfe, 0xf6) || pattern_match(diffs, 0xf7, 0xf3) ||
+                     pattern_match(diffs, 0xfd, 0xf5))
+                dst11 = interpolate2_pixels(w[5], 1, w[7], 1, 1);
+            else if (cond07)
+                dst11 = interpolate2_pixels(w[4], 5, w[8], 3, 3);
+            else
+                dst11 = interpolate_3pixels(w[4], 2, w[5], 1, w[7], 1, 2);
+        }
+
         // Generic HQ2x scaler with buffer policy
         template<typename InputImage, typename OutputImage, typename BufferPolicy>
         void scale_hq2x_with_policy(const InputImage& src, OutputImage& result, size_t scale_factor = 2) {
@@ -140,174 +309,11 @@ namespace scaler {
                     std::array <PixelType, 9> w;
                     buffers.get_neighborhood(static_cast <int>(x), w.data());
 
-                    // Compute conditions corresponding to each set of 2x2 interpolation rules
-                    uint8_t diffs = compute_differences(w);
-                    const bool cond00 = (pattern_match(diffs, 0xbf, 0x37) || pattern_match(diffs, 0xdb, 0x13)) &&
-                                        yuv_difference(w[1], w[5]);
-                    const bool cond01 = (pattern_match(diffs, 0xdb, 0x49) || pattern_match(diffs, 0xef, 0x6d)) &&
-                                        yuv_difference(w[7], w[3]);
-                    const bool cond02 = (pattern_match(diffs, 0x6f, 0x2a) || pattern_match(diffs, 0x5b, 0x0a) ||
-                                         pattern_match(diffs, 0xbf, 0x3a) ||
-                                         pattern_match(diffs, 0xdf, 0x5a) || pattern_match(diffs, 0x9f, 0x8a) ||
-                                         pattern_match(diffs, 0xcf, 0x8a) ||
-                                         pattern_match(diffs, 0xef, 0x4e) || pattern_match(diffs, 0x3f, 0x0e) ||
-                                         pattern_match(diffs, 0xfb, 0x5a) ||
-                                         pattern_match(diffs, 0xbb, 0x8a) || pattern_match(diffs, 0x7f, 0x5a) ||
-                                         pattern_match(diffs, 0xaf, 0x8a) ||
-                                         pattern_match(diffs, 0xeb, 0x8a)) && yuv_difference(w[3], w[1]);
-                    const bool cond03 = pattern_match(diffs, 0xdb, 0x49) || pattern_match(diffs, 0xef, 0x6d);
-                    const bool cond04 = pattern_match(diffs, 0xbf, 0x37) || pattern_match(diffs, 0xdb, 0x13);
-                    const bool cond05 = pattern_match(diffs, 0x1b, 0x03) || pattern_match(diffs, 0x4f, 0x43) ||
-                                        pattern_match(diffs, 0x8b, 0x83) || pattern_match(diffs, 0x6b, 0x43);
-                    const bool cond06 = pattern_match(diffs, 0x4b, 0x09) || pattern_match(diffs, 0x8b, 0x89) ||
-                                        pattern_match(diffs, 0x1f, 0x19) || pattern_match(diffs, 0x3b, 0x19);
-                    const bool cond07 = pattern_match(diffs, 0x0b, 0x08) || pattern_match(diffs, 0xf9, 0x68) ||
-                                        pattern_match(diffs, 0xf3, 0x62) ||
-                                        pattern_match(diffs, 0x6d, 0x6c) || pattern_match(diffs, 0x67, 0x66) ||
-                                        pattern_match(diffs, 0x3d, 0x3c) ||
-                                        pattern_match(diffs, 0x37, 0x36) || pattern_match(diffs, 0xf9, 0xf8) ||
-                                        pattern_match(diffs, 0xdd, 0xdc) ||
-                                        pattern_match(diffs, 0xf3, 0xf2) || pattern_match(diffs, 0xd7, 0xd6) ||
-                                        pattern_match(diffs, 0xdd, 0x1c) ||
-                                        pattern_match(diffs, 0xd7, 0x16) || pattern_match(diffs, 0x0b, 0x02);
-                    const bool cond08 = (pattern_match(diffs, 0x0f, 0x0b) || pattern_match(diffs, 0x2b, 0x0b) ||
-                                         pattern_match(diffs, 0xfe, 0x4a) ||
-                                         pattern_match(diffs, 0xfe, 0x1a)) && yuv_difference(w[3], w[1]);
-                    const bool cond09 = pattern_match(diffs, 0x2f, 0x2f);
-                    const bool cond10 = pattern_match(diffs, 0x0a, 0x00);
-                    const bool cond11 = pattern_match(diffs, 0x0b, 0x09);
-                    const bool cond12 = pattern_match(diffs, 0x7e, 0x2a) || pattern_match(diffs, 0xef, 0xab);
-                    const bool cond13 = pattern_match(diffs, 0xbf, 0x8f) || pattern_match(diffs, 0x7e, 0x0e);
-                    const bool cond14 = pattern_match(diffs, 0x4f, 0x4b) || pattern_match(diffs, 0x9f, 0x1b) ||
-                                        pattern_match(diffs, 0x2f, 0x0b) ||
-                                        pattern_match(diffs, 0xbe, 0x0a) || pattern_match(diffs, 0xee, 0x0a) ||
-                                        pattern_match(diffs, 0x7e, 0x0a) ||
-                                        pattern_match(diffs, 0xeb, 0x4b) || pattern_match(diffs, 0x3b, 0x1b);
-                    const bool cond15 = pattern_match(diffs, 0x0b, 0x03);
-
-                    // Assign destination pixel values corresponding to the various conditions
                     auto dst00 = w[4];
                     auto dst01 = w[4];
                     auto dst10 = w[4];
                     auto dst11 = w[4];
-
-                    // Top-left pixel
-                    if (cond00)
-                        dst00 = interpolate2_pixels(w[4], 5, w[3], 3, 3);
-                    else if (cond01)
-                        dst00 = interpolate2_pixels(w[4], 5, w[1], 3, 3);
-                    else if ((pattern_match(diffs, 0x0b, 0x0b) || pattern_match(diffs, 0xfe, 0x4a) ||
-                              pattern_match(diffs, 0xfe, 0x1a)) && yuv_difference(w[3], w[1]))
-                        dst00 = w[4];
-                    else if (cond02)
-                        dst00 = interpolate2_pixels(w[4], 5, w[0], 3, 3);
-                    else if (cond03)
-                        dst00 = interpolate2_pixels(w[4], 3, w[3], 1, 2);
-                    else if (cond04)
-                        dst00 = interpolate2_pixels(w[4], 3, w[1], 1, 2);
-                    else if (cond05)
-                        dst00 = interpolate2_pixels(w[4], 5, w[3], 3, 3);
-                    else if (cond06)
-                        dst00 = interpolate2_pixels(w[4], 5, w[1], 3, 3);
-                    else if (pattern_match(diffs, 0x0f, 0x0b) || pattern_match(diffs, 0x5e, 0x0a) ||
-                             pattern_match(diffs, 0x2b, 0x0b) || pattern_match(diffs, 0xbe, 0x0a) ||
-                             pattern_match(diffs, 0x7a, 0x0a) || pattern_match(diffs, 0xee, 0x0a))
-                        dst00 = interpolate2_pixels(w[1], 1, w[3], 1, 1);
-                    else if (cond07)
-                        dst00 = interpolate2_pixels(w[4], 5, w[0], 3, 3);
-                    else
-                        dst00 = interpolate_3pixels(w[4], 2, w[1], 1, w[3], 1, 2);
-
-                    // Top-right pixel
-                    if (cond00)
-                        dst01 = interpolate2_pixels(w[4], 7, w[5], 1, 3);
-                    else if (cond01)
-                        dst01 = interpolate2_pixels(w[4], 5, w[2], 3, 3);
-                    else if (cond08)
-                        dst01 = w[4];
-                    else if (cond02)
-                        dst01 = interpolate2_pixels(w[4], 7, w[1], 1, 3);
-                    else if (cond03)
-                        dst01 = interpolate2_pixels(w[4], 5, w[2], 3, 3);
-                    else if (cond04)
-                        dst01 = interpolate2_pixels(w[4], 3, w[1], 1, 2);
-                    else if (cond05)
-                        dst01 = interpolate2_pixels(w[4], 7, w[1], 1, 3);
-                    else if (cond06)
-                        dst01 = interpolate2_pixels(w[4], 5, w[1], 3, 3);
-                    else if (cond09)
-                        dst01 = w[4];
-                    else if (cond10)
-                        dst01 = interpolate2_pixels(w[1], 1, w[5], 1, 1);
-                    else if (cond11)
-                        dst01 = interpolate2_pixels(w[4], 5, w[2], 3, 3);
-                    else if (cond07)
-                        dst01 = interpolate2_pixels(w[4], 7, w[5], 1, 3);
-                    else
-                        dst01 = interpolate_3pixels(w[4], 2, w[1], 1, w[5], 1, 2);
-
-                    // Bottom-left pixel
-                    if (cond00)
-                        dst10 = interpolate2_pixels(w[4], 5, w[3], 3, 3);
-                    else if (cond01)
-                        dst10 = interpolate2_pixels(w[4], 7, w[7], 1, 3);
-                    else if (cond08)
-                        dst10 = interpolate2_pixels(w[4], 7, w[3], 1, 3);
-                    else if (cond02)
-                        dst10 = w[4];
-                    else if (cond03)
-                        dst10 = interpolate2_pixels(w[4], 3, w[3], 1, 2);
-                    else if (cond04)
-                        dst10 = interpolate2_pixels(w[4], 5, w[6], 3, 3);
-                    else if (cond05)
-                        dst10 = interpolate2_pixels(w[4], 5, w[3], 3, 3);
-                    else if (cond06)
-                        dst10 = interpolate2_pixels(w[4], 7, w[3], 1, 3);
-                    else if (cond12)
-                        dst10 = interpolate2_pixels(w[3], 1, w[7], 1, 1);
-                    else if (cond13)
-                        dst10 = interpolate2_pixels(w[4], 5, w[6], 3, 3);
-                    else if (cond14)
-                        dst10 = w[4];
-                    else if (cond07)
-                        dst10 = interpolate2_pixels(w[4], 7, w[7], 1, 3);
-                    else
-                        dst10 = interpolate_3pixels(w[4], 2, w[3], 1, w[7], 1, 2);
-
-                    // Bottom-right pixel
-                    if (cond00)
-                        dst11 = interpolate2_pixels(w[4], 7, w[5], 1, 3);
-                    else if (cond01)
-                        dst11 = interpolate2_pixels(w[4], 5, w[8], 3, 3);
-                    else if (cond08)
-                        dst11 = interpolate2_pixels(w[4], 7, w[5], 1, 3);
-                    else if (cond02)
-                        dst11 = interpolate2_pixels(w[4], 7, w[7], 1, 3);
-                    else if (cond03)
-                        dst11 = interpolate2_pixels(w[4], 5, w[8], 3, 3);
-                    else if (cond04)
-                        dst11 = interpolate2_pixels(w[4], 3, w[7], 1, 2);
-                    else if (cond05)
-                        dst11 = interpolate2_pixels(w[4], 7, w[7], 1, 3);
-                    else if (cond06)
-                        dst11 = interpolate2_pixels(w[4], 7, w[5], 1, 3);
-                    else if (cond15)
-                        dst11 = w[4];
-                    else if (pattern_match(diffs, 0xf7, 0xf6) || pattern_match(diffs, 0x37, 0x36) ||
-                             pattern_match(diffs, 0x37, 0x16) || pattern_match(diffs, 0xdb, 0xd2) ||
-                             pattern_match(diffs, 0xf3, 0xf2) || pattern_match(diffs, 0xf9, 0xf8) ||
-                             pattern_match(diffs, 0x6d, 0x6c) || pattern_match(diffs, 0xf3, 0xf0))
-                        dst11 = interpolate2_pixels(w[4], 5, w[8], 3, 3);
-                    else if (pattern_match(diffs, 0xf7, 0xf7) || pattern_match(diffs, 0xff, 0xff) ||
-                             pattern_match(diffs, 0xfc, 0xf4) || pattern_match(diffs, 0xfb, 0xf3) ||
-                             pattern_match(diffs, 0xfb, 0xfb) || pattern_match(diffs, 0xfd, 0xfd) ||
-                             pattern_match(diffs, 0xfe, 0xf6) || pattern_match(diffs, 0xf7, 0xf3) ||
-                             pattern_match(diffs, 0xfd, 0xf5))
-                        dst11 = interpolate2_pixels(w[5], 1, w[7], 1, 1);
-                    else if (cond07)
-                        dst11 = interpolate2_pixels(w[4], 5, w[8], 3, 3);
-                    else
-                        dst11 = interpolate_3pixels(w[4], 2, w[5], 1, w[7], 1, 2);
+                    hq2x_blend(w, compute_differences(w), dst00, dst01, dst10, dst11);
 
                     size_t dst_x = scale_factor * x;
                     size_t dst_y = scale_factor * y;
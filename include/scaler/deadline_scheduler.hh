@@ -0,0 +1,328 @@
+/**
+ * @file deadline_scheduler.hh
+ * @brief Per-frame algorithm choice under a time budget
+ *
+ * Whether HQ or xBR fits a frame budget depends on the machine and on what
+ * else it is doing, so the algorithm cannot be fixed up front. The
+ * deadline_scheduler times every band it scales, predicts each algorithm's
+ * frame time from those timings and picks the most preferred algorithm
+ * predicted to fit; a frame that runs over anyway switches to a cheaper
+ * algorithm for its remaining bands.
+ *
+ * @code
+ * scaler::deadline_options options;
+ * options.budget = std::chrono::milliseconds(4);
+ * options.preference = {scaler::algorithm::xBR, scaler::algorithm::HQ, scaler::algorithm::Nearest};
+ * scaler::deadline_scheduler scheduler(options);
+ * for (;;) {
+ *     const auto report = scheduler.scale(frame, output);   // output is 3x frame
+ *     if (report.over_budget()) { ... }
+ * }
+ * @endcode
+ */
+#pragma once
+
+#include <scaler/algorithm.hh>
+#include <scaler/image.hh>
+#include <scaler/unified_scaler.hh>
+#include <scaler/cpu/band_parallel.hh>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace scaler {
+
+    struct deadline_options {
+        /// Time allowed for one frame
+        std::chrono::nanoseconds budget = std::chrono::milliseconds(16);
+        /// Algorithms from most to least preferred; the last is the floor
+        std::vector <algorithm> preference = {algorithm::xBR, algorithm::HQ, algorithm::Scale, algorithm::Nearest};
+        /// Bands a frame is split into; each band boundary is a fallback point
+        size_t bands = 4;
+        /// Share of the budget an algorithm must be predicted to fit in
+        double headroom = 0.9;
+        /// Stricter share a more preferred algorithm must fit in to be switched to
+        double upgrade_margin = 0.7;
+        /// Consecutive frames that stricter fit must hold before switching up
+        unsigned upgrade_frames = 30;
+        /// Weight of the newest timing in the running average
+        double smoothing = 0.25;
+        /// Share by which, every frame, the timings of algorithms more
+        /// preferred than the current one shrink; they are not being run, so
+        /// without this a downgrade taken under load would never be undone
+        double stale_decay = 0.01;
+    };
+
+    /**
+     * What happened to one frame
+     */
+    struct deadline_report {
+        /// Algorithm chosen for the frame
+        algorithm planned = algorithm::Nearest;
+        /// Algorithm of the last band; differs from planned after a fallback
+        algorithm finished = algorithm::Nearest;
+        size_t bands = 0;
+        /// Bands scaled with a cheaper algorithm than planned
+        size_t fallback_bands = 0;
+        std::chrono::nanoseconds elapsed{0};
+        std::chrono::nanoseconds budget{0};
+
+        [[nodiscard]] bool over_budget() const { return elapsed > budget; }
+    };
+
+    /**
+     * Picks, frame by frame, the most preferred algorithm that fits a time budget
+     *
+     * Timings are kept per algorithm as a running average of nanoseconds per
+     * input pixel, measured on the bands scale() runs; observe() feeds in
+     * timings taken elsewhere. An algorithm without timings yet is assumed
+     * to fit, so it gets tried; the band-level fallback bounds the cost.
+     *
+     * Switching down is immediate once the current algorithm is predicted
+     * to miss the budget. Switching up needs the better algorithm to fit in
+     * upgrade_margin of the budget for upgrade_frames frames in a row, so a
+     * frame time hovering near the budget does not flip between algorithms.
+     * The timings of those better algorithms only come from the frames that
+     * ran them, so each frame shrinks them by stale_decay: once load drops,
+     * the better algorithm is predicted to fit again and gets retried. If it
+     * still does not fit, its fresh timings switch back down and
+     * the next retry waits for the decay again.
+     *
+     * Within a frame, before every band after the first, the remaining rows
+     * are predicted at the current algorithm; if they would overrun what is
+     * left of the budget, the rest of the frame uses the most preferred
+     * cheaper algorithm predicted to fit it (or the last one).
+     *
+     * Bands are scaled with band_halo_rows() of context, so a frame without
+     * fallback is identical to a whole-image scale. Not thread-safe.
+     */
+    class deadline_scheduler {
+        public:
+            /**
+             * @throws std::invalid_argument if the preference list is empty
+             */
+            explicit deadline_scheduler(deadline_options options)
+                : options_(std::move(options)) {
+                if (options_.preference.empty()) {
+                    throw std::invalid_argument("deadline_scheduler needs at least one algorithm");
+                }
+                options_.bands = std::max <size_t>(options_.bands, 1);
+                options_.smoothing = std::clamp(options_.smoothing, 0.01, 1.0);
+                options_.stale_decay = std::clamp(options_.stale_decay, 0.0, 1.0);
+            }
+
+            /**
+             * Scale input into output, which must be an integral multiple of it
+             *
+             * @throws unsupported_scale_exception if no preferred algorithm
+             *         supports the scale
+             * @throws dimension_mismatch_exception if the two axes scale differently
+             */
+            template<typename InputImage, typename OutputImage>
+            deadline_report scale(const InputImage& input, OutputImage& output) {
+                using pixel = std::decay_t <decltype(std::declval <const InputImage&>().get_pixel(0, 0))>;
+                using clock = std::chrono::steady_clock;
+
+                const size_t width = input.width();
+                const size_t height = input.height();
+                const size_t factor = width > 0 ? output.width() / width : 0;
+                if (factor < 1 || factor * width != output.width()) {
+                    const float requested = width > 0
+                                                ? static_cast<float>(output.width()) / static_cast<float>(width)
+                                                : 0.0f;
+                    throw unsupported_scale_exception(options_.preference.front(), requested,
+                                                      scaler_capabilities::get_supported_scales(
+                                                          options_.preference.front()));
+                }
+                if (height * factor != output.height()) {
+                    throw dimension_mismatch_exception(options_.preference.front(), width, height,
+                                                       output.width(), output.height(),
+                                                       output.width(), height * factor);
+                }
+
+                const auto start = clock::now();
+                const std::vector <algorithm> usable = usable_algorithms(factor);
+                deadline_report report;
+                report.budget = options_.budget;
+                report.planned = choose(width * height, factor);
+                algorithm algo = report.planned;
+
+                const size_t band_rows = std::max <size_t>((height + options_.bands - 1) / options_.bands, 1);
+                for (size_t first = 0; first < height; first += band_rows) {
+                    const size_t last = std::min(height, first + band_rows);
+
+                    if (first > 0 && algo != usable.back()) {
+                        const double left_ns = static_cast<double>(options_.budget.count()) -
+                                               static_cast<double>((clock::now() - start).count());
+                        const size_t remaining = (height - first) * width;
+                        if (predicted_ns(algo, remaining) > left_ns) {
+                            algo = best_fit(usable, remaining, left_ns, algo);
+                        }
+                    }
+                    if (algo != report.planned) {
+                        ++report.fallback_bands;
+                    }
+
+                    const auto band_start = clock::now();
+                    scale_band <pixel>(input, output, algo, factor, first, last);
+                    observe(algo, (last - first) * width, clock::now() - band_start);
+                    ++report.bands;
+                }
+
+                report.finished = algo;
+                report.elapsed = std::chrono::duration_cast <std::chrono::nanoseconds>(clock::now() - start);
+                return report;
+            }
+
+            /**
+             * Algorithm for the next frame of pixels input pixels at factor,
+             * applying the switching rules (each call counts as one frame)
+             *
+             * @throws unsupported_scale_exception if no preferred algorithm
+             *         supports the scale
+             */
+            algorithm choose(size_t pixels, size_t factor) {
+                const std::vector <algorithm> usable = usable_algorithms(factor);
+                const double budget_ns = static_cast<double>(options_.budget.count());
+                if (has_current_) {
+                    decay_better_than(usable, current_);
+                }
+                const algorithm fit = best_fit(usable, pixels, budget_ns * options_.headroom, usable.front());
+
+                const auto current = std::find(usable.begin(), usable.end(), current_);
+                if (!has_current_ || current == usable.end() || fit == current_ ||
+                    std::find(usable.begin(), usable.end(), fit) > current) {
+                    // First frame, a scale the current algorithm cannot do, or it no longer fits
+                    current_ = fit;
+                    has_current_ = true;
+                    upgrade_streak_ = 0;
+                    return current_;
+                }
+
+                // A better algorithm fits; switch once it has fitted comfortably for long enough
+                const algorithm better = best_fit(usable, pixels, budget_ns * options_.upgrade_margin,
+                                                  usable.front());
+                if (std::find(usable.begin(), usable.end(), better) < current) {
+                    if (++upgrade_streak_ >= options_.upgrade_frames) {
+                        current_ = better;
+                        upgrade_streak_ = 0;
+                    }
+                } else {
+                    upgrade_streak_ = 0;
+                }
+                return current_;
+            }
+
+            /**
+             * Add a timing: algo scaled pixels input pixels in elapsed
+             */
+            void observe(algorithm algo, size_t pixels, std::chrono::nanoseconds elapsed) {
+                if (pixels == 0) {
+                    return;
+                }
+                const double sample = static_cast<double>(elapsed.count()) / static_cast<double>(pixels);
+                const auto [it, inserted] = ns_per_pixel_.emplace(algo, sample);
+                if (!inserted) {
+                    it->second += options_.smoothing * (sample - it->second);
+                }
+            }
+
+            /**
+             * Predicted time for algo to scale pixels input pixels; zero
+             * while algo has no timings
+             */
+            [[nodiscard]] std::chrono::nanoseconds predict(algorithm algo, size_t pixels) const {
+                return std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(predicted_ns(algo, pixels)));
+            }
+
+            /// Algorithm of the latest choose(); the first preference before any frame
+            [[nodiscard]] algorithm current() const {
+                return has_current_ ? current_ : options_.preference.front();
+            }
+
+            [[nodiscard]] const deadline_options& options() const { return options_; }
+
+        private:
+            [[nodiscard]] double predicted_ns(algorithm algo, size_t pixels) const {
+                const auto it = ns_per_pixel_.find(algo);
+                return it == ns_per_pixel_.end() ? 0.0 : it->second * static_cast<double>(pixels);
+            }
+
+            // Shrink the timings of the algorithms preferred over current,
+            // which only scale() frames that ran them would refresh
+            void decay_better_than(const std::vector <algorithm>& usable, algorithm current) {
+                const auto end = std::find(usable.begin(), usable.end(), current);
+                if (end == usable.end()) {
+                    return;
+                }
+                for (auto it = usable.begin(); it != end; ++it) {
+                    const auto timing = ns_per_pixel_.find(*it);
+                    if (timing != ns_per_pixel_.end()) {
+                        timing->second *= 1.0 - options_.stale_decay;
+                    }
+                }
+            }
+
+            [[nodiscard]] std::vector <algorithm> usable_algorithms(size_t factor) const {
+                std::vector <algorithm> usable;
+                for (algorithm algo : options_.preference) {
+                    if (scaler_capabilities::is_scale_supported(algo, static_cast<float>(factor))) {
+                        usable.push_back(algo);
+                    }
+                }
+                if (usable.empty()) {
+                    throw unsupported_scale_exception(options_.preference.front(), static_cast<float>(factor),
+                                                      scaler_capabilities::get_supported_scales(
+                                                          options_.preference.front()));
+                }
+                return usable;
+            }
+
+            // The most preferred algorithm from `from` on that is predicted to
+            // scale pixels within limit_ns, or the last one
+            [[nodiscard]] algorithm best_fit(const std::vector <algorithm>& usable, size_t pixels, double limit_ns,
+                                             algorithm from) const {
+                auto it = std::find(usable.begin(), usable.end(), from);
+                for (; it != usable.end(); ++it) {
+                    if (predicted_ns(*it, pixels) <= limit_ns) {
+                        return *it;
+                    }
+                }
+                return usable.back();
+            }
+
+            // Rows [first, last) of input, scaled with halo context into output
+            template<typename Pixel, typename InputImage, typename OutputImage>
+            static void scale_band(const InputImage& input, OutputImage& output, algorithm algo, size_t factor,
+                                   size_t first, size_t last) {
+                const size_t halo = band_halo_rows(algo);
+                const size_t top = first > halo ? first - halo : 0;
+                const size_t bottom = std::min(input.height(), last + halo);
+
+                const band_view <InputImage> view(input, top, bottom - top);
+                image <Pixel> scaled(output.width(), (bottom - top) * factor);
+                // Band times drive the fallback model, so a band never fans out to other threads
+                unified_scaler <band_view <InputImage>, image <Pixel>>::scale(view, scaled, algo,
+                                                                               detail::band_plan{});
+
+                for (size_t y = first * factor; y < last * factor; ++y) {
+                    const auto line = scaled.row(y - top * factor);
+                    for (size_t x = 0; x < output.width(); ++x) {
+                        output.set_pixel(x, y, line[x]);
+                    }
+                }
+            }
+
+            deadline_options options_;
+            std::map <algorithm, double> ns_per_pixel_;
+            algorithm current_ = algorithm::Nearest;
+            bool has_current_ = false;
+            unsigned upgrade_streak_ = 0;
+    };
+
+} // namespace scaler
@@ -0,0 +1,304 @@
+#pragma once
+
+#include <scaler/gpu/opengl_utils.hh>
+#include <scaler/gpu/gpu_exceptions.hh>
+#include <scaler/gpu/pack_format.hh>
+#include <scaler/warning_macros.hh>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace scaler::gpu {
+
+    /**
+     * Counters for gl_async_readback
+     */
+    struct gl_readback_stats {
+        size_t transfers = 0;  ///< Readbacks submitted
+        size_t bytes = 0;      ///< Bytes read back through pack buffers
+        size_t stalls = 0;     ///< Times the CPU had to wait for the GPU to release a buffer
+    };
+
+    namespace detail {
+        /**
+         * Ring of pixel pack buffers guarded by fences
+         *
+         * Slot i may only be rewritten once the GPU has signalled the fence
+         * issued after its last use, which is what lets the readback of
+         * frame N + 1 be queued while frame N is still in flight.
+         */
+        class pbo_ring {
+            public:
+                explicit pbo_ring(size_t depth)
+                    : slots_(depth) {
+                    if (depth == 0) {
+                        throw std::invalid_argument("Readback ring depth must be at least 1");
+                    }
+                    for (auto& slot : slots_) {
+                        glGenBuffers(1, &slot.buffer);
+                    }
+                    detail::check_gl_error("After readback ring creation");
+                }
+
+                ~pbo_ring() {
+                    for (auto& slot : slots_) {
+                        if (slot.fence) {
+                            glDeleteSync(slot.fence);
+                        }
+                        if (slot.buffer) {
+                            glDeleteBuffers(1, &slot.buffer);
+                        }
+                    }
+                }
+
+                pbo_ring(const pbo_ring&) = delete;
+                pbo_ring& operator=(const pbo_ring&) = delete;
+
+                [[nodiscard]] size_t depth() const {
+                    return slots_.size();
+                }
+
+                /**
+                 * Take the next slot, waiting for the GPU if it is still in use,
+                 * and make sure it holds at least size bytes (bound to the target)
+                 */
+                size_t acquire(size_t size, gl_readback_stats& stats) {
+                    const size_t index = next_;
+                    next_ = (next_ + 1) % slots_.size();
+                    wait(index, stats);
+
+                    auto& slot = slots_[index];
+                    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+                    if (slot.capacity < size) {
+                        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_READ);
+                        slot.capacity = size;
+                    }
+                    slot.size = size;
+                    return index;
+                }
+
+                // Fence the commands issued for a slot since acquire()
+                void release(size_t index) {
+                    auto& slot = slots_[index];
+                    if (slot.fence) {
+                        glDeleteSync(slot.fence);
+                    }
+                    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+                }
+
+                [[nodiscard]] bool ready(size_t index) const {
+                    GLsync fence = slots_[index].fence;
+                    if (!fence) {
+                        return true;
+                    }
+                    GLint status = GL_UNSIGNALED;
+                    glGetSynciv(fence, GL_SYNC_STATUS, 1, nullptr, &status);
+                    return status == GL_SIGNALED;
+                }
+
+                void wait(size_t index, gl_readback_stats& stats) {
+                    auto& slot = slots_[index];
+                    if (!slot.fence) {
+                        return;
+                    }
+                    if (!ready(index)) {
+                        ++stats.stalls;
+                        // Flush so the fence can signal, then block until it does
+                        while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                                wait_timeout_ns) == GL_TIMEOUT_EXPIRED) {
+                        }
+                    }
+                    glDeleteSync(slot.fence);
+                    slot.fence = nullptr;
+                }
+
+                [[nodiscard]] GLuint buffer(size_t index) const {
+                    return slots_[index].buffer;
+                }
+
+                [[nodiscard]] size_t size(size_t index) const {
+                    return slots_[index].size;
+                }
+
+            private:
+                static constexpr GLuint64 wait_timeout_ns = 1000000000;
+
+                struct slot_type {
+                    GLuint buffer = 0;
+                    GLsync fence = nullptr;
+                    size_t capacity = 0;
+                    size_t size = 0;
+                };
+
+                std::vector<slot_type> slots_;
+                size_t next_ = 0;
+        };
+    }
+
+    /**
+     * Asynchronous RGBA8 texture readback
+     *
+     * submit() queues a glReadPixels into a pixel pack buffer and returns
+     * immediately; the pixels are fetched later with try_read() / read(),
+     * typically a frame or two afterwards, so the CPU never waits for the
+     * GPU to finish the scaling that produced them.
+     *
+     * @code
+     * gpu::gl_async_readback readback(2);
+     * auto ticket = readback.submit(output_tex, w, h);
+     * // ... submit more work ...
+     * readback.read(ticket, pixels);   // blocks only if still in flight
+     * @endcode
+     *
+     * Tickets stay valid until depth() further submissions reuse their slot.
+     *
+     * Textures packed by opengl_texture_scaler::pack_texture() are read back
+     * in their packed layout, so fewer bytes cross the bus and no CPU
+     * conversion pass is needed:
+     *
+     * @code
+     * const auto layout = gpu::make_pack_layout(gpu::pack_format::yuv420, w, h, true);
+     * auto ticket = readback.submit(scaler.pack_texture(output_tex, layout), layout);
+     * // later: an I420 frame, top row first
+     * readback.read(ticket, frame);
+     * @endcode
+     */
+    class gl_async_readback {
+        public:
+            struct ticket {
+                size_t slot = 0;
+                size_t sequence = 0;
+                GLsizei width = 0;
+                GLsizei height = 0;
+            };
+
+            explicit gl_async_readback(size_t depth = 2)
+                : ring_(depth),
+                  sequences_(depth, 0) {
+                glGenFramebuffers(1, &fbo_);
+            }
+
+            ~gl_async_readback() {
+                if (fbo_) {
+                    glDeleteFramebuffers(1, &fbo_);
+                }
+            }
+
+            gl_async_readback(const gl_async_readback&) = delete;
+            gl_async_readback& operator=(const gl_async_readback&) = delete;
+
+            /**
+             * Queue a readback of texture (RGBA8, bottom row first as glReadPixels returns it)
+             */
+            ticket submit(GLuint texture, GLsizei width, GLsizei height) {
+                if (width <= 0 || height <= 0) {
+                    throw std::invalid_argument("gl_async_readback::submit: empty image");
+                }
+                return submit(texture, make_pack_layout(pack_format::rgba8, width, height));
+            }
+
+            /**
+             * Queue a readback of texture holding an image packed as layout
+             * (by opengl_texture_scaler::pack_texture() if layout.needs_pass());
+             * the planes follow each other in the read buffer
+             */
+            ticket submit(GLuint texture, const pack_layout& layout) {
+                const size_t total = layout.bytes();
+                if (total == 0) {
+                    throw std::invalid_argument("gl_async_readback::submit: empty image");
+                }
+
+                GLint previous_fbo = 0;
+                glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous_fbo);
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo_);
+                glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+
+                const size_t slot = ring_.acquire(total, stats_);
+                glPixelStorei(GL_PACK_ALIGNMENT, 1);
+                size_t offset = 0;
+                for (size_t i = 0; i < layout.plane_count; ++i) {
+                    const auto& plane = layout.planes[i];
+                    // With a pack buffer bound the data pointer is an offset into it
+                    glReadPixels(plane.x, plane.y, plane.width, plane.height, layout.read_format, layout.read_type,
+                                 reinterpret_cast <void*>(offset));
+                    offset += SCALER_GLSIZEI_TO_SIZE(plane.width) * SCALER_GLSIZEI_TO_SIZE(plane.height) *
+                              layout.bytes_per_pixel;
+                }
+                glPixelStorei(GL_PACK_ALIGNMENT, 4);
+                ring_.release(slot);
+
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, SCALER_GLINT_TO_GLUINT(previous_fbo));
+                detail::check_gl_error("After gl_async_readback::submit");
+
+                ++stats_.transfers;
+                stats_.bytes += total;
+                sequences_[slot] = ++sequence_;
+                return ticket{slot, sequence_, layout.width, layout.height};
+            }
+
+            /**
+             * Whether read() would return without waiting
+             */
+            [[nodiscard]] bool ready(const ticket& t) const {
+                check_ticket(t);
+                return ring_.ready(t.slot);
+            }
+
+            /**
+             * Copy the pixels out if the GPU is done; never blocks
+             * @return false if the readback is still in flight
+             */
+            bool try_read(const ticket& t, std::vector<std::uint8_t>& out) {
+                if (!ready(t)) {
+                    return false;
+                }
+                read(t, out);
+                return true;
+            }
+
+            /**
+             * Copy the pixels out, waiting for the GPU if necessary
+             */
+            void read(const ticket& t, std::vector<std::uint8_t>& out) {
+                check_ticket(t);
+                ring_.wait(t.slot, stats_);
+
+                const size_t total = ring_.size(t.slot);
+                out.resize(total);
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, ring_.buffer(t.slot));
+                const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                                                      static_cast<GLsizeiptr>(total), GL_MAP_READ_BIT);
+                if (!mapped) {
+                    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+                    throw resource_error("Failed to map readback buffer");
+                }
+                std::memcpy(out.data(), mapped, total);
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            }
+
+            [[nodiscard]] size_t depth() const {
+                return ring_.depth();
+            }
+
+            [[nodiscard]] const gl_readback_stats& stats() const {
+                return stats_;
+            }
+
+        private:
+            void check_ticket(const ticket& t) const {
+                if (t.slot >= sequences_.size() || sequences_[t.slot] != t.sequence) {
+                    throw std::invalid_argument("gl_async_readback: stale ticket");
+                }
+            }
+
+            detail::pbo_ring ring_;
+            std::vector<size_t> sequences_;
+            size_t sequence_ = 0;
+            GLuint fbo_ = 0;
+            gl_readback_stats stats_;
+    };
+
+} // namespace scaler::gpu
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <scaler/gpu/opengl_texture_scaler.hh>
+#include <scaler/gpu/shader_cache.hh>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace scaler::gpu {
+
+    /**
+     * Opaque identity of a GL context (SDL_GLContext, HGLRC, GLXContext, ...)
+     */
+    using gl_context_handle = const void*;
+
+    /**
+     * Process-wide opengl_texture_scaler per GL context, with programs shared
+     * per share group
+     *
+     * Contexts created to share objects with each other form a share group;
+     * declare that with add_to_share_group() before a context is first used.
+     * All scalers of a group compile into one shader_cache, so a program is
+     * compiled once per group rather than once per thread or context.
+     * Per-context objects (VAO, framebuffers, parameter buffer) are created
+     * lazily by each context's scaler on its first draw.
+     *
+     * The registry identifies the current context through the query set with
+     * set_context_query(). Without a query, every thread is treated as its own
+     * context and its own group, and the thread's scaler is destroyed when
+     * the thread exits, like the former thread_local scaler. A thread that
+     * wants its GL objects deleted cleanly calls release_current_context()
+     * while its context is still current.
+     *
+     * Repeated lookups from a thread that keeps using the same context are
+     * served from a thread-local slot without taking the registry's lock.
+     *
+     * @code
+     * auto& registry = gpu::gl_context_registry::instance();
+     * registry.set_context_query([] {
+     *     return static_cast<gpu::gl_context_handle>(SDL_GL_GetCurrentContext());
+     * });
+     * // worker_context was created with SDL_GL_SHARE_WITH_CURRENT_CONTEXT
+     * registry.add_to_share_group(worker_context, main_context);
+     * @endcode
+     */
+    class gl_context_registry {
+        public:
+            using context_query = gl_context_handle (*)();
+
+            static gl_context_registry& instance() {
+                static gl_context_registry registry;
+                return registry;
+            }
+
+            gl_context_registry() {
+                std::lock_guard <std::mutex> lock(live_mutex());
+                live_registries().insert(this);
+            }
+
+            ~gl_context_registry() {
+                std::lock_guard <std::mutex> lock(live_mutex());
+                live_registries().erase(this);
+            }
+
+            gl_context_registry(const gl_context_registry&) = delete;
+            gl_context_registry& operator=(const gl_context_registry&) = delete;
+
+            /**
+             * Set how the current context is identified (nullptr = per thread)
+             */
+            void set_context_query(context_query query) {
+                std::lock_guard <std::mutex> lock(mutex_);
+                query_.store(query, std::memory_order_release);
+                epoch_.fetch_add(1, std::memory_order_acq_rel);
+            }
+
+            /**
+             * Declare that context shares objects with share_with
+             * @throws std::logic_error if context was already used with another group
+             */
+            void add_to_share_group(gl_context_handle context, gl_context_handle share_with) {
+                std::lock_guard <std::mutex> lock(mutex_);
+                auto& group = groups_[share_with];
+                if (!group) {
+                    group = std::make_shared <shader_group>();
+                }
+
+                auto& own = groups_[context];
+                if (own && own != group && contexts_.count(context)) {
+                    throw std::logic_error("gl_context_registry: context already belongs to another share group");
+                }
+                own = group;
+            }
+
+            /**
+             * Scaler for the current context, created on first use
+             * @note The scaler must only be used while that context is current
+             */
+            opengl_texture_scaler& scaler_for_current_context() {
+                const gl_context_handle context = current_context();
+                const std::uint64_t epoch = epoch_.load(std::memory_order_acquire);
+
+                thread_local lookup_slot slot;
+                if (slot.registry == this && slot.context == context && slot.epoch == epoch) {
+                    return *slot.scaler;
+                }
+
+                std::lock_guard <std::mutex> lock(mutex_);
+                auto& entry = contexts_[context];
+                if (!entry) {
+                    auto& group = groups_[context];
+                    if (!group) {
+                        group = std::make_shared <shader_group>();
+                    }
+                    entry = std::make_unique <opengl_texture_scaler>(group->shaders);
+                    if (context == thread_identity::current()) {
+                        thread_identity::current()->track(this);
+                    }
+                }
+
+                slot = {this, context, epoch_.load(std::memory_order_acquire), entry.get()};
+                return *entry;
+            }
+
+            /**
+             * Destroy the current context's scaler (call before destroying the
+             * context, while it is current). The group's programs are
+             * released with its last member.
+             */
+            void release_current_context() {
+                release(current_context());
+            }
+
+            void release(gl_context_handle context) {
+                std::lock_guard <std::mutex> lock(mutex_);
+                contexts_.erase(context);
+                groups_.erase(context);
+                epoch_.fetch_add(1, std::memory_order_acq_rel);
+            }
+
+            /**
+             * Contexts that currently have a scaler
+             */
+            [[nodiscard]] size_t context_count() const {
+                std::lock_guard <std::mutex> lock(mutex_);
+                return contexts_.size();
+            }
+
+            /**
+             * Identity of the calling thread's current context
+             */
+            [[nodiscard]] gl_context_handle current_context() const {
+                if (context_query query = query_.load(std::memory_order_acquire)) {
+                    return query();
+                }
+                return thread_identity::current();
+            }
+
+        private:
+            /**
+             * Fallback context identity of one thread
+             *
+             * Its address may be reused by a later thread, so the scalers
+             * created under it are released when the thread exits.
+             */
+            class thread_identity {
+                public:
+                    static thread_identity* current() {
+                        thread_local thread_identity identity;
+                        return &identity;
+                    }
+
+                    void track(gl_context_registry* registry) {
+                        for (auto* known : registries_) {
+                            if (known == registry) {
+                                return;
+                            }
+                        }
+                        registries_.push_back(registry);
+                    }
+
+                    ~thread_identity() {
+                        std::lock_guard <std::mutex> lock(live_mutex());
+                        for (auto* registry : registries_) {
+                            if (live_registries().count(registry)) {
+                                registry->release(this);
+                            }
+                        }
+                    }
+
+                private:
+                    std::vector <gl_context_registry*> registries_;
+            };
+
+            // Registries a thread_identity may still release into; leaked so
+            // threads outliving static destruction can still consult them
+            static std::mutex& live_mutex() {
+                static auto* mutex = new std::mutex;
+                return *mutex;
+            }
+
+            static std::unordered_set <const gl_context_registry*>& live_registries() {
+                static auto* registries = new std::unordered_set <const gl_context_registry*>;
+                return *registries;
+            }
+
+            struct shader_group {
+                std::shared_ptr <shader_cache> shaders = std::make_shared <shader_cache>();
+            };
+
+            struct lookup_slot {
+                const gl_context_registry* registry = nullptr;
+                gl_context_handle context = nullptr;
+                std::uint64_t epoch = 0;
+                opengl_texture_scaler* scaler = nullptr;
+            };
+
+            mutable std::mutex mutex_;
+            std::atomic <context_query> query_{nullptr};
+            // Invalidates the thread-local lookup slots
+            std::atomic <std::uint64_t> epoch_{0};
+            std::unordered_map <gl_context_handle, std::shared_ptr <shader_group>> groups_;
+            std::unordered_map <gl_context_handle, std::unique_ptr <opengl_texture_scaler>> contexts_;
+    };
+
+} // namespace scaler::gpu
@@ -0,0 +1,300 @@
+#pragma once
+
+#include <scaler/gpu/opengl_utils.hh>
+#include <scaler/gpu/shader_source.hh>
+#include <cstddef>
+#include <cstring>
+
+namespace scaler::gpu {
+
+    /**
+     * Counters for GL calls issued (and avoided) by gl_state_cache
+     */
+    struct gl_call_stats {
+        size_t state_changes = 0;     ///< Bind/use/viewport calls actually issued
+        size_t redundant_skipped = 0; ///< Calls elided because the state already matched
+        size_t state_queries = 0;     ///< glGet*/glCheckFramebufferStatus round-trips
+        size_t uniform_uploads = 0;   ///< Parameter buffer updates issued
+        size_t draw_calls = 0;
+
+        [[nodiscard]] size_t total_gl_calls() const {
+            return state_changes + state_queries + uniform_uploads + draw_calls;
+        }
+    };
+
+    /**
+     * Shadow copy of the GL state touched by the scalers
+     *
+     * Tracks the bound program, 2D texture on unit 0, VAO, draw framebuffer
+     * and viewport so that repeated scaling calls only issue the state
+     * changes that actually differ. Per-draw sizes go through one std140
+     * uniform buffer (see shader_source::scaler_params_binding), and sampling
+     * state comes from a sampler object instead of glTexParameteri on every
+     * input texture.
+     *
+     * GL state is only assumed to be owned by the cache between begin() and
+     * end() (see scoped_gl_batch). The outermost begin() queries the caller's
+     * framebuffer and viewport, and the outermost end() restores them and
+     * leaves program, texture, sampler and VAO unbound, which is what a
+     * single unbatched call has always done. Wrapping many calls in one
+     * batch therefore costs two queries in total instead of two per call.
+     */
+    class gl_state_cache {
+        public:
+            gl_state_cache() = default;
+
+            ~gl_state_cache() {
+                release();
+            }
+
+            gl_state_cache(const gl_state_cache&) = delete;
+            gl_state_cache& operator=(const gl_state_cache&) = delete;
+
+            gl_state_cache(gl_state_cache&& other) noexcept {
+                *this = std::move(other);
+            }
+
+            gl_state_cache& operator=(gl_state_cache&& other) noexcept {
+                if (this != &other) {
+                    release();
+                    params_buffer_ = other.params_buffer_;
+                    sampler_ = other.sampler_;
+                    std::memcpy(params_, other.params_, sizeof(params_));
+                    params_valid_ = other.params_valid_;
+                    stats_ = other.stats_;
+                    invalidate();
+                    other.params_buffer_ = 0;
+                    other.sampler_ = 0;
+                    other.params_valid_ = false;
+                }
+                return *this;
+            }
+
+            void begin() {
+                if (depth_++ > 0) {
+                    return;
+                }
+
+                invalidate();
+
+                GLint value = 0;
+                glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &value);
+                saved_framebuffer_ = SCALER_GLINT_TO_GLUINT(value);
+                framebuffer_ = saved_framebuffer_;
+                glGetIntegerv(GL_VIEWPORT, saved_viewport_);
+                std::memcpy(viewport_, saved_viewport_, sizeof(viewport_));
+                stats_.state_queries += 2;
+
+                ensure_resources();
+
+                // Unit 0 and the parameter binding point are ours for the batch
+                glActiveTexture(GL_TEXTURE0);
+                glBindSampler(0, sampler_);
+                glBindBufferBase(GL_UNIFORM_BUFFER, shader_source::scaler_params_binding, params_buffer_);
+                stats_.state_changes += 3;
+            }
+
+            void end() {
+                if (depth_ == 0 || --depth_ > 0) {
+                    return;
+                }
+
+                bind_vertex_array(0);
+                bind_texture(0);
+                use_program(0);
+                bind_framebuffer(saved_framebuffer_);
+                viewport(saved_viewport_[0], saved_viewport_[1], saved_viewport_[2], saved_viewport_[3]);
+                glBindSampler(0, 0);
+                ++stats_.state_changes;
+
+                invalidate();
+            }
+
+            [[nodiscard]] bool in_batch() const {
+                return depth_ > 0;
+            }
+
+            /**
+             * Forget all shadowed bindings (e.g. after foreign code touched GL state
+             * inside a batch)
+             */
+            void invalidate() {
+                program_ = unknown;
+                texture_ = unknown;
+                vertex_array_ = unknown;
+                framebuffer_ = unknown;
+                viewport_[0] = viewport_[1] = -1;
+                viewport_[2] = viewport_[3] = -1;
+            }
+
+            void use_program(GLuint program) {
+                if (track(program_, program)) {
+                    glUseProgram(program);
+                }
+            }
+
+            void bind_texture(GLuint texture) {
+                if (track(texture_, texture)) {
+                    glBindTexture(GL_TEXTURE_2D, texture);
+                }
+            }
+
+            void bind_vertex_array(GLuint vao) {
+                if (track(vertex_array_, vao)) {
+                    glBindVertexArray(vao);
+                }
+            }
+
+            void bind_framebuffer(GLuint fbo) {
+                if (track(framebuffer_, fbo)) {
+                    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+                }
+            }
+
+            void viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+                if (viewport_[0] == x && viewport_[1] == y &&
+                    viewport_[2] == width && viewport_[3] == height) {
+                    ++stats_.redundant_skipped;
+                    return;
+                }
+                glViewport(x, y, width, height);
+                viewport_[0] = x;
+                viewport_[1] = y;
+                viewport_[2] = width;
+                viewport_[3] = height;
+                ++stats_.state_changes;
+            }
+
+            /**
+             * Update the scaler_params uniform block, skipping unchanged values
+             */
+            void upload_params(float texture_width, float texture_height,
+                               float output_width, float output_height) {
+                // std140: vec2 u_texture_size at 0, vec2 u_output_size at 8
+                const float params[4] = {texture_width, texture_height, output_width, output_height};
+                if (params_valid_ && std::memcmp(params, params_, sizeof(params)) == 0) {
+                    ++stats_.redundant_skipped;
+                    return;
+                }
+                ensure_resources();
+                glBindBuffer(GL_UNIFORM_BUFFER, params_buffer_);
+                glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(params), params);
+                std::memcpy(params_, params, sizeof(params));
+                params_valid_ = true;
+                ++stats_.uniform_uploads;
+            }
+
+            void draw_quad() {
+                glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+                ++stats_.draw_calls;
+            }
+
+            void count_query() {
+                ++stats_.state_queries;
+            }
+
+            void count_state_change() {
+                ++stats_.state_changes;
+            }
+
+            [[nodiscard]] const gl_call_stats& stats() const {
+                return stats_;
+            }
+
+            void reset_stats() {
+                stats_ = gl_call_stats{};
+            }
+
+            /**
+             * Delete the GL objects owned by the cache (needs the owning context current)
+             */
+            void release() {
+                if (params_buffer_) {
+                    glDeleteBuffers(1, &params_buffer_);
+                    params_buffer_ = 0;
+                }
+                if (sampler_) {
+                    glDeleteSamplers(1, &sampler_);
+                    sampler_ = 0;
+                }
+                params_valid_ = false;
+            }
+
+        private:
+            static constexpr GLuint unknown = ~0u;
+
+            bool track(GLuint& current, GLuint wanted) {
+                if (current == wanted) {
+                    ++stats_.redundant_skipped;
+                    return false;
+                }
+                current = wanted;
+                ++stats_.state_changes;
+                return true;
+            }
+
+            void ensure_resources() {
+                if (!params_buffer_) {
+                    glGenBuffers(1, &params_buffer_);
+                    glBindBuffer(GL_UNIFORM_BUFFER, params_buffer_);
+                    glBufferData(GL_UNIFORM_BUFFER, sizeof(params_), nullptr, GL_DYNAMIC_DRAW);
+                    params_valid_ = false;
+                }
+                if (!sampler_) {
+                    glGenSamplers(1, &sampler_);
+                    glSamplerParameteri(sampler_, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                    glSamplerParameteri(sampler_, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                    glSamplerParameteri(sampler_, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                    glSamplerParameteri(sampler_, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                }
+            }
+
+            GLuint program_ = unknown;
+            GLuint texture_ = unknown;
+            GLuint vertex_array_ = unknown;
+            GLuint framebuffer_ = unknown;
+            GLint viewport_[4] = {-1, -1, -1, -1};
+
+            GLuint saved_framebuffer_ = 0;
+            GLint saved_viewport_[4] = {0, 0, 0, 0};
+            int depth_ = 0;
+
+            GLuint params_buffer_ = 0;
+            GLuint sampler_ = 0;
+            float params_[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            bool params_valid_ = false;
+
+            gl_call_stats stats_;
+    };
+
+    /**
+     * RAII batch scope for gl_state_cache
+     *
+     * @code
+     * {
+     *     gpu::scoped_gl_batch batch(scaler.state());
+     *     for (auto& sprite : sprites) {
+     *         scaler.scale_texture_to_texture(...);
+     *     }
+     * } // caller framebuffer and viewport restored here
+     * @endcode
+     */
+    class scoped_gl_batch {
+        public:
+            explicit scoped_gl_batch(gl_state_cache& cache)
+                : cache_(cache) {
+                cache_.begin();
+            }
+
+            ~scoped_gl_batch() {
+                cache_.end();
+            }
+
+            scoped_gl_batch(const scoped_gl_batch&) = delete;
+            scoped_gl_batch& operator=(const scoped_gl_batch&) = delete;
+
+        private:
+            gl_state_cache& cache_;
+    };
+
+} // namespace scaler::gpu
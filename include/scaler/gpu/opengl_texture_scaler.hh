@@ -4,12 +4,18 @@
 #include <scaler/algorithm_capabilities.hh>
 #include <scaler/gpu/opengl_utils.hh>
 #include <scaler/gpu/shader_cache.hh>
+#include <scaler/gpu/gl_state_cache.hh>
+#include <scaler/gpu/raw_texture.hh>
+#include <scaler/gpu/pack_format.hh>
 #include <scaler/gpu/algorithm_traits_impl.hh>
 #include <scaler/gpu/gpu_exceptions.hh>
 #include <scaler/warning_macros.hh>
 #include <memory>
 #include <vector>
 #include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 namespace scaler::gpu {
     /**
@@ -18,9 +24,36 @@ namespace scaler::gpu {
      */
     class opengl_texture_scaler {
         private:
-            shader_cache cache_;
+            // Programs may be shared with scalers of other contexts in the same
+            // share group (see gl_context_registry)
+            std::shared_ptr <shader_cache> cache_ = std::make_shared <shader_cache>();
+            // Variant lookups answered without the shared cache's mutex; reset
+            // when the shared cache is cleared
+            std::unordered_map <shader_variant_key, const shader_program*, shader_variant_key_hash> programs_;
+            unsigned int programs_generation_ = 0;
+            gl_state_cache state_;
             GLuint vao_ = 0;
             GLuint vbo_ = 0;
+            GLuint fbo_ = 0;
+            GLuint fbo_attachment_ = 0;
+
+            // Scaler-owned intermediate texture with its framebuffer, reused
+            // while size and format are unchanged
+            struct render_target {
+                GLuint fbo = 0;
+                GLuint texture = 0;
+                GLsizei width = 0;
+                GLsizei height = 0;
+                GLenum format = 0;
+            };
+
+            render_target decode_target_;   // raw_texture inputs expanded to RGBA8
+            render_target pack_target_;     // outputs packed for readback
+            shader_variant_options variant_options_;
+            bool async_compile_ = false;
+            // Programs whose extra sampler uniforms already point at their units;
+            // cleared with programs_ when the cache generation changes
+            std::unordered_set <GLuint> configured_programs_;
             bool initialized_ = false;
 
             // Constants
@@ -29,6 +62,9 @@ namespace scaler::gpu {
             static constexpr float DEFAULT_SCALE_4X = 4.0f;
             static constexpr int DEFAULT_LOG_BUFFER_SIZE = 512;
 
+            // Texture unit used besides unit 0
+            static constexpr GLint PALETTE_UNIT = 1;
+
             // Vertex data for full-screen quad
             static constexpr float quad_vertices[] = {
                 // positions   // texCoords
@@ -93,86 +129,297 @@ namespace scaler::gpu {
                 }
 
                 // Get or compile the appropriate shader
-                const auto& shader = get_or_compile_shader(algo, scale_factor);
+                const auto key = variant_key(algo, scale_factor, input_width, input_height,
+                                             output_width, output_height);
+                // While it is still compiling, nearest keeps frames coming without a stall
+                const auto& shader = async_compile_ && !request_variant(key)
+                                         ? get_or_compile_shader(fallback_key())
+                                         : get_or_compile_shader(key);
 
-                // Save and set viewport
-                GLint old_viewport[4];
-                glGetIntegerv(GL_VIEWPORT, old_viewport);
-                detail::check_gl_error("After glGetIntegerv viewport");
-                glViewport(0, 0, output_width, output_height);
-                detail::check_gl_error("After glViewport");
+                // Callers open the batch before binding their target framebuffer
+                state_.viewport(0, 0, output_width, output_height);
 
                 // Clear if requested
                 if (clear_output) {
                     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
                     glClear(GL_COLOR_BUFFER_BIT);
+                    state_.count_state_change();
+                }
+
+                // Sampler unit 0 and nearest/clamp sampling are set up by the batch;
+                // sizes go through the shared parameter buffer
+                state_.use_program(shader.program.get());
+                state_.upload_params(static_cast <float>(input_width),
+                                     static_cast <float>(input_height),
+                                     static_cast <float>(output_width),
+                                     static_cast <float>(output_height));
+                state_.bind_texture(input_texture);
+                state_.bind_vertex_array(vao_);
+                state_.draw_quad();
+                detail::check_gl_error("After glDrawArrays");
+            }
+
+            /**
+             * Bind the shared framebuffer with output_texture attached
+             * (must be called inside a batch)
+             */
+            void bind_output_texture(GLuint output_texture) {
+                // One framebuffer is reused for every output texture
+                if (!fbo_) {
+                    glGenFramebuffers(1, &fbo_);
+                    detail::check_gl_error("After glGenFramebuffers");
+                }
+                state_.bind_framebuffer(fbo_);
+
+                // Attach output texture to framebuffer. Attaching is cheap and always
+                // done (texture names can be recycled); the completeness check is a
+                // driver round-trip and only runs when the target changes.
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                       GL_TEXTURE_2D, output_texture, 0);
+                state_.count_state_change();
+
+                if (fbo_attachment_ != output_texture) {
+                    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+                    state_.count_query();
+                    if (status != GL_FRAMEBUFFER_COMPLETE) {
+                        fbo_attachment_ = 0;
+                        throw resource_error("Framebuffer incomplete: " + std::to_string(status));
+                    }
+                    fbo_attachment_ = output_texture;
                 }
+            }
 
-                // Use shader and set uniforms
-                shader.use();
-                // Don't check error here - shader.use() already does it internally
-                glUniform1i(shader.u_texture, 0);
-                detail::check_gl_error("After glUniform1i");
-                glUniform2f(shader.u_texture_size,
-                            static_cast <float>(input_width),
-                            static_cast <float>(input_height));
-                detail::check_gl_error("After glUniform2f texture_size");
-                glUniform2f(shader.u_output_size,
-                            static_cast <float>(output_width),
-                            static_cast <float>(output_height));
-                detail::check_gl_error("After glUniform2f output_size");
-
-                // Bind and configure input texture
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, input_texture);
+            /**
+             * (Re)create an intermediate target (must be called inside a batch)
+             * @param format GL_RGBA8, or an integer format for packed readback
+             */
+            void ensure_target(render_target& target, GLsizei width, GLsizei height, GLenum format) {
+                if (target.texture && target.width == width && target.height == height &&
+                    target.format == format) {
+                    return;
+                }
+
+                if (target.texture) {
+                    glDeleteTextures(1, &target.texture);
+                    target.texture = 0;
+                }
+                target.texture = format == GL_RGBA8
+                                     ? create_output_texture(width, height)
+                                     : create_integer_texture(width, height, format);
+                target.width = width;
+                target.height = height;
+                target.format = format;
+                // Texture creation rebinds GL_TEXTURE_2D behind the cache's back
+                state_.invalidate();
+
+                if (!target.fbo) {
+                    glGenFramebuffers(1, &target.fbo);
+                    detail::check_gl_error("After glGenFramebuffers");
+                }
+                state_.bind_framebuffer(target.fbo);
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                       GL_TEXTURE_2D, target.texture, 0);
+                state_.count_state_change();
+
+                GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+                state_.count_query();
+                if (status != GL_FRAMEBUFFER_COMPLETE) {
+                    throw resource_error("Intermediate framebuffer incomplete: " + std::to_string(status));
+                }
+            }
+
+            static void release_target(render_target& target) {
+                if (target.fbo)
+                    glDeleteFramebuffers(1, &target.fbo);
+                if (target.texture)
+                    glDeleteTextures(1, &target.texture);
+                target = render_target{};
+            }
+
+            // Packed readback storage: GL_R8UI or GL_R16UI
+            static GLuint create_integer_texture(GLsizei width, GLsizei height, GLenum internal_format) {
+                const GLenum format = GL_RED_INTEGER;
+                const GLenum type = internal_format == GL_R16UI ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+                GLuint texture;
+                glGenTextures(1, &texture);
+                glBindTexture(GL_TEXTURE_2D, texture);
+                glTexImage2D(GL_TEXTURE_2D, 0, static_cast <GLint>(internal_format), width, height, 0,
+                             format, type, nullptr);
+                // Integer textures are only complete without filtering and mipmaps
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                glBindTexture(GL_TEXTURE_2D, 0);
+                detail::check_gl_error("After create_integer_texture");
+                return texture;
+            }
 
-                // Render the quad
-                glBindVertexArray(vao_);
-                detail::check_gl_error("After glBindVertexArray");
-                glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-                detail::check_gl_error("After glDrawArrays");
-                glBindVertexArray(0);
-                detail::check_gl_error("After glBindVertexArray(0)");
+            /**
+             * Make program current and point one of its sampler uniforms at unit.
+             * Sampler uniforms are program state, so this is only done once per program.
+             */
+            void use_program_with_unit(const shader_program& shader, const char* sampler, GLint unit) {
+                // Program names are recycled once the cache is cleared
+                sync_programs();
+                state_.use_program(shader.program.get());
+                if (configured_programs_.insert(shader.program.get()).second) {
+                    glUniform1i(shader.uniform_location(sampler), unit);
+                }
+            }
 
-                // Cleanup
-                glUseProgram(0);
-                glBindTexture(GL_TEXTURE_2D, 0);
+            /**
+             * Expand a raw_texture to RGBA8 on the GPU (must be called inside a batch)
+             * @return Decoded texture, owned by the scaler
+             */
+            GLuint decode_raw(const raw_texture& input) {
+                ensure_target(decode_target_, input.width(), input.height(), GL_RGBA8);
+
+                const bool indexed = input.format() == raw_pixel_format::indexed8;
+                const auto& shader = indexed
+                                         ? cache_->get_or_compile("raw_decode_indexed",
+                                                                 shader_source::vertex_shader_source,
+                                                                 shader_source::indexed_decode_fragment_shader)
+                                         : cache_->get_or_compile("raw_decode_rgb565",
+                                                                 shader_source::vertex_shader_source,
+                                                                 shader_source::rgb565_decode_fragment_shader);
+
+                state_.bind_framebuffer(decode_target_.fbo);
+                state_.viewport(0, 0, input.width(), input.height());
+
+                if (indexed) {
+                    use_program_with_unit(shader, "u_palette", PALETTE_UNIT);
+                    glActiveTexture(GL_TEXTURE0 + PALETTE_UNIT);
+                    glBindTexture(GL_TEXTURE_2D, input.palette_id());
+                    glActiveTexture(GL_TEXTURE0);
+                    state_.count_state_change();
+                } else {
+                    state_.use_program(shader.program.get());
+                }
+
+                state_.bind_texture(input.id());
+                state_.bind_vertex_array(vao_);
+                state_.draw_quad();
+                detail::check_gl_error("After raw decode pass");
 
-                // Restore viewport
-                glViewport(old_viewport[0], old_viewport[1], old_viewport[2], old_viewport[3]);
+                return decode_target_.texture;
             }
 
-            const shader_program& get_or_compile_shader(algorithm algo, float scale_factor) {
+            shader_variant_key variant_key(algorithm algo, float scale_factor,
+                                           GLsizei input_width, GLsizei input_height,
+                                           GLsizei output_width, GLsizei output_height) const {
+                return shader_variant_key::make(algo, scale_factor, input_width, input_height,
+                                                output_width, output_height, variant_options_);
+            }
+
+            /**
+             * The nearest program async draws fall back to, whatever the
+             * scale and size: specializing it would compile a new fallback,
+             * synchronously, for every input size. Opaque still applies, as
+             * it changes the output rather than only the code.
+             */
+            shader_variant_key fallback_key() const {
+                shader_variant_key key;
+                key.algo = algorithm::Nearest;
+                key.scale = 1.0f;
+                key.opaque = variant_options_.opaque;
+                return key;
+            }
+
+            /**
+             * Queue the program a draw needs and advance compilation
+             * @return Whether it is ready
+             */
+            bool request_variant(const shader_variant_key& key) {
+                if (find_program(key)) {
+                    return true;
+                }
+                const char* source = get_shader_for_algorithm_and_scale(key.algo, key.scale);
+                if (!source) {
+                    // Let the synchronous path report it
+                    return true;
+                }
+                cache_->request(key, shader_source::vertex_shader_source, source);
+                cache_->pump();
+                return find_program(key) != nullptr;
+            }
+
+            /**
+             * Single-pass program for a variant key
+             */
+            const shader_program& get_or_compile_shader(const shader_variant_key& key) {
                 // Get the appropriate shader source based on algorithm and scale
-                const char* fragment_source = get_shader_for_algorithm_and_scale(algo, scale_factor);
+                const char* fragment_source = get_shader_for_algorithm_and_scale(key.algo, key.scale);
                 if (!fragment_source) {
                     throw shader_error("No shader available for algorithm " +
-                                       std::to_string(static_cast <int>(algo)) +
-                                       " at scale " + std::to_string(scale_factor));
+                                       std::to_string(static_cast <int>(key.algo)) +
+                                       " at scale " + std::to_string(key.scale));
                 }
 
-                // Use the common vertex shader
-                const char* vertex_source = shader_source::vertex_shader_source;
+                return program_for(key, fragment_source);
+            }
 
-                // Create a unique key for this algorithm/scale combination
-                std::string shader_key = "scaler_" + std::to_string(static_cast <int>(algo)) +
-                                         "_" + std::to_string(scale_factor);
+            /**
+             * Compiled variant from the local table, else from the shared cache
+             * @return nullptr if the variant was never compiled
+             */
+            const shader_program* find_program(const shader_variant_key& key) {
+                sync_programs();
+                auto it = programs_.find(key);
+                if (it != programs_.end()) {
+                    return it->second;
+                }
+                const shader_program* program = cache_->find(key);
+                if (program) {
+                    programs_.emplace(key, program);
+                }
+                return program;
+            }
 
-                return cache_.get_or_compile(shader_key, vertex_source, fragment_source);
+            const shader_program& program_for(const shader_variant_key& key, const char* fragment_source) {
+                if (const shader_program* program = find_program(key)) {
+                    return *program;
+                }
+                const auto& program = cache_->get_or_compile(key, shader_source::vertex_shader_source,
+                                                             fragment_source);
+                programs_.emplace(key, &program);
+                return program;
+            }
+
+            void sync_programs() {
+                const unsigned int generation = cache_->generation();
+                if (generation != programs_generation_) {
+                    programs_.clear();
+                    configured_programs_.clear();
+                    programs_generation_ = generation;
+                }
             }
 
         public:
             opengl_texture_scaler() = default;
 
+            /**
+             * Scaler that compiles into (and reuses programs from) shared_shaders
+             *
+             * All scalers sharing a cache must live in contexts of one GL share
+             * group. Per-context objects (VAO, framebuffers, parameter buffer)
+             * stay per scaler.
+             * @throws std::invalid_argument if shared_shaders is null
+             */
+            explicit opengl_texture_scaler(std::shared_ptr <shader_cache> shared_shaders)
+                : cache_(std::move(shared_shaders)) {
+                if (!cache_) {
+                    throw std::invalid_argument("opengl_texture_scaler: null shader cache");
+                }
+            }
+
             ~opengl_texture_scaler() {
                 if (vao_)
                     glDeleteVertexArrays(1, &vao_);
                 if (vbo_)
                     glDeleteBuffers(1, &vbo_);
+                if (fbo_)
+                    glDeleteFramebuffers(1, &fbo_);
+                release_target(decode_target_);
+                release_target(pack_target_);
             }
 
             // Non-copyable but moveable
@@ -181,11 +428,23 @@ namespace scaler::gpu {
 
             opengl_texture_scaler(opengl_texture_scaler&& other) noexcept
                 : cache_(std::move(other.cache_))
+                  , programs_(std::move(other.programs_))
+                  , programs_generation_(other.programs_generation_)
+                  , state_(std::move(other.state_))
                   , vao_(other.vao_)
                   , vbo_(other.vbo_)
+                  , fbo_(other.fbo_)
+                  , fbo_attachment_(other.fbo_attachment_)
+                  , decode_target_(std::exchange(other.decode_target_, render_target{}))
+                  , pack_target_(std::exchange(other.pack_target_, render_target{}))
+                  , variant_options_(other.variant_options_)
+                  , async_compile_(other.async_compile_)
+                  , configured_programs_(std::move(other.configured_programs_))
                   , initialized_(other.initialized_) {
                 other.vao_ = 0;
                 other.vbo_ = 0;
+                other.fbo_ = 0;
+                other.fbo_attachment_ = 0;
                 other.initialized_ = false;
             }
 
@@ -195,14 +454,30 @@ namespace scaler::gpu {
                         glDeleteVertexArrays(1, &vao_);
                     if (vbo_)
                         glDeleteBuffers(1, &vbo_);
+                    if (fbo_)
+                        glDeleteFramebuffers(1, &fbo_);
+                    release_target(decode_target_);
+                    release_target(pack_target_);
 
                     cache_ = std::move(other.cache_);
+                    programs_ = std::move(other.programs_);
+                    programs_generation_ = other.programs_generation_;
+                    state_ = std::move(other.state_);
                     vao_ = other.vao_;
                     vbo_ = other.vbo_;
+                    fbo_ = other.fbo_;
+                    fbo_attachment_ = other.fbo_attachment_;
+                    decode_target_ = std::exchange(other.decode_target_, render_target{});
+                    pack_target_ = std::exchange(other.pack_target_, render_target{});
+                    variant_options_ = other.variant_options_;
+                    async_compile_ = other.async_compile_;
+                    configured_programs_ = std::move(other.configured_programs_);
                     initialized_ = other.initialized_;
 
                     other.vao_ = 0;
                     other.vbo_ = 0;
+                    other.fbo_ = 0;
+                    other.fbo_attachment_ = 0;
                     other.initialized_ = false;
                 }
                 return *this;
@@ -245,34 +520,47 @@ namespace scaler::gpu {
                 while (glGetError() != GL_NO_ERROR) {
                 }
 
-                // Create framebuffer for output
-                GLuint fbo;
-                glGenFramebuffers(1, &fbo);
-                detail::check_gl_error("After glGenFramebuffers");
+                scoped_gl_batch batch(state_);
 
-                detail::scoped_framebuffer_bind fb_bind(fbo);
-                detail::check_gl_error("After framebuffer bind");
-
-                // Attach output texture to framebuffer
-                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                                       GL_TEXTURE_2D, output_texture, 0);
-                detail::check_gl_error("After glFramebufferTexture2D");
-
-                // Check framebuffer completeness
-                GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-                if (status != GL_FRAMEBUFFER_COMPLETE) {
-                    glDeleteFramebuffers(1, &fbo);
-                    throw resource_error("Framebuffer incomplete: " + std::to_string(status));
-                }
+                bind_output_texture(output_texture);
 
                 // Render with common function
                 render_scaled_texture(input_texture, input_width, input_height,
                                       output_width, output_height, algo, true);
+            }
+
+            /**
+             * Scale a raw (indexed or RGB565) texture to preallocated texture
+             *
+             * A first pass decodes the raw texels into an internal RGBA8 texture
+             * of the input size, then the algorithm runs on it exactly as in
+             * scale_texture_to_texture(), so the result matches an RGBA8 upload
+             * of the same image.
+             *
+             * @param input Raw source texture
+             * @param output_texture Target texture (must be preallocated as render target)
+             * @param output_width Width of output texture
+             * @param output_height Height of output texture
+             * @param algo Scaling algorithm to use
+             */
+            void scale_raw_to_texture(
+                const raw_texture& input,
+                GLuint output_texture,
+                GLsizei output_width,
+                GLsizei output_height,
+                algorithm algo) {
+                ensure_initialized();
 
-                // Cleanup handled by scoped_framebuffer_bind destructor
-                glDeleteFramebuffers(1, &fbo);
+                // Clear any existing GL errors
+                while (glGetError() != GL_NO_ERROR) {
+                }
+
+                scoped_gl_batch batch(state_);
 
-                detail::check_gl_error("After scale_texture_to_texture");
+                GLuint decoded = decode_raw(input);
+                bind_output_texture(output_texture);
+                render_scaled_texture(decoded, input.width(), input.height(),
+                                      output_width, output_height, algo, true);
             }
 
             /**
@@ -295,14 +583,103 @@ namespace scaler::gpu {
                 algorithm algo) {
                 ensure_initialized();
 
+                scoped_gl_batch batch(state_);
+
                 // Bind target framebuffer
-                glBindFramebuffer(GL_FRAMEBUFFER, target_fbo);
+                state_.bind_framebuffer(target_fbo);
 
                 // Render with common function (don't clear for external framebuffers)
                 render_scaled_texture(input_texture, input_width, input_height,
                                       fbo_width, fbo_height, algo, false);
+            }
 
-                detail::check_gl_error("After scale_texture_to_framebuffer");
+            /**
+             * Pack an RGBA8 texture (e.g. a scaled output) for
+             * gl_async_readback::submit(texture, layout)
+             *
+             * Converting on the GPU shrinks the readback (2 bytes per pixel for
+             * rgb565, 1 for indexed8, 1.5 for yuv420 instead of 4) and leaves
+             * no conversion pass for the CPU. Each plane is one draw into a
+             * scaler-owned texture, reused while the layout's packed size and
+             * format are unchanged.
+             *
+             * @param texture Source texture, layout.width x layout.height
+             * @param layout From make_pack_layout()
+             * @param palette 256x1 RGBA8 palette texture for pack_format::indexed8,
+             *                e.g. raw_texture::palette_id()
+             * @param palette_size Palette entries to choose from (1 to 256)
+             * @return Texture to read back, valid until the next pack_texture();
+             *         texture itself if the layout needs no pass
+             * @throws std::invalid_argument if indexed8 is packed without a palette
+             */
+            GLuint pack_texture(GLuint texture, const pack_layout& layout,
+                                GLuint palette = 0, GLint palette_size = 256) {
+                if (!layout.needs_pass()) {
+                    return texture;
+                }
+                const bool indexed = layout.format == pack_format::indexed8;
+                if (indexed && (!palette || palette_size < 1 || palette_size > 256)) {
+                    throw std::invalid_argument("pack_texture: indexed8 needs a palette of 1 to 256 entries");
+                }
+
+                ensure_initialized();
+
+                // Clear any existing GL errors
+                while (glGetError() != GL_NO_ERROR) {
+                }
+
+                scoped_gl_batch batch(state_);
+                ensure_target(pack_target_, layout.texture_width, layout.texture_height, layout.internal_format);
+
+                const shader_program* shader = nullptr;
+                switch (layout.format) {
+                    case pack_format::rgb565:
+                        shader = &cache_->get_or_compile("pack_rgb565", shader_source::vertex_shader_source,
+                                                         shader_source::pack_rgb565_fragment_shader);
+                        break;
+                    case pack_format::indexed8:
+                        shader = &cache_->get_or_compile("pack_indexed", shader_source::vertex_shader_source,
+                                                         shader_source::pack_indexed_fragment_shader);
+                        break;
+                    case pack_format::yuv420:
+                        shader = &cache_->get_or_compile("pack_yuv420", shader_source::vertex_shader_source,
+                                                         shader_source::pack_yuv420_fragment_shader);
+                        break;
+                    default:
+                        shader = &cache_->get_or_compile("pack_copy", shader_source::vertex_shader_source,
+                                                         shader_source::pack_copy_fragment_shader);
+                        break;
+                }
+
+                state_.bind_framebuffer(pack_target_.fbo);
+                if (indexed) {
+                    use_program_with_unit(*shader, "u_palette", PALETTE_UNIT);
+                    glActiveTexture(GL_TEXTURE0 + PALETTE_UNIT);
+                    glBindTexture(GL_TEXTURE_2D, palette);
+                    glActiveTexture(GL_TEXTURE0);
+                    glUniform1i(shader->uniform_location("u_palette_size"), palette_size);
+                } else {
+                    state_.use_program(shader->program.get());
+                }
+                glUniform2i(shader->uniform_location("u_source_size"), layout.width, layout.height);
+                glUniform1i(shader->uniform_location("u_flip"), layout.flip_rows ? 1 : 0);
+                state_.count_state_change();
+
+                state_.bind_texture(texture);
+                state_.bind_vertex_array(vao_);
+                for (size_t i = 0; i < layout.plane_count; ++i) {
+                    const auto& plane = layout.planes[i];
+                    state_.viewport(plane.x, plane.y, plane.width, plane.height);
+                    glUniform2i(shader->uniform_location("u_origin"), plane.x, plane.y);
+                    if (layout.format == pack_format::yuv420) {
+                        glUniform1i(shader->uniform_location("u_plane"), static_cast <GLint>(i));
+                    }
+                    state_.count_state_change();
+                    state_.draw_quad();
+                }
+                detail::check_gl_error("After pack pass");
+
+                return pack_target_.texture;
             }
 
             /**
@@ -366,22 +743,26 @@ namespace scaler::gpu {
                 std::vector <GLuint> outputs;
                 outputs.reserve(inputs.size());
 
+                // Create all targets first: texture creation rebinds GL_TEXTURE_2D
+                // behind the state cache's back
                 for (const auto& input : inputs) {
-                    // Calculate output dimensions
                     auto dims = get_output_size(input.width, input.height, algo, scale_factor);
+                    outputs.push_back(create_output_texture(SCALER_SIZE_TO_GLSIZEI(dims.width),
+                                                            SCALER_SIZE_TO_GLSIZEI(dims.height)));
+                }
 
-                    // Create output texture
-                    GLuint output = create_output_texture(SCALER_SIZE_TO_GLSIZEI(dims.width),
-                                                          SCALER_SIZE_TO_GLSIZEI(dims.height));
+                // Keep GL state across the whole batch
+                scoped_gl_batch batch(state_);
+
+                for (size_t i = 0; i < inputs.size(); ++i) {
+                    const auto& input = inputs[i];
+                    auto dims = get_output_size(input.width, input.height, algo, scale_factor);
 
-                    // Scale the texture
                     scale_texture_to_texture(
                         input.texture, input.width, input.height,
-                        output, SCALER_SIZE_TO_GLSIZEI(dims.width), SCALER_SIZE_TO_GLSIZEI(dims.height),
+                        outputs[i], SCALER_SIZE_TO_GLSIZEI(dims.width), SCALER_SIZE_TO_GLSIZEI(dims.height),
                         algo
                     );
-
-                    outputs.push_back(output);
                 }
 
                 return outputs;
@@ -393,7 +774,8 @@ namespace scaler::gpu {
              * @param scale_factor Scale factor to precompile for
              */
             void precompile_shader(algorithm algo, float scale_factor) {
-                get_or_compile_shader(algo, scale_factor);
+                // Size-specialized variants are compiled on first use
+                get_or_compile_shader(variant_key(algo, scale_factor, 0, 0, 0, 0));
             }
 
             /**
@@ -419,6 +801,109 @@ namespace scaler::gpu {
                 }
             }
 
+            /**
+             * Compile shaders in the background instead of stalling the first draw
+             *
+             * While the program an algorithm needs is still compiling, draws
+             * fall back to nearest-neighbor. Each draw (and pump_shader_compiles())
+             * advances compilation; see shader_cache::pump() for how much work
+             * that is with and without GL_KHR_parallel_shader_compile.
+             *
+             * Enabling compiles the nearest fallback right away (one program
+             * for every scale and size), so call it with the context current.
+             */
+            void set_async_compile(bool enabled) {
+                async_compile_ = enabled;
+                if (async_compile_) {
+                    get_or_compile_shader(fallback_key());
+                }
+            }
+
+            [[nodiscard]] bool async_compile() const {
+                return async_compile_;
+            }
+
+            /**
+             * Queue shaders for (algorithm, scale) pairs without blocking
+             *
+             * Call at startup, then pump_shader_compiles() once per frame until
+             * it returns 0. Variants specialized for an input size are only
+             * known at draw time and are not covered.
+             * @throws unsupported_operation_error for combinations the GPU cannot scale
+             */
+            void prewarm(const std::vector <std::pair <algorithm, float>>& variants) {
+                for (const auto& [algo, scale_factor] : variants) {
+                    if (!algorithm_capabilities::is_gpu_scale_supported(algo, scale_factor)) {
+                        throw unsupported_operation_error(
+                            std::string("Cannot prewarm ") + algorithm_capabilities::get_algorithm_name(algo) +
+                            " at scale " + std::to_string(scale_factor));
+                    }
+
+                    if (const char* source = get_shader_for_algorithm_and_scale(algo, scale_factor)) {
+                        cache_->request(variant_key(algo, scale_factor, 0, 0, 0, 0),
+                                       shader_source::vertex_shader_source, source);
+                    }
+                }
+            }
+
+            /**
+             * Advance background compilation
+             * @return Number of shaders still compiling
+             */
+            size_t pump_shader_compiles() {
+                return cache_->pump();
+            }
+
+            [[nodiscard]] size_t pending_shaders() const {
+                return cache_->pending();
+            }
+
+            /**
+             * Select the shader specializations used from now on
+             *
+             * Already compiled variants stay cached, so switching back and forth
+             * does not recompile.
+             */
+            void set_shader_variants(const shader_variant_options& options) {
+                variant_options_ = options;
+                if (async_compile_) {
+                    get_or_compile_shader(fallback_key());
+                }
+            }
+
+            [[nodiscard]] const shader_variant_options& shader_variants() const {
+                return variant_options_;
+            }
+
+            /**
+             * Shader cache, possibly shared with scalers of other contexts
+             */
+            [[nodiscard]] const std::shared_ptr <shader_cache>& shaders() const {
+                return cache_;
+            }
+
+            /**
+             * GL state cache used by this scaler
+             *
+             * Open a scoped_gl_batch on it to keep state across many scaling
+             * calls; the caller's framebuffer and viewport are restored when
+             * the outermost batch closes.
+             */
+            gl_state_cache& state() {
+                return state_;
+            }
+
+            /**
+             * GL calls issued and avoided since construction or the last reset
+             */
+            const gl_call_stats& get_gl_stats() const {
+                return state_.stats();
+            }
+
+            void reset_gl_stats() {
+                state_.reset_stats();
+            }
+
             /**
              * Check if an algorithm is available for GPU acceleration
              */
@@ -274,6 +274,21 @@ namespace scaler::gpu::detail {
         }
     };
 
+    /**
+     * Whether the current context advertises an extension (GL 3.0+ query)
+     */
+    inline bool has_gl_extension(const char* name) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; ++i) {
+            const char* ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, SCALER_GLINT_TO_GLUINT(i)));
+            if (ext && std::strcmp(ext, name) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     /**
      * Helper to get OpenGL version info
      */
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <scaler/gpu/opengl_utils.hh>
+#include <scaler/warning_macros.hh>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+
+namespace scaler::gpu {
+
+    /**
+     * Layouts a scaled RGBA8 texture can be packed into before readback
+     */
+    enum class pack_format {
+        rgba8,    ///< As rendered, 4 bytes per pixel
+        bgra8,    ///< Red and blue swapped, 4 bytes per pixel
+        rgb565,   ///< 16-bit packed R5G6B5 in native byte order
+        indexed8, ///< Index of the nearest palette entry, 1 byte per pixel
+        yuv420    ///< Planar BT.601 video range Y, then U and V at half width and height (I420)
+    };
+
+    /**
+     * One rectangle of the packed texture, read back tightly packed
+     */
+    struct pack_plane {
+        GLint x = 0;
+        GLint y = 0;
+        GLsizei width = 0;
+        GLsizei height = 0;
+    };
+
+    /**
+     * Where a pack pass writes an image of a given size and how it is read back
+     *
+     * Planes are read back one after the other into a single buffer of
+     * bytes(), so a yuv420 readback is a ready I420 frame.
+     */
+    struct pack_layout {
+        pack_format format = pack_format::rgba8;
+        GLsizei width = 0;                  ///< Image size in pixels
+        GLsizei height = 0;
+        bool flip_rows = false;             ///< Top row first instead of glReadPixels' bottom row first
+        GLsizei texture_width = 0;          ///< Size of the packed texture
+        GLsizei texture_height = 0;
+        GLenum internal_format = GL_RGBA8;  ///< Of the packed texture
+        GLenum read_format = GL_RGBA;       ///< glReadPixels format and type
+        GLenum read_type = GL_UNSIGNED_BYTE;
+        size_t bytes_per_pixel = 4;
+        std::array <pack_plane, 3> planes{};
+        size_t plane_count = 1;
+
+        /// Whether the texture has to go through a pack pass, or is read back as rendered
+        [[nodiscard]] bool needs_pass() const {
+            return flip_rows || (format != pack_format::rgba8 && format != pack_format::bgra8);
+        }
+
+        /// Bytes of one readback
+        [[nodiscard]] size_t bytes() const {
+            size_t total = 0;
+            for (size_t i = 0; i < plane_count; ++i) {
+                total += SCALER_GLSIZEI_TO_SIZE(planes[i].width) * SCALER_GLSIZEI_TO_SIZE(planes[i].height) *
+                         bytes_per_pixel;
+            }
+            return total;
+        }
+    };
+
+    /**
+     * Layout of a width x height image packed as format
+     *
+     * yuv420 chroma samples the average of each 2x2 block; odd sizes round
+     * the chroma planes up and repeat the last row or column.
+     *
+     * @throws std::invalid_argument if dimensions are not positive
+     */
+    inline pack_layout make_pack_layout(pack_format format, GLsizei width, GLsizei height, bool flip_rows = false) {
+        if (width <= 0 || height <= 0) {
+            throw std::invalid_argument("make_pack_layout: dimensions must be positive");
+        }
+
+        pack_layout layout;
+        layout.format = format;
+        layout.width = width;
+        layout.height = height;
+        layout.flip_rows = flip_rows;
+        layout.texture_width = width;
+        layout.texture_height = height;
+        layout.planes[0] = {0, 0, width, height};
+
+        switch (format) {
+            case pack_format::rgba8:
+                break;
+            case pack_format::bgra8:
+                layout.read_format = GL_BGRA;
+                break;
+            case pack_format::rgb565:
+                layout.internal_format = GL_R16UI;
+                layout.read_format = GL_RED_INTEGER;
+                layout.read_type = GL_UNSIGNED_SHORT;
+                layout.bytes_per_pixel = 2;
+                break;
+            case pack_format::indexed8:
+                layout.internal_format = GL_R8UI;
+                layout.read_format = GL_RED_INTEGER;
+                layout.bytes_per_pixel = 1;
+                break;
+            case pack_format::yuv420: {
+                // Y on top, U and V side by side below it
+                const GLsizei chroma_width = (width + 1) / 2;
+                const GLsizei chroma_height = (height + 1) / 2;
+                layout.texture_width = std::max(width, 2 * chroma_width);
+                layout.texture_height = height + chroma_height;
+                layout.internal_format = GL_R8UI;
+                layout.read_format = GL_RED_INTEGER;
+                layout.bytes_per_pixel = 1;
+                layout.planes[1] = {0, height, chroma_width, chroma_height};
+                layout.planes[2] = {chroma_width, height, chroma_width, chroma_height};
+                layout.plane_count = 3;
+                break;
+            }
+        }
+        return layout;
+    }
+
+} // namespace scaler::gpu
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <scaler/gpu/opengl_utils.hh>
+#include <scaler/gpu/gpu_exceptions.hh>
+#include <scaler/warning_macros.hh>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace scaler::gpu {
+
+    /**
+     * Pixel layouts that can be uploaded without CPU-side expansion
+     */
+    enum class raw_pixel_format {
+        indexed8, ///< 8-bit palette indices + up to 256 RGBA palette entries
+        rgb565    ///< 16-bit packed R5G6B5 in native byte order
+    };
+
+    inline size_t raw_bytes_per_pixel(raw_pixel_format format) {
+        return format == raw_pixel_format::indexed8 ? 1 : 2;
+    }
+
+    /**
+     * GPU texture holding pixels in their native retro format
+     *
+     * Indexed and RGB565 images are uploaded as-is into an integer texture
+     * (GL_R8UI / GL_R16UI), i.e. at 1/4 and 1/2 of the bytes of an RGBA8
+     * upload, and the CPU never converts them. opengl_texture_scaler decodes
+     * them on the GPU in a first 1:1 pass before running the scaling shader
+     * (see scale_raw_to_texture()).
+     *
+     * @code
+     * gpu::raw_texture frame(gpu::raw_pixel_format::indexed8, 320, 200);
+     * frame.upload_palette(palette_rgba, 256);   // only when it changes
+     * // per frame:
+     * frame.upload(surface->pixels, surface->pitch);
+     * scaler.scale_raw_to_texture(frame, output_tex, 640, 400, algorithm::EPX);
+     * @endcode
+     *
+     * @note Requires the owning GL context to be current for all calls
+     * @note Uploads rebind GL_TEXTURE_2D; do them outside a scoped_gl_batch
+     *       (or call gl_state_cache::invalidate() afterwards)
+     */
+    class raw_texture {
+        public:
+            /**
+             * @throws std::invalid_argument if dimensions are not positive
+             */
+            raw_texture(raw_pixel_format format, GLsizei width, GLsizei height)
+                : format_(format),
+                  width_(width),
+                  height_(height) {
+                if (width <= 0 || height <= 0) {
+                    throw std::invalid_argument("raw_texture dimensions must be positive");
+                }
+
+                texture_ = detail::make_texture();
+                const bool indexed = format == raw_pixel_format::indexed8;
+                allocate(texture_, indexed ? GL_R8UI : GL_R16UI, width, height,
+                         GL_RED_INTEGER, indexed ? GL_UNSIGNED_BYTE : GL_UNSIGNED_SHORT);
+
+                if (indexed) {
+                    palette_ = detail::make_texture();
+                    // Unused entries decode to opaque black
+                    std::vector<std::uint8_t> black(palette_size * 4, 0);
+                    for (size_t i = 0; i < palette_size; ++i) {
+                        black[i * 4 + 3] = 255;
+                    }
+                    allocate(palette_, GL_RGBA8, static_cast<GLsizei>(palette_size), 1,
+                             GL_RGBA, GL_UNSIGNED_BYTE, black.data());
+                }
+
+                detail::check_gl_error("After raw_texture creation");
+            }
+
+            raw_texture(raw_texture&&) noexcept = default;
+            raw_texture& operator=(raw_texture&&) noexcept = default;
+
+            /**
+             * Upload a full frame
+             * @param pixels First row of pixels (indices or RGB565 values)
+             * @param pitch Bytes between rows; 0 means tightly packed
+             */
+            void upload(const void* pixels, size_t pitch = 0) {
+                const size_t bpp = raw_bytes_per_pixel(format_);
+                const size_t row_bytes = static_cast<size_t>(width_) * bpp;
+                if (pitch == 0) {
+                    pitch = row_bytes;
+                }
+                if (pitch < row_bytes || pitch % bpp != 0) {
+                    throw std::invalid_argument("raw_texture::upload: invalid pitch");
+                }
+
+                const bool indexed = format_ == raw_pixel_format::indexed8;
+                glBindTexture(GL_TEXTURE_2D, texture_.get());
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(pitch / bpp));
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, GL_RED_INTEGER,
+                                indexed ? GL_UNSIGNED_BYTE : GL_UNSIGNED_SHORT, pixels);
+                glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                glBindTexture(GL_TEXTURE_2D, 0);
+
+                uploaded_bytes_ += row_bytes * static_cast<size_t>(height_);
+                detail::check_gl_error("After raw_texture::upload");
+            }
+
+            /**
+             * Replace palette entries [0, count) of an indexed texture
+             * @param rgba count * 4 bytes (R, G, B, A); alpha is passed through
+             * @throws unsupported_operation_error for non-indexed textures
+             */
+            void upload_palette(const std::uint8_t* rgba, size_t count) {
+                if (format_ != raw_pixel_format::indexed8) {
+                    throw unsupported_operation_error("palette upload on a non-indexed raw_texture");
+                }
+                if (count > palette_size) {
+                    throw std::invalid_argument("raw_texture::upload_palette: more than 256 entries");
+                }
+                if (count == 0) {
+                    return;
+                }
+
+                glBindTexture(GL_TEXTURE_2D, palette_.get());
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, static_cast<GLsizei>(count), 1,
+                                GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                glBindTexture(GL_TEXTURE_2D, 0);
+
+                uploaded_bytes_ += count * 4;
+                detail::check_gl_error("After raw_texture::upload_palette");
+            }
+
+            [[nodiscard]] raw_pixel_format format() const { return format_; }
+            [[nodiscard]] GLsizei width() const { return width_; }
+            [[nodiscard]] GLsizei height() const { return height_; }
+            [[nodiscard]] GLuint id() const { return texture_.get(); }
+            [[nodiscard]] GLuint palette_id() const { return palette_.get(); }
+
+            // Bytes sent to the GPU by upload()/upload_palette() so far
+            [[nodiscard]] size_t uploaded_bytes() const { return uploaded_bytes_; }
+
+            static constexpr size_t palette_size = 256;
+
+        private:
+            static void allocate(const detail::texture_resource& texture, GLint internal_format,
+                                 GLsizei width, GLsizei height, GLenum format, GLenum type,
+                                 const void* data = nullptr) {
+                glBindTexture(GL_TEXTURE_2D, texture.get());
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, type, data);
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                // Integer textures are only complete with non-filtering, non-mipmapped sampling
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                glBindTexture(GL_TEXTURE_2D, 0);
+            }
+
+            raw_pixel_format format_;
+            GLsizei width_;
+            GLsizei height_;
+            detail::texture_resource texture_;
+            detail::texture_resource palette_;
+            size_t uploaded_bytes_ = 0;
+    };
+
+} // namespace scaler::gpu
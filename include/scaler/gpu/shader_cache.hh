@@ -1,13 +1,23 @@
 #pragma once
 
 #include <scaler/gpu/opengl_utils.hh>
+#include <scaler/gpu/shader_source.hh>
+#include <scaler/gpu/shader_variant.hh>
 #include <scaler/algorithm.hh>
+#include <algorithm>
 #include <unordered_map>
+#include <atomic>
 #include <mutex>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+// GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile (same value)
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 namespace scaler::gpu {
 
     /**
@@ -26,10 +36,26 @@ namespace scaler::gpu {
         GLint u_time = -1;  // For animated effects
         GLint u_sharpness = -1;  // For adjustable sharpness
 
+        // Index of the scaler_params uniform block (GL_INVALID_INDEX if unused)
+        GLuint params_block = GL_INVALID_INDEX;
+
+        // Every active default-block uniform, filled once at link time. Programs
+        // are shared by all scalers of a share group, possibly on several
+        // threads, so the table is never modified afterwards.
+        std::unordered_map<std::string, GLint> uniform_locations;
+
         bool is_valid() const {
             return program.is_valid();
         }
 
+        /**
+         * Location of a uniform by name, -1 if the program has no such uniform
+         */
+        GLint uniform_location(const char* name) const {
+            auto it = uniform_locations.find(name);
+            return it != uniform_locations.end() ? it->second : -1;
+        }
+
         void use() const {
             if (!is_valid()) {
                 throw std::runtime_error("Attempting to use invalid shader program");
@@ -63,6 +89,27 @@ namespace scaler::gpu {
         mutable std::unique_ptr<std::mutex> mutex_;
         std::unordered_map<algorithm, shader_program> algo_cache_;
         std::unordered_map<std::string, shader_program> string_cache_;
+        std::unordered_map<shader_variant_key, shader_program, shader_variant_key_hash> variant_cache_;
+
+        /**
+         * Variant requested through request() that is not linked yet
+         */
+        struct pending_variant {
+            shader_variant_key key;
+            const char* vertex_source = nullptr;
+            std::string fragment_source;    // specialized
+            detail::shader_resource vertex;
+            detail::shader_resource fragment;
+            detail::program_resource program; // valid once compilation started
+        };
+
+        // In request order
+        std::vector<pending_variant> pending_;
+        // -1 = not queried yet (needs a current context)
+        int parallel_compile_ = -1;
+
+        // Bumped by clear(); lets users keep their own program pointers
+        std::atomic<unsigned int> generation_{0};
 
         // Currently active shader
         algorithm current_algorithm_ = algorithm::Nearest;
@@ -72,6 +119,15 @@ namespace scaler::gpu {
          * Compile a shader from source
          */
         static detail::shader_resource compile_shader(GLenum type, const char* source) {
+            auto shader = start_compile_shader(type, source);
+            check_compiled(shader, type);
+            return shader;
+        }
+
+        /**
+         * Submit a shader to the driver without waiting for the result
+         */
+        static detail::shader_resource start_compile_shader(GLenum type, const char* source) {
             auto shader = detail::make_shader(type);
 
             if (!shader.is_valid()) {
@@ -80,8 +136,13 @@ namespace scaler::gpu {
 
             glShaderSource(shader.get(), 1, &source, nullptr);
             glCompileShader(shader.get());
+            return shader;
+        }
 
-            // Check compilation status
+        /**
+         * Throw with the info log if compilation failed (blocks until it finished)
+         */
+        static void check_compiled(const detail::shader_resource& shader, GLenum type) {
             GLint success;
             glGetShaderiv(shader.get(), GL_COMPILE_STATUS, &success);
 
@@ -97,8 +158,6 @@ namespace scaler::gpu {
                 throw std::runtime_error("Failed to compile " + shader_type + " shader: " +
                                        std::string(error_log.data()));
             }
-
-            return shader;
         }
 
         /**
@@ -106,16 +165,64 @@ namespace scaler::gpu {
          */
         static shader_program link_program(const detail::shader_resource& vertex,
                                           const detail::shader_resource& fragment) {
-            shader_program result;
-            result.program = detail::make_program();
+            return finish_link(start_link(vertex, fragment), vertex, fragment);
+        }
 
-            if (!result.program.is_valid()) {
+        /**
+         * Submit the link without waiting for the result
+         */
+        static detail::program_resource start_link(const detail::shader_resource& vertex,
+                                                   const detail::shader_resource& fragment) {
+            auto program = detail::make_program();
+
+            if (!program.is_valid()) {
                 throw std::runtime_error("Failed to create shader program");
             }
 
-            glAttachShader(result.program.get(), vertex.get());
-            glAttachShader(result.program.get(), fragment.get());
-            glLinkProgram(result.program.get());
+            glAttachShader(program.get(), vertex.get());
+            glAttachShader(program.get(), fragment.get());
+            glLinkProgram(program.get());
+            return program;
+        }
+
+        /**
+         * Locations of the active uniforms of a linked program; arrays are
+         * listed under both "name" and "name[0]", block members not at all
+         */
+        static std::unordered_map<std::string, GLint> active_uniform_locations(GLuint program) {
+            std::unordered_map<std::string, GLint> locations;
+            GLint count = 0;
+            GLint max_length = 0;
+            glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+            glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+            std::vector<char> name(SCALER_GLINT_TO_SIZE(std::max(max_length, 1)));
+            for (GLint i = 0; i < count; ++i) {
+                GLsizei length = 0;
+                GLint size = 0;
+                GLenum type = 0;
+                glGetActiveUniform(program, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()),
+                                   &length, &size, &type, name.data());
+                std::string uniform(name.data(), SCALER_GLSIZEI_TO_SIZE(length));
+                const GLint location = glGetUniformLocation(program, uniform.c_str());
+                if (location < 0) {
+                    continue;
+                }
+                if (uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0) {
+                    locations.emplace(uniform.substr(0, uniform.size() - 3), location);
+                }
+                locations.emplace(std::move(uniform), location);
+            }
+            return locations;
+        }
+
+        /**
+         * Check the link status (blocks until linked) and query uniform locations
+         */
+        static shader_program finish_link(detail::program_resource program,
+                                          const detail::shader_resource& vertex,
+                                          const detail::shader_resource& fragment) {
+            shader_program result;
+            result.program = std::move(program);
 
             // Check link status
             GLint success;
@@ -148,6 +255,15 @@ namespace scaler::gpu {
             result.u_time = glGetUniformLocation(result.program.get(), "u_time");
             result.u_sharpness = glGetUniformLocation(result.program.get(), "u_sharpness");
 
+            result.uniform_locations = active_uniform_locations(result.program.get());
+
+            // Size parameters come from the shared uniform buffer
+            result.params_block = glGetUniformBlockIndex(result.program.get(), "scaler_params");
+            if (result.params_block != GL_INVALID_INDEX) {
+                glUniformBlockBinding(result.program.get(), result.params_block,
+                                      shader_source::scaler_params_binding);
+            }
+
             return result;
         }
 
@@ -159,6 +275,10 @@ namespace scaler::gpu {
             : mutex_(std::make_unique<std::mutex>())
             , algo_cache_(std::move(other.algo_cache_))
             , string_cache_(std::move(other.string_cache_))
+            , variant_cache_(std::move(other.variant_cache_))
+            , pending_(std::move(other.pending_))
+            , parallel_compile_(other.parallel_compile_)
+            , generation_(other.generation_.load() + 1)
             , current_algorithm_(other.current_algorithm_)
             , current_shader_(nullptr) {}
 
@@ -167,6 +287,10 @@ namespace scaler::gpu {
             if (this != &other) {
                 algo_cache_ = std::move(other.algo_cache_);
                 string_cache_ = std::move(other.string_cache_);
+                variant_cache_ = std::move(other.variant_cache_);
+                pending_ = std::move(other.pending_);
+                parallel_compile_ = other.parallel_compile_;
+                generation_.fetch_add(1);
                 current_algorithm_ = other.current_algorithm_;
                 current_shader_ = nullptr;
             }
@@ -209,6 +333,144 @@ namespace scaler::gpu {
             return inserted_it->second;
         }
 
+        /**
+         * Get or compile a specialized variant of fragment_source
+         * (see specialize_shader())
+         */
+        const shader_program& get_or_compile(const shader_variant_key& key,
+                                            const char* vertex_source,
+                                            const char* fragment_source) {
+            std::lock_guard<std::mutex> lock(*mutex_);
+
+            auto it = variant_cache_.find(key);
+            if (it != variant_cache_.end()) {
+                return it->second;
+            }
+
+            const std::string specialized = specialize_shader(fragment_source, key);
+            shader_program program = compile(vertex_source, specialized.c_str());
+            auto [inserted_it, success] = variant_cache_.emplace(key, std::move(program));
+            return inserted_it->second;
+        }
+
+        /**
+         * Check if a variant is cached
+         */
+        bool is_cached(const shader_variant_key& key) const {
+            std::lock_guard<std::mutex> lock(*mutex_);
+            return variant_cache_.find(key) != variant_cache_.end();
+        }
+
+        /**
+         * Changes whenever previously returned programs may have been destroyed
+         * (clear() or move); readable without the cache's lock
+         */
+        unsigned int generation() const {
+            return generation_.load(std::memory_order_acquire);
+        }
+
+        /**
+         * Cached variant, or nullptr if it was never compiled (does not compile)
+         */
+        const shader_program* find(const shader_variant_key& key) const {
+            std::lock_guard<std::mutex> lock(*mutex_);
+            auto it = variant_cache_.find(key);
+            return it != variant_cache_.end() ? &it->second : nullptr;
+        }
+
+        /**
+         * Queue a variant for background compilation; see pump()
+         */
+        void request(const shader_variant_key& key,
+                     const char* vertex_source,
+                     const char* fragment_source) {
+            std::lock_guard<std::mutex> lock(*mutex_);
+            if (variant_cache_.find(key) != variant_cache_.end()) {
+                return;
+            }
+            for (const auto& pending : pending_) {
+                if (pending.key == key) {
+                    return;
+                }
+            }
+
+            pending_variant pending;
+            pending.key = key;
+            pending.vertex_source = vertex_source;
+            pending.fragment_source = specialize_shader(fragment_source, key);
+            pending_.push_back(std::move(pending));
+        }
+
+        /**
+         * Advance queued compilations without blocking on the driver
+         *
+         * With GL_KHR_parallel_shader_compile (or the ARB variant) every
+         * queued program is submitted at once and only collected when the
+         * driver reports completion. Without it, one program is compiled per
+         * call, so the stall per frame is bounded by a single program.
+         *
+         * @return Number of variants still pending
+         * @throws std::runtime_error with the info log if a variant fails;
+         *         the failed variant is dropped from the queue
+         */
+        size_t pump() {
+            std::lock_guard<std::mutex> lock(*mutex_);
+            if (pending_.empty()) {
+                return 0;
+            }
+
+            if (parallel_compile_ < 0) {
+                parallel_compile_ = detail::has_gl_extension("GL_KHR_parallel_shader_compile") ||
+                                    detail::has_gl_extension("GL_ARB_parallel_shader_compile");
+            }
+
+            if (!parallel_compile_) {
+                pending_variant pending = std::move(pending_.front());
+                pending_.erase(pending_.begin());
+                variant_cache_.emplace(pending.key,
+                                       compile(pending.vertex_source, pending.fragment_source.c_str()));
+                return pending_.size();
+            }
+
+            for (auto& pending : pending_) {
+                if (!pending.program.is_valid()) {
+                    pending.vertex = start_compile_shader(GL_VERTEX_SHADER, pending.vertex_source);
+                    pending.fragment = start_compile_shader(GL_FRAGMENT_SHADER, pending.fragment_source.c_str());
+                    pending.program = start_link(pending.vertex, pending.fragment);
+                }
+            }
+
+            for (auto it = pending_.begin(); it != pending_.end();) {
+                GLint done = GL_FALSE;
+                glGetProgramiv(it->program.get(), GL_COMPLETION_STATUS_KHR, &done);
+                if (!done) {
+                    ++it;
+                    continue;
+                }
+
+                pending_variant finished = std::move(*it);
+                it = pending_.erase(it);
+                GLint linked = GL_FALSE;
+                glGetProgramiv(finished.program.get(), GL_LINK_STATUS, &linked);
+                if (!linked) {
+                    // Report the compile log when a stage failed
+                    check_compiled(finished.vertex, GL_VERTEX_SHADER);
+                    check_compiled(finished.fragment, GL_FRAGMENT_SHADER);
+                }
+                variant_cache_.emplace(finished.key,
+                                       finish_link(std::move(finished.program), finished.vertex, finished.fragment));
+            }
+            return pending_.size();
+        }
+
+        /**
+         * Number of variants queued by request() and not finished yet
+         */
+        size_t pending() const {
+            std::lock_guard<std::mutex> lock(*mutex_);
+            return pending_.size();
+        }
+
         /**
          * Get or compile shader for algorithm
          */
@@ -275,6 +537,9 @@ namespace scaler::gpu {
             std::lock_guard<std::mutex> lock(*mutex_);
             algo_cache_.clear();
             string_cache_.clear();
+            variant_cache_.clear();
+            pending_.clear();
+            generation_.fetch_add(1);
             current_shader_ = nullptr;
             current_algorithm_ = algorithm::Nearest;
         }
@@ -301,11 +566,14 @@ namespace scaler::gpu {
          */
         size_t size() const {
             std::lock_guard<std::mutex> lock(*mutex_);
-            return algo_cache_.size() + string_cache_.size();
+            return algo_cache_.size() + string_cache_.size() + variant_cache_.size();
         }
 
         /**
-         * Set uniform values for current shader
+         * Set default-block uniform values for current shader
+         *
+         * Shaders from shader_source read their sizes from the scaler_params
+         * uniform block instead; fill it with gl_state_cache::upload_params().
          */
         void set_uniforms(GLsizei input_width, GLsizei input_height,
                          GLsizei output_width, GLsizei output_height,
@@ -341,7 +609,7 @@ namespace scaler::gpu {
             const shader_program* shader = get_current();
             if (!shader || !shader->is_valid()) return;
 
-            GLint location = glGetUniformLocation(shader->program.get(), name);
+            GLint location = shader->uniform_location(name);
             if (location >= 0) {
                 glUniform1f(location, value);
             }
@@ -351,7 +619,7 @@ namespace scaler::gpu {
             const shader_program* shader = get_current();
             if (!shader || !shader->is_valid()) return;
 
-            GLint location = glGetUniformLocation(shader->program.get(), name);
+            GLint location = shader->uniform_location(name);
             if (location >= 0) {
                 glUniform1i(location, value);
             }
@@ -5,6 +5,11 @@
 #pragma once
 
 namespace scaler::gpu::shader_source {
+    // Per-draw sizes are read from the std140 "scaler_params" uniform block
+    // (binding point scaler_params_binding), filled by gl_state_cache from a
+    // single uniform buffer. The sampler u_texture always uses unit 0.
+    static constexpr unsigned int scaler_params_binding = 0;
+
     // Vertex shader - common for all scaling algorithms
     static constexpr const char* vertex_shader_source = R"(
         #version 330 core
@@ -36,7 +41,10 @@ namespace scaler::gpu::shader_source {
         in vec2 v_texCoord;
         out vec4 FragColor;
         uniform sampler2D u_texture;
-        uniform vec2 u_texture_size;
+        layout(std140) uniform scaler_params {
+            vec2 u_texture_size;
+            vec2 u_output_size;
+        };
 
         void main() {
             vec2 texel = 1.0 / u_texture_size;
@@ -73,8 +81,10 @@ namespace scaler::gpu::shader_source {
         in vec2 v_texCoord;
         out vec4 FragColor;
         uniform sampler2D u_texture;
-        uniform vec2 u_texture_size;
-        uniform vec2 u_output_size;
+        layout(std140) uniform scaler_params {
+            vec2 u_texture_size;
+            vec2 u_output_size;
+        };
 
         vec4 sampleTexture(vec2 pos) {
             vec2 clamped = clamp(pos, vec2(0.0), vec2(1.0));
@@ -117,8 +127,10 @@ namespace scaler::gpu::shader_source {
         in vec2 v_texCoord;
         out vec4 FragColor;
         uniform sampler2D u_texture;
-        uniform vec2 u_texture_size;
-        uniform vec2 u_output_size;
+        layout(std140) uniform scaler_params {
+            vec2 u_texture_size;
+            vec2 u_output_size;
+        };
 
         bool threeOrMoreIdentical(vec4 a, vec4 b, vec4 c, vec4 d) {
             int equal_pairs = 0;
@@ -202,8 +214,10 @@ namespace scaler::gpu::shader_source {
         in vec2 v_texCoord;
         out vec4 FragColor;
         uniform sampler2D u_texture;
-        uniform vec2 u_texture_size;
-        uniform vec2 u_output_size;
+        layout(std140) uniform scaler_params {
+            vec2 u_texture_size;
+            vec2 u_output_size;
+        };
 
         vec4 sampleTexture(vec2 pos) {
             vec2 clamped = clamp(pos, vec2(0.0), vec2(1.0));
@@ -311,8 +325,10 @@ namespace scaler::gpu::shader_source {
         in vec2 v_texCoord;
         out vec4 FragColor;
         uniform sampler2D u_texture;
-        uniform vec2 u_texture_size;
-        uniform vec2 u_output_size;
+        layout(std140) uniform scaler_params {
+            vec2 u_texture_size;
+            vec2 u_output_size;
+        };
 
         vec4 sampleTexture(vec2 pos) {
             vec2 clamped = clamp(pos, vec2(0.0), vec2(1.0));
@@ -421,8 +437,10 @@ namespace scaler::gpu::shader_source {
         in vec2 v_texCoord;
         out vec4 FragColor;
         uniform sampler2D u_texture;
-        uniform vec2 u_texture_size;
-        uniform vec2 u_output_size;
+        layout(std140) uniform scaler_params {
+            vec2 u_texture_size;
+            vec2 u_output_size;
+        };
 
         vec4 sampleTexture(vec2 pos) {
             vec2 clamped = clamp(pos, vec2(0.0), vec2(1.0));
@@ -489,8 +507,10 @@ namespace scaler::gpu::shader_source {
         in vec2 v_texCoord;
         out vec4 FragColor;
         uniform sampler2D u_texture;
-        uniform vec2 u_texture_size;
-        uniform vec2 u_output_size;
+        layout(std140) uniform scaler_params {
+            vec2 u_texture_size;
+            vec2 u_output_size;
+        };
 
         vec4 sampleTexture(vec2 pos) {
             vec2 clamped = clamp(pos, vec2(0.0), vec2(1.0));
@@ -632,8 +652,10 @@ namespace scaler::gpu::shader_source {
         in vec2 v_texCoord;
         out vec4 FragColor;
         uniform sampler2D u_texture;
-        uniform vec2 u_texture_size;
-        uniform vec2 u_output_size;
+        layout(std140) uniform scaler_params {
+            vec2 u_texture_size;
+            vec2 u_output_size;
+        };
 
         vec4 sampleTexture(vec2 pos) {
             // Clamp to texture bounds to handle edge cases
@@ -728,8 +750,10 @@ namespace scaler::gpu::shader_source {
         in vec2 v_texCoord;
         out vec4 FragColor;
         uniform sampler2D u_texture;
-        uniform vec2 u_texture_size;
-        uniform vec2 u_output_size;
+        layout(std140) uniform scaler_params {
+            vec2 u_texture_size;
+            vec2 u_output_size;
+        };
 
         vec4 sampleTexture(vec2 pos) {
             // Clamp to texture bounds to handle edge cases
@@ -818,8 +842,10 @@ namespace scaler::gpu::shader_source {
         in vec2 v_texCoord;
         out vec4 FragColor;
         uniform sampler2D u_texture;
-        uniform vec2 u_texture_size;
-        uniform vec2 u_output_size;
+        layout(std140) uniform scaler_params {
+            vec2 u_texture_size;
+            vec2 u_output_size;
+        };
 
         vec4 sampleTexture(vec2 pos) {
             // Clamp to texture bounds to handle edge cases
@@ -913,8 +939,10 @@ namespace scaler::gpu::shader_source {
         in vec2 v_texCoord;
         out vec4 FragColor;
         uniform sampler2D u_texture;
-        uniform vec2 u_texture_size;
-        uniform vec2 u_output_size;
+        layout(std140) uniform scaler_params {
+            vec2 u_texture_size;
+            vec2 u_output_size;
+        };
 
         vec4 sampleTexture(vec2 pos) {
             vec2 clamped = clamp(pos, vec2(0.0), vec2(1.0));
@@ -983,8 +1011,10 @@ namespace scaler::gpu::shader_source {
         in vec2 v_texCoord;
         out vec4 FragColor;
         uniform sampler2D u_texture;
-        uniform vec2 u_texture_size;
-        uniform vec2 u_output_size;
+        layout(std140) uniform scaler_params {
+            vec2 u_texture_size;
+            vec2 u_output_size;
+        };
 
         // HQ colorspace conversion for pattern detection
         vec3 rgb_to_hq_colospace(vec4 rgb) {
@@ -1004,6 +1034,14 @@ namespace scaler::gpu::shader_source {
 
         #define P(m, r) ((pattern & (m)) == (r))
 
+        // Diagonal of one output pixel in source pixels; a constant in
+        // variants specialized for an integral scale (see shader_variant.hh)
+        #ifdef SCALER_SCALE
+        #define SCALER_PIXEL_SIZE length(vec2(1.0 / float(SCALER_SCALE)))
+        #else
+        #define SCALER_PIXEL_SIZE length(1.0 / (output_resolution / input_resolution))
+        #endif
+
         void main() {
             vec2 position = v_texCoord;
             vec2 input_resolution = u_texture_size;
@@ -1074,7 +1112,7 @@ namespace scaler::gpu::shader_source {
             }
             if (P(0x2F,0x2F)) {
                 float dist = length(p - vec2(0.5));
-                float pixel_size = length(1.0 / (output_resolution / input_resolution));
+                float pixel_size = SCALER_PIXEL_SIZE;
                 if (dist < 0.5 - pixel_size / 2.0) {
                     FragColor = w4;
                     return;
@@ -1096,7 +1134,7 @@ namespace scaler::gpu::shader_source {
             }
             if (P(0xBF,0x37) || P(0xDB,0x13)) {
                 float dist = p.x - 2.0 * p.y;
-                float pixel_size = length(1.0 / (output_resolution / input_resolution)) * sqrt(5.0);
+                float pixel_size = SCALER_PIXEL_SIZE * sqrt(5.0);
                 if (dist > pixel_size / 2.0) {
                     FragColor = w1;
                     return;
@@ -1111,7 +1149,7 @@ namespace scaler::gpu::shader_source {
             }
             if (P(0xDB,0x49) || P(0xEF,0x6D)) {
                 float dist = p.y - 2.0 * p.x;
-                float pixel_size = length(1.0 / (output_resolution / input_resolution)) * sqrt(5.0);
+                float pixel_size = SCALER_PIXEL_SIZE * sqrt(5.0);
                 if (p.y - 2.0 * p.x > pixel_size / 2.0) {
                     FragColor = w3;
                     return;
@@ -1126,7 +1164,7 @@ namespace scaler::gpu::shader_source {
             }
             if (P(0xBF,0x8F) || P(0x7E,0x0E)) {
                 float dist = p.x + 2.0 * p.y;
-                float pixel_size = length(1.0 / (output_resolution / input_resolution)) * sqrt(5.0);
+                float pixel_size = SCALER_PIXEL_SIZE * sqrt(5.0);
 
                 if (dist > 1.0 + pixel_size / 2.0) {
                     FragColor = w4;
@@ -1152,7 +1190,7 @@ namespace scaler::gpu::shader_source {
 
             if (P(0x7E,0x2A) || P(0xEF,0xAB)) {
                 float dist = p.y + 2.0 * p.x;
-                float pixel_size = length(1.0 / (output_resolution / input_resolution)) * sqrt(5.0);
+                float pixel_size = SCALER_PIXEL_SIZE * sqrt(5.0);
 
                 if (p.y + 2.0 * p.x > 1.0 + pixel_size / 2.0) {
                     FragColor = w4;
@@ -1197,7 +1235,7 @@ namespace scaler::gpu::shader_source {
                 P(0xBE,0x0A) || P(0xEE,0x0A) || P(0x7E,0x0A) || P(0xEB,0x4B) ||
                 P(0x3B,0x1B)) {
                 float dist = p.x + p.y;
-                float pixel_size = length(1.0 / (output_resolution / input_resolution));
+                float pixel_size = SCALER_PIXEL_SIZE;
 
                 if (dist > 0.5 + pixel_size / 2.0) {
                     FragColor = w4;
@@ -1232,7 +1270,7 @@ namespace scaler::gpu::shader_source {
             }
 
             float dist = p.x + p.y;
-            float pixel_size = length(1.0 / (output_resolution / input_resolution));
+            float pixel_size = SCALER_PIXEL_SIZE;
 
             if (dist > 0.5 + pixel_size / 2.0) {
                 FragColor = w4;
@@ -1275,4 +1313,139 @@ namespace scaler::gpu::shader_source {
             FragColor = w4;
         }
     )";
+
+    // Raw-format decode passes (see raw_texture.hh). They run at 1:1 scale and
+    // address texels by fragment position, so the decoded texture has exactly
+    // the layout an RGBA8 upload of the same image would have.
+
+    // 8-bit indices (GL_R8UI on unit 0) looked up in a 256x1 RGBA8 palette (unit 1)
+    static constexpr const char* indexed_decode_fragment_shader = R"(
+        #version 330 core
+        out vec4 FragColor;
+        uniform usampler2D u_texture;
+        uniform sampler2D u_palette;
+
+        void main() {
+            uint index = texelFetch(u_texture, ivec2(gl_FragCoord.xy), 0).r;
+            FragColor = texelFetch(u_palette, ivec2(int(index), 0), 0);
+        }
+    )";
+
+    // Packed RGB565 (GL_R16UI on unit 0), widened exactly like a 5/6-bit UNORM
+    static constexpr const char* rgb565_decode_fragment_shader = R"(
+        #version 330 core
+        out vec4 FragColor;
+        uniform usampler2D u_texture;
+
+        void main() {
+            uint v = texelFetch(u_texture, ivec2(gl_FragCoord.xy), 0).r;
+            FragColor = vec4(float((v >> 11u) & 31u) / 31.0,
+                             float((v >> 5u) & 63u) / 63.0,
+                             float(v & 31u) / 31.0,
+                             1.0);
+        }
+    )";
+
+    // Readback pack passes (see pack_format.hh). They address the source by
+    // fragment position like the decode passes; u_origin is the corner of the
+    // plane being drawn, and u_flip makes row 0 the image's top row. Colours
+    // are converted from exact 8-bit values, so results match a CPU
+    // conversion of an RGBA8 readback bit for bit.
+
+    // RGBA8 unchanged, only flipped (bgra8 swaps at readback)
+    static constexpr const char* pack_copy_fragment_shader = R"(
+        #version 330 core
+        out vec4 FragColor;
+        uniform sampler2D u_texture;
+        uniform ivec2 u_source_size;
+        uniform int u_flip;
+        uniform ivec2 u_origin;
+
+        void main() {
+            ivec2 p = ivec2(gl_FragCoord.xy) - u_origin;
+            if (u_flip != 0) p.y = u_source_size.y - 1 - p.y;
+            FragColor = texelFetch(u_texture, p, 0);
+        }
+    )";
+
+    // R5G6B5 into GL_R16UI, each channel rounded to nearest
+    static constexpr const char* pack_rgb565_fragment_shader = R"(
+        #version 330 core
+        out uint FragColor;
+        uniform sampler2D u_texture;
+        uniform ivec2 u_source_size;
+        uniform int u_flip;
+        uniform ivec2 u_origin;
+
+        void main() {
+            ivec2 p = ivec2(gl_FragCoord.xy) - u_origin;
+            if (u_flip != 0) p.y = u_source_size.y - 1 - p.y;
+            uvec3 c = uvec3(texelFetch(u_texture, p, 0).rgb * 255.0 + 0.5);
+            uvec3 q = (c * uvec3(31u, 63u, 31u) + 127u) / 255u;
+            FragColor = (q.r << 11u) | (q.g << 5u) | q.b;
+        }
+    )";
+
+    // Nearest of u_palette_size entries of a 256x1 RGBA8 palette (unit 1) by
+    // squared RGB distance, the lowest index on ties, into GL_R8UI
+    static constexpr const char* pack_indexed_fragment_shader = R"(
+        #version 330 core
+        out uint FragColor;
+        uniform sampler2D u_texture;
+        uniform sampler2D u_palette;
+        uniform ivec2 u_source_size;
+        uniform int u_flip;
+        uniform ivec2 u_origin;
+        uniform int u_palette_size;
+
+        void main() {
+            ivec2 p = ivec2(gl_FragCoord.xy) - u_origin;
+            if (u_flip != 0) p.y = u_source_size.y - 1 - p.y;
+            ivec3 c = ivec3(texelFetch(u_texture, p, 0).rgb * 255.0 + 0.5);
+            int best = 0;
+            int best_distance = 0x7fffffff;
+            for (int i = 0; i < u_palette_size; ++i) {
+                ivec3 d = ivec3(texelFetch(u_palette, ivec2(i, 0), 0).rgb * 255.0 + 0.5) - c;
+                int distance = d.r * d.r + d.g * d.g + d.b * d.b;
+                if (distance < best_distance) {
+                    best = i;
+                    best_distance = distance;
+                }
+            }
+            FragColor = uint(best);
+        }
+    )";
+
+    // BT.601 video range, one plane per draw (u_plane 0 = Y, 1 = U, 2 = V)
+    // into GL_R8UI; chroma averages the 2x2 block, clamped at the edges
+    static constexpr const char* pack_yuv420_fragment_shader = R"(
+        #version 330 core
+        out uint FragColor;
+        uniform sampler2D u_texture;
+        uniform ivec2 u_source_size;
+        uniform int u_flip;
+        uniform ivec2 u_origin;
+        uniform int u_plane;
+
+        ivec3 source_rgb(ivec2 p) {
+            p = min(p, u_source_size - 1);
+            if (u_flip != 0) p.y = u_source_size.y - 1 - p.y;
+            return ivec3(texelFetch(u_texture, p, 0).rgb * 255.0 + 0.5);
+        }
+
+        void main() {
+            ivec2 p = ivec2(gl_FragCoord.xy) - u_origin;
+            if (u_plane == 0) {
+                ivec3 c = source_rgb(p);
+                FragColor = uint(((66 * c.r + 129 * c.g + 25 * c.b + 128) >> 8) + 16);
+                return;
+            }
+            ivec2 q = p * 2;
+            ivec3 c = (source_rgb(q) + source_rgb(q + ivec2(1, 0)) +
+                       source_rgb(q + ivec2(0, 1)) + source_rgb(q + ivec2(1, 1)) + 2) / 4;
+            int v = u_plane == 1 ? ((-38 * c.r - 74 * c.g + 112 * c.b + 128) >> 8) + 128
+                                 : ((112 * c.r - 94 * c.g - 18 * c.b + 128) >> 8) + 128;
+            FragColor = uint(v);
+        }
+    )";
 }
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <scaler/algorithm.hh>
+#include <scaler/gpu/gpu_exceptions.hh>
+#include <scaler/warning_macros.hh>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace scaler::gpu {
+
+    /**
+     * Color space the shaders blend in
+     */
+    enum class gamma_mode : std::uint8_t {
+        none,   ///< Blend the stored (sRGB-encoded) values directly
+        linear  ///< Decode sRGB on fetch, blend in linear light, encode on output
+    };
+
+    /**
+     * Specializations applied to every shader a scaler compiles
+     *
+     * The integral scale factor is always baked in; the options below trade
+     * extra programs for cheaper shaders.
+     */
+    struct shader_variant_options {
+        /// Bake input and output sizes in as constants. Every distinct input
+        /// size compiles its own programs, so this suits fixed-resolution sources.
+        bool specialize_size = false;
+        /// Force output alpha to 1
+        bool opaque = false;
+        /// Only affects algorithms that blend colors (Bilinear, Super2xSaI,
+        /// AAScale, OmniScale); their edge detection then also sees linear values
+        gamma_mode gamma = gamma_mode::none;
+    };
+
+    /**
+     * Identity of one compiled shader variant
+     *
+     * Build keys with make() so that specializations that cannot apply to a
+     * draw (e.g. gamma for a pure pixel-copy algorithm) do not create
+     * duplicate programs.
+     */
+    struct shader_variant_key {
+        algorithm algo = algorithm::Nearest;
+        float scale = 0.0f;             ///< Scale used to select the shader source
+        bool integral_scale = false;    ///< Output is exactly input * scale on both axes
+        bool opaque = false;
+        gamma_mode gamma = gamma_mode::none;
+        std::uint16_t texture_width = 0;  ///< 0 = sizes come from scaler_params
+        std::uint16_t texture_height = 0;
+
+        /**
+         * Key for a draw of input_width x input_height to output_width x output_height
+         * (sizes of 0 mean unknown, e.g. when precompiling)
+         */
+        static shader_variant_key make(algorithm algo, float scale_factor,
+                                       int input_width, int input_height,
+                                       int output_width, int output_height,
+                                       const shader_variant_options& options) {
+            shader_variant_key key;
+            key.algo = algo;
+            key.scale = scale_factor;
+
+            const float rounded = std::round(scale_factor);
+            const int factor = static_cast<int>(rounded);
+            SCALER_DISABLE_WARNING_PUSH
+            SCALER_DISABLE_WARNING_FLOAT_EQUAL
+            const bool whole = rounded == scale_factor && factor >= 1 && factor <= 255;
+            SCALER_DISABLE_WARNING_POP
+            const bool known_size = input_width > 0 && input_height > 0;
+            key.integral_scale = whole && (!known_size ||
+                                           (output_width == input_width * factor &&
+                                            output_height == input_height * factor));
+
+            if (options.specialize_size && key.integral_scale && known_size &&
+                input_width <= UINT16_MAX && input_height <= UINT16_MAX) {
+                key.texture_width = static_cast<std::uint16_t>(input_width);
+                key.texture_height = static_cast<std::uint16_t>(input_height);
+            }
+
+            key.opaque = options.opaque;
+            key.gamma = blends_colors(algo) ? options.gamma : gamma_mode::none;
+            return key;
+        }
+
+        /**
+         * Whether algo produces colors that are not copies of source pixels
+         */
+        static bool blends_colors(algorithm algo) {
+            return algo == algorithm::Bilinear || algo == algorithm::Super2xSaI ||
+                   algo == algorithm::AAScale || algo == algorithm::OmniScale;
+        }
+
+        bool operator==(const shader_variant_key& other) const {
+            SCALER_DISABLE_WARNING_PUSH
+            SCALER_DISABLE_WARNING_FLOAT_EQUAL
+            return algo == other.algo && scale == other.scale &&
+                   integral_scale == other.integral_scale && opaque == other.opaque &&
+                   gamma == other.gamma && texture_width == other.texture_width &&
+                   texture_height == other.texture_height;
+            SCALER_DISABLE_WARNING_POP
+        }
+
+        bool operator!=(const shader_variant_key& other) const {
+            return !(*this == other);
+        }
+    };
+
+    struct shader_variant_key_hash {
+        size_t operator()(const shader_variant_key& key) const noexcept {
+            std::uint64_t h = static_cast<std::uint64_t>(key.algo);
+            h = h << 1 | (key.integral_scale ? 1u : 0u);
+            h = h << 1 | (key.opaque ? 1u : 0u);
+            h = h << 1 | static_cast<std::uint64_t>(key.gamma);
+            h = h << 16 | key.texture_width;
+            h = h << 16 | key.texture_height;
+            // Scales are small multiples of 1/8 in practice
+            h = h * 31 + static_cast<std::uint64_t>(static_cast<std::int64_t>(key.scale * 8.0f));
+            return static_cast<size_t>(h ^ (h >> 29));
+        }
+    };
+
+    /**
+     * Build the GLSL of a variant from one of the shader_source strings
+     *
+     * Specializations are injected as defines right after the #version line,
+     * so the driver compiler sees constants and can fold and unroll:
+     * - integral scale: SCALER_SCALE (OmniScale derives its pixel size from it)
+     * - size: the scaler_params block becomes two const vec2 with the same names
+     * - gamma linear: texture()/texelFetch() results are decoded to linear and
+     *   the output is re-encoded; opaque: output alpha forced to 1.
+     *   Both wrap the shader's main() and require an "out vec4 FragColor".
+     *
+     * @throws shader_error if source has no #version line or, for a size
+     *         specialization, an unexpected scaler_params block
+     */
+    inline std::string specialize_shader(const char* source, const shader_variant_key& key) {
+        std::string result(source);
+        const auto version = result.find("#version");
+        if (version == std::string::npos) {
+            throw shader_error("shader source without #version line");
+        }
+
+        if (key.texture_width != 0) {
+            const char* block_start = "layout(std140) uniform scaler_params {";
+            const auto begin = result.find(block_start);
+            if (begin != std::string::npos) {
+                const auto end = result.find("};", begin);
+                if (end == std::string::npos) {
+                    throw shader_error("unterminated scaler_params block");
+                }
+                const auto factor = static_cast<unsigned>(std::lround(key.scale));
+                const auto vec = [](unsigned x, unsigned y) {
+                    return "vec2(" + std::to_string(x) + ".0, " + std::to_string(y) + ".0)";
+                };
+                result.replace(begin, end + 2 - begin,
+                               "const vec2 u_texture_size = " + vec(key.texture_width, key.texture_height) +
+                               ";\n        const vec2 u_output_size = " +
+                               vec(key.texture_width * factor, key.texture_height * factor) + ";");
+            }
+        }
+
+        std::string defines;
+        if (key.integral_scale) {
+            defines += "#define SCALER_SCALE " + std::to_string(std::lround(key.scale)) + "\n";
+        }
+
+        const bool linear = key.gamma == gamma_mode::linear;
+        const bool wrap_main = linear || key.opaque;
+        if (linear) {
+            // Exact sRGB transfer functions
+            defines +=
+                "vec4 scaler_to_linear(vec4 c) {\n"
+                "    bvec3 low = lessThanEqual(c.rgb, vec3(0.04045));\n"
+                "    return vec4(mix(pow((c.rgb + 0.055) / 1.055, vec3(2.4)), c.rgb / 12.92, vec3(low)), c.a);\n"
+                "}\n"
+                "vec3 scaler_to_srgb(vec3 c) {\n"
+                "    bvec3 low = lessThanEqual(c, vec3(0.0031308));\n"
+                "    return mix(1.055 * pow(c, vec3(1.0 / 2.4)) - 0.055, c * 12.92, vec3(low));\n"
+                "}\n"
+                "#define texture(s, p) scaler_to_linear(texture(s, p))\n"
+                "#define texelFetch(s, p, l) scaler_to_linear(texelFetch(s, p, l))\n";
+        }
+        if (wrap_main) {
+            defines += "#define main scaler_variant_main\n";
+        }
+
+        const auto line_end = result.find('\n', version);
+        result.insert(line_end == std::string::npos ? result.size() : line_end + 1, defines);
+
+        if (wrap_main) {
+            result += "\n#undef main\nvoid main() {\n    scaler_variant_main();\n";
+            if (linear) {
+                result += "    FragColor.rgb = scaler_to_srgb(clamp(FragColor.rgb, 0.0, 1.0));\n";
+            }
+            if (key.opaque) {
+                result += "    FragColor.a = 1.0;\n";
+            }
+            result += "}\n";
+        }
+        return result;
+    }
+
+} // namespace scaler::gpu
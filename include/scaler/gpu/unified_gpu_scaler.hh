@@ -30,6 +30,7 @@
 #include <scaler/unified_scaler.hh>
 #include <scaler/gpu/texture_ref.hh>
 #include <scaler/gpu/opengl_texture_scaler.hh>
+#include <scaler/gpu/gl_context_registry.hh>
 #include <scaler/algorithm_capabilities.hh>
 #include <memory>
 
@@ -47,10 +48,12 @@ namespace scaler {
      * - Requires active OpenGL context
      * - Limited algorithm support (not all CPU algorithms have GPU versions)
      * - Better performance for large images
-     * - Thread-local GPU scaler instance for efficiency
+     * - One GPU scaler per GL context, shared programs per share group
      *
-     * @note The GPU scaler uses a thread-local singleton pattern to avoid
-     *       recreating shader programs for each scaling operation.
+     * @note Scalers come from gpu::gl_context_registry. Install a context
+     *       query there (e.g. SDL_GL_GetCurrentContext) so that threads using
+     *       the same share group reuse compiled programs; without one, every
+     *       thread gets its own scaler, destroyed when the thread exits.
      */
     template<>
     class unified_scaler <gpu::input_texture, gpu::output_texture> {
@@ -152,7 +155,7 @@ namespace scaler {
              * @endcode
              *
              * @note Requires active OpenGL context
-             * @note Uses thread-local GPU scaler instance for efficiency
+             * @note Uses the current context's scaler from gpu::gl_context_registry
              */
             static void scale(const gpu::input_texture& input,
                               gpu::output_texture& output,
@@ -183,14 +186,11 @@ namespace scaler {
                                                        expected.width, expected.height);
                 }
 
-                // Get or create the GPU scaler instance
-                static thread_local std::unique_ptr <gpu::opengl_texture_scaler> gpu_scaler;
-                if (!gpu_scaler) {
-                    gpu_scaler = std::make_unique <gpu::opengl_texture_scaler>();
-                }
+                // Scaler of the current context; programs are shared per share group
+                auto& gpu_scaler = gpu::gl_context_registry::instance().scaler_for_current_context();
 
                 // Perform the scaling
-                gpu_scaler->scale_texture_to_texture(
+                gpu_scaler.scale_texture_to_texture(
                     input.id(),
                     SCALER_SIZE_TO_GLSIZEI(input.width()),
                     SCALER_SIZE_TO_GLSIZEI(input.height()),
@@ -0,0 +1,149 @@
+/**
+ * @file in_place.hh
+ * @brief Integer-factor upscaling inside the output buffer
+ *
+ * For memory-tight targets the source frame can live in the top-left corner
+ * of the buffer that receives the scaled frame, so no separate input buffer
+ * is held:
+ *
+ * @code
+ * scaler::image<scaler::uvec3> buffer(1280, 960);
+ * render_frame_into(buffer, 320, 240);          // source in the top-left
+ * scaler::scale_in_place(buffer, 320, 240, scaler::algorithm::HQ);
+ * @endcode
+ */
+#pragma once
+
+#include <scaler/algorithm.hh>
+#include <scaler/image.hh>
+#include <scaler/image_base.hh>
+#include <scaler/unified_scaler.hh>
+#include <scaler/cpu/band_parallel.hh>
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <type_traits>
+#include <vector>
+
+namespace scaler {
+
+    namespace detail {
+
+        /**
+         * Rows [top, top + rows) of the source, served from saved copies
+         */
+        template<typename Pixel>
+        class saved_rows_view : public input_image_base <saved_rows_view <Pixel>, Pixel> {
+            public:
+                using pixel_type = Pixel;
+
+                saved_rows_view(const std::deque <std::vector <Pixel>>& saved, size_t first_saved,
+                                size_t width, size_t top, size_t rows)
+                    : saved_(saved), first_saved_(first_saved), width_(width), top_(top), rows_(rows) {
+                }
+
+                [[nodiscard]] size_t width_impl() const { return width_; }
+                [[nodiscard]] size_t height_impl() const { return rows_; }
+
+                [[nodiscard]] Pixel get_pixel_impl(size_t x, size_t y) const {
+                    return saved_[top_ + y - first_saved_][x];
+                }
+
+            private:
+                const std::deque <std::vector <Pixel>>& saved_;
+                size_t first_saved_;
+                size_t width_;
+                size_t top_;
+                size_t rows_;
+        };
+
+    } // namespace detail
+
+    /**
+     * Scale the source_width x source_height image in the top-left corner of
+     * buffer so that it fills the whole buffer
+     *
+     * Bands of band_rows source rows are processed from the bottom up. Each
+     * band's source rows, plus band_halo_rows() of context on either side,
+     * are copied into a small window before the band's output overwrites
+     * them. Output rows of a band only cover source rows that lie below it,
+     * and every row a later (higher) band still needs is in the window by
+     * then, so nothing is read after it was overwritten. The output is
+     * identical to unified_scaler::scale().
+     *
+     * Peak memory beyond the buffer is the window, (band_rows + 2 * halo)
+     * source rows, and one scaled band.
+     *
+     * @tparam Image Readable and writable image (get_pixel() and set_pixel())
+     * @throws unsupported_scale_exception if the buffer is not an integral
+     *         multiple of the source that algo supports
+     * @throws dimension_mismatch_exception if the two axes scale differently
+     */
+    template<typename Image>
+    void scale_in_place(Image& buffer, size_t source_width, size_t source_height, algorithm algo,
+                        size_t band_rows = 32) {
+        using pixel = std::decay_t <decltype(std::declval <const Image&>().get_pixel(0, 0))>;
+
+        const size_t out_width = buffer.width();
+        const size_t out_height = buffer.height();
+        const size_t factor = source_width > 0 ? out_width / source_width : 0;
+        const float scale_factor = static_cast<float>(factor);
+        if (factor < 1 || factor * source_width != out_width ||
+            !scaler_capabilities::is_scale_supported(algo, scale_factor)) {
+            const float requested = source_width > 0
+                                        ? static_cast<float>(out_width) / static_cast<float>(source_width)
+                                        : 0.0f;
+            throw unsupported_scale_exception(algo, requested, scaler_capabilities::get_supported_scales(algo));
+        }
+        if (source_height * factor != out_height) {
+            throw dimension_mismatch_exception(algo, source_width, source_height, out_width, out_height,
+                                               out_width, source_height * factor);
+        }
+        if (factor == 1) {
+            return;
+        }
+
+        const size_t halo = band_halo_rows(algo);
+        band_rows = std::max <size_t>(band_rows, 1);
+
+        // saved[i] holds source row first_saved + i
+        std::deque <std::vector <pixel>> saved;
+        size_t first_saved = source_height;
+
+        for (size_t band_end = source_height; band_end > 0;) {
+            const size_t band_start = band_end > band_rows ? band_end - band_rows : 0;
+            const size_t top = band_start > halo ? band_start - halo : 0;
+            const size_t bottom = std::min(source_height, band_end + halo);
+
+            // Save the rows this band reads that are not saved yet; they are
+            // still intact, since output so far only covers rows >= band_end * factor
+            while (first_saved > top) {
+                --first_saved;
+                std::vector <pixel> row(source_width);
+                for (size_t x = 0; x < source_width; ++x) {
+                    row[x] = buffer.get_pixel(x, first_saved);
+                }
+                saved.push_front(std::move(row));
+            }
+            // Rows past the band's halo are not needed by any band above
+            while (first_saved + saved.size() > bottom) {
+                saved.pop_back();
+            }
+
+            const detail::saved_rows_view <pixel> view(saved, first_saved, source_width, top, bottom - top);
+            image <pixel> scaled(out_width, (bottom - top) * factor);
+            // A band is only a few rows; splitting it across threads again only adds overhead
+            unified_scaler <detail::saved_rows_view <pixel>, image <pixel>>::scale(view, scaled, algo,
+                                                                                    detail::band_plan{});
+
+            for (size_t y = band_start * factor; y < band_end * factor; ++y) {
+                const auto line = scaled.row(y - top * factor);
+                for (size_t x = 0; x < out_width; ++x) {
+                    buffer.set_pixel(x, y, line[x]);
+                }
+            }
+            band_end = band_start;
+        }
+    }
+
+} // namespace scaler
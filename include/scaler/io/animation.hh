@@ -0,0 +1,406 @@
+#pragma once
+
+#include <scaler/algorithm.hh>
+#include <scaler/image_base.hh>
+#include <scaler/unified_scaler.hh>
+#include <scaler/cpu/band_parallel.hh>
+#include <scaler/io/animation_frame.hh>
+#include <scaler/io/apng.hh>
+#include <scaler/io/gif.hh>
+#include <scaler/io/io_exceptions.hh>
+#include <scaler/io/packed_image.hh>
+#include <scaler/io/streaming_scaler.hh>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace scaler::io {
+
+    /**
+     * What scale_animation() did
+     */
+    struct animation_stats {
+        size_t frames = 0;
+        /// Source rows whose output was computed
+        size_t rows_scaled = 0;
+        /// Source rows whose output was copied from the previous frame
+        size_t rows_reused = 0;
+    };
+
+    namespace detail {
+
+        /**
+         * Rows [top, top + rows) of an RGBA frame, either as color or as
+         * alpha repeated in all three channels
+         */
+        class frame_band_view : public input_image_base <frame_band_view, rgb_pixel> {
+            public:
+                using pixel_type = rgb_pixel;
+
+                frame_band_view(const packed_image& frame, size_t top, size_t rows, bool alpha)
+                    : frame_(frame), top_(top), rows_(rows), alpha_(alpha) {
+                }
+
+                [[nodiscard]] size_t width_impl() const { return frame_.width(); }
+                [[nodiscard]] size_t height_impl() const { return rows_; }
+
+                [[nodiscard]] rgb_pixel get_pixel_impl(size_t x, size_t y) const {
+                    const std::uint8_t* p = frame_.row(top_ + y) + x * 4;
+                    if (alpha_) {
+                        return {p[3], p[3], p[3]};
+                    }
+                    return {p[0], p[1], p[2]};
+                }
+
+            private:
+                const packed_image& frame_;
+                size_t top_;
+                size_t rows_;
+                bool alpha_;
+        };
+
+        inline bool has_transparency(const packed_image& frame) {
+            for (size_t y = 0; y < frame.height(); ++y) {
+                const std::uint8_t* p = frame.row(y);
+                for (size_t x = 0; x < frame.width(); ++x) {
+                    if (p[x * 4 + 3] != 255) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        /**
+         * Source rows whose output differs from the previous frame's
+         *
+         * A row's output depends on the rows within halo of it, so changed
+         * rows are widened by halo. Gaps of at most 2 * halo rows between
+         * marked runs are marked too: scaling them costs no more than the
+         * halo a separate band would need.
+         */
+        inline std::vector <bool> rows_to_scale(const packed_image& previous, const packed_image& frame, size_t halo) {
+            const size_t height = frame.height();
+            std::vector <bool> marked(height, false);
+            for (size_t y = 0; y < height; ++y) {
+                if (std::memcmp(previous.row(y), frame.row(y), frame.row_bytes()) != 0) {
+                    const size_t first = y > halo ? y - halo : 0;
+                    const size_t last = std::min(height, y + halo + 1);
+                    std::fill(marked.begin() + static_cast<std::ptrdiff_t>(first),
+                              marked.begin() + static_cast<std::ptrdiff_t>(last), true);
+                }
+            }
+
+            size_t previous_end = 0;
+            bool seen = false;
+            for (size_t y = 0; y < height;) {
+                if (!marked[y]) {
+                    ++y;
+                    continue;
+                }
+                if (seen && y - previous_end <= 2 * halo) {
+                    std::fill(marked.begin() + static_cast<std::ptrdiff_t>(previous_end),
+                              marked.begin() + static_cast<std::ptrdiff_t>(y), true);
+                }
+                while (y < height && marked[y]) {
+                    ++y;
+                }
+                previous_end = y;
+                seen = true;
+            }
+            return marked;
+        }
+
+        /**
+         * Scale the marked rows of an RGBA frame, band by band
+         *
+         * Color goes through algo; alpha goes through it too when the frame
+         * has any transparency and is 255 otherwise. Unmarked output rows
+         * are left for the caller to fill.
+         */
+        inline packed_image scale_frame_rows(const packed_image& frame, const std::vector <bool>& rows,
+                                             algorithm algo, size_t factor, bool alpha) {
+            const size_t width = frame.width();
+            const size_t height = frame.height();
+            const size_t halo = band_halo_rows(algo);
+            packed_image output(width * factor, height * factor, 4);
+
+            for (size_t y = 0; y < height;) {
+                if (!rows[y]) {
+                    ++y;
+                    continue;
+                }
+                size_t end = y;
+                while (end < height && rows[end]) {
+                    ++end;
+                }
+                const size_t top = y > halo ? y - halo : 0;
+                const size_t bottom = std::min(height, end + halo);
+
+                const frame_band_view color(frame, top, bottom - top, false);
+                rgb_band_image scaled(width * factor, (bottom - top) * factor);
+                unified_scaler <frame_band_view, rgb_band_image>::scale(color, scaled, algo);
+                for (size_t out_y = y * factor; out_y < end * factor; ++out_y) {
+                    const std::uint8_t* in = scaled.row(out_y - top * factor);
+                    std::uint8_t* out = output.row(out_y);
+                    for (size_t x = 0; x < width * factor; ++x) {
+                        std::memcpy(out + x * 4, in + x * 3, 3);
+                    }
+                }
+
+                if (alpha) {
+                    const frame_band_view transparency(frame, top, bottom - top, true);
+                    unified_scaler <frame_band_view, rgb_band_image>::scale(transparency, scaled, algo);
+                    for (size_t out_y = y * factor; out_y < end * factor; ++out_y) {
+                        const std::uint8_t* in = scaled.row(out_y - top * factor);
+                        std::uint8_t* out = output.row(out_y);
+                        for (size_t x = 0; x < width * factor; ++x) {
+                            out[x * 4 + 3] = in[x * 3];
+                        }
+                    }
+                }
+                y = end;
+            }
+            return output;
+        }
+
+    } // namespace detail
+
+    /**
+     * Scale every frame of an animation
+     *
+     * Frames are decoded one at a time and scaled on up to threads worker
+     * threads, several frames at once. Rows whose neighbourhood did not
+     * change since the previous frame are not scaled again: their output is
+     * copied from the previous scaled frame, so a sprite moving over a
+     * static background costs little more than its own rows. Frames reach
+     * the writer in order, which encodes only what changed between them.
+     * The result is identical to scaling each frame on its own.
+     *
+     * FrameReader needs bool read_frame(animation_frame&) (gif_reader,
+     * apng_reader); FrameWriter needs write_frame(const packed_image&,
+     * unsigned delay_ms) and finish() (gif_writer, apng_writer) and must be
+     * created for the scaled size.
+     *
+     * @param scale_factor Integral scale supported by algo
+     * @param threads Frames scaled at once, 0 = hardware concurrency
+     * @throws std::invalid_argument for a scale the algorithm does not support
+     */
+    template<typename FrameReader, typename FrameWriter>
+    animation_stats scale_animation(FrameReader& reader, FrameWriter& writer, algorithm algo, int scale_factor,
+                                    unsigned threads = 0) {
+        if (scale_factor < 1 || !scaler_capabilities::is_scale_supported(algo, static_cast<float>(scale_factor))) {
+            throw std::invalid_argument("scale_animation: " + scaler_capabilities::get_algorithm_name(algo) +
+                                        " does not support scale " + std::to_string(scale_factor));
+        }
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        const auto factor = static_cast<size_t>(scale_factor);
+        const size_t halo = band_halo_rows(algo);
+
+        struct pending_frame {
+            std::future <packed_image> scaled;
+            std::vector <bool> rows;
+            unsigned delay_ms;
+        };
+        std::deque <pending_frame> in_flight;
+        animation_stats stats;
+        packed_image previous_output(1, 1, 4);
+
+        const auto write_oldest = [&]() {
+            pending_frame job = std::move(in_flight.front());
+            in_flight.pop_front();
+            packed_image output = job.scaled.get();
+            for (size_t y = 0; y < job.rows.size(); ++y) {
+                if (job.rows[y]) {
+                    ++stats.rows_scaled;
+                    continue;
+                }
+                ++stats.rows_reused;
+                for (size_t out_y = y * factor; out_y < (y + 1) * factor; ++out_y) {
+                    std::memcpy(output.row(out_y), previous_output.row(out_y), output.row_bytes());
+                }
+            }
+            writer.write_frame(output, job.delay_ms);
+            previous_output = std::move(output);
+            ++stats.frames;
+        };
+
+        std::shared_ptr <const packed_image> previous;
+        bool previous_alpha = false;
+        animation_frame frame;
+        while (reader.read_frame(frame)) {
+            auto source = std::make_shared <const packed_image>(std::move(frame.image));
+            const bool alpha = detail::has_transparency(*source);
+            std::vector <bool> rows = previous && alpha == previous_alpha
+                                          ? detail::rows_to_scale(*previous, *source, halo)
+                                          : std::vector <bool>(source->height(), true);
+
+            const auto policy = threads > 1 ? std::launch::async : std::launch::deferred;
+            auto scaled = std::async(policy, [source, rows, algo, factor, alpha]() {
+                return detail::scale_frame_rows(*source, rows, algo, factor, alpha);
+            });
+            in_flight.push_back({std::move(scaled), std::move(rows), frame.delay_ms});
+            if (in_flight.size() >= threads) {
+                write_oldest();
+            }
+            previous = std::move(source);
+            previous_alpha = alpha;
+        }
+        while (!in_flight.empty()) {
+            write_oldest();
+        }
+        writer.finish();
+        return stats;
+    }
+
+    /**
+     * Animation container formats
+     */
+    enum class animation_file_format {
+        unknown,
+        gif,
+        apng ///< Animated PNG (.png or .apng)
+    };
+
+    /**
+     * Format of an animation file by its extension (.gif, .png, .apng)
+     */
+    inline animation_file_format animation_file_format_of(const std::string& path) {
+        const size_t dot = path.find_last_of('.');
+        if (dot == std::string::npos) {
+            return animation_file_format::unknown;
+        }
+        std::string ext = path.substr(dot + 1);
+        std::transform(ext.begin(), ext.end(), ext.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (ext == "gif") {
+            return animation_file_format::gif;
+        }
+        if (ext == "png" || ext == "apng") {
+            return animation_file_format::apng;
+        }
+        return animation_file_format::unknown;
+    }
+
+    /**
+     * Whether a file holds an animation: any GIF, or a PNG with an acTL chunk
+     */
+    inline bool is_animated_file(const std::string& path) {
+        try {
+            switch (animation_file_format_of(path)) {
+                case animation_file_format::gif: {
+                    gif_reader reader(path);
+                    return true;
+                }
+                case animation_file_format::apng: {
+                    apng_reader reader(path);
+                    return reader.animated();
+                }
+                default:
+                    return false;
+            }
+        } catch (const io_error&) {
+            return false;
+        }
+    }
+
+    /**
+     * Whether algo only ever outputs colors of its input, so that scaled
+     * palette frames still fit a GIF color table
+     */
+    inline bool keeps_palette(algorithm algo) {
+        switch (algo) {
+            case algorithm::Nearest:
+            case algorithm::EPX:
+            case algorithm::Eagle:
+            case algorithm::Scale:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * Scale a GIF or APNG file into a GIF or APNG file, by extension
+     *
+     * The loop count carries over. GIF output needs frames of at most 256
+     * colors, so it is only accepted when keeps_palette(algo); the
+     * interpolating algorithms call for APNG output. The animation is written to
+     * a sibling file that replaces output_path once the last frame is
+     * encoded, so a failure never leaves a truncated file behind.
+     *
+     * @param level zlib level, used for APNG output only
+     * @param threads Frames scaled at once, 0 = hardware concurrency
+     * @throws io_error for an unknown extension, GIF output from an
+     *         interpolating algorithm or a malformed file
+     */
+    inline animation_stats scale_animation_file(const std::string& input_path, const std::string& output_path,
+                                                algorithm algo, int scale_factor, int level = 6,
+                                                unsigned threads = 0) {
+        const animation_file_format output_format = animation_file_format_of(output_path);
+        if (output_format == animation_file_format::unknown) {
+            throw io_error("cannot write an animation to " + output_path + " (expected .gif, .png or .apng)");
+        }
+        if (output_format == animation_file_format::gif && !keeps_palette(algo)) {
+            throw io_error("cannot write " + output_path + ": " + scaler_capabilities::get_algorithm_name(algo) +
+                           " blends colors beyond a GIF palette (write APNG (.png) instead)");
+        }
+
+        const std::string temporary = output_path + ".tmp";
+        const auto scale_from = [&](auto& reader) {
+            const auto factor = static_cast<size_t>(std::max(scale_factor, 1));
+            const size_t width = reader.width() * factor;
+            const size_t height = reader.height() * factor;
+            if (output_format == animation_file_format::gif) {
+                gif_writer writer(temporary, width, height, reader.loop_count());
+                return scale_animation(reader, writer, algo, scale_factor, threads);
+            }
+            apng_writer writer(temporary, width, height, reader.loop_count(), level);
+            return scale_animation(reader, writer, algo, scale_factor, threads);
+        };
+        const auto scale_file = [&]() {
+            switch (animation_file_format_of(input_path)) {
+                case animation_file_format::gif: {
+                    gif_reader reader(input_path);
+                    return scale_from(reader);
+                }
+                case animation_file_format::apng: {
+                    apng_reader reader(input_path);
+                    return scale_from(reader);
+                }
+                default:
+                    throw io_error("cannot read an animation from " + input_path +
+                                   " (expected .gif, .png or .apng)");
+            }
+        };
+
+        animation_stats stats;
+        try {
+            stats = scale_file();
+        } catch (...) {
+            std::error_code ignored;
+            std::filesystem::remove(temporary, ignored);
+            throw;
+        }
+        std::error_code error;
+        std::filesystem::rename(temporary, output_path, error);
+        if (error) {
+            std::filesystem::remove(temporary, error);
+            throw io_error("cannot replace " + output_path);
+        }
+        return stats;
+    }
+
+} // namespace scaler::io
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <scaler/io/packed_image.hh>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace scaler::io {
+
+    /**
+     * One fully composed frame of an animation
+     *
+     * Readers apply each format's disposal and blending rules, so image is
+     * always the whole canvas as it is displayed (RGBA, 4 channels), and
+     * writers take whole canvases and work out the inter-frame deltas
+     * themselves.
+     */
+    struct animation_frame {
+        packed_image image{1, 1, 4};
+        /// Display time in milliseconds
+        unsigned delay_ms = 0;
+    };
+
+    /**
+     * Rectangle of a canvas, in pixels
+     */
+    struct frame_rect {
+        size_t x = 0;
+        size_t y = 0;
+        size_t width = 0;
+        size_t height = 0;
+
+        [[nodiscard]] bool empty() const { return width == 0 || height == 0; }
+
+        [[nodiscard]] bool contains(size_t px, size_t py) const {
+            return px >= x && px < x + width && py >= y && py < y + height;
+        }
+    };
+
+    namespace detail {
+
+        /**
+         * Smallest rectangle holding both a and b
+         */
+        inline frame_rect merge_rects(const frame_rect& a, const frame_rect& b) {
+            if (a.empty()) {
+                return b;
+            }
+            if (b.empty()) {
+                return a;
+            }
+            const size_t left = std::min(a.x, b.x);
+            const size_t top = std::min(a.y, b.y);
+            const size_t right = std::max(a.x + a.width, b.x + b.width);
+            const size_t bottom = std::max(a.y + a.height, b.y + b.height);
+            return {left, top, right - left, bottom - top};
+        }
+
+        /**
+         * Bounding box of the pixels where two RGBA canvases of equal size
+         * differ; empty if they are identical
+         */
+        inline frame_rect changed_rect(const packed_image& before, const packed_image& after) {
+            const size_t width = after.width();
+            const size_t height = after.height();
+            size_t top = height;
+            size_t bottom = 0;
+            size_t left = width;
+            size_t right = 0;
+            for (size_t y = 0; y < height; ++y) {
+                const std::uint8_t* a = before.row(y);
+                const std::uint8_t* b = after.row(y);
+                if (std::memcmp(a, b, after.row_bytes()) == 0) {
+                    continue;
+                }
+                top = std::min(top, y);
+                bottom = y + 1;
+                size_t first = 0;
+                while (std::memcmp(a + first * 4, b + first * 4, 4) == 0) {
+                    ++first;
+                }
+                size_t last = width - 1;
+                while (std::memcmp(a + last * 4, b + last * 4, 4) == 0) {
+                    --last;
+                }
+                left = std::min(left, first);
+                right = std::max(right, last + 1);
+            }
+            if (bottom == 0) {
+                return {};
+            }
+            return {left, top, right - left, bottom - top};
+        }
+
+        /**
+         * Clear a rectangle of an RGBA canvas to transparent black
+         */
+        inline void clear_rect(packed_image& canvas, const frame_rect& rect) {
+            for (size_t y = rect.y; y < rect.y + rect.height; ++y) {
+                std::memset(canvas.row(y) + rect.x * 4, 0, rect.width * 4);
+            }
+        }
+
+    } // namespace detail
+
+} // namespace scaler::io
@@ -0,0 +1,608 @@
+#pragma once
+
+#include <scaler/io/animation_frame.hh>
+#include <scaler/io/io_exceptions.hh>
+#include <scaler/io/packed_image.hh>
+#include <scaler/io/png_stream.hh>
+#include <scaler/io/zlib_codec.hh>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace scaler::io {
+
+    namespace detail {
+
+        inline constexpr std::uint8_t apng_dispose_none = 0;
+        inline constexpr std::uint8_t apng_dispose_background = 1;
+        inline constexpr std::uint8_t apng_dispose_previous = 2;
+        inline constexpr std::uint8_t apng_blend_source = 0;
+        inline constexpr std::uint8_t apng_blend_over = 1;
+        inline constexpr size_t apng_frame_control_size = 26;
+
+        /**
+         * One chunk of a PNG file, CRC already verified
+         */
+        struct png_chunk {
+            std::string type;
+            std::vector <std::uint8_t> data;
+        };
+
+        /**
+         * Frame control (fcTL) of an APNG frame
+         */
+        struct apng_frame_control {
+            frame_rect rect;
+            unsigned delay_ms = 0;
+            std::uint8_t dispose = apng_dispose_none;
+            std::uint8_t blend = apng_blend_source;
+        };
+
+        inline std::uint16_t read_be16(const std::uint8_t* p) {
+            return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+        }
+
+        /**
+         * Composite an RGBA pixel over another ("over" operator, 8-bit)
+         */
+        inline void blend_over(const std::uint8_t* src, std::uint8_t* dst) {
+            const unsigned sa = src[3];
+            if (sa == 255) {
+                std::memcpy(dst, src, 4);
+                return;
+            }
+            if (sa == 0) {
+                return;
+            }
+            const unsigned da = dst[3] * (255u - sa) / 255u;
+            const unsigned out_a = sa + da;
+            for (size_t c = 0; c < 3; ++c) {
+                dst[c] = static_cast<std::uint8_t>((src[c] * sa + dst[c] * da + out_a / 2) / out_a);
+            }
+            dst[3] = static_cast<std::uint8_t>(out_a);
+        }
+
+    } // namespace detail
+
+    /**
+     * APNG decoder that delivers one composed frame at a time
+     *
+     * Chunks are read as frames are requested, so only the canvas and the
+     * compressed data of one frame are held. Each frame's data is decoded
+     * by png_row_reader, which gives every bit depth and color type. A
+     * plain PNG reads as a one-frame animation.
+     *
+     * @code
+     * io::apng_reader reader("walk.png");
+     * io::animation_frame frame;
+     * while (reader.read_frame(frame)) { ... }
+     * @endcode
+     */
+    class apng_reader {
+        public:
+            /**
+             * @throws png_error if the file cannot be opened or its header is invalid
+             */
+            explicit apng_reader(const std::string& path)
+                : file_(std::make_unique <std::ifstream>(path, std::ios::binary)),
+                  in_(*file_) {
+                if (!*file_) {
+                    throw png_error("cannot open " + path);
+                }
+                read_header();
+            }
+
+            /**
+             * Read from a stream positioned at the PNG signature
+             */
+            explicit apng_reader(std::istream& in)
+                : in_(in) {
+                read_header();
+            }
+
+            apng_reader(const apng_reader&) = delete;
+            apng_reader& operator=(const apng_reader&) = delete;
+
+            [[nodiscard]] size_t width() const { return width_; }
+            [[nodiscard]] size_t height() const { return height_; }
+
+            /// Times the animation plays, 0 = forever
+            [[nodiscard]] unsigned loop_count() const { return loop_count_; }
+
+            /// Frames announced by acTL (1 for a plain PNG)
+            [[nodiscard]] size_t frame_count() const { return frame_count_; }
+
+            /// Whether the file has an acTL chunk
+            [[nodiscard]] bool animated() const { return animated_; }
+
+            [[nodiscard]] size_t frames_read() const { return frames_; }
+
+            /**
+             * Decode the next frame and compose it onto the canvas
+             * @return false after the last frame
+             * @throws png_error / zlib_error on malformed data
+             */
+            bool read_frame(animation_frame& frame) {
+                if (frames_ == frame_count_) {
+                    return false;
+                }
+
+                detail::apng_frame_control control;
+                std::vector <std::uint8_t> data;
+                if (frames_ == 0 && (!animated_ || default_control_)) {
+                    control = default_control_ ? *default_control_
+                                               : detail::apng_frame_control{{0, 0, width_, height_}};
+                    collect_data("IDAT", 0, data);
+                } else {
+                    if (frames_ == 0) {
+                        // The default image is not part of the animation
+                        collect_data("IDAT", 0, data);
+                        data.clear();
+                    }
+                    while (true) {
+                        detail::png_chunk chunk = next_chunk();
+                        if (chunk.type == "fcTL") {
+                            control = parse_frame_control(chunk.data);
+                            break;
+                        }
+                        if (chunk.type == "IEND") {
+                            throw png_error("animation ends after " + std::to_string(frames_) + " of " +
+                                            std::to_string(frame_count_) + " frames");
+                        }
+                    }
+                    collect_data("fdAT", 4, data);
+                }
+
+                compose(control, data);
+                frame.image = canvas_;
+                frame.delay_ms = control.delay_ms;
+                ++frames_;
+                return true;
+            }
+
+        private:
+            // Chunk data is read in pieces of this size at most
+            static constexpr size_t read_piece_size = 64 * 1024;
+
+            void read_exact(std::uint8_t* data, size_t size) {
+                in_.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(size));
+                if (static_cast<size_t>(in_.gcount()) != size) {
+                    throw png_error("unexpected end of file");
+                }
+            }
+
+            detail::png_chunk next_chunk() {
+                if (lookahead_) {
+                    detail::png_chunk chunk = std::move(*lookahead_);
+                    lookahead_.reset();
+                    return chunk;
+                }
+                std::uint8_t header[8];
+                read_exact(header, 8);
+                const std::uint32_t length = detail::read_be32(header);
+                if (length > 0x7FFFFFFFu) {
+                    throw png_error("invalid chunk length");
+                }
+                detail::png_chunk chunk;
+                chunk.type.assign(reinterpret_cast<const char*>(header + 4), 4);
+                // Grow with the bytes actually read: a truncated chunk claiming
+                // 2 GiB then fails after at most one piece, not one huge allocation
+                while (chunk.data.size() < length) {
+                    const size_t offset = chunk.data.size();
+                    const size_t count = std::min <size_t>(length - offset, read_piece_size);
+                    chunk.data.resize(offset + count);
+                    read_exact(chunk.data.data() + offset, count);
+                }
+                std::uint8_t stored[4];
+                read_exact(stored, 4);
+                const std::uint32_t crc = crc32(chunk.data.data(), length, crc32(header + 4, 4));
+                if (detail::read_be32(stored) != crc) {
+                    throw png_error("chunk CRC mismatch");
+                }
+                return chunk;
+            }
+
+            // Append the payload of consecutive chunks of one type, skipping a prefix of each
+            void collect_data(const char* type, size_t skip, std::vector <std::uint8_t>& data) {
+                while (true) {
+                    detail::png_chunk chunk = next_chunk();
+                    if (chunk.type != type) {
+                        lookahead_ = std::move(chunk);
+                        return;
+                    }
+                    if (chunk.data.size() < skip) {
+                        throw png_error("truncated " + chunk.type);
+                    }
+                    data.insert(data.end(), chunk.data.begin() + static_cast<std::ptrdiff_t>(skip), chunk.data.end());
+                }
+            }
+
+            detail::apng_frame_control parse_frame_control(const std::vector <std::uint8_t>& data) const {
+                if (data.size() < detail::apng_frame_control_size) {
+                    throw png_error("truncated fcTL");
+                }
+                detail::apng_frame_control control;
+                control.rect = {detail::read_be32(data.data() + 12), detail::read_be32(data.data() + 16),
+                                detail::read_be32(data.data() + 4), detail::read_be32(data.data() + 8)};
+                if (control.rect.empty() || control.rect.x + control.rect.width > width_ ||
+                    control.rect.y + control.rect.height > height_) {
+                    throw png_error("frame outside the canvas");
+                }
+                const unsigned numerator = detail::read_be16(data.data() + 20);
+                const unsigned denominator = detail::read_be16(data.data() + 22);
+                control.delay_ms = denominator == 0 ? numerator * 10u : numerator * 1000u / denominator;
+                control.dispose = data[24];
+                control.blend = data[25];
+                if (control.dispose > detail::apng_dispose_previous || control.blend > detail::apng_blend_over) {
+                    throw png_error("invalid fcTL dispose or blend operation");
+                }
+                return control;
+            }
+
+            void read_header() {
+                std::uint8_t signature[8];
+                read_exact(signature, 8);
+                if (!std::equal(signature, signature + 8, detail::png_signature)) {
+                    throw png_error("not a PNG file");
+                }
+                detail::png_chunk chunk = next_chunk();
+                if (chunk.type != "IHDR" || chunk.data.size() != 13) {
+                    throw png_error("missing IHDR");
+                }
+                header_ = chunk.data;
+                width_ = detail::read_be32(header_.data());
+                height_ = detail::read_be32(header_.data() + 4);
+                if (width_ == 0 || height_ == 0) {
+                    throw png_error("invalid IHDR");
+                }
+
+                // Everything up to the first IDAT
+                while (true) {
+                    chunk = next_chunk();
+                    if (chunk.type == "IDAT") {
+                        lookahead_ = std::move(chunk);
+                        break;
+                    }
+                    if (chunk.type == "IEND") {
+                        throw png_error("no image data");
+                    }
+                    if (chunk.type == "acTL" && chunk.data.size() == 8) {
+                        animated_ = true;
+                        frame_count_ = detail::read_be32(chunk.data.data());
+                        loop_count_ = detail::read_be32(chunk.data.data() + 4);
+                    } else if (chunk.type == "fcTL") {
+                        default_control_ = parse_frame_control(chunk.data);
+                    } else if (chunk.type == "PLTE") {
+                        palette_ = std::move(chunk.data);
+                    } else if (chunk.type == "tRNS") {
+                        transparency_ = std::move(chunk.data);
+                    } else if (!(chunk.type[0] & 0x20)) {
+                        throw png_error("unsupported critical chunk " + chunk.type);
+                    }
+                }
+                if (animated_ && frame_count_ == 0) {
+                    throw png_error("acTL announces no frames");
+                }
+
+                canvas_ = packed_image(width_, height_, 4);
+                detail::clear_rect(canvas_, {0, 0, width_, height_});
+            }
+
+            // Decode the frame's data as a standalone PNG of the frame's size
+            packed_image decode_frame(const frame_rect& rect, const std::vector <std::uint8_t>& data) const {
+                std::ostringstream png;
+                png.write(reinterpret_cast<const char*>(detail::png_signature), 8);
+                std::vector <std::uint8_t> header = header_;
+                detail::write_be32(header.data(), static_cast<std::uint32_t>(rect.width));
+                detail::write_be32(header.data() + 4, static_cast<std::uint32_t>(rect.height));
+                detail::write_png_chunk(png, "IHDR", header.data(), header.size());
+                if (!palette_.empty()) {
+                    detail::write_png_chunk(png, "PLTE", palette_.data(), palette_.size());
+                }
+                if (!transparency_.empty()) {
+                    detail::write_png_chunk(png, "tRNS", transparency_.data(), transparency_.size());
+                }
+                detail::write_png_chunk(png, "IDAT", data.data(), data.size());
+                detail::write_png_chunk(png, "IEND", nullptr, 0);
+
+                std::istringstream in(png.str());
+                png_row_reader reader(in);
+                packed_image pixels(rect.width, rect.height, 4);
+                for (size_t y = 0; y < rect.height; ++y) {
+                    if (!reader.read_row(pixels.row(y), 4)) {
+                        throw png_error("frame data ends early");
+                    }
+                }
+                return pixels;
+            }
+
+            void compose(const detail::apng_frame_control& control, const std::vector <std::uint8_t>& data) {
+                const packed_image pixels = decode_frame(control.rect, data);
+
+                // The previous frame's disposal applies before this frame is drawn
+                if (previous_dispose_ == detail::apng_dispose_background) {
+                    detail::clear_rect(canvas_, previous_rect_);
+                } else if (previous_dispose_ == detail::apng_dispose_previous) {
+                    canvas_ = saved_;
+                }
+
+                std::uint8_t dispose = control.dispose;
+                if (dispose == detail::apng_dispose_previous) {
+                    if (frames_ == 0) {
+                        dispose = detail::apng_dispose_background;
+                    } else {
+                        saved_ = canvas_;
+                    }
+                }
+
+                const frame_rect& rect = control.rect;
+                for (size_t y = 0; y < rect.height; ++y) {
+                    const std::uint8_t* src = pixels.row(y);
+                    std::uint8_t* dst = canvas_.row(rect.y + y) + rect.x * 4;
+                    if (control.blend == detail::apng_blend_source) {
+                        std::memcpy(dst, src, rect.width * 4);
+                        continue;
+                    }
+                    for (size_t x = 0; x < rect.width; ++x) {
+                        detail::blend_over(src + x * 4, dst + x * 4);
+                    }
+                }
+
+                previous_dispose_ = dispose;
+                previous_rect_ = rect;
+            }
+
+            std::unique_ptr <std::ifstream> file_;
+            std::istream& in_;
+
+            size_t width_ = 0;
+            size_t height_ = 0;
+            bool animated_ = false;
+            size_t frame_count_ = 1;
+            unsigned loop_count_ = 0;
+            std::vector <std::uint8_t> header_;
+            std::vector <std::uint8_t> palette_;
+            std::vector <std::uint8_t> transparency_;
+            std::optional <detail::apng_frame_control> default_control_;
+            std::optional <detail::png_chunk> lookahead_;
+
+            packed_image canvas_{1, 1, 4};
+            packed_image saved_{1, 1, 4};
+            std::uint8_t previous_dispose_ = detail::apng_dispose_none;
+            frame_rect previous_rect_;
+            size_t frames_ = 0;
+    };
+
+    /**
+     * APNG encoder that takes whole canvases
+     *
+     * The first frame is the full canvas (and the default image, so viewers
+     * without APNG support show it). Every later frame is cropped to the
+     * rectangle that changed; when all changed pixels are opaque it is
+     * blended "over" the previous frame with unchanged pixels written as
+     * transparent black, which filters and deflates to almost nothing.
+     * Consecutive identical frames are merged into one with the summed
+     * delay. Output is 8-bit RGBA.
+     *
+     * The frame count in acTL is patched when the animation is finished,
+     * so the output stream must be seekable.
+     */
+    class apng_writer {
+        public:
+            /// Compressed bytes per IDAT/fdAT chunk at most
+            static constexpr size_t data_chunk_size = 1024 * 1024;
+
+            /**
+             * @param loop_count Times the animation plays, 0 = forever
+             * @param level zlib compression level 0-9
+             * @throws png_error if the file cannot be created or the size is invalid
+             */
+            apng_writer(const std::string& path, size_t width, size_t height, unsigned loop_count = 0,
+                        int level = 6)
+                : file_(std::make_unique <std::ofstream>(path, std::ios::binary | std::ios::trunc)),
+                  out_(*file_),
+                  width_(width),
+                  height_(height),
+                  level_(level) {
+                if (!*file_) {
+                    throw png_error("cannot create " + path);
+                }
+                start(loop_count);
+            }
+
+            apng_writer(std::ostream& out, size_t width, size_t height, unsigned loop_count = 0, int level = 6)
+                : out_(out),
+                  width_(width),
+                  height_(height),
+                  level_(level) {
+                start(loop_count);
+            }
+
+            apng_writer(const apng_writer&) = delete;
+            apng_writer& operator=(const apng_writer&) = delete;
+
+            /**
+             * Append a frame (RGB or RGBA canvas of the animation's size)
+             * @throws png_error for a canvas of the wrong size
+             */
+            void write_frame(const packed_image& canvas, unsigned delay_ms) {
+                if (canvas.width() != width_ || canvas.height() != height_) {
+                    throw png_error("frame size differs from the animation size");
+                }
+                packed_image frame(width_, height_, 4);
+                const auto channels = static_cast<size_t>(canvas.channels());
+                for (size_t y = 0; y < height_; ++y) {
+                    const std::uint8_t* in = canvas.row(y);
+                    std::uint8_t* out = frame.row(y);
+                    for (size_t x = 0; x < width_; ++x, in += channels, out += 4) {
+                        std::memcpy(out, in, 3);
+                        out[3] = channels == 4 ? in[3] : 255;
+                    }
+                }
+
+                if (has_pending_ && std::memcmp(frame.data(), pending_.data(), frame.row_bytes() * height_) == 0) {
+                    pending_delay_ += delay_ms;
+                    return;
+                }
+                if (has_pending_) {
+                    emit_pending();
+                }
+                pending_ = std::move(frame);
+                pending_delay_ = delay_ms;
+                has_pending_ = true;
+            }
+
+            /**
+             * Write the held-back frame, the end of the file and the frame count
+             * @throws png_error if no frame was written
+             */
+            void finish() {
+                if (finished_) {
+                    return;
+                }
+                if (!has_pending_) {
+                    throw png_error("animation has no frames");
+                }
+                emit_pending();
+                has_pending_ = false;
+                detail::write_png_chunk(out_, "IEND", nullptr, 0);
+
+                const std::streampos end = out_.tellp();
+                out_.seekp(animation_control_at_);
+                write_animation_control();
+                out_.seekp(end);
+                out_.flush();
+                if (!out_) {
+                    throw png_error("write failed");
+                }
+                finished_ = true;
+            }
+
+            /**
+             * Frames encoded so far (identical frames count once)
+             */
+            [[nodiscard]] size_t frames_written() const { return frames_; }
+
+        private:
+            void start(unsigned loop_count) {
+                loop_count_ = loop_count;
+                detail::write_png_header(out_, width_, height_, 4);
+                animation_control_at_ = out_.tellp();
+                if (animation_control_at_ == std::streampos(-1)) {
+                    throw png_error("APNG output needs a seekable stream");
+                }
+                write_animation_control();
+                previous_ = packed_image(width_, height_, 4);
+                detail::clear_rect(previous_, {0, 0, width_, height_});
+            }
+
+            void write_animation_control() {
+                std::uint8_t data[8];
+                detail::write_be32(data, static_cast<std::uint32_t>(std::max <size_t>(frames_, 1)));
+                detail::write_be32(data + 4, loop_count_);
+                detail::write_png_chunk(out_, "acTL", data, sizeof(data));
+            }
+
+            void emit_pending() {
+                frame_rect rect{0, 0, width_, height_};
+                std::uint8_t blend = detail::apng_blend_source;
+                if (frames_ > 0) {
+                    rect = detail::changed_rect(previous_, pending_);
+                    if (rect.empty()) {
+                        rect = {0, 0, 1, 1};
+                    }
+                    blend = detail::apng_blend_over;
+                    for (size_t y = rect.y; y < rect.y + rect.height && blend == detail::apng_blend_over; ++y) {
+                        const std::uint8_t* p = pending_.row(y) + rect.x * 4;
+                        const std::uint8_t* q = previous_.row(y) + rect.x * 4;
+                        for (size_t x = 0; x < rect.width; ++x, p += 4, q += 4) {
+                            if (p[3] != 255 && std::memcmp(p, q, 4) != 0) {
+                                blend = detail::apng_blend_source;
+                                break;
+                            }
+                        }
+                    }
+                }
+
+                std::uint8_t control[detail::apng_frame_control_size];
+                detail::write_be32(control, sequence_++);
+                detail::write_be32(control + 4, static_cast<std::uint32_t>(rect.width));
+                detail::write_be32(control + 8, static_cast<std::uint32_t>(rect.height));
+                detail::write_be32(control + 12, static_cast<std::uint32_t>(rect.x));
+                detail::write_be32(control + 16, static_cast<std::uint32_t>(rect.y));
+                const unsigned delay = std::min(pending_delay_, 0xFFFFu);
+                control[20] = static_cast<std::uint8_t>(delay >> 8);
+                control[21] = static_cast<std::uint8_t>(delay);
+                control[22] = static_cast<std::uint8_t>(1000 >> 8);
+                control[23] = static_cast<std::uint8_t>(1000 & 0xFF);
+                control[24] = detail::apng_dispose_none;
+                control[25] = blend;
+                detail::write_png_chunk(out_, "fcTL", control, sizeof(control));
+
+                // Filter and deflate the rectangle
+                const size_t size = rect.width * 4;
+                std::vector <std::uint8_t> row(size);
+                std::vector <std::uint8_t> prior(size, 0);
+                std::vector <std::uint8_t> filtered(size + 1);
+                std::vector <std::uint8_t> scratch;
+                std::vector <std::uint8_t> compressed;
+                deflater deflate(level_);
+                for (size_t y = rect.y; y < rect.y + rect.height; ++y) {
+                    const std::uint8_t* p = pending_.row(y) + rect.x * 4;
+                    const std::uint8_t* q = previous_.row(y) + rect.x * 4;
+                    for (size_t x = 0; x < size; x += 4) {
+                        if (blend == detail::apng_blend_over && std::memcmp(p + x, q + x, 4) == 0) {
+                            std::memset(row.data() + x, 0, 4);
+                        } else {
+                            std::memcpy(row.data() + x, p + x, 4);
+                        }
+                    }
+                    detail::png_filter_row(row.data(), prior.data(), size, 4, level_ > 0, scratch, filtered.data());
+                    std::swap(row, prior);
+                    deflate.write(filtered.data(), filtered.size(), compressed,
+                                  y + 1 == rect.y + rect.height ? deflate_flush::finish : deflate_flush::none);
+                }
+
+                std::vector <std::uint8_t> chunk;
+                for (size_t at = 0; at < compressed.size(); at += data_chunk_size) {
+                    const size_t count = std::min(data_chunk_size, compressed.size() - at);
+                    if (frames_ == 0) {
+                        detail::write_png_chunk(out_, "IDAT", compressed.data() + at, count);
+                        continue;
+                    }
+                    chunk.resize(4 + count);
+                    detail::write_be32(chunk.data(), sequence_++);
+                    std::memcpy(chunk.data() + 4, compressed.data() + at, count);
+                    detail::write_png_chunk(out_, "fdAT", chunk.data(), chunk.size());
+                }
+
+                previous_ = pending_;
+                ++frames_;
+            }
+
+            std::unique_ptr <std::ofstream> file_;
+            std::ostream& out_;
+            size_t width_;
+            size_t height_;
+            int level_;
+            unsigned loop_count_ = 0;
+            std::streampos animation_control_at_ = 0;
+
+            packed_image previous_{1, 1, 4};
+            packed_image pending_{1, 1, 4};
+            unsigned pending_delay_ = 0;
+            bool has_pending_ = false;
+            std::uint32_t sequence_ = 0;
+            size_t frames_ = 0;
+            bool finished_ = false;
+    };
+
+} // namespace scaler::io
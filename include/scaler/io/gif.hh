@@ -0,0 +1,736 @@
+#pragma once
+
+#include <scaler/io/animation_frame.hh>
+#include <scaler/io/io_exceptions.hh>
+#include <scaler/io/packed_image.hh>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace scaler::io {
+
+    namespace detail {
+
+        inline constexpr std::uint8_t gif_extension = 0x21;
+        inline constexpr std::uint8_t gif_image = 0x2C;
+        inline constexpr std::uint8_t gif_trailer = 0x3B;
+        inline constexpr std::uint8_t gif_graphic_control = 0xF9;
+        inline constexpr std::uint8_t gif_application = 0xFF;
+        inline constexpr unsigned gif_max_codes = 4096;
+        inline constexpr size_t gif_max_dimension = 0xFFFF;
+        /// Largest logical screen gif_reader decodes: 64 Mpixels, a 256 MiB RGBA canvas
+        inline constexpr size_t gif_max_canvas_pixels = size_t{1} << 26;
+
+        /**
+         * Decode GIF LZW data into count palette indices
+         * @return Indices produced; fewer than count if the data ends early
+         * @throws gif_error on an invalid code
+         */
+        inline size_t gif_lzw_decode(const std::uint8_t* data, size_t size, int min_code_size,
+                                     std::uint8_t* out, size_t count) {
+            if (min_code_size < 1 || min_code_size > 11) {
+                throw gif_error("invalid LZW code size " + std::to_string(min_code_size));
+            }
+            const unsigned clear = 1u << min_code_size;
+            const unsigned end = clear + 1;
+
+            std::array <std::uint16_t, gif_max_codes> prefix{};
+            std::array <std::uint8_t, gif_max_codes> suffix{};
+            std::array <std::uint8_t, gif_max_codes> first{};
+            std::array <std::uint16_t, gif_max_codes> length{};
+            for (unsigned i = 0; i < clear; ++i) {
+                suffix[i] = static_cast<std::uint8_t>(i);
+                first[i] = static_cast<std::uint8_t>(i);
+                length[i] = 1;
+            }
+
+            int code_size = min_code_size + 1;
+            unsigned next = clear + 2;
+            unsigned prev = gif_max_codes;
+            std::uint32_t bits = 0;
+            int bit_count = 0;
+            size_t pos = 0;
+            size_t produced = 0;
+
+            while (produced < count) {
+                while (bit_count < code_size) {
+                    if (pos == size) {
+                        return produced;
+                    }
+                    bits |= static_cast<std::uint32_t>(data[pos++]) << bit_count;
+                    bit_count += 8;
+                }
+                const unsigned code = bits & ((1u << code_size) - 1u);
+                bits >>= code_size;
+                bit_count -= code_size;
+
+                if (code == clear) {
+                    code_size = min_code_size + 1;
+                    next = clear + 2;
+                    prev = gif_max_codes;
+                    continue;
+                }
+                if (code == end) {
+                    break;
+                }
+                if (prev == gif_max_codes) {
+                    if (code >= clear) {
+                        throw gif_error("invalid first LZW code");
+                    }
+                } else {
+                    if (code > next || (code == next && next == gif_max_codes)) {
+                        throw gif_error("invalid LZW code");
+                    }
+                    if (next < gif_max_codes) {
+                        // code == next is the KwKwK case: prev + first(prev)
+                        prefix[next] = static_cast<std::uint16_t>(prev);
+                        suffix[next] = first[code == next ? prev : code];
+                        first[next] = first[prev];
+                        length[next] = static_cast<std::uint16_t>(length[prev] + 1);
+                        if (++next == (1u << code_size) && code_size < 12) {
+                            ++code_size;
+                        }
+                    }
+                }
+
+                // Entries are stored back to front
+                const size_t run = length[code];
+                unsigned c = code;
+                for (size_t i = run; i-- > 0;) {
+                    if (produced + i < count) {
+                        out[produced + i] = suffix[c];
+                    }
+                    c = prefix[c];
+                }
+                produced += std::min(run, count - produced);
+                prev = code;
+            }
+            return produced;
+        }
+
+        /**
+         * GIF LZW-encode palette indices, appending the code stream to out
+         */
+        inline void gif_lzw_encode(const std::uint8_t* indices, size_t count, int min_code_size,
+                                   std::vector <std::uint8_t>& out) {
+            const unsigned clear = 1u << min_code_size;
+            const unsigned end = clear + 1;
+
+            // Open addressing: (prefix << 8 | byte) + 1 -> code, 0 marks a free slot
+            constexpr size_t table_size = 8192;
+            std::vector <std::uint32_t> keys(table_size);
+            std::vector <std::uint16_t> codes(table_size);
+
+            int code_size = min_code_size + 1;
+            unsigned next = clear + 2;
+            std::uint32_t bits = 0;
+            int bit_count = 0;
+            const auto put = [&](unsigned code) {
+                bits |= static_cast<std::uint32_t>(code) << bit_count;
+                bit_count += code_size;
+                while (bit_count >= 8) {
+                    out.push_back(static_cast<std::uint8_t>(bits));
+                    bits >>= 8;
+                    bit_count -= 8;
+                }
+            };
+            const auto reset = [&]() {
+                std::fill(keys.begin(), keys.end(), 0u);
+                code_size = min_code_size + 1;
+                next = clear + 2;
+            };
+
+            put(clear);
+            if (count > 0) {
+                unsigned current = indices[0];
+                for (size_t i = 1; i < count; ++i) {
+                    const std::uint32_t key = ((static_cast<std::uint32_t>(current) << 8) | indices[i]) + 1;
+                    size_t slot = (key * 2654435761u) & (table_size - 1);
+                    while (keys[slot] != 0 && keys[slot] != key) {
+                        slot = (slot + 1) & (table_size - 1);
+                    }
+                    if (keys[slot] == key) {
+                        current = codes[slot];
+                        continue;
+                    }
+
+                    put(current);
+                    keys[slot] = key;
+                    codes[slot] = static_cast<std::uint16_t>(next);
+                    if (++next > (1u << code_size) && code_size < 12) {
+                        ++code_size;
+                    }
+                    if (next == gif_max_codes) {
+                        put(clear);
+                        reset();
+                    }
+                    current = indices[i];
+                }
+                put(current);
+            }
+            put(end);
+            if (bit_count > 0) {
+                out.push_back(static_cast<std::uint8_t>(bits));
+            }
+        }
+
+        /**
+         * Image row of decoded row r of an interlaced GIF frame
+         */
+        inline size_t gif_interlaced_row(size_t r, size_t height) {
+            static constexpr size_t starts[4] = {0, 4, 2, 1};
+            static constexpr size_t steps[4] = {8, 8, 4, 2};
+            for (size_t pass = 0; pass < 4; ++pass) {
+                const size_t rows = height > starts[pass] ? (height - starts[pass] + steps[pass] - 1) / steps[pass] : 0;
+                if (r < rows) {
+                    return starts[pass] + r * steps[pass];
+                }
+                r -= rows;
+            }
+            return height;
+        }
+
+    } // namespace detail
+
+    /**
+     * Animated GIF decoder that delivers one composed frame at a time
+     *
+     * Only the canvas (plus a saved copy while a frame uses "restore to
+     * previous") is held, so long animations decode in constant memory.
+     * Disposal "restore to background" clears to transparent, as browsers
+     * do. Frames without a graphic control extension get a delay of 0.
+     *
+     * Screens of more than detail::gif_max_canvas_pixels pixels and frames
+     * that reach outside the screen are rejected before anything is
+     * allocated for them.
+     *
+     * @code
+     * io::gif_reader reader("walk.gif");
+     * io::animation_frame frame;
+     * while (reader.read_frame(frame)) { ... }
+     * @endcode
+     */
+    class gif_reader {
+        public:
+            /**
+             * @throws gif_error if the file cannot be opened or its header is invalid
+             */
+            explicit gif_reader(const std::string& path)
+                : file_(std::make_unique <std::ifstream>(path, std::ios::binary)),
+                  in_(*file_) {
+                if (!*file_) {
+                    throw gif_error("cannot open " + path);
+                }
+                read_header();
+            }
+
+            /**
+             * Read from a stream positioned at the GIF signature
+             */
+            explicit gif_reader(std::istream& in)
+                : in_(in) {
+                read_header();
+            }
+
+            gif_reader(const gif_reader&) = delete;
+            gif_reader& operator=(const gif_reader&) = delete;
+
+            [[nodiscard]] size_t width() const { return width_; }
+            [[nodiscard]] size_t height() const { return height_; }
+
+            /**
+             * Times the animation plays, 0 = forever (from the NETSCAPE2.0
+             * extension before the first frame)
+             */
+            [[nodiscard]] unsigned loop_count() const { return loop_count_; }
+
+            [[nodiscard]] size_t frames_read() const { return frames_; }
+
+            /**
+             * Decode the next frame and compose it onto the canvas
+             * @return false after the last frame
+             * @throws gif_error on malformed data
+             */
+            bool read_frame(animation_frame& frame) {
+                if (!at_image_) {
+                    read_to_image();
+                }
+                if (done_) {
+                    return false;
+                }
+                read_image();
+                at_image_ = false;
+                frame.image = canvas_;
+                frame.delay_ms = delay_cs_ * 10;
+                delay_cs_ = 0;
+                disposal_ = 0;
+                transparent_ = -1;
+                ++frames_;
+                return true;
+            }
+
+        private:
+            static std::string to_hex(unsigned value) {
+                static constexpr char digits[] = "0123456789abcdef";
+                return {digits[(value >> 4) & 15u], digits[value & 15u]};
+            }
+
+            std::uint8_t read_byte() {
+                const int value = in_.get();
+                if (value == std::char_traits <char>::eof()) {
+                    throw gif_error("unexpected end of file");
+                }
+                return static_cast<std::uint8_t>(value);
+            }
+
+            void read_exact(std::uint8_t* data, size_t size) {
+                in_.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(size));
+                if (static_cast<size_t>(in_.gcount()) != size) {
+                    throw gif_error("unexpected end of file");
+                }
+            }
+
+            size_t read_u16() {
+                std::uint8_t bytes[2];
+                read_exact(bytes, 2);
+                return static_cast<size_t>(bytes[0] | (bytes[1] << 8));
+            }
+
+            // Concatenated payload of a sub-block sequence
+            std::vector <std::uint8_t> read_sub_blocks() {
+                std::vector <std::uint8_t> data;
+                while (const std::uint8_t size = read_byte()) {
+                    const size_t at = data.size();
+                    data.resize(at + size);
+                    read_exact(data.data() + at, size);
+                }
+                return data;
+            }
+
+            std::vector <std::uint8_t> read_palette(unsigned size_bits) {
+                std::vector <std::uint8_t> palette(size_t{3} << (size_bits + 1));
+                read_exact(palette.data(), palette.size());
+                return palette;
+            }
+
+            void read_header() {
+                std::uint8_t header[13];
+                read_exact(header, sizeof(header));
+                if (std::memcmp(header, "GIF87a", 6) != 0 && std::memcmp(header, "GIF89a", 6) != 0) {
+                    throw gif_error("not a GIF file");
+                }
+                width_ = static_cast<size_t>(header[6] | (header[7] << 8));
+                height_ = static_cast<size_t>(header[8] | (header[9] << 8));
+                if (width_ == 0 || height_ == 0) {
+                    throw gif_error("invalid screen size");
+                }
+                if (width_ * height_ > detail::gif_max_canvas_pixels) {
+                    throw gif_error("screen of " + std::to_string(width_) + "x" + std::to_string(height_) +
+                                    " exceeds the decoder limit");
+                }
+                if (header[10] & 0x80u) {
+                    global_palette_ = read_palette(header[10] & 7u);
+                }
+                canvas_ = packed_image(width_, height_, 4);
+                detail::clear_rect(canvas_, {0, 0, width_, height_});
+                // The loop count precedes the first frame
+                read_to_image();
+            }
+
+            // Read extensions up to the next image descriptor or the end of the file
+            void read_to_image() {
+                while (!done_) {
+                    const int introducer = in_.get();
+                    if (introducer == std::char_traits <char>::eof() || introducer == detail::gif_trailer) {
+                        // A missing trailer is common and harmless
+                        done_ = true;
+                    } else if (introducer == detail::gif_extension) {
+                        read_extension();
+                    } else if (introducer == detail::gif_image) {
+                        at_image_ = true;
+                        return;
+                    } else {
+                        throw gif_error("unexpected block 0x" + to_hex(static_cast<unsigned>(introducer)));
+                    }
+                }
+            }
+
+            void read_extension() {
+                const std::uint8_t label = read_byte();
+                const std::vector <std::uint8_t> data = read_sub_blocks();
+                if (label == detail::gif_graphic_control && data.size() >= 4) {
+                    disposal_ = (data[0] >> 2) & 7u;
+                    delay_cs_ = static_cast<unsigned>(data[1] | (data[2] << 8));
+                    transparent_ = (data[0] & 1u) ? data[3] : -1;
+                } else if (label == detail::gif_application && data.size() >= 14 && data[11] == 1 &&
+                           (std::memcmp(data.data(), "NETSCAPE2.0", 11) == 0 ||
+                            std::memcmp(data.data(), "ANIMEXTS1.0", 11) == 0)) {
+                    // Stored as extra repetitions; 0 loops forever
+                    const unsigned repeats = static_cast<unsigned>(data[12] | (data[13] << 8));
+                    loop_count_ = repeats == 0 ? 0 : repeats + 1;
+                }
+            }
+
+            void read_image() {
+                // The previous frame's disposal applies before this frame is drawn
+                if (previous_disposal_ == 2) {
+                    detail::clear_rect(canvas_, previous_rect_);
+                } else if (previous_disposal_ == 3) {
+                    canvas_ = saved_;
+                }
+
+                std::uint8_t descriptor[9];
+                read_exact(descriptor, sizeof(descriptor));
+                const size_t left = static_cast<size_t>(descriptor[0] | (descriptor[1] << 8));
+                const size_t top = static_cast<size_t>(descriptor[2] | (descriptor[3] << 8));
+                const size_t width = static_cast<size_t>(descriptor[4] | (descriptor[5] << 8));
+                const size_t height = static_cast<size_t>(descriptor[6] | (descriptor[7] << 8));
+                const bool interlaced = (descriptor[8] & 0x40u) != 0;
+                if (left + width > width_ || top + height > height_) {
+                    throw gif_error("frame reaches outside the screen");
+                }
+                const std::vector <std::uint8_t> local_palette =
+                    (descriptor[8] & 0x80u) ? read_palette(descriptor[8] & 7u) : std::vector <std::uint8_t>{};
+                const std::vector <std::uint8_t>& palette = local_palette.empty() ? global_palette_ : local_palette;
+                if (palette.empty()) {
+                    throw gif_error("frame without a color table");
+                }
+
+                const int min_code_size = read_byte();
+                const std::vector <std::uint8_t> data = read_sub_blocks();
+                std::vector <std::uint8_t> indices(width * height);
+                const size_t decoded = detail::gif_lzw_decode(data.data(), data.size(), min_code_size,
+                                                              indices.data(), indices.size());
+
+                if (disposal_ == 3) {
+                    saved_ = canvas_;
+                }
+
+                // Pixels the data does not cover keep the canvas, like transparent ones
+                const size_t colors = palette.size() / 3;
+                for (size_t i = 0; i < decoded; ++i) {
+                    const size_t r = i / width;
+                    const size_t x = left + i % width;
+                    const size_t y = top + (interlaced ? detail::gif_interlaced_row(r, height) : r);
+                    const std::uint8_t index = indices[i];
+                    if (static_cast<int>(index) == transparent_ || index >= colors) {
+                        continue;
+                    }
+                    std::uint8_t* p = canvas_.row(y) + x * 4;
+                    p[0] = palette[index * 3u];
+                    p[1] = palette[index * 3u + 1];
+                    p[2] = palette[index * 3u + 2];
+                    p[3] = 255;
+                }
+
+                previous_disposal_ = disposal_;
+                previous_rect_ = {left, top, width, height};
+            }
+
+            std::unique_ptr <std::ifstream> file_;
+            std::istream& in_;
+
+            size_t width_ = 0;
+            size_t height_ = 0;
+            unsigned loop_count_ = 1;
+            std::vector <std::uint8_t> global_palette_;
+
+            packed_image canvas_{1, 1, 4};
+            packed_image saved_{1, 1, 4};
+            unsigned previous_disposal_ = 0;
+            frame_rect previous_rect_;
+            size_t frames_ = 0;
+            bool at_image_ = false;
+            bool done_ = false;
+
+            // Graphic control of the next frame
+            unsigned delay_cs_ = 0;
+            unsigned disposal_ = 0;
+            int transparent_ = -1;
+    };
+
+    /**
+     * Animated GIF encoder that takes whole canvases
+     *
+     * Each frame is cropped to the rectangle that changed since the canvas
+     * on screen, and pixels inside it that did not change are written as
+     * the transparent index, which LZW packs into long runs. Consecutive
+     * identical frames are merged into one with the summed delay. Where a
+     * frame turns opaque pixels transparent, the frame before it is
+     * disposed to background instead. Every frame has its own color table,
+     * so each frame may use up to 256 colors (255 with transparency); alpha
+     * below 128 is transparent.
+     *
+     * One frame is held back until the next arrives, since its disposal
+     * depends on it.
+     */
+    class gif_writer {
+        public:
+            /**
+             * @param loop_count Times the animation plays, 0 = forever
+             * @throws gif_error if the file cannot be created or the size is invalid
+             */
+            gif_writer(const std::string& path, size_t width, size_t height, unsigned loop_count = 0)
+                : file_(std::make_unique <std::ofstream>(path, std::ios::binary | std::ios::trunc)),
+                  out_(*file_),
+                  width_(width),
+                  height_(height) {
+                if (!*file_) {
+                    throw gif_error("cannot create " + path);
+                }
+                start(loop_count);
+            }
+
+            gif_writer(std::ostream& out, size_t width, size_t height, unsigned loop_count = 0)
+                : out_(out),
+                  width_(width),
+                  height_(height) {
+                start(loop_count);
+            }
+
+            gif_writer(const gif_writer&) = delete;
+            gif_writer& operator=(const gif_writer&) = delete;
+
+            /**
+             * Append a frame (RGB or RGBA canvas of the animation's size)
+             * @throws gif_error for a canvas of the wrong size or a frame of
+             *         more than 256 colors
+             */
+            void write_frame(const packed_image& canvas, unsigned delay_ms) {
+                if (canvas.width() != width_ || canvas.height() != height_) {
+                    throw gif_error("frame size differs from the animation size");
+                }
+                packed_image frame = normalize(canvas);
+                if (has_pending_ && std::memcmp(frame.data(), pending_.data(), frame.row_bytes() * height_) == 0) {
+                    pending_delay_ += delay_ms;
+                    return;
+                }
+                if (has_pending_) {
+                    emit_pending(&frame);
+                }
+                pending_ = std::move(frame);
+                pending_delay_ = delay_ms;
+                has_pending_ = true;
+            }
+
+            /**
+             * Write the held-back frame and the trailer
+             * @throws gif_error if no frame was written
+             */
+            void finish() {
+                if (finished_) {
+                    return;
+                }
+                if (!has_pending_) {
+                    throw gif_error("animation has no frames");
+                }
+                emit_pending(nullptr);
+                has_pending_ = false;
+                out_.put(static_cast<char>(detail::gif_trailer));
+                out_.flush();
+                if (!out_) {
+                    throw gif_error("write failed");
+                }
+                finished_ = true;
+            }
+
+            /**
+             * Frames encoded so far (identical frames count once)
+             */
+            [[nodiscard]] size_t frames_written() const { return frames_; }
+
+        private:
+            void write_u16(size_t value) {
+                out_.put(static_cast<char>(value & 0xFFu));
+                out_.put(static_cast<char>((value >> 8) & 0xFFu));
+            }
+
+            void start(unsigned loop_count) {
+                if (width_ == 0 || height_ == 0 || width_ > detail::gif_max_dimension ||
+                    height_ > detail::gif_max_dimension) {
+                    throw gif_error("invalid image size");
+                }
+                out_.write("GIF89a", 6);
+                write_u16(width_);
+                write_u16(height_);
+                // No global color table, 8-bit color resolution
+                const char screen[3] = {0x70, 0, 0};
+                out_.write(screen, 3);
+                if (loop_count != 1) {
+                    const unsigned repeats = loop_count == 0 ? 0 : std::min(loop_count - 1, 0xFFFFu);
+                    const char application[3] = {static_cast<char>(detail::gif_extension),
+                                                  static_cast<char>(detail::gif_application), 11};
+                    out_.write(application, 3);
+                    out_.write("NETSCAPE2.0", 11);
+                    const char loop[2] = {3, 1};
+                    out_.write(loop, 2);
+                    write_u16(repeats);
+                    out_.put(0);
+                }
+                base_ = packed_image(width_, height_, 4);
+                detail::clear_rect(base_, {0, 0, width_, height_});
+            }
+
+            // RGBA with binary alpha; transparent pixels are all zero
+            packed_image normalize(const packed_image& canvas) const {
+                packed_image frame(width_, height_, 4);
+                const auto channels = static_cast<size_t>(canvas.channels());
+                for (size_t y = 0; y < height_; ++y) {
+                    const std::uint8_t* in = canvas.row(y);
+                    std::uint8_t* out = frame.row(y);
+                    for (size_t x = 0; x < width_; ++x, in += channels, out += 4) {
+                        if (channels == 4 && in[3] < 128) {
+                            std::memset(out, 0, 4);
+                        } else {
+                            out[0] = in[0];
+                            out[1] = in[1];
+                            out[2] = in[2];
+                            out[3] = 255;
+                        }
+                    }
+                }
+                return frame;
+            }
+
+            // Bounding box of pixels opaque in before and transparent in after
+            frame_rect cleared_rect(const packed_image& before, const packed_image& after) const {
+                frame_rect rect;
+                for (size_t y = 0; y < height_; ++y) {
+                    const std::uint8_t* a = before.row(y);
+                    const std::uint8_t* b = after.row(y);
+                    for (size_t x = 0; x < width_; ++x) {
+                        if (a[x * 4 + 3] != 0 && b[x * 4 + 3] == 0) {
+                            rect = detail::merge_rects(rect, {x, y, 1, 1});
+                        }
+                    }
+                }
+                return rect;
+            }
+
+            void emit_pending(const packed_image* next) {
+                frame_rect rect = detail::changed_rect(base_, pending_);
+                if (rect.empty()) {
+                    rect = {0, 0, 1, 1};
+                }
+                unsigned disposal = 1;
+                if (next != nullptr) {
+                    const frame_rect cleared = cleared_rect(pending_, *next);
+                    if (!cleared.empty()) {
+                        rect = detail::merge_rects(rect, cleared);
+                        disposal = 2;
+                    }
+                }
+
+                // Colors of the opaque pixels in the rectangle
+                std::unordered_map <std::uint32_t, std::uint8_t> color_index;
+                std::vector <std::uint8_t> palette;
+                bool has_transparent = false;
+                for (size_t y = rect.y; y < rect.y + rect.height; ++y) {
+                    const std::uint8_t* p = pending_.row(y) + rect.x * 4;
+                    for (size_t x = 0; x < rect.width; ++x, p += 4) {
+                        if (p[3] == 0) {
+                            has_transparent = true;
+                            continue;
+                        }
+                        const std::uint32_t rgb = (static_cast<std::uint32_t>(p[0]) << 16) | (p[1] << 8) | p[2];
+                        if (color_index.count(rgb) == 0) {
+                            if (color_index.size() == 256) {
+                                throw gif_error("frame " + std::to_string(frames_ + 1) +
+                                                " has more than 256 colors; write APNG (.png) instead");
+                            }
+                            color_index.emplace(rgb, static_cast<std::uint8_t>(color_index.size()));
+                            palette.insert(palette.end(), {p[0], p[1], p[2]});
+                        }
+                    }
+                }
+                const size_t colors = color_index.size();
+                if (has_transparent && colors == 256) {
+                    throw gif_error("frame " + std::to_string(frames_ + 1) +
+                                    " has 256 colors and transparency; write APNG (.png) instead");
+                }
+                // Unchanged pixels become transparent whenever an index is free for it
+                const bool use_transparent = colors < 256;
+                const auto transparent_index = static_cast<std::uint8_t>(colors);
+
+                unsigned table_bits = 1;
+                while ((size_t{1} << table_bits) < colors + (use_transparent ? 1u : 0u)) {
+                    ++table_bits;
+                }
+                palette.resize(size_t{3} << table_bits, 0);
+
+                std::vector <std::uint8_t> indices(rect.width * rect.height);
+                size_t i = 0;
+                for (size_t y = rect.y; y < rect.y + rect.height; ++y) {
+                    const std::uint8_t* p = pending_.row(y) + rect.x * 4;
+                    const std::uint8_t* b = base_.row(y) + rect.x * 4;
+                    for (size_t x = 0; x < rect.width; ++x, p += 4, b += 4) {
+                        if (p[3] == 0 || (use_transparent && std::memcmp(p, b, 4) == 0)) {
+                            indices[i++] = transparent_index;
+                        } else {
+                            const std::uint32_t rgb = (static_cast<std::uint32_t>(p[0]) << 16) | (p[1] << 8) | p[2];
+                            indices[i++] = color_index[rgb];
+                        }
+                    }
+                }
+
+                const size_t delay_cs = std::min <size_t>((pending_delay_ + 5u) / 10u, 0xFFFFu);
+                const char control[4] = {static_cast<char>(detail::gif_extension),
+                                         static_cast<char>(detail::gif_graphic_control), 4,
+                                         static_cast<char>((disposal << 2) | (use_transparent ? 1u : 0u))};
+                out_.write(control, 4);
+                write_u16(delay_cs);
+                out_.put(static_cast<char>(use_transparent ? transparent_index : 0));
+                out_.put(0);
+
+                out_.put(static_cast<char>(detail::gif_image));
+                write_u16(rect.x);
+                write_u16(rect.y);
+                write_u16(rect.width);
+                write_u16(rect.height);
+                out_.put(static_cast<char>(0x80u | (table_bits - 1)));
+                out_.write(reinterpret_cast<const char*>(palette.data()), static_cast<std::streamsize>(palette.size()));
+
+                const int min_code_size = static_cast<int>(std::max(2u, table_bits));
+                std::vector <std::uint8_t> data;
+                detail::gif_lzw_encode(indices.data(), indices.size(), min_code_size, data);
+                out_.put(static_cast<char>(min_code_size));
+                for (size_t at = 0; at < data.size(); at += 255) {
+                    const size_t size = std::min <size_t>(255, data.size() - at);
+                    out_.put(static_cast<char>(size));
+                    out_.write(reinterpret_cast<const char*>(data.data() + at), static_cast<std::streamsize>(size));
+                }
+                out_.put(0);
+                if (!out_) {
+                    throw gif_error("write failed");
+                }
+
+                base_ = pending_;
+                if (disposal == 2) {
+                    detail::clear_rect(base_, rect);
+                }
+                ++frames_;
+            }
+
+            std::unique_ptr <std::ofstream> file_;
+            std::ostream& out_;
+            size_t width_;
+            size_t height_;
+
+            // Canvas on screen before the pending frame is drawn
+            packed_image base_{1, 1, 4};
+            packed_image pending_{1, 1, 4};
+            unsigned pending_delay_ = 0;
+            bool has_pending_ = false;
+            size_t frames_ = 0;
+            bool finished_ = false;
+    };
+
+} // namespace scaler::io
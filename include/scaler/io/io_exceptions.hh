@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+namespace scaler::io {
+
+    /**
+     * Base exception for all image I/O errors
+     */
+    class io_error : public std::runtime_error {
+    public:
+        explicit io_error(const std::string& what)
+            : std::runtime_error("I/O Error: " + what) {}
+    };
+
+    /**
+     * Exception for corrupt or truncated deflate/zlib streams
+     */
+    class zlib_error : public io_error {
+    public:
+        explicit zlib_error(const std::string& what)
+            : io_error("zlib: " + what) {}
+    };
+
+    /**
+     * Exception for malformed PNG files and unsupported PNG features
+     */
+    class png_error : public io_error {
+    public:
+        explicit png_error(const std::string& what)
+            : io_error("PNG: " + what) {}
+    };
+
+    /**
+     * Exception for malformed GIF files and frames GIF cannot represent
+     */
+    class gif_error : public io_error {
+    public:
+        explicit gif_error(const std::string& what)
+            : io_error("GIF: " + what) {}
+    };
+
+    /**
+     * Exception for malformed or truncated QOI files
+     */
+    class qoi_error : public io_error {
+    public:
+        explicit qoi_error(const std::string& what)
+            : io_error("QOI: " + what) {}
+    };
+
+    /**
+     * Exception for malformed or truncated raw image files
+     */
+    class raw_image_error : public io_error {
+    public:
+        explicit raw_image_error(const std::string& what)
+            : io_error("raw image: " + what) {}
+    };
+
+} // namespace scaler::io
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <scaler/image_base.hh>
+#include <scaler/vec3.hh>
+#include <scaler/io/io_exceptions.hh>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace scaler::io {
+
+    /**
+     * Interleaved 8-bit RGB or RGBA image in one contiguous buffer
+     *
+     * Scalers read and write the color channels; an alpha channel is kept
+     * as loaded (new images start opaque). Rows are laid out exactly as the
+     * row readers and writers of this directory expect, so whole files are
+     * loaded and saved with read_image()/write_image() without conversion.
+     */
+    class packed_image : public input_image_base <packed_image, vec3 <std::uint8_t>>,
+                         public output_image_base <packed_image, vec3 <std::uint8_t>> {
+        public:
+            using pixel_type = vec3 <std::uint8_t>;
+            using input_image_base <packed_image, pixel_type>::width;
+            using input_image_base <packed_image, pixel_type>::height;
+
+            /**
+             * @param channels 3 (RGB) or 4 (RGBA)
+             * @throws std::invalid_argument for another channel count
+             */
+            packed_image(size_t width, size_t height, int channels = 3)
+                : width_(width),
+                  height_(height),
+                  channels_(static_cast<size_t>(channels)) {
+                if (channels != 3 && channels != 4) {
+                    throw std::invalid_argument("packed_image: channels must be 3 or 4");
+                }
+                data_.assign(width * height * channels_, 0);
+                if (channels_ == 4) {
+                    for (size_t i = 3; i < data_.size(); i += 4) {
+                        data_[i] = 255;
+                    }
+                }
+            }
+
+            /**
+             * Constructor used by unified_scaler for outputs and intermediates
+             */
+            template<typename Source>
+            packed_image(size_t width, size_t height, const Source&)
+                : packed_image(width, height, 3) {
+            }
+
+            [[nodiscard]] size_t width_impl() const { return width_; }
+            [[nodiscard]] size_t height_impl() const { return height_; }
+
+            [[nodiscard]] pixel_type get_pixel_impl(size_t x, size_t y) const {
+                const std::uint8_t* p = &data_[(y * width_ + x) * channels_];
+                return {p[0], p[1], p[2]};
+            }
+
+            void set_pixel_impl(size_t x, size_t y, const pixel_type& pixel) {
+                std::uint8_t* p = &data_[(y * width_ + x) * channels_];
+                p[0] = pixel.x;
+                p[1] = pixel.y;
+                p[2] = pixel.z;
+            }
+
+            [[nodiscard]] int channels() const { return static_cast<int>(channels_); }
+
+            [[nodiscard]] size_t row_bytes() const { return width_ * channels_; }
+
+            [[nodiscard]] const std::uint8_t* row(size_t y) const { return &data_[y * row_bytes()]; }
+            [[nodiscard]] std::uint8_t* row(size_t y) { return &data_[y * row_bytes()]; }
+
+            [[nodiscard]] const std::uint8_t* data() const { return data_.data(); }
+            [[nodiscard]] std::uint8_t* data() { return data_.data(); }
+
+        private:
+            size_t width_;
+            size_t height_;
+            size_t channels_;
+            std::vector <std::uint8_t> data_;
+    };
+
+    /**
+     * Decode all rows of a row reader (png_row_reader, qoi_row_reader,
+     * raw_row_reader) straight into a packed_image
+     *
+     * The image has the reader's channels(), so alpha survives a round trip.
+     * @throws io_error if the reader runs out of rows early
+     */
+    template<typename RowReader>
+    packed_image read_image(RowReader& reader) {
+        packed_image image(reader.width(), reader.height(), reader.channels());
+        for (size_t y = 0; y < image.height(); ++y) {
+            if (!reader.read_row(image.row(y), image.channels())) {
+                throw io_error("image ended after " + std::to_string(y) + " of " +
+                               std::to_string(image.height()) + " rows");
+            }
+        }
+        return image;
+    }
+
+    /**
+     * Encode a packed_image with a row writer created for its size and
+     * channel count, then finish the file
+     */
+    template<typename RowWriter>
+    void write_image(RowWriter& writer, const packed_image& image) {
+        for (size_t y = 0; y < image.height(); ++y) {
+            writer.write_row(image.row(y));
+        }
+        writer.finish();
+    }
+
+} // namespace scaler::io
@@ -0,0 +1,329 @@
+#pragma once
+
+#include <scaler/io/io_exceptions.hh>
+#include <scaler/io/png_stream.hh>
+#include <scaler/io/zlib_codec.hh>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace scaler::io {
+
+    /**
+     * PNG encoder that filters and deflates blocks of rows on worker threads
+     *
+     * Rows are grouped into blocks of about block_bytes. Each block becomes
+     * an independent raw deflate stream that is primed with the last 32 KiB
+     * of the data before it and ends in a sync flush, so the streams simply
+     * concatenate into one valid zlib stream (the pigz scheme). Compression
+     * therefore stays close to a single-threaded encoder of the same level.
+     * The Adler-32 trailer and the IDAT chunk CRCs are joined from per-block
+     * checksums with adler32_combine()/crc32_combine(), so the writing thread
+     * never rescans data.
+     *
+     * Memory is bounded by the blocks in flight (two per thread), whatever
+     * the image size. The interface matches png_row_writer, so both can sit
+     * behind a row_sink.
+     *
+     * @code
+     * io::parallel_png_writer writer("out.png", width, height, 3, 6);
+     * io::scale_rows(reader, algorithm::HQ, 3, [&](const std::uint8_t* row) {
+     *     writer.write_row(row);
+     * });
+     * writer.finish();
+     * @endcode
+     */
+    class parallel_png_writer {
+        public:
+            /// Target uncompressed size of one block
+            static constexpr size_t default_block_bytes = 256 * 1024;
+            /// IDAT chunks are cut once they reach this size
+            static constexpr size_t idat_chunk_size = 1024 * 1024;
+
+            /**
+             * @param channels 1 gray, 2 gray+alpha, 3 RGB, 4 RGBA
+             * @param level zlib compression level 0-9
+             * @param threads Worker threads, 0 = hardware concurrency
+             * @throws png_error if the file cannot be created or the size is invalid
+             */
+            parallel_png_writer(const std::string& path, size_t width, size_t height, int channels = 3,
+                                int level = 6, unsigned threads = 0,
+                                size_t block_bytes = default_block_bytes)
+                : file_(std::make_unique <std::ofstream>(path, std::ios::binary | std::ios::trunc)),
+                  out_(*file_) {
+                if (!*file_) {
+                    throw png_error("cannot create " + path);
+                }
+                start(width, height, channels, level, threads, block_bytes);
+            }
+
+            parallel_png_writer(std::ostream& out, size_t width, size_t height, int channels = 3,
+                                int level = 6, unsigned threads = 0,
+                                size_t block_bytes = default_block_bytes)
+                : out_(out) {
+                start(width, height, channels, level, threads, block_bytes);
+            }
+
+            parallel_png_writer(const parallel_png_writer&) = delete;
+            parallel_png_writer& operator=(const parallel_png_writer&) = delete;
+
+            ~parallel_png_writer() {
+                {
+                    std::lock_guard <std::mutex> lock(mutex_);
+                    stopping_ = true;
+                }
+                work_ready_.notify_all();
+                for (auto& worker : workers_) {
+                    worker.join();
+                }
+            }
+
+            /**
+             * Append the next row (width * channels bytes)
+             * @throws png_error if all rows have already been written
+             */
+            void write_row(const std::uint8_t* row) {
+                if (row_ == height_) {
+                    throw png_error("too many rows");
+                }
+
+                block_rows_.insert(block_rows_.end(), row, row + row_bytes_);
+                ++row_;
+                if (row_ == height_ || block_rows_.size() == rows_per_block_ * row_bytes_) {
+                    submit_block();
+                }
+            }
+
+            /**
+             * Wait for all blocks and write the end of the file
+             * @throws png_error if fewer rows than the height were written
+             */
+            void finish() {
+                if (row_ != height_) {
+                    throw png_error("image incomplete: " + std::to_string(row_) + " of " +
+                                    std::to_string(height_) + " rows written");
+                }
+                if (finished_) {
+                    return;
+                }
+
+                collect(0);
+                std::vector <std::uint8_t> trailer(4);
+                detail::write_be32(trailer.data(), adler_);
+                add_piece(std::move(trailer));
+                flush_chunks(true);
+
+                detail::write_png_chunk(out_, "IEND", nullptr, 0);
+                out_.flush();
+                finished_ = true;
+            }
+
+            [[nodiscard]] size_t rows_written() const { return row_; }
+            [[nodiscard]] unsigned threads() const { return static_cast<unsigned>(workers_.size()); }
+
+        private:
+            struct block_result {
+                std::vector <std::uint8_t> compressed;
+                std::uint32_t crc = 0;           ///< CRC-32 of compressed
+                std::uint32_t adler = 1;         ///< Adler-32 of the filtered rows
+                std::uint64_t filtered_size = 0;
+            };
+
+            struct idat_piece {
+                std::vector <std::uint8_t> data;
+                std::uint32_t crc;
+            };
+
+            void start(size_t width, size_t height, int channels, int level, unsigned threads,
+                       size_t block_bytes) {
+                detail::write_png_header(out_, width, height, channels);
+                height_ = height;
+                channels_ = channels;
+                level_ = std::clamp(level, 0, 9);
+                row_bytes_ = width * static_cast<size_t>(channels);
+                rows_per_block_ = std::max <size_t>(1, block_bytes / (row_bytes_ + 1));
+                // Rows whose filtered bytes fill the 32 KiB match window
+                context_rows_ = level_ == 0 ? 0 : (detail::deflate_window + row_bytes_) / (row_bytes_ + 1);
+
+                const auto header = deflater::zlib_header(level_);
+                add_piece({header.begin(), header.end()});
+
+                if (threads == 0) {
+                    threads = std::max(1u, std::thread::hardware_concurrency());
+                }
+                max_in_flight_ = 2 * static_cast<size_t>(threads);
+                for (unsigned i = 0; i < threads; ++i) {
+                    workers_.emplace_back([this] { worker_loop(); });
+                }
+            }
+
+            void worker_loop() {
+                while (true) {
+                    std::packaged_task <block_result()> task;
+                    {
+                        std::unique_lock <std::mutex> lock(mutex_);
+                        work_ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                        if (queue_.empty()) {
+                            return;
+                        }
+                        task = std::move(queue_.front());
+                        queue_.pop_front();
+                    }
+                    task();
+                }
+            }
+
+            void submit_block() {
+                // The job gets the row above the block for filtering and the
+                // rows before it that make up its deflate dictionary
+                const size_t block_count = block_rows_.size() / row_bytes_;
+                const size_t history_count = history_.size() / row_bytes_;
+                const size_t context = std::min(context_rows_, history_count > 0 ? history_count - 1 : 0);
+
+                std::vector <std::uint8_t> rows;
+                rows.reserve((context + 1 + block_count) * row_bytes_);
+                if (history_count > 0) {
+                    rows.insert(rows.end(), history_.end() - static_cast<std::ptrdiff_t>((context + 1) * row_bytes_),
+                                history_.end());
+                } else {
+                    rows.resize(row_bytes_, 0);
+                }
+                rows.insert(rows.end(), block_rows_.begin(), block_rows_.end());
+
+                // Keep the tail for the next block
+                history_.insert(history_.end(), block_rows_.begin(), block_rows_.end());
+                const size_t keep = std::min(history_.size(), (context_rows_ + 1) * row_bytes_);
+                history_.erase(history_.begin(), history_.end() - static_cast<std::ptrdiff_t>(keep));
+                block_rows_.clear();
+
+                const bool last = row_ == height_;
+                std::packaged_task <block_result()> task(
+                    [rows = std::move(rows), context, last, row_bytes = row_bytes_,
+                     bpp = static_cast<size_t>(channels_), level = level_]() {
+                        return compress_block(rows, context, row_bytes, bpp, level, last);
+                    });
+                in_flight_.push_back(task.get_future());
+                {
+                    std::lock_guard <std::mutex> lock(mutex_);
+                    queue_.push_back(std::move(task));
+                }
+                work_ready_.notify_one();
+
+                collect(max_in_flight_);
+            }
+
+            // rows = prior row, context rows, block rows
+            static block_result compress_block(const std::vector <std::uint8_t>& rows, size_t context,
+                                               size_t row_bytes, size_t bpp, int level, bool last) {
+                const size_t row_count = rows.size() / row_bytes - 1;
+                std::vector <std::uint8_t> filtered(row_count * (row_bytes + 1));
+                std::vector <std::uint8_t> scratch;
+                for (size_t i = 0; i < row_count; ++i) {
+                    detail::png_filter_row(rows.data() + (i + 1) * row_bytes, rows.data() + i * row_bytes,
+                                           row_bytes, bpp, level > 0, scratch,
+                                           filtered.data() + i * (row_bytes + 1));
+                }
+
+                const size_t context_bytes = context * (row_bytes + 1);
+                const std::uint8_t* data = filtered.data() + context_bytes;
+                const size_t size = filtered.size() - context_bytes;
+
+                block_result result;
+                deflater deflate(level, deflate_format::raw);
+                deflate.set_dictionary(filtered.data(), context_bytes);
+                deflate.write(data, size, result.compressed, last ? deflate_flush::finish : deflate_flush::sync);
+                result.crc = crc32(result.compressed.data(), result.compressed.size());
+                result.adler = adler32(data, size);
+                result.filtered_size = size;
+                return result;
+            }
+
+            // Write finished blocks in order until at most keep are in flight
+            void collect(size_t keep) {
+                while (!in_flight_.empty()) {
+                    auto& front = in_flight_.front();
+                    const bool ready = front.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+                    if (!ready && in_flight_.size() <= keep) {
+                        break;
+                    }
+                    block_result result = front.get();
+                    in_flight_.pop_front();
+
+                    adler_ = adler32_combine(adler_, result.adler, result.filtered_size);
+                    pieces_.push_back({std::move(result.compressed), result.crc});
+                    pending_bytes_ += pieces_.back().data.size();
+                    flush_chunks(false);
+                }
+            }
+
+            void add_piece(std::vector <std::uint8_t> data) {
+                const std::uint32_t crc = crc32(data.data(), data.size());
+                pending_bytes_ += data.size();
+                pieces_.push_back({std::move(data), crc});
+            }
+
+            void flush_chunks(bool all) {
+                if (pending_bytes_ == 0 || (!all && pending_bytes_ < idat_chunk_size)) {
+                    return;
+                }
+
+                std::uint8_t header[8];
+                detail::write_be32(header, static_cast<std::uint32_t>(pending_bytes_));
+                std::memcpy(header + 4, "IDAT", 4);
+                std::uint32_t crc = crc32(header + 4, 4);
+                out_.write(reinterpret_cast<const char*>(header), 8);
+                for (const auto& piece : pieces_) {
+                    out_.write(reinterpret_cast<const char*>(piece.data.data()),
+                               static_cast<std::streamsize>(piece.data.size()));
+                    crc = crc32_combine(crc, piece.crc, piece.data.size());
+                }
+                std::uint8_t trailer[4];
+                detail::write_be32(trailer, crc);
+                out_.write(reinterpret_cast<const char*>(trailer), 4);
+                if (!out_) {
+                    throw png_error("write failed");
+                }
+
+                pieces_.clear();
+                pending_bytes_ = 0;
+            }
+
+            std::unique_ptr <std::ofstream> file_;
+            std::ostream& out_;
+            size_t height_ = 0;
+            int channels_ = 3;
+            int level_ = 6;
+            size_t row_bytes_ = 0;
+            size_t rows_per_block_ = 1;
+            size_t context_rows_ = 0;
+
+            size_t row_ = 0;
+            bool finished_ = false;
+            std::vector <std::uint8_t> block_rows_;
+            std::vector <std::uint8_t> history_;
+
+            std::uint32_t adler_ = 1;
+            std::vector <idat_piece> pieces_;
+            size_t pending_bytes_ = 0;
+
+            std::mutex mutex_;
+            std::condition_variable work_ready_;
+            std::deque <std::packaged_task <block_result()>> queue_;
+            bool stopping_ = false;
+            std::vector <std::thread> workers_;
+            std::deque <std::future <block_result>> in_flight_;
+            size_t max_in_flight_ = 2;
+    };
+
+} // namespace scaler::io
@@ -0,0 +1,671 @@
+#pragma once
+
+#include <scaler/io/io_exceptions.hh>
+#include <scaler/io/zlib_codec.hh>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace scaler::io {
+
+    /**
+     * PNG color types (IHDR)
+     */
+    enum class png_color_type : std::uint8_t {
+        gray = 0,
+        rgb = 2,
+        palette = 3,
+        gray_alpha = 4,
+        rgba = 6
+    };
+
+    namespace detail {
+
+        constexpr std::uint8_t png_signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+        inline std::uint32_t read_be32(const std::uint8_t* p) {
+            return (static_cast<std::uint32_t>(p[0]) << 24) | (static_cast<std::uint32_t>(p[1]) << 16) |
+                   (static_cast<std::uint32_t>(p[2]) << 8) | p[3];
+        }
+
+        inline void write_be32(std::uint8_t* p, std::uint32_t value) {
+            p[0] = static_cast<std::uint8_t>(value >> 24);
+            p[1] = static_cast<std::uint8_t>(value >> 16);
+            p[2] = static_cast<std::uint8_t>(value >> 8);
+            p[3] = static_cast<std::uint8_t>(value);
+        }
+
+        inline int png_channel_count(png_color_type type) {
+            switch (type) {
+                case png_color_type::gray: return 1;
+                case png_color_type::gray_alpha: return 2;
+                case png_color_type::rgb: return 3;
+                case png_color_type::rgba: return 4;
+                case png_color_type::palette: return 1;
+            }
+            return 0;
+        }
+
+        inline std::uint8_t paeth(std::uint8_t a, std::uint8_t b, std::uint8_t c) {
+            const int p = a + b - c;
+            const int pa = std::abs(p - a);
+            const int pb = std::abs(p - b);
+            const int pc = std::abs(p - c);
+            if (pa <= pb && pa <= pc) {
+                return a;
+            }
+            return pb <= pc ? b : c;
+        }
+
+        /**
+         * Undo the filter of one scanline in place
+         * @param bpp Bytes per complete pixel, at least 1
+         */
+        inline void png_unfilter(std::uint8_t filter, std::uint8_t* row, const std::uint8_t* prior,
+                                 size_t size, size_t bpp) {
+            switch (filter) {
+                case 0:
+                    break;
+                case 1:
+                    for (size_t i = bpp; i < size; ++i) {
+                        row[i] = static_cast<std::uint8_t>(row[i] + row[i - bpp]);
+                    }
+                    break;
+                case 2:
+                    for (size_t i = 0; i < size; ++i) {
+                        row[i] = static_cast<std::uint8_t>(row[i] + prior[i]);
+                    }
+                    break;
+                case 3:
+                    for (size_t i = 0; i < size; ++i) {
+                        const unsigned left = i >= bpp ? row[i - bpp] : 0u;
+                        row[i] = static_cast<std::uint8_t>(row[i] + ((left + prior[i]) >> 1));
+                    }
+                    break;
+                case 4:
+                    for (size_t i = 0; i < size; ++i) {
+                        const std::uint8_t left = i >= bpp ? row[i - bpp] : 0;
+                        const std::uint8_t upper_left = i >= bpp ? prior[i - bpp] : 0;
+                        row[i] = static_cast<std::uint8_t>(row[i] + paeth(left, prior[i], upper_left));
+                    }
+                    break;
+                default:
+                    throw png_error("invalid filter type " + std::to_string(filter));
+            }
+        }
+
+        /**
+         * Apply filter to row into out
+         */
+        inline void png_filter(std::uint8_t filter, const std::uint8_t* row, const std::uint8_t* prior,
+                               size_t size, size_t bpp, std::uint8_t* out) {
+            for (size_t i = 0; i < size; ++i) {
+                const std::uint8_t left = i >= bpp ? row[i - bpp] : 0;
+                const std::uint8_t upper_left = i >= bpp ? prior[i - bpp] : 0;
+                std::uint8_t predicted = 0;
+                switch (filter) {
+                    case 1: predicted = left; break;
+                    case 2: predicted = prior[i]; break;
+                    case 3: predicted = static_cast<std::uint8_t>((left + prior[i]) >> 1); break;
+                    case 4: predicted = paeth(left, prior[i], upper_left); break;
+                    default: break;
+                }
+                out[i] = static_cast<std::uint8_t>(row[i] - predicted);
+            }
+        }
+
+        /**
+         * Filter a row with the filter that minimizes the sum of absolute
+         * residuals (the libpng heuristic); writes filter byte + data to out
+         * @param adaptive false always uses filter 0 (for level 0)
+         */
+        inline void png_filter_row(const std::uint8_t* row, const std::uint8_t* prior, size_t size,
+                                   size_t bpp, bool adaptive, std::vector <std::uint8_t>& scratch,
+                                   std::uint8_t* out) {
+            out[0] = 0;
+            if (!adaptive) {
+                std::memcpy(out + 1, row, size);
+                return;
+            }
+
+            scratch.resize(size);
+            std::uint64_t best_cost = UINT64_MAX;
+            for (std::uint8_t filter = 0; filter < 5; ++filter) {
+                png_filter(filter, row, prior, size, bpp, scratch.data());
+                std::uint64_t cost = 0;
+                for (size_t i = 0; i < size; ++i) {
+                    cost += scratch[i] < 128 ? scratch[i] : 256u - scratch[i];
+                }
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    out[0] = filter;
+                    std::memcpy(out + 1, scratch.data(), size);
+                }
+            }
+        }
+
+        inline void write_png_chunk(std::ostream& out, const char* type, const std::uint8_t* data, size_t size) {
+            if (size > 0x7FFFFFFFu) {
+                throw png_error("chunk too large");
+            }
+            std::uint8_t header[8];
+            write_be32(header, static_cast<std::uint32_t>(size));
+            std::memcpy(header + 4, type, 4);
+            std::uint32_t crc = crc32(header + 4, 4);
+            crc = crc32(data, size, crc);
+            std::uint8_t trailer[4];
+            write_be32(trailer, crc);
+
+            out.write(reinterpret_cast<const char*>(header), 8);
+            out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+            out.write(reinterpret_cast<const char*>(trailer), 4);
+            if (!out) {
+                throw png_error("write failed");
+            }
+        }
+
+        inline void write_png_header(std::ostream& out, size_t width, size_t height, int channels) {
+            if (width == 0 || height == 0 || width > 0x7FFFFFFFu || height > 0x7FFFFFFFu) {
+                throw png_error("invalid image size");
+            }
+            if (channels < 1 || channels > 4) {
+                throw png_error("channels must be 1-4");
+            }
+            static constexpr std::uint8_t color_types[5] = {0, 0, 4, 2, 6};
+
+            out.write(reinterpret_cast<const char*>(png_signature), 8);
+            std::uint8_t ihdr[13] = {};
+            write_be32(ihdr, static_cast<std::uint32_t>(width));
+            write_be32(ihdr + 4, static_cast<std::uint32_t>(height));
+            ihdr[8] = 8;
+            ihdr[9] = color_types[channels];
+            write_png_chunk(out, "IHDR", ihdr, sizeof(ihdr));
+        }
+
+    } // namespace detail
+
+    /**
+     * PNG decoder that delivers one row at a time
+     *
+     * Only the current and previous scanline are held; compressed data is
+     * read from the stream as rows are requested. All bit depths and color
+     * types are supported and converted to 8-bit RGB or RGBA (16-bit
+     * samples keep their high byte, palette and tRNS are resolved).
+     * Interlaced (Adam7) files cannot be streamed and are rejected.
+     *
+     * @code
+     * io::png_row_reader reader("big.png");
+     * std::vector<std::uint8_t> row(reader.width() * 3);
+     * while (reader.read_row(row.data())) { ... }
+     * @endcode
+     */
+    class png_row_reader {
+        public:
+            /**
+             * @throws png_error if the file cannot be opened or its header is invalid
+             */
+            explicit png_row_reader(const std::string& path)
+                : file_(std::make_unique <std::ifstream>(path, std::ios::binary)),
+                  in_(*file_) {
+                if (!*file_) {
+                    throw png_error("cannot open " + path);
+                }
+                read_header();
+            }
+
+            /**
+             * Read from a stream positioned at the PNG signature
+             */
+            explicit png_row_reader(std::istream& in)
+                : in_(in) {
+                read_header();
+            }
+
+            png_row_reader(const png_row_reader&) = delete;
+            png_row_reader& operator=(const png_row_reader&) = delete;
+
+            [[nodiscard]] size_t width() const { return width_; }
+            [[nodiscard]] size_t height() const { return height_; }
+            [[nodiscard]] int bit_depth() const { return bit_depth_; }
+            [[nodiscard]] png_color_type color_type() const { return color_type_; }
+
+            /**
+             * Channels of the decoded data: 4 if the file has any alpha, else 3
+             */
+            [[nodiscard]] int channels() const {
+                const bool alpha = color_type_ == png_color_type::gray_alpha ||
+                                   color_type_ == png_color_type::rgba || has_transparency_;
+                return alpha ? 4 : 3;
+            }
+
+            /**
+             * Rows delivered so far
+             */
+            [[nodiscard]] size_t rows_read() const { return row_; }
+
+            /**
+             * Decode the next row into out as 8-bit RGB (channels = 3) or RGBA (4)
+             * @return false once all rows have been read
+             * @throws png_error / zlib_error on corrupt or truncated data
+             */
+            bool read_row(std::uint8_t* out, int channels = 3) {
+                if (row_ == height_) {
+                    return false;
+                }
+
+                std::swap(current_, prior_);
+                std::uint8_t filter = 0;
+                if (inflater_->read(&filter, 1) != 1 ||
+                    inflater_->read(current_.data(), current_.size()) != current_.size()) {
+                    throw png_error("image data ends early");
+                }
+                detail::png_unfilter(filter, current_.data(), prior_.data(), current_.size(), filter_bpp_);
+                convert_row(out, channels == 4);
+
+                if (++row_ == height_) {
+                    inflater_->finish();
+                }
+                return true;
+            }
+
+        private:
+            void read_exact(std::uint8_t* data, size_t size) {
+                in_.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(size));
+                if (static_cast<size_t>(in_.gcount()) != size) {
+                    throw png_error("unexpected end of file");
+                }
+            }
+
+            // Reads a chunk header; returns its length and fills type
+            std::uint32_t next_chunk(char* type) {
+                std::uint8_t header[8];
+                read_exact(header, 8);
+                std::memcpy(type, header + 4, 4);
+                chunk_crc_ = crc32(header + 4, 4);
+                const std::uint32_t length = detail::read_be32(header);
+                if (length > 0x7FFFFFFFu) {
+                    throw png_error("invalid chunk length");
+                }
+                return length;
+            }
+
+            void check_crc() {
+                std::uint8_t stored[4];
+                read_exact(stored, 4);
+                if (detail::read_be32(stored) != chunk_crc_) {
+                    throw png_error("chunk CRC mismatch");
+                }
+            }
+
+            // Callers bound length first: a corrupt or hostile header may claim up to 2 GiB
+            void read_chunk_data(std::vector <std::uint8_t>& data, std::uint32_t length) {
+                data.resize(length);
+                read_exact(data.data(), length);
+                chunk_crc_ = crc32(data.data(), length, chunk_crc_);
+                check_crc();
+            }
+
+            // Reads past a chunk's data in bounded pieces, so its length costs no memory
+            void skip_chunk_data(std::uint32_t length) {
+                std::uint8_t buffer[4096];
+                while (length > 0) {
+                    const std::uint32_t count = std::min <std::uint32_t>(length, sizeof(buffer));
+                    read_exact(buffer, count);
+                    chunk_crc_ = crc32(buffer, count, chunk_crc_);
+                    length -= count;
+                }
+                check_crc();
+            }
+
+            void read_header() {
+                std::uint8_t signature[8];
+                read_exact(signature, 8);
+                if (!std::equal(signature, signature + 8, detail::png_signature)) {
+                    throw png_error("not a PNG file");
+                }
+
+                char type[4];
+                std::vector <std::uint8_t> data;
+                std::uint32_t length = next_chunk(type);
+                if (std::memcmp(type, "IHDR", 4) != 0 || length != 13) {
+                    throw png_error("missing IHDR");
+                }
+                read_chunk_data(data, length);
+                width_ = detail::read_be32(data.data());
+                height_ = detail::read_be32(data.data() + 4);
+                bit_depth_ = data[8];
+                color_type_ = static_cast<png_color_type>(data[9]);
+                if (width_ == 0 || height_ == 0 || data[10] != 0 || data[11] != 0) {
+                    throw png_error("invalid IHDR");
+                }
+                if (data[12] != 0) {
+                    throw png_error("interlaced images cannot be streamed");
+                }
+                validate_format();
+
+                // Everything up to the first IDAT
+                while (true) {
+                    length = next_chunk(type);
+                    if (std::memcmp(type, "IDAT", 4) == 0) {
+                        break;
+                    }
+                    if (std::memcmp(type, "IEND", 4) == 0) {
+                        throw png_error("no image data");
+                    }
+                    if (std::memcmp(type, "PLTE", 4) == 0) {
+                        if (length % 3 != 0 || length > 768) {
+                            throw png_error("invalid palette");
+                        }
+                        read_chunk_data(data, length);
+                        palette_.assign(256, {0, 0, 0, 255});
+                        for (size_t i = 0; i < length / 3; ++i) {
+                            palette_[i] = {data[3 * i], data[3 * i + 1], data[3 * i + 2], 255};
+                        }
+                    } else if (std::memcmp(type, "tRNS", 4) == 0) {
+                        if (length > 256) {
+                            throw png_error("invalid tRNS");
+                        }
+                        read_chunk_data(data, length);
+                        read_transparency(data);
+                    } else if (!(type[0] & 0x20)) {
+                        throw png_error("unsupported critical chunk " + std::string(type, 4));
+                    } else {
+                        skip_chunk_data(length);
+                    }
+                }
+                if (color_type_ == png_color_type::palette && palette_.empty()) {
+                    throw png_error("missing palette");
+                }
+
+                idat_remaining_ = length;
+                const size_t bits_per_pixel = static_cast<size_t>(detail::png_channel_count(color_type_) * bit_depth_);
+                filter_bpp_ = std::max <size_t>(1, bits_per_pixel / 8);
+                current_.assign((width_ * bits_per_pixel + 7) / 8, 0);
+                prior_.assign(current_.size(), 0);
+                inflater_ = std::make_unique <inflater>([this](std::uint8_t* buffer, size_t capacity) {
+                    return read_image_data(buffer, capacity);
+                });
+            }
+
+            void validate_format() {
+                const int depth = bit_depth_;
+                bool valid = false;
+                switch (color_type_) {
+                    case png_color_type::gray:
+                        valid = depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16;
+                        break;
+                    case png_color_type::palette:
+                        valid = depth == 1 || depth == 2 || depth == 4 || depth == 8;
+                        break;
+                    case png_color_type::rgb:
+                    case png_color_type::gray_alpha:
+                    case png_color_type::rgba:
+                        valid = depth == 8 || depth == 16;
+                        break;
+                }
+                if (!valid) {
+                    throw png_error("invalid color type / bit depth combination");
+                }
+            }
+
+            void read_transparency(const std::vector <std::uint8_t>& data) {
+                if (color_type_ == png_color_type::palette) {
+                    if (palette_.empty() || data.size() > 256) {
+                        throw png_error("invalid tRNS");
+                    }
+                    for (size_t i = 0; i < data.size(); ++i) {
+                        palette_[i][3] = data[i];
+                    }
+                    has_transparency_ = true;
+                } else if (color_type_ == png_color_type::gray && data.size() == 2) {
+                    key_[0] = key_[1] = key_[2] = static_cast<std::uint16_t>((data[0] << 8) | data[1]);
+                    has_transparency_ = true;
+                } else if (color_type_ == png_color_type::rgb && data.size() == 6) {
+                    for (size_t i = 0; i < 3; ++i) {
+                        key_[i] = static_cast<std::uint16_t>((data[2 * i] << 8) | data[2 * i + 1]);
+                    }
+                    has_transparency_ = true;
+                }
+            }
+
+            // Inflater source: the payload of consecutive IDAT chunks
+            size_t read_image_data(std::uint8_t* buffer, size_t capacity) {
+                while (idat_remaining_ == 0) {
+                    if (idat_done_) {
+                        return 0;
+                    }
+                    check_crc();
+                    char type[4];
+                    const std::uint32_t length = next_chunk(type);
+                    if (std::memcmp(type, "IDAT", 4) != 0) {
+                        // Trailing chunks are never needed for decoding
+                        idat_done_ = true;
+                        return 0;
+                    }
+                    idat_remaining_ = length;
+                }
+
+                const size_t count = std::min <size_t>(capacity, idat_remaining_);
+                read_exact(buffer, count);
+                chunk_crc_ = crc32(buffer, count, chunk_crc_);
+                idat_remaining_ -= static_cast<std::uint32_t>(count);
+                return count;
+            }
+
+            // Sample x of the current row at the file's bit depth
+            [[nodiscard]] unsigned sample(size_t index) const {
+                switch (bit_depth_) {
+                    case 16:
+                        return static_cast<unsigned>((current_[2 * index] << 8) | current_[2 * index + 1]);
+                    case 8:
+                        return current_[index];
+                    default: {
+                        const auto depth = static_cast<size_t>(bit_depth_);
+                        const size_t bit = index * depth;
+                        const unsigned shift = static_cast<unsigned>(8 - depth - bit % 8);
+                        return (current_[bit / 8] >> shift) & ((1u << depth) - 1u);
+                    }
+                }
+            }
+
+            [[nodiscard]] std::uint8_t to_8bit(unsigned value) const {
+                switch (bit_depth_) {
+                    case 16: return static_cast<std::uint8_t>(value >> 8);
+                    case 8: return static_cast<std::uint8_t>(value);
+                    default: return static_cast<std::uint8_t>(value * 255u / ((1u << bit_depth_) - 1u));
+                }
+            }
+
+            void convert_row(std::uint8_t* out, bool alpha) {
+                const size_t stride = alpha ? 4 : 3;
+                for (size_t x = 0; x < width_; ++x, out += stride) {
+                    std::uint8_t a = 255;
+                    switch (color_type_) {
+                        case png_color_type::gray: {
+                            const unsigned v = sample(x);
+                            out[0] = out[1] = out[2] = to_8bit(v);
+                            if (has_transparency_ && v == key_[0]) {
+                                a = 0;
+                            }
+                            break;
+                        }
+                        case png_color_type::gray_alpha:
+                            out[0] = out[1] = out[2] = to_8bit(sample(2 * x));
+                            a = to_8bit(sample(2 * x + 1));
+                            break;
+                        case png_color_type::rgb: {
+                            const unsigned r = sample(3 * x);
+                            const unsigned g = sample(3 * x + 1);
+                            const unsigned b = sample(3 * x + 2);
+                            out[0] = to_8bit(r);
+                            out[1] = to_8bit(g);
+                            out[2] = to_8bit(b);
+                            if (has_transparency_ && r == key_[0] && g == key_[1] && b == key_[2]) {
+                                a = 0;
+                            }
+                            break;
+                        }
+                        case png_color_type::rgba:
+                            out[0] = to_8bit(sample(4 * x));
+                            out[1] = to_8bit(sample(4 * x + 1));
+                            out[2] = to_8bit(sample(4 * x + 2));
+                            a = to_8bit(sample(4 * x + 3));
+                            break;
+                        case png_color_type::palette: {
+                            const auto& entry = palette_[sample(x)];
+                            out[0] = entry[0];
+                            out[1] = entry[1];
+                            out[2] = entry[2];
+                            a = entry[3];
+                            break;
+                        }
+                    }
+                    if (alpha) {
+                        out[3] = a;
+                    }
+                }
+            }
+
+            std::unique_ptr <std::ifstream> file_;
+            std::istream& in_;
+
+            size_t width_ = 0;
+            size_t height_ = 0;
+            int bit_depth_ = 8;
+            png_color_type color_type_ = png_color_type::rgb;
+            std::vector <std::array <std::uint8_t, 4>> palette_;
+            bool has_transparency_ = false;
+            std::uint16_t key_[3] = {};
+
+            std::uint32_t chunk_crc_ = 0;
+            std::uint32_t idat_remaining_ = 0;
+            bool idat_done_ = false;
+            std::unique_ptr <inflater> inflater_;
+
+            size_t filter_bpp_ = 1;
+            size_t row_ = 0;
+            std::vector <std::uint8_t> current_;
+            std::vector <std::uint8_t> prior_;
+    };
+
+    /**
+     * PNG encoder that accepts one row at a time
+     *
+     * Writes 8-bit gray, gray+alpha, RGB or RGBA. Each row is filtered
+     * (adaptively, except at level 0) and deflated as it arrives, and image
+     * data is flushed in IDAT chunks of bounded size, so memory use does not
+     * depend on the image height.
+     */
+    class png_row_writer {
+        public:
+            /// Compressed bytes buffered before an IDAT chunk is written
+            static constexpr size_t idat_chunk_size = 256 * 1024;
+
+            /**
+             * @param channels 1 gray, 2 gray+alpha, 3 RGB, 4 RGBA
+             * @param level zlib compression level 0-9
+             * @throws png_error if the file cannot be created or the size is invalid
+             */
+            png_row_writer(const std::string& path, size_t width, size_t height, int channels = 3, int level = 6)
+                : file_(std::make_unique <std::ofstream>(path, std::ios::binary | std::ios::trunc)),
+                  out_(*file_),
+                  width_(width),
+                  height_(height),
+                  channels_(channels),
+                  deflater_(level) {
+                if (!*file_) {
+                    throw png_error("cannot create " + path);
+                }
+                start();
+            }
+
+            png_row_writer(std::ostream& out, size_t width, size_t height, int channels = 3, int level = 6)
+                : out_(out),
+                  width_(width),
+                  height_(height),
+                  channels_(channels),
+                  deflater_(level) {
+                start();
+            }
+
+            png_row_writer(const png_row_writer&) = delete;
+            png_row_writer& operator=(const png_row_writer&) = delete;
+
+            /**
+             * Append the next row (width * channels bytes)
+             * @throws png_error if all rows have already been written
+             */
+            void write_row(const std::uint8_t* row) {
+                if (row_ == height_) {
+                    throw png_error("too many rows");
+                }
+
+                const size_t size = width_ * static_cast<size_t>(channels_);
+                detail::png_filter_row(row, prior_.data(), size, static_cast<size_t>(channels_),
+                                       deflater_.level() > 0, scratch_, filtered_.data());
+                std::memcpy(prior_.data(), row, size);
+
+                const bool last = ++row_ == height_;
+                deflater_.write(filtered_.data(), filtered_.size(), compressed_,
+                                last ? deflate_flush::finish : deflate_flush::none);
+                flush_chunks(last);
+            }
+
+            /**
+             * Write the end of the file
+             * @throws png_error if fewer rows than the height were written
+             */
+            void finish() {
+                if (row_ != height_) {
+                    throw png_error("image incomplete: " + std::to_string(row_) + " of " +
+                                    std::to_string(height_) + " rows written");
+                }
+                if (!finished_) {
+                    detail::write_png_chunk(out_, "IEND", nullptr, 0);
+                    out_.flush();
+                    finished_ = true;
+                }
+            }
+
+            [[nodiscard]] size_t rows_written() const { return row_; }
+
+        private:
+            void start() {
+                detail::write_png_header(out_, width_, height_, channels_);
+                const size_t size = width_ * static_cast<size_t>(channels_);
+                prior_.assign(size, 0);
+                filtered_.assign(size + 1, 0);
+            }
+
+            void flush_chunks(bool all) {
+                while (compressed_.size() >= idat_chunk_size || (all && !compressed_.empty())) {
+                    const size_t size = std::min(compressed_.size(), idat_chunk_size);
+                    detail::write_png_chunk(out_, "IDAT", compressed_.data(), size);
+                    compressed_.erase(compressed_.begin(), compressed_.begin() + static_cast<std::ptrdiff_t>(size));
+                }
+            }
+
+            std::unique_ptr <std::ofstream> file_;
+            std::ostream& out_;
+            size_t width_;
+            size_t height_;
+            int channels_;
+            deflater deflater_;
+
+            size_t row_ = 0;
+            bool finished_ = false;
+            std::vector <std::uint8_t> prior_;
+            std::vector <std::uint8_t> filtered_;
+            std::vector <std::uint8_t> scratch_;
+            std::vector <std::uint8_t> compressed_;
+    };
+
+} // namespace scaler::io
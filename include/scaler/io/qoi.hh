@@ -0,0 +1,477 @@
+#pragma once
+
+#include <scaler/io/io_exceptions.hh>
+#include <scaler/io/packed_image.hh>
+#include <scaler/io/png_stream.hh>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace scaler::io {
+
+    namespace detail {
+
+        inline constexpr std::uint8_t qoi_magic[4] = {'q', 'o', 'i', 'f'};
+        inline constexpr std::uint8_t qoi_end_marker[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+        inline constexpr size_t qoi_header_size = 14;
+        /// Largest image the reference implementation accepts
+        inline constexpr std::uint64_t qoi_pixels_max = 400000000;
+
+        inline constexpr std::uint8_t qoi_op_index = 0x00;
+        inline constexpr std::uint8_t qoi_op_diff = 0x40;
+        inline constexpr std::uint8_t qoi_op_luma = 0x80;
+        inline constexpr std::uint8_t qoi_op_run = 0xc0;
+        inline constexpr std::uint8_t qoi_op_rgb = 0xfe;
+        inline constexpr std::uint8_t qoi_op_rgba = 0xff;
+        inline constexpr std::uint8_t qoi_mask = 0xc0;
+
+        // Aggregate without member initializers: the color table starts all zero
+        struct qoi_pixel {
+            std::uint8_t r;
+            std::uint8_t g;
+            std::uint8_t b;
+            std::uint8_t a;
+
+            [[nodiscard]] bool operator==(const qoi_pixel& other) const {
+                return r == other.r && g == other.g && b == other.b && a == other.a;
+            }
+            [[nodiscard]] bool operator!=(const qoi_pixel& other) const { return !(*this == other); }
+        };
+
+        inline unsigned qoi_hash(const qoi_pixel& p) {
+            return (p.r * 3u + p.g * 5u + p.b * 7u + p.a * 11u) & 63u;
+        }
+
+        inline void check_qoi_size(size_t width, size_t height) {
+            if (width == 0 || height == 0 || width > 0xFFFFFFFFu || height > 0xFFFFFFFFu ||
+                static_cast<std::uint64_t>(width) * height > qoi_pixels_max) {
+                throw qoi_error("invalid image size");
+            }
+        }
+
+    } // namespace detail
+
+    /**
+     * QOI ("Quite OK Image") decoder that delivers one row at a time
+     *
+     * QOI is lossless like PNG but needs no entropy coder: every pixel is a
+     * run, a lookup in a 64-entry table of recent colors, a small delta or a
+     * literal. Decoding is a single branchy pass over a buffered byte stream
+     * and typically runs several times faster than inflate, which makes it
+     * the format of choice for intermediate files between pipeline stages.
+     * Only the decoder state (previous pixel, color table, pending run) is
+     * carried between rows, so it feeds scale_rows() like png_row_reader.
+     *
+     * @code
+     * io::qoi_row_reader reader("frame.qoi");
+     * std::vector<std::uint8_t> row(reader.width() * 3);
+     * while (reader.read_row(row.data())) { ... }
+     * @endcode
+     */
+    class qoi_row_reader {
+        public:
+            /// Bytes read from the stream at a time
+            static constexpr size_t buffer_size = 64 * 1024;
+
+            /**
+             * @throws qoi_error if the file cannot be opened or its header is invalid
+             */
+            explicit qoi_row_reader(const std::string& path)
+                : file_(std::make_unique <std::ifstream>(path, std::ios::binary)),
+                  in_(*file_) {
+                if (!*file_) {
+                    throw qoi_error("cannot open " + path);
+                }
+                read_header();
+            }
+
+            /**
+             * Read from a stream positioned at the QOI magic
+             */
+            explicit qoi_row_reader(std::istream& in)
+                : in_(in) {
+                read_header();
+            }
+
+            qoi_row_reader(const qoi_row_reader&) = delete;
+            qoi_row_reader& operator=(const qoi_row_reader&) = delete;
+
+            [[nodiscard]] size_t width() const { return width_; }
+            [[nodiscard]] size_t height() const { return height_; }
+
+            /**
+             * Channels recorded in the header: 3 (RGB) or 4 (RGBA)
+             */
+            [[nodiscard]] int channels() const { return channels_; }
+
+            /**
+             * Colorspace recorded in the header: 0 sRGB with linear alpha, 1 all linear
+             */
+            [[nodiscard]] int colorspace() const { return colorspace_; }
+
+            [[nodiscard]] size_t rows_read() const { return row_; }
+
+            /**
+             * Decode the next row into out as 8-bit RGB (channels = 3) or RGBA (4)
+             * @return false once all rows have been read
+             * @throws qoi_error on truncated data or a missing end marker
+             */
+            bool read_row(std::uint8_t* out, int channels = 3) {
+                if (row_ == height_) {
+                    return false;
+                }
+                if (channels == 4) {
+                    decode_row <4>(out);
+                } else {
+                    decode_row <3>(out);
+                }
+
+                if (++row_ == height_) {
+                    ensure(sizeof(detail::qoi_end_marker));
+                    if (std::memcmp(&buffer_[pos_], detail::qoi_end_marker, sizeof(detail::qoi_end_marker)) != 0) {
+                        throw qoi_error("missing end marker");
+                    }
+                    pos_ += sizeof(detail::qoi_end_marker);
+                }
+                return true;
+            }
+
+        private:
+            void read_header() {
+                std::uint8_t header[detail::qoi_header_size];
+                in_.read(reinterpret_cast<char*>(header), sizeof(header));
+                if (static_cast<size_t>(in_.gcount()) != sizeof(header) ||
+                    std::memcmp(header, detail::qoi_magic, 4) != 0) {
+                    throw qoi_error("not a QOI file");
+                }
+                width_ = detail::read_be32(header + 4);
+                height_ = detail::read_be32(header + 8);
+                channels_ = header[12];
+                colorspace_ = header[13];
+                detail::check_qoi_size(width_, height_);
+                if ((channels_ != 3 && channels_ != 4) || colorspace_ > 1) {
+                    throw qoi_error("invalid header");
+                }
+                buffer_.resize(buffer_size);
+            }
+
+            // Make at least n bytes available at pos_
+            void ensure(size_t n) {
+                if (end_ - pos_ >= n) {
+                    return;
+                }
+                std::memmove(buffer_.data(), buffer_.data() + pos_, end_ - pos_);
+                end_ -= pos_;
+                pos_ = 0;
+                while (end_ < n && in_) {
+                    in_.read(reinterpret_cast<char*>(buffer_.data() + end_),
+                             static_cast<std::streamsize>(buffer_.size() - end_));
+                    end_ += static_cast<size_t>(in_.gcount());
+                }
+                if (end_ < n) {
+                    throw qoi_error("unexpected end of file");
+                }
+            }
+
+            template<int Channels>
+            void decode_row(std::uint8_t* out) {
+                // State lives in locals for the duration of the row
+                detail::qoi_pixel px = px_;
+                unsigned run = run_;
+                size_t pos = pos_;
+                const std::uint8_t* data = buffer_.data();
+
+                for (size_t x = 0; x < width_; ++x) {
+                    if (run > 0) {
+                        --run;
+                    } else {
+                        // Every op is at most 5 bytes and the 8-byte end
+                        // marker follows the last one, so this only fails on
+                        // truncated files
+                        if (end_ - pos < 5) {
+                            pos_ = pos;
+                            ensure(5);
+                            pos = pos_;
+                            data = buffer_.data();
+                        }
+                        const std::uint8_t b1 = data[pos++];
+                        if (b1 == detail::qoi_op_rgb) {
+                            px.r = data[pos];
+                            px.g = data[pos + 1];
+                            px.b = data[pos + 2];
+                            pos += 3;
+                        } else if (b1 == detail::qoi_op_rgba) {
+                            px.r = data[pos];
+                            px.g = data[pos + 1];
+                            px.b = data[pos + 2];
+                            px.a = data[pos + 3];
+                            pos += 4;
+                        } else {
+                            switch (b1 & detail::qoi_mask) {
+                                case detail::qoi_op_index:
+                                    px = index_[b1];
+                                    break;
+                                case detail::qoi_op_diff:
+                                    px.r = static_cast<std::uint8_t>(px.r + ((b1 >> 4) & 3) - 2);
+                                    px.g = static_cast<std::uint8_t>(px.g + ((b1 >> 2) & 3) - 2);
+                                    px.b = static_cast<std::uint8_t>(px.b + (b1 & 3) - 2);
+                                    break;
+                                case detail::qoi_op_luma: {
+                                    const std::uint8_t b2 = data[pos++];
+                                    const int dg = (b1 & 0x3f) - 32;
+                                    px.r = static_cast<std::uint8_t>(px.r + dg - 8 + ((b2 >> 4) & 0x0f));
+                                    px.g = static_cast<std::uint8_t>(px.g + dg);
+                                    px.b = static_cast<std::uint8_t>(px.b + dg - 8 + (b2 & 0x0f));
+                                    break;
+                                }
+                                default:
+                                    run = b1 & 0x3fu;
+                                    break;
+                            }
+                        }
+                        index_[detail::qoi_hash(px)] = px;
+                    }
+
+                    std::uint8_t* p = out + x * Channels;
+                    p[0] = px.r;
+                    p[1] = px.g;
+                    p[2] = px.b;
+                    if constexpr (Channels == 4) {
+                        p[3] = px.a;
+                    }
+                }
+
+                px_ = px;
+                run_ = run;
+                pos_ = pos;
+            }
+
+            std::unique_ptr <std::ifstream> file_;
+            std::istream& in_;
+            size_t width_ = 0;
+            size_t height_ = 0;
+            int channels_ = 3;
+            int colorspace_ = 0;
+
+            std::vector <std::uint8_t> buffer_;
+            size_t pos_ = 0;
+            size_t end_ = 0;
+
+            detail::qoi_pixel px_ = {0, 0, 0, 255};
+            detail::qoi_pixel index_[64] = {};
+            unsigned run_ = 0;
+            size_t row_ = 0;
+    };
+
+    /**
+     * QOI encoder that accepts one row at a time
+     *
+     * Runs and the color table carry over between rows, so the output is
+     * byte-identical to encoding the whole image at once. Encoded bytes are
+     * written in blocks of buffer_size.
+     */
+    class qoi_row_writer {
+        public:
+            /// Encoded bytes buffered before they are written
+            static constexpr size_t buffer_size = 64 * 1024;
+
+            /**
+             * @param channels 3 (RGB) or 4 (RGBA), both in the rows and in the file
+             * @param colorspace 0 sRGB with linear alpha, 1 all linear
+             * @throws qoi_error if the file cannot be created or the size is invalid
+             */
+            qoi_row_writer(const std::string& path, size_t width, size_t height, int channels = 3,
+                           int colorspace = 0)
+                : file_(std::make_unique <std::ofstream>(path, std::ios::binary | std::ios::trunc)),
+                  out_(*file_),
+                  width_(width),
+                  height_(height),
+                  channels_(channels) {
+                if (!*file_) {
+                    throw qoi_error("cannot create " + path);
+                }
+                start(colorspace);
+            }
+
+            qoi_row_writer(std::ostream& out, size_t width, size_t height, int channels = 3,
+                           int colorspace = 0)
+                : out_(out),
+                  width_(width),
+                  height_(height),
+                  channels_(channels) {
+                start(colorspace);
+            }
+
+            qoi_row_writer(const qoi_row_writer&) = delete;
+            qoi_row_writer& operator=(const qoi_row_writer&) = delete;
+
+            /**
+             * Append the next row (width * channels bytes)
+             * @throws qoi_error if all rows have already been written
+             */
+            void write_row(const std::uint8_t* row) {
+                if (row_ == height_) {
+                    throw qoi_error("too many rows");
+                }
+                // Worst case is 5 bytes per pixel
+                const size_t needed = bytes_.size() + width_ * 5 + 1;
+                if (needed > bytes_.capacity()) {
+                    bytes_.reserve(needed);
+                }
+                if (channels_ == 4) {
+                    encode_row <4>(row);
+                } else {
+                    encode_row <3>(row);
+                }
+
+                if (++row_ == height_ && run_ > 0) {
+                    bytes_.push_back(static_cast<std::uint8_t>(detail::qoi_op_run | (run_ - 1)));
+                    run_ = 0;
+                }
+                if (bytes_.size() >= buffer_size) {
+                    flush();
+                }
+            }
+
+            /**
+             * Write the end marker
+             * @throws qoi_error if fewer rows than the height were written
+             */
+            void finish() {
+                if (row_ != height_) {
+                    throw qoi_error("image incomplete: " + std::to_string(row_) + " of " +
+                                    std::to_string(height_) + " rows written");
+                }
+                if (!finished_) {
+                    bytes_.insert(bytes_.end(), std::begin(detail::qoi_end_marker), std::end(detail::qoi_end_marker));
+                    flush();
+                    out_.flush();
+                    finished_ = true;
+                }
+            }
+
+            [[nodiscard]] size_t rows_written() const { return row_; }
+
+        private:
+            void start(int colorspace) {
+                detail::check_qoi_size(width_, height_);
+                if ((channels_ != 3 && channels_ != 4) || colorspace < 0 || colorspace > 1) {
+                    throw qoi_error("channels must be 3 or 4 and colorspace 0 or 1");
+                }
+                std::uint8_t header[detail::qoi_header_size];
+                std::memcpy(header, detail::qoi_magic, 4);
+                detail::write_be32(header + 4, static_cast<std::uint32_t>(width_));
+                detail::write_be32(header + 8, static_cast<std::uint32_t>(height_));
+                header[12] = static_cast<std::uint8_t>(channels_);
+                header[13] = static_cast<std::uint8_t>(colorspace);
+                bytes_.assign(header, header + sizeof(header));
+            }
+
+            template<int Channels>
+            void encode_row(const std::uint8_t* row) {
+                detail::qoi_pixel prev = px_;
+                unsigned run = run_;
+                auto& bytes = bytes_;
+
+                for (size_t x = 0; x < width_; ++x) {
+                    const std::uint8_t* p = row + x * Channels;
+                    detail::qoi_pixel px{p[0], p[1], p[2], Channels == 4 ? p[3] : prev.a};
+
+                    if (px == prev) {
+                        if (++run == 62) {
+                            bytes.push_back(static_cast<std::uint8_t>(detail::qoi_op_run | (run - 1)));
+                            run = 0;
+                        }
+                        continue;
+                    }
+                    if (run > 0) {
+                        bytes.push_back(static_cast<std::uint8_t>(detail::qoi_op_run | (run - 1)));
+                        run = 0;
+                    }
+
+                    const unsigned hash = detail::qoi_hash(px);
+                    if (index_[hash] == px) {
+                        bytes.push_back(static_cast<std::uint8_t>(detail::qoi_op_index | hash));
+                    } else {
+                        index_[hash] = px;
+                        if (px.a == prev.a) {
+                            const auto vr = static_cast<std::int8_t>(px.r - prev.r);
+                            const auto vg = static_cast<std::int8_t>(px.g - prev.g);
+                            const auto vb = static_cast<std::int8_t>(px.b - prev.b);
+                            const int vg_r = vr - vg;
+                            const int vg_b = vb - vg;
+
+                            if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                                bytes.push_back(static_cast<std::uint8_t>(
+                                    detail::qoi_op_diff | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2)));
+                            } else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8) {
+                                bytes.push_back(static_cast<std::uint8_t>(detail::qoi_op_luma | (vg + 32)));
+                                bytes.push_back(static_cast<std::uint8_t>((vg_r + 8) << 4 | (vg_b + 8)));
+                            } else {
+                                bytes.push_back(detail::qoi_op_rgb);
+                                bytes.push_back(px.r);
+                                bytes.push_back(px.g);
+                                bytes.push_back(px.b);
+                            }
+                        } else {
+                            bytes.push_back(detail::qoi_op_rgba);
+                            bytes.push_back(px.r);
+                            bytes.push_back(px.g);
+                            bytes.push_back(px.b);
+                            bytes.push_back(px.a);
+                        }
+                    }
+                    prev = px;
+                }
+
+                px_ = prev;
+                run_ = run;
+            }
+
+            void flush() {
+                out_.write(reinterpret_cast<const char*>(bytes_.data()), static_cast<std::streamsize>(bytes_.size()));
+                if (!out_) {
+                    throw qoi_error("write failed");
+                }
+                bytes_.clear();
+            }
+
+            std::unique_ptr <std::ofstream> file_;
+            std::ostream& out_;
+            size_t width_;
+            size_t height_;
+            int channels_;
+
+            detail::qoi_pixel px_ = {0, 0, 0, 255};
+            detail::qoi_pixel index_[64] = {};
+            unsigned run_ = 0;
+            size_t row_ = 0;
+            bool finished_ = false;
+            std::vector <std::uint8_t> bytes_;
+    };
+
+    /**
+     * Load a whole QOI file
+     * @throws qoi_error on a missing or malformed file
+     */
+    inline packed_image load_qoi(const std::string& path) {
+        qoi_row_reader reader(path);
+        return read_image(reader);
+    }
+
+    /**
+     * Save a packed_image as QOI with the image's channel count
+     * @throws qoi_error if the file cannot be written
+     */
+    inline void save_qoi(const std::string& path, const packed_image& image) {
+        qoi_row_writer writer(path, image.width(), image.height(), image.channels());
+        write_image(writer, image);
+    }
+
+} // namespace scaler::io
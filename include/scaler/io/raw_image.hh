@@ -0,0 +1,276 @@
+#pragma once
+
+#include <scaler/io/io_exceptions.hh>
+#include <scaler/io/packed_image.hh>
+#include <scaler/io/png_stream.hh>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace scaler::io {
+
+    namespace detail {
+
+        /**
+         * Raw image header, 16 bytes:
+         *   0  magic "SRAW"
+         *   4  width (big endian)
+         *   8  height (big endian)
+         *   12 channels (1 gray, 2 gray+alpha, 3 RGB, 4 RGBA)
+         *   13 bits per sample (always 8)
+         *   14 reserved, zero
+         * followed by height rows of width * channels bytes.
+         */
+        inline constexpr std::uint8_t raw_magic[4] = {'S', 'R', 'A', 'W'};
+        inline constexpr size_t raw_header_size = 16;
+
+        // Expand gray/gray+alpha/RGB/RGBA samples to RGB (3) or RGBA (4)
+        inline void convert_channels(const std::uint8_t* in, int in_channels, std::uint8_t* out,
+                                     int out_channels, size_t width) {
+            const auto in_step = static_cast<size_t>(in_channels);
+            const auto out_step = static_cast<size_t>(out_channels);
+            for (size_t x = 0; x < width; ++x) {
+                const std::uint8_t* s = in + x * in_step;
+                std::uint8_t* d = out + x * out_step;
+                if (in_channels >= 3) {
+                    d[0] = s[0];
+                    d[1] = s[1];
+                    d[2] = s[2];
+                } else {
+                    d[0] = d[1] = d[2] = s[0];
+                }
+                if (out_channels == 4) {
+                    d[3] = in_channels == 4 ? s[3] : in_channels == 2 ? s[1] : std::uint8_t(255);
+                }
+            }
+        }
+
+    } // namespace detail
+
+    /**
+     * Reader for uncompressed 8-bit images with a 16-byte header
+     *
+     * The fastest possible intermediate format: when the requested channel
+     * count matches the file, rows are read straight into the caller's
+     * buffer (for scale_rows(), the band window) with no decoding at all.
+     *
+     * @code
+     * io::raw_row_reader reader("frame.raw");
+     * io::scale_rows(reader, algorithm::EPX, 2, sink);
+     * @endcode
+     */
+    class raw_row_reader {
+        public:
+            /**
+             * @throws raw_image_error if the file cannot be opened or its header is invalid
+             */
+            explicit raw_row_reader(const std::string& path)
+                : file_(std::make_unique <std::ifstream>(path, std::ios::binary)),
+                  in_(*file_) {
+                if (!*file_) {
+                    throw raw_image_error("cannot open " + path);
+                }
+                read_header();
+            }
+
+            /**
+             * Read from a stream positioned at the raw image header
+             */
+            explicit raw_row_reader(std::istream& in)
+                : in_(in) {
+                read_header();
+            }
+
+            raw_row_reader(const raw_row_reader&) = delete;
+            raw_row_reader& operator=(const raw_row_reader&) = delete;
+
+            [[nodiscard]] size_t width() const { return width_; }
+            [[nodiscard]] size_t height() const { return height_; }
+
+            /**
+             * Channels stored in the file (1-4)
+             */
+            [[nodiscard]] int stored_channels() const { return stored_channels_; }
+
+            /**
+             * Channels of the decoded data: 4 if the file has alpha, else 3
+             */
+            [[nodiscard]] int channels() const { return stored_channels_ % 2 == 0 ? 4 : 3; }
+
+            [[nodiscard]] size_t rows_read() const { return row_; }
+
+            /**
+             * Read the next row into out as 8-bit RGB (channels = 3) or RGBA (4)
+             * @return false once all rows have been read
+             * @throws raw_image_error if the file ends early
+             */
+            bool read_row(std::uint8_t* out, int channels = 3) {
+                if (row_ == height_) {
+                    return false;
+                }
+                const int out_channels = channels == 4 ? 4 : 3;
+                if (out_channels == stored_channels_) {
+                    read_exact(out, row_bytes_);
+                } else {
+                    row_buffer_.resize(row_bytes_);
+                    read_exact(row_buffer_.data(), row_bytes_);
+                    detail::convert_channels(row_buffer_.data(), stored_channels_, out, out_channels, width_);
+                }
+                ++row_;
+                return true;
+            }
+
+        private:
+            void read_exact(std::uint8_t* data, size_t size) {
+                in_.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(size));
+                if (static_cast<size_t>(in_.gcount()) != size) {
+                    throw raw_image_error("unexpected end of file");
+                }
+            }
+
+            void read_header() {
+                std::uint8_t header[detail::raw_header_size];
+                in_.read(reinterpret_cast<char*>(header), sizeof(header));
+                if (static_cast<size_t>(in_.gcount()) != sizeof(header) ||
+                    std::memcmp(header, detail::raw_magic, 4) != 0) {
+                    throw raw_image_error("not a raw image file");
+                }
+                width_ = detail::read_be32(header + 4);
+                height_ = detail::read_be32(header + 8);
+                stored_channels_ = header[12];
+                if (width_ == 0 || height_ == 0 || stored_channels_ < 1 || stored_channels_ > 4 || header[13] != 8) {
+                    throw raw_image_error("invalid header");
+                }
+                row_bytes_ = width_ * static_cast<size_t>(stored_channels_);
+            }
+
+            std::unique_ptr <std::ifstream> file_;
+            std::istream& in_;
+            size_t width_ = 0;
+            size_t height_ = 0;
+            int stored_channels_ = 3;
+            size_t row_bytes_ = 0;
+            size_t row_ = 0;
+            std::vector <std::uint8_t> row_buffer_;
+    };
+
+    /**
+     * Writer for the raw image format read by raw_row_reader
+     *
+     * Rows are written unchanged, so the cost is that of the copy into the
+     * stream buffer.
+     */
+    class raw_row_writer {
+        public:
+            /**
+             * @param channels 1 gray, 2 gray+alpha, 3 RGB, 4 RGBA
+             * @throws raw_image_error if the file cannot be created or the size is invalid
+             */
+            raw_row_writer(const std::string& path, size_t width, size_t height, int channels = 3)
+                : file_(std::make_unique <std::ofstream>(path, std::ios::binary | std::ios::trunc)),
+                  out_(*file_),
+                  width_(width),
+                  height_(height),
+                  channels_(channels) {
+                if (!*file_) {
+                    throw raw_image_error("cannot create " + path);
+                }
+                start();
+            }
+
+            raw_row_writer(std::ostream& out, size_t width, size_t height, int channels = 3)
+                : out_(out),
+                  width_(width),
+                  height_(height),
+                  channels_(channels) {
+                start();
+            }
+
+            raw_row_writer(const raw_row_writer&) = delete;
+            raw_row_writer& operator=(const raw_row_writer&) = delete;
+
+            /**
+             * Append the next row (width * channels bytes)
+             * @throws raw_image_error if all rows have already been written
+             */
+            void write_row(const std::uint8_t* row) {
+                if (row_ == height_) {
+                    throw raw_image_error("too many rows");
+                }
+                write(row, width_ * static_cast<size_t>(channels_));
+                ++row_;
+            }
+
+            /**
+             * Flush the file
+             * @throws raw_image_error if fewer rows than the height were written
+             */
+            void finish() {
+                if (row_ != height_) {
+                    throw raw_image_error("image incomplete: " + std::to_string(row_) + " of " +
+                                          std::to_string(height_) + " rows written");
+                }
+                out_.flush();
+                if (!out_) {
+                    throw raw_image_error("write failed");
+                }
+            }
+
+            [[nodiscard]] size_t rows_written() const { return row_; }
+
+        private:
+            void start() {
+                if (width_ == 0 || height_ == 0 || width_ > 0xFFFFFFFFu || height_ > 0xFFFFFFFFu) {
+                    throw raw_image_error("invalid image size");
+                }
+                if (channels_ < 1 || channels_ > 4) {
+                    throw raw_image_error("channels must be 1-4");
+                }
+                std::uint8_t header[detail::raw_header_size] = {};
+                std::memcpy(header, detail::raw_magic, 4);
+                detail::write_be32(header + 4, static_cast<std::uint32_t>(width_));
+                detail::write_be32(header + 8, static_cast<std::uint32_t>(height_));
+                header[12] = static_cast<std::uint8_t>(channels_);
+                header[13] = 8;
+                write(header, sizeof(header));
+            }
+
+            void write(const std::uint8_t* data, size_t size) {
+                out_.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+                if (!out_) {
+                    throw raw_image_error("write failed");
+                }
+            }
+
+            std::unique_ptr <std::ofstream> file_;
+            std::ostream& out_;
+            size_t width_;
+            size_t height_;
+            int channels_;
+            size_t row_ = 0;
+    };
+
+    /**
+     * Load a whole raw image file as RGB or RGBA
+     * @throws raw_image_error on a missing or malformed file
+     */
+    inline packed_image load_raw(const std::string& path) {
+        raw_row_reader reader(path);
+        return read_image(reader);
+    }
+
+    /**
+     * Save a packed_image as a raw image file
+     * @throws raw_image_error if the file cannot be written
+     */
+    inline void save_raw(const std::string& path, const packed_image& image) {
+        raw_row_writer writer(path, image.width(), image.height(), image.channels());
+        write_image(writer, image);
+    }
+
+} // namespace scaler::io
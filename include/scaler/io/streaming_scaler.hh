@@ -0,0 +1,332 @@
+#pragma once
+
+#include <scaler/algorithm.hh>
+#include <scaler/image_base.hh>
+#include <scaler/unified_scaler.hh>
+#include <scaler/cpu/band_parallel.hh>
+#include <scaler/io/io_exceptions.hh>
+#include <scaler/io/parallel_png_writer.hh>
+#include <scaler/io/png_stream.hh>
+#include <scaler/io/qoi.hh>
+#include <scaler/io/raw_image.hh>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <string>
+#include <vector>
+
+namespace scaler::io {
+
+    /**
+     * Receives finished output rows in order (8-bit RGB, width * 3 bytes)
+     */
+    using row_sink = std::function <void(const std::uint8_t* row)>;
+
+    namespace detail {
+
+        using rgb_pixel = vec3 <std::uint8_t>;
+
+        /**
+         * Input band: the RGB rows currently held by the streaming scaler
+         */
+        class row_band_view : public input_image_base <row_band_view, rgb_pixel> {
+            public:
+                using pixel_type = rgb_pixel;
+
+                row_band_view(size_t width, const std::vector <const std::uint8_t*>& rows)
+                    : width_(width), rows_(rows) {
+                }
+
+                [[nodiscard]] size_t width_impl() const { return width_; }
+                [[nodiscard]] size_t height_impl() const { return rows_.size(); }
+
+                [[nodiscard]] rgb_pixel get_pixel_impl(size_t x, size_t y) const {
+                    const std::uint8_t* p = rows_[y] + x * 3;
+                    return {p[0], p[1], p[2]};
+                }
+
+            private:
+                size_t width_;
+                const std::vector <const std::uint8_t*>& rows_;
+        };
+
+        /**
+         * Scaled band (and intermediate image of multi-pass algorithms)
+         */
+        class rgb_band_image : public input_image_base <rgb_band_image, rgb_pixel>,
+                               public output_image_base <rgb_band_image, rgb_pixel> {
+            public:
+                using pixel_type = rgb_pixel;
+                using input_image_base <rgb_band_image, rgb_pixel>::width;
+                using input_image_base <rgb_band_image, rgb_pixel>::height;
+
+                rgb_band_image(size_t width, size_t height)
+                    : width_(width), height_(height), data_(width * height * 3) {
+                }
+
+                template<typename Source>
+                rgb_band_image(size_t width, size_t height, const Source&)
+                    : rgb_band_image(width, height) {
+                }
+
+                [[nodiscard]] size_t width_impl() const { return width_; }
+                [[nodiscard]] size_t height_impl() const { return height_; }
+
+                [[nodiscard]] rgb_pixel get_pixel_impl(size_t x, size_t y) const {
+                    const std::uint8_t* p = &data_[(y * width_ + x) * 3];
+                    return {p[0], p[1], p[2]};
+                }
+
+                void set_pixel_impl(size_t x, size_t y, const rgb_pixel& pixel) {
+                    std::uint8_t* p = &data_[(y * width_ + x) * 3];
+                    p[0] = pixel.x;
+                    p[1] = pixel.y;
+                    p[2] = pixel.z;
+                }
+
+                [[nodiscard]] const std::uint8_t* row(size_t y) const {
+                    return &data_[y * width_ * 3];
+                }
+
+            private:
+                size_t width_;
+                size_t height_;
+                std::vector <std::uint8_t> data_;
+        };
+
+    } // namespace detail
+
+    /**
+     * Input rows above and below a band that an algorithm reads to produce
+     * the band's output rows exactly as a whole-image scale would
+     */
+    inline size_t streaming_halo_rows(algorithm algo) {
+        return band_halo_rows(algo);
+    }
+
+    /**
+     * Scale an image that arrives row by row, emitting output rows as soon
+     * as they are final
+     *
+     * The image is processed in horizontal bands of band_rows input rows.
+     * Each band is scaled together with streaming_halo_rows() context rows
+     * on either side, which makes the output identical to scaling the whole
+     * image while holding only O(width * (band_rows + 2 * halo)) pixels.
+     * Rows of the next band are decoded on a worker thread while the
+     * current band is scaled and its rows are consumed by the sink.
+     *
+     * RowSource needs width(), height() and bool read_row(std::uint8_t* rgb),
+     * which png_row_reader, qoi_row_reader and raw_row_reader provide.
+     *
+     * @param scale_factor Integral scale supported by algo
+     * @throws std::invalid_argument for a scale the algorithm does not support
+     * @throws io_error if the source ends before height() rows
+     */
+    template<typename RowSource>
+    void scale_rows(RowSource& source, algorithm algo, int scale_factor, const row_sink& sink,
+                    size_t band_rows = 32) {
+        if (scale_factor < 1 || !scaler_capabilities::is_scale_supported(algo, static_cast<float>(scale_factor))) {
+            throw std::invalid_argument("scale_rows: " + scaler_capabilities::get_algorithm_name(algo) +
+                                        " does not support scale " + std::to_string(scale_factor));
+        }
+
+        const size_t width = source.width();
+        const size_t height = source.height();
+        const auto factor = static_cast<size_t>(scale_factor);
+        const size_t halo = streaming_halo_rows(algo);
+        band_rows = std::max <size_t>(band_rows, 1);
+
+        using row_buffer = std::vector <std::uint8_t>;
+        size_t rows_loaded = 0;
+        const auto load_rows = [&source, width, height](size_t first, size_t end) {
+            std::vector <row_buffer> rows;
+            for (size_t y = first; y < std::min(end, height); ++y) {
+                rows.emplace_back(width * 3);
+                if (!source.read_row(rows.back().data())) {
+                    throw io_error("row source ended after " + std::to_string(y) + " of " +
+                                   std::to_string(height) + " rows");
+                }
+            }
+            return rows;
+        };
+
+        // window holds input rows [window_first, window_first + window.size())
+        std::deque <row_buffer> window;
+        size_t window_first = 0;
+        for (auto& row : load_rows(0, band_rows + halo)) {
+            window.push_back(std::move(row));
+        }
+        rows_loaded = window.size();
+
+        std::vector <const std::uint8_t*> band;
+        for (size_t y0 = 0; y0 < height; y0 += band_rows) {
+            const size_t y1 = std::min(height, y0 + band_rows);
+            const size_t next_end = std::min(height, y1 + band_rows + halo);
+            auto ahead = std::async(std::launch::async, load_rows, rows_loaded, next_end);
+
+            const size_t keep_from = y0 > halo ? y0 - halo : 0;
+            while (window_first < keep_from) {
+                window.pop_front();
+                ++window_first;
+            }
+
+            band.clear();
+            for (const auto& row : window) {
+                band.push_back(row.data());
+            }
+            const detail::row_band_view input(width, band);
+            detail::rgb_band_image output(width * factor, band.size() * factor);
+            unified_scaler <detail::row_band_view, detail::rgb_band_image>::scale(input, output, algo);
+
+            for (size_t y = y0; y < y1; ++y) {
+                for (size_t sub = 0; sub < factor; ++sub) {
+                    sink(output.row((y - window_first) * factor + sub));
+                }
+            }
+
+            for (auto& row : ahead.get()) {
+                window.push_back(std::move(row));
+            }
+            rows_loaded = std::max(rows_loaded, next_end);
+        }
+    }
+
+    /**
+     * File formats that can be streamed row by row
+     */
+    enum class image_file_format {
+        unknown,
+        png,
+        qoi,  ///< Quite OK Image, fast lossless
+        raw   ///< Uncompressed, see raw_row_reader
+    };
+
+    /**
+     * Format of a file by its extension (.png, .qoi, .raw, case-insensitive)
+     */
+    inline image_file_format image_file_format_of(const std::string& path) {
+        const size_t dot = path.find_last_of('.');
+        if (dot == std::string::npos) {
+            return image_file_format::unknown;
+        }
+        std::string ext = path.substr(dot + 1);
+        std::transform(ext.begin(), ext.end(), ext.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (ext == "png") {
+            return image_file_format::png;
+        }
+        if (ext == "qoi") {
+            return image_file_format::qoi;
+        }
+        if (ext == "raw") {
+            return image_file_format::raw;
+        }
+        return image_file_format::unknown;
+    }
+
+    namespace detail {
+
+        template<typename RowReader>
+        void scale_reader_to_file(RowReader& reader, const std::string& output_path, image_file_format format,
+                                  algorithm algo, int scale_factor, int level, size_t band_rows,
+                                  unsigned threads) {
+            const size_t width = reader.width() * static_cast<size_t>(scale_factor);
+            const size_t height = reader.height() * static_cast<size_t>(scale_factor);
+
+            const auto run = [&](auto& writer) {
+                scale_rows(reader, algo, scale_factor, [&writer](const std::uint8_t* row) {
+                    writer.write_row(row);
+                }, band_rows);
+                writer.finish();
+            };
+            switch (format) {
+                case image_file_format::qoi: {
+                    qoi_row_writer writer(output_path, width, height, 3);
+                    run(writer);
+                    break;
+                }
+                case image_file_format::raw: {
+                    raw_row_writer writer(output_path, width, height, 3);
+                    run(writer);
+                    break;
+                }
+                default:
+                    if (threads == 1) {
+                        png_row_writer writer(output_path, width, height, 3, level);
+                        run(writer);
+                    } else {
+                        parallel_png_writer writer(output_path, width, height, 3, level, threads);
+                        run(writer);
+                    }
+                    break;
+            }
+        }
+
+    } // namespace detail
+
+    /**
+     * Stream a PNG through scale_rows into a PNG, without ever holding
+     * either image in memory
+     *
+     * @param level zlib level of the output
+     * @param threads Compression threads (parallel_png_writer), 0 = hardware
+     *                concurrency, 1 = encode on the calling thread
+     * @throws png_error for interlaced input (use a whole-image decoder instead)
+     */
+    inline void scale_png_file(const std::string& input_path, const std::string& output_path,
+                               algorithm algo, int scale_factor, int level = 6,
+                               size_t band_rows = 32, unsigned threads = 0) {
+        png_row_reader reader(input_path);
+        detail::scale_reader_to_file(reader, output_path, image_file_format::png, algo, scale_factor,
+                                     level, band_rows, threads);
+    }
+
+    /**
+     * Stream any combination of PNG, QOI and raw files through scale_rows,
+     * choosing the formats by file extension
+     *
+     * QOI and raw skip zlib entirely, so for intermediate files between
+     * pipeline stages the scaler rather than the codec sets the pace.
+     *
+     * @param level zlib level, used for PNG output only
+     * @param threads PNG compression threads, as for scale_png_file()
+     * @throws io_error for an unknown extension or a malformed input file
+     */
+    inline void scale_image_file(const std::string& input_path, const std::string& output_path,
+                                 algorithm algo, int scale_factor, int level = 6,
+                                 size_t band_rows = 32, unsigned threads = 0) {
+        const image_file_format output_format = image_file_format_of(output_path);
+        if (output_format == image_file_format::unknown) {
+            throw io_error("cannot stream to " + output_path + " (expected .png, .qoi or .raw)");
+        }
+
+        const auto scale_from = [&](auto& reader) {
+            detail::scale_reader_to_file(reader, output_path, output_format, algo, scale_factor,
+                                         level, band_rows, threads);
+        };
+        switch (image_file_format_of(input_path)) {
+            case image_file_format::png: {
+                png_row_reader reader(input_path);
+                scale_from(reader);
+                break;
+            }
+            case image_file_format::qoi: {
+                qoi_row_reader reader(input_path);
+                scale_from(reader);
+                break;
+            }
+            case image_file_format::raw: {
+                raw_row_reader reader(input_path);
+                scale_from(reader);
+                break;
+            }
+            default:
+                throw io_error("cannot stream from " + input_path + " (expected .png, .qoi or .raw)");
+        }
+    }
+
+} // namespace scaler::io
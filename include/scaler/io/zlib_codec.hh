@@ -0,0 +1,1253 @@
+#pragma once
+
+#include <scaler/io/io_exceptions.hh>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace scaler::io {
+
+    /**
+     * CRC-32 (ISO 3309, as used by PNG chunks)
+     * @param crc CRC of the preceding data, to checksum in pieces
+     */
+    inline std::uint32_t crc32(const std::uint8_t* data, size_t size, std::uint32_t crc = 0) {
+        static const auto table = [] {
+            std::array <std::uint32_t, 256> t{};
+            for (std::uint32_t n = 0; n < 256; ++n) {
+                std::uint32_t c = n;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1u) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                t[n] = c;
+            }
+            return t;
+        }();
+
+        crc = ~crc;
+        for (size_t i = 0; i < size; ++i) {
+            crc = table[(crc ^ data[i]) & 0xFFu] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    /**
+     * Adler-32 (RFC 1950)
+     * @param adler Checksum of the preceding data, to checksum in pieces
+     */
+    inline std::uint32_t adler32(const std::uint8_t* data, size_t size, std::uint32_t adler = 1) {
+        constexpr std::uint32_t base = 65521;
+        // Largest run for which the sums cannot overflow 32 bits
+        constexpr size_t nmax = 5552;
+
+        std::uint32_t a = adler & 0xFFFFu;
+        std::uint32_t b = adler >> 16;
+        while (size > 0) {
+            const size_t run = std::min(size, nmax);
+            for (size_t i = 0; i < run; ++i) {
+                a += data[i];
+                b += a;
+            }
+            a %= base;
+            b %= base;
+            data += run;
+            size -= run;
+        }
+        return (b << 16) | a;
+    }
+
+    namespace detail {
+
+        // Multiply a 32x32 GF(2) matrix by a vector
+        inline std::uint32_t gf2_matrix_times(const std::uint32_t* matrix, std::uint32_t vector) {
+            std::uint32_t sum = 0;
+            for (; vector != 0; vector >>= 1, ++matrix) {
+                if (vector & 1u) {
+                    sum ^= *matrix;
+                }
+            }
+            return sum;
+        }
+
+        inline void gf2_matrix_square(std::uint32_t* square, const std::uint32_t* matrix) {
+            for (int n = 0; n < 32; ++n) {
+                square[n] = gf2_matrix_times(matrix, matrix[n]);
+            }
+        }
+
+    } // namespace detail
+
+    /**
+     * CRC-32 of A followed by B, given crc32(A), crc32(B) and the length of B
+     *
+     * Lets pieces be checksummed independently (e.g. on worker threads) and
+     * joined in O(log length) without touching the data again.
+     */
+    inline std::uint32_t crc32_combine(std::uint32_t crc1, std::uint32_t crc2, std::uint64_t length2) {
+        if (length2 == 0) {
+            return crc1;
+        }
+
+        // Operator for one zero bit, then squared to two and four zero bits
+        std::uint32_t odd[32];
+        std::uint32_t even[32];
+        odd[0] = 0xEDB88320u;
+        for (int n = 1; n < 32; ++n) {
+            odd[n] = 1u << (n - 1);
+        }
+        detail::gf2_matrix_square(even, odd);
+        detail::gf2_matrix_square(odd, even);
+
+        // Apply length2 zero bytes to crc1
+        do {
+            detail::gf2_matrix_square(even, odd);
+            if (length2 & 1u) {
+                crc1 = detail::gf2_matrix_times(even, crc1);
+            }
+            length2 >>= 1;
+            if (length2 == 0) {
+                break;
+            }
+            detail::gf2_matrix_square(odd, even);
+            if (length2 & 1u) {
+                crc1 = detail::gf2_matrix_times(odd, crc1);
+            }
+            length2 >>= 1;
+        } while (length2 != 0);
+
+        return crc1 ^ crc2;
+    }
+
+    /**
+     * Adler-32 of A followed by B, given adler32(A), adler32(B) and the length of B
+     */
+    inline std::uint32_t adler32_combine(std::uint32_t adler1, std::uint32_t adler2, std::uint64_t length2) {
+        constexpr std::uint32_t base = 65521;
+        const auto remainder = static_cast<std::uint32_t>(length2 % base);
+
+        std::uint32_t sum1 = adler1 & 0xFFFFu;
+        std::uint32_t sum2 = static_cast<std::uint32_t>((std::uint64_t{remainder} * sum1) % base);
+        sum1 += (adler2 & 0xFFFFu) + base - 1;
+        sum2 += (adler1 >> 16) + (adler2 >> 16) + base - remainder;
+        if (sum1 >= base) {
+            sum1 -= base;
+        }
+        if (sum1 >= base) {
+            sum1 -= base;
+        }
+        if (sum2 >= base << 1) {
+            sum2 -= base << 1;
+        }
+        if (sum2 >= base) {
+            sum2 -= base;
+        }
+        return sum1 | (sum2 << 16);
+    }
+
+    /**
+     * Framing of a deflate stream
+     */
+    enum class deflate_format {
+        zlib, ///< RFC 1950: 2-byte header, deflate data, Adler-32 trailer
+        raw   ///< Bare RFC 1951 deflate data
+    };
+
+    namespace detail {
+
+        constexpr size_t deflate_window = 32768;
+        constexpr int max_code_bits = 15;
+
+        constexpr std::uint16_t length_base[29] = {
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+            35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+        };
+        constexpr std::uint8_t length_extra[29] = {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+            3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+        };
+        constexpr std::uint16_t distance_base[30] = {
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+        };
+        constexpr std::uint8_t distance_extra[30] = {
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+            7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+        };
+        // Transmission order of the code length code lengths
+        constexpr std::uint8_t code_length_order[19] = {
+            16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+        };
+
+        inline std::uint32_t reverse_bits(std::uint32_t code, int length) {
+            std::uint32_t result = 0;
+            for (int i = 0; i < length; ++i) {
+                result = (result << 1) | (code & 1u);
+                code >>= 1;
+            }
+            return result;
+        }
+
+        /**
+         * Canonical codes for the given lengths, bit-reversed for LSB-first output
+         */
+        inline void canonical_codes(const std::uint8_t* lengths, size_t count, std::uint16_t* codes) {
+            std::uint16_t length_count[max_code_bits + 1] = {};
+            for (size_t i = 0; i < count; ++i) {
+                ++length_count[lengths[i]];
+            }
+            length_count[0] = 0;
+
+            std::uint32_t next[max_code_bits + 1] = {};
+            std::uint32_t code = 0;
+            for (int bits = 1; bits <= max_code_bits; ++bits) {
+                code = (code + length_count[bits - 1]) << 1;
+                next[bits] = code;
+            }
+            for (size_t i = 0; i < count; ++i) {
+                const int len = lengths[i];
+                codes[i] = len ? static_cast<std::uint16_t>(reverse_bits(next[len]++, len)) : 0;
+            }
+        }
+
+        /**
+         * Huffman code lengths of at most max_bits for the given frequencies
+         *
+         * Builds an unrestricted Huffman tree and, while it is too deep,
+         * flattens the frequencies and rebuilds; this converges quickly and
+         * costs little compression for deflate's alphabet sizes.
+         */
+        inline void build_code_lengths(const std::uint32_t* frequencies, size_t count, int max_bits,
+                                       std::uint8_t* lengths) {
+            std::fill(lengths, lengths + count, std::uint8_t{0});
+
+            std::vector <std::uint32_t> weights(frequencies, frequencies + count);
+            std::vector <size_t> used;
+            for (size_t i = 0; i < count; ++i) {
+                if (weights[i] != 0) {
+                    used.push_back(i);
+                }
+            }
+            if (used.empty()) {
+                return;
+            }
+            if (used.size() == 1) {
+                lengths[used[0]] = 1;
+                return;
+            }
+
+            std::vector <std::uint64_t> node_weight;
+            std::vector <size_t> parent;
+            while (true) {
+                // Leaves are nodes [0, used.size()), internal nodes follow
+                node_weight.clear();
+                parent.assign(2 * used.size() - 1, 0);
+                using entry = std::pair <std::uint64_t, size_t>;
+                std::vector <entry> heap;
+                for (size_t leaf = 0; leaf < used.size(); ++leaf) {
+                    node_weight.push_back(weights[used[leaf]]);
+                    heap.emplace_back(weights[used[leaf]], leaf);
+                }
+                const auto greater = [](const entry& a, const entry& b) {
+                    return a.first > b.first || (a.first == b.first && a.second > b.second);
+                };
+                std::make_heap(heap.begin(), heap.end(), greater);
+
+                while (heap.size() > 1) {
+                    std::pop_heap(heap.begin(), heap.end(), greater);
+                    const entry a = heap.back();
+                    heap.pop_back();
+                    std::pop_heap(heap.begin(), heap.end(), greater);
+                    const entry b = heap.back();
+                    heap.pop_back();
+
+                    const size_t node = node_weight.size();
+                    node_weight.push_back(a.first + b.first);
+                    parent[a.second] = node;
+                    parent[b.second] = node;
+                    heap.emplace_back(a.first + b.first, node);
+                    std::push_heap(heap.begin(), heap.end(), greater);
+                }
+
+                // Parents always have higher indices, so depths resolve top-down
+                const size_t root = node_weight.size() - 1;
+                std::vector <int> depth(node_weight.size(), 0);
+                int deepest = 0;
+                for (size_t node = root; node-- > 0;) {
+                    depth[node] = depth[parent[node]] + 1;
+                    if (node < used.size()) {
+                        deepest = std::max(deepest, depth[node]);
+                    }
+                }
+
+                if (deepest <= max_bits) {
+                    for (size_t leaf = 0; leaf < used.size(); ++leaf) {
+                        lengths[used[leaf]] = static_cast<std::uint8_t>(depth[leaf]);
+                    }
+                    return;
+                }
+                for (size_t symbol : used) {
+                    weights[symbol] = (weights[symbol] >> 1) | 1u;
+                }
+            }
+        }
+
+        /**
+         * LSB-first bit packer appending to a byte vector
+         */
+        class bit_writer {
+            public:
+                void put(std::vector <std::uint8_t>& out, std::uint32_t value, int bits) {
+                    buffer_ |= static_cast<std::uint64_t>(value) << count_;
+                    count_ += bits;
+                    while (count_ >= 8) {
+                        out.push_back(static_cast<std::uint8_t>(buffer_));
+                        buffer_ >>= 8;
+                        count_ -= 8;
+                    }
+                }
+
+                void align(std::vector <std::uint8_t>& out) {
+                    if (count_ > 0) {
+                        put(out, 0, 8 - count_);
+                    }
+                }
+
+                [[nodiscard]] int pending_bits() const { return count_; }
+
+            private:
+                std::uint64_t buffer_ = 0;
+                int count_ = 0;
+        };
+
+        /**
+         * Table-driven decoder for one canonical Huffman code
+         *
+         * Codes up to fast_bits long resolve with one lookup; longer codes
+         * (rare in practice) are decoded bit by bit from the canonical counts.
+         */
+        class huffman_decoder {
+            public:
+                static constexpr int fast_bits = 10;
+
+                /**
+                 * @throws zlib_error if the lengths do not form a valid prefix code
+                 */
+                void build(const std::uint8_t* lengths, size_t count) {
+                    std::fill(std::begin(counts_), std::end(counts_), std::uint16_t{0});
+                    for (size_t i = 0; i < count; ++i) {
+                        ++counts_[lengths[i]];
+                    }
+                    counts_[0] = 0;
+
+                    // Over-subscribed codes are corrupt; incomplete codes are only
+                    // legal for a single code of length one
+                    int left = 1;
+                    for (int len = 1; len <= max_code_bits; ++len) {
+                        left = (left << 1) - counts_[len];
+                        if (left < 0) {
+                            throw zlib_error("over-subscribed Huffman code");
+                        }
+                    }
+                    const int used = static_cast<int>(count) - static_cast<int>(std::count(lengths, lengths + count, 0));
+                    if (left > 0 && !(used == 1 && counts_[1] == 1)) {
+                        throw zlib_error("incomplete Huffman code");
+                    }
+
+                    std::uint16_t offsets[max_code_bits + 2] = {};
+                    for (int len = 1; len <= max_code_bits; ++len) {
+                        offsets[len + 1] = static_cast<std::uint16_t>(offsets[len] + counts_[len]);
+                    }
+                    symbols_.assign(count, 0);
+                    for (size_t i = 0; i < count; ++i) {
+                        if (lengths[i]) {
+                            symbols_[offsets[lengths[i]]++] = static_cast<std::uint16_t>(i);
+                        }
+                    }
+
+                    fast_.fill(0);
+                    std::uint16_t codes[320];
+                    canonical_codes(lengths, count, codes);
+                    for (size_t i = 0; i < count; ++i) {
+                        const int len = lengths[i];
+                        if (len == 0 || len > fast_bits) {
+                            continue;
+                        }
+                        const auto entry = static_cast<std::uint16_t>((i << 4) | static_cast<size_t>(len));
+                        for (std::uint32_t index = codes[i]; index < fast_.size(); index += 1u << len) {
+                            fast_[index] = entry;
+                        }
+                    }
+                }
+
+                /// Entry for the next fast_bits input bits: symbol << 4 | length, 0 if longer
+                [[nodiscard]] std::uint16_t fast_entry(std::uint32_t bits) const {
+                    return fast_[bits & (fast_.size() - 1)];
+                }
+
+                /**
+                 * Slow path: bit(i) returns input bit i; returns {symbol, length}
+                 */
+                template<typename BitFn>
+                std::pair <int, int> decode_slow(BitFn&& bit) const {
+                    int code = 0;
+                    int first = 0;
+                    int index = 0;
+                    for (int len = 1; len <= max_code_bits; ++len) {
+                        code |= bit(len - 1);
+                        const int count = counts_[len];
+                        if (code - count < first) {
+                            return {symbols_[static_cast<size_t>(index + code - first)], len};
+                        }
+                        index += count;
+                        first = (first + count) << 1;
+                        code <<= 1;
+                    }
+                    throw zlib_error("invalid Huffman code");
+                }
+
+            private:
+                std::uint16_t counts_[max_code_bits + 1] = {};
+                std::vector <std::uint16_t> symbols_;
+                std::array <std::uint16_t, 1u << fast_bits> fast_{};
+        };
+
+    } // namespace detail
+
+    /**
+     * Incremental deflate/zlib decompressor
+     *
+     * Compressed bytes are pulled from a source callback as output is
+     * requested, so neither side has to be held in memory: apart from the
+     * 32 KiB history window, memory use does not depend on the stream size.
+     *
+     * @code
+     * io::inflater inflate([&](std::uint8_t* buffer, size_t capacity) {
+     *     return std::fread(buffer, 1, capacity, file);
+     * });
+     * while (size_t n = inflate.read(row.data(), row.size())) { ... }
+     * @endcode
+     */
+    class inflater {
+        public:
+            /// Fills up to capacity bytes and returns the count; 0 means end of input
+            using source = std::function <size_t(std::uint8_t* buffer, size_t capacity)>;
+
+            explicit inflater(source input, deflate_format format = deflate_format::zlib)
+                : input_(std::move(input)),
+                  format_(format),
+                  window_(detail::deflate_window),
+                  buffer_(16384) {
+            }
+
+            /**
+             * Decompress up to size bytes into out
+             * @return Bytes produced; less than size only at the end of the stream
+             * @throws zlib_error on corrupt or truncated data or a checksum mismatch
+             */
+            size_t read(std::uint8_t* out, size_t size) {
+                size_t produced = 0;
+                size_t checksummed = 0;
+                while (produced < size && state_ != state::done) {
+                    if (copy_length_ > 0) {
+                        const size_t run = std::min(size - produced, copy_length_);
+                        for (size_t i = 0; i < run; ++i) {
+                            out[produced++] = emit(window_[(window_pos_ - copy_distance_) & window_mask]);
+                        }
+                        copy_length_ -= run;
+                        continue;
+                    }
+
+                    switch (state_) {
+                        case state::header:
+                            read_header();
+                            break;
+                        case state::block_header:
+                            // The trailer check needs the checksum of everything produced
+                            checksum_ = adler32(out + checksummed, produced - checksummed, checksum_);
+                            checksummed = produced;
+                            read_block_header();
+                            break;
+                        case state::stored:
+                            if (stored_remaining_ == 0) {
+                                state_ = state::block_header;
+                                break;
+                            }
+                            while (stored_remaining_ > 0 && produced < size) {
+                                out[produced++] = emit(static_cast<std::uint8_t>(take_bits(8)));
+                                --stored_remaining_;
+                            }
+                            break;
+                        case state::huffman:
+                            produced += decode_symbols(out + produced, size - produced);
+                            break;
+                        case state::done:
+                            break;
+                    }
+                }
+
+                checksum_ = adler32(out + checksummed, produced - checksummed, checksum_);
+                return produced;
+            }
+
+            /**
+             * Consume the end of the stream and verify its trailer
+             * @return false if the stream holds more data than was read
+             */
+            bool finish() {
+                std::uint8_t extra = 0;
+                return read(&extra, 1) == 0;
+            }
+
+            /**
+             * Whether the end of the stream (and its trailer) has been reached
+             */
+            [[nodiscard]] bool finished() const {
+                return state_ == state::done;
+            }
+
+            /**
+             * Bytes decompressed so far
+             */
+            [[nodiscard]] std::uint64_t total_out() const {
+                return total_out_;
+            }
+
+        private:
+            enum class state { header, block_header, stored, huffman, done };
+            static constexpr size_t window_mask = detail::deflate_window - 1;
+
+            std::uint8_t emit(std::uint8_t byte) {
+                window_[window_pos_] = byte;
+                window_pos_ = (window_pos_ + 1) & window_mask;
+                ++total_out_;
+                return byte;
+            }
+
+            bool pull_byte() {
+                if (buffer_pos_ == buffer_size_) {
+                    if (input_exhausted_) {
+                        return false;
+                    }
+                    buffer_size_ = input_(buffer_.data(), buffer_.size());
+                    buffer_pos_ = 0;
+                    if (buffer_size_ == 0) {
+                        input_exhausted_ = true;
+                        return false;
+                    }
+                }
+                bits_ |= static_cast<std::uint64_t>(buffer_[buffer_pos_++]) << bit_count_;
+                bit_count_ += 8;
+                return true;
+            }
+
+            void need_bits(int count) {
+                while (bit_count_ < count) {
+                    if (!pull_byte()) {
+                        throw zlib_error("unexpected end of compressed data");
+                    }
+                }
+            }
+
+            // Top up without failing at the end of input (for table lookups)
+            void fill_bits() {
+                while (bit_count_ <= 56 && pull_byte()) {
+                }
+            }
+
+            std::uint32_t take_bits(int count) {
+                need_bits(count);
+                const auto value = static_cast<std::uint32_t>(bits_ & ((std::uint64_t{1} << count) - 1));
+                bits_ >>= count;
+                bit_count_ -= count;
+                return value;
+            }
+
+            void align_to_byte() {
+                take_bits(bit_count_ % 8);
+            }
+
+            int decode(const detail::huffman_decoder& decoder) {
+                if (bit_count_ < max_code_bits_) {
+                    fill_bits();
+                }
+                const std::uint16_t entry = decoder.fast_entry(static_cast<std::uint32_t>(bits_));
+                const int length = entry & 0xF;
+                if (length != 0 && length <= bit_count_) {
+                    bits_ >>= length;
+                    bit_count_ -= length;
+                    return entry >> 4;
+                }
+
+                const auto [symbol, bits] = decoder.decode_slow([this](int index) {
+                    need_bits(index + 1);
+                    return static_cast<int>((bits_ >> index) & 1u);
+                });
+                bits_ >>= bits;
+                bit_count_ -= bits;
+                return symbol;
+            }
+
+            void read_header() {
+                if (format_ == deflate_format::zlib) {
+                    const std::uint32_t cmf = take_bits(8);
+                    const std::uint32_t flg = take_bits(8);
+                    if ((cmf & 0x0Fu) != 8 || (cmf >> 4) > 7 || ((cmf << 8) | flg) % 31 != 0) {
+                        throw zlib_error("invalid zlib header");
+                    }
+                    if (flg & 0x20u) {
+                        throw zlib_error("preset dictionaries are not supported");
+                    }
+                }
+                state_ = state::block_header;
+            }
+
+            void read_block_header() {
+                if (last_block_) {
+                    finish_stream();
+                    return;
+                }
+
+                last_block_ = take_bits(1) != 0;
+                switch (take_bits(2)) {
+                    case 0: {
+                        align_to_byte();
+                        const std::uint32_t length = take_bits(16);
+                        const std::uint32_t complement = take_bits(16);
+                        if ((length ^ 0xFFFFu) != complement) {
+                            throw zlib_error("stored block length mismatch");
+                        }
+                        stored_remaining_ = length;
+                        state_ = state::stored;
+                        break;
+                    }
+                    case 1:
+                        build_fixed_codes();
+                        state_ = state::huffman;
+                        break;
+                    case 2:
+                        read_dynamic_codes();
+                        state_ = state::huffman;
+                        break;
+                    default:
+                        throw zlib_error("invalid block type");
+                }
+            }
+
+            void finish_stream() {
+                if (format_ == deflate_format::zlib) {
+                    align_to_byte();
+                    std::uint32_t expected = 0;
+                    for (int i = 0; i < 4; ++i) {
+                        expected = (expected << 8) | take_bits(8);
+                    }
+                    if (expected != checksum_) {
+                        throw zlib_error("Adler-32 mismatch");
+                    }
+                }
+                state_ = state::done;
+            }
+
+            void build_fixed_codes() {
+                // Distance codes 30 and 31 complete the code but never occur
+                std::uint8_t lengths[288 + 32];
+                std::fill(lengths, lengths + 144, std::uint8_t{8});
+                std::fill(lengths + 144, lengths + 256, std::uint8_t{9});
+                std::fill(lengths + 256, lengths + 280, std::uint8_t{7});
+                std::fill(lengths + 280, lengths + 288, std::uint8_t{8});
+                std::fill(lengths + 288, lengths + 320, std::uint8_t{5});
+                literal_codes_.build(lengths, 288);
+                distance_codes_.build(lengths + 288, 32);
+            }
+
+            void read_dynamic_codes() {
+                const size_t literal_count = take_bits(5) + 257;
+                const size_t distance_count = take_bits(5) + 1;
+                const size_t code_length_count = take_bits(4) + 4;
+                if (literal_count > 286 || distance_count > 30) {
+                    throw zlib_error("too many length or distance codes");
+                }
+
+                std::uint8_t code_length_lengths[19] = {};
+                for (size_t i = 0; i < code_length_count; ++i) {
+                    code_length_lengths[detail::code_length_order[i]] = static_cast<std::uint8_t>(take_bits(3));
+                }
+                detail::huffman_decoder code_length_codes;
+                code_length_codes.build(code_length_lengths, 19);
+
+                std::uint8_t lengths[286 + 30] = {};
+                const size_t total = literal_count + distance_count;
+                size_t index = 0;
+                while (index < total) {
+                    const int symbol = decode(code_length_codes);
+                    if (symbol < 16) {
+                        lengths[index++] = static_cast<std::uint8_t>(symbol);
+                        continue;
+                    }
+
+                    std::uint8_t value = 0;
+                    size_t repeat = 0;
+                    if (symbol == 16) {
+                        if (index == 0) {
+                            throw zlib_error("repeat with no previous length");
+                        }
+                        value = lengths[index - 1];
+                        repeat = 3 + take_bits(2);
+                    } else if (symbol == 17) {
+                        repeat = 3 + take_bits(3);
+                    } else {
+                        repeat = 11 + take_bits(7);
+                    }
+                    if (index + repeat > total) {
+                        throw zlib_error("code lengths overflow");
+                    }
+                    std::fill(lengths + index, lengths + index + repeat, value);
+                    index += repeat;
+                }
+
+                if (lengths[256] == 0) {
+                    throw zlib_error("missing end-of-block code");
+                }
+                literal_codes_.build(lengths, literal_count);
+                distance_codes_.build(lengths + literal_count, distance_count);
+            }
+
+            size_t decode_symbols(std::uint8_t* out, size_t size) {
+                size_t produced = 0;
+                while (produced < size) {
+                    const int symbol = decode(literal_codes_);
+                    if (symbol < 256) {
+                        out[produced++] = emit(static_cast<std::uint8_t>(symbol));
+                        continue;
+                    }
+                    if (symbol == 256) {
+                        state_ = state::block_header;
+                        break;
+                    }
+
+                    const auto length_code = static_cast<size_t>(symbol - 257);
+                    if (length_code >= 29) {
+                        throw zlib_error("invalid length code");
+                    }
+                    const size_t length = detail::length_base[length_code] +
+                                          take_bits(detail::length_extra[length_code]);
+
+                    const auto distance_code = static_cast<size_t>(decode(distance_codes_));
+                    if (distance_code >= 30) {
+                        throw zlib_error("invalid distance code");
+                    }
+                    const size_t distance = detail::distance_base[distance_code] +
+                                            take_bits(detail::distance_extra[distance_code]);
+                    if (distance > total_out_) {
+                        throw zlib_error("distance beyond start of output");
+                    }
+
+                    copy_length_ = length;
+                    copy_distance_ = distance;
+                    break;
+                }
+                return produced;
+            }
+
+            static constexpr int max_code_bits_ = detail::max_code_bits;
+
+            source input_;
+            deflate_format format_;
+            state state_ = state::header;
+            bool last_block_ = false;
+
+            std::vector <std::uint8_t> window_;
+            size_t window_pos_ = 0;
+            std::uint64_t total_out_ = 0;
+            std::uint32_t checksum_ = 1;
+
+            std::vector <std::uint8_t> buffer_;
+            size_t buffer_pos_ = 0;
+            size_t buffer_size_ = 0;
+            bool input_exhausted_ = false;
+            std::uint64_t bits_ = 0;
+            int bit_count_ = 0;
+
+            size_t stored_remaining_ = 0;
+            size_t copy_length_ = 0;
+            size_t copy_distance_ = 0;
+            detail::huffman_decoder literal_codes_;
+            detail::huffman_decoder distance_codes_;
+    };
+
+    /**
+     * How far deflater::write() completes the stream
+     */
+    enum class deflate_flush {
+        none,  ///< Buffer input; blocks are emitted as they fill
+        sync,  ///< Emit all buffered input and byte-align with an empty stored block
+        finish ///< Emit everything, mark the last block and write the trailer
+    };
+
+    /**
+     * Streaming deflate/zlib compressor
+     *
+     * LZ77 over hash chains with lazy matching, each block coded with
+     * whichever of dynamic Huffman, fixed Huffman or stored is smallest.
+     * Levels follow zlib: 0 stores, 1 is fastest, 9 searches hardest.
+     */
+    class deflater {
+        public:
+            explicit deflater(int level = 6, deflate_format format = deflate_format::zlib)
+                : level_(std::clamp(level, 0, 9)),
+                  format_(format) {
+            }
+
+            /**
+             * Prime the match window with data that precedes the stream
+             * (raw streams only; the data itself is not emitted)
+             */
+            void set_dictionary(const std::uint8_t* data, size_t size) {
+                if (size > detail::deflate_window) {
+                    data += size - detail::deflate_window;
+                    size = detail::deflate_window;
+                }
+                history_.assign(data, data + size);
+            }
+
+            /**
+             * Compress size bytes, appending whatever output is complete to out
+             */
+            void write(const std::uint8_t* data, size_t size, std::vector <std::uint8_t>& out,
+                       deflate_flush flush = deflate_flush::none) {
+                write_header(out);
+                checksum_ = adler32(data, size, checksum_);
+
+                while (size > 0) {
+                    const size_t take = std::min(size, block_size - pending_.size());
+                    pending_.insert(pending_.end(), data, data + take);
+                    data += take;
+                    size -= take;
+                    if (pending_.size() == block_size) {
+                        compress_block(out, false);
+                    }
+                }
+
+                if (flush == deflate_flush::none) {
+                    return;
+                }
+
+                const bool last = flush == deflate_flush::finish;
+                if (!pending_.empty() || last) {
+                    compress_block(out, last);
+                }
+                if (last) {
+                    bits_.align(out);
+                    if (format_ == deflate_format::zlib) {
+                        for (int shift = 24; shift >= 0; shift -= 8) {
+                            out.push_back(static_cast<std::uint8_t>(checksum_ >> shift));
+                        }
+                    }
+                } else {
+                    // Empty stored block: byte-aligns the output
+                    bits_.put(out, 0, 3);
+                    bits_.align(out);
+                    out.insert(out.end(), {0x00, 0x00, 0xFF, 0xFF});
+                }
+            }
+
+            /**
+             * Adler-32 of all data written so far
+             */
+            [[nodiscard]] std::uint32_t checksum() const {
+                return checksum_;
+            }
+
+            [[nodiscard]] int level() const {
+                return level_;
+            }
+
+            /**
+             * The two zlib header bytes for a level
+             */
+            static std::array <std::uint8_t, 2> zlib_header(int level) {
+                const std::uint32_t level_bits = level <= 1 ? 0u : level <= 5 ? 1u : level == 6 ? 2u : 3u;
+                std::uint32_t header = (0x78u << 8) | (level_bits << 6);
+                header += 31 - header % 31;
+                return {static_cast<std::uint8_t>(header >> 8), static_cast<std::uint8_t>(header)};
+            }
+
+        private:
+            static constexpr size_t block_size = 65536;
+            static constexpr size_t hash_bits = 15;
+            static constexpr size_t min_match = 3;
+            static constexpr size_t max_match = 258;
+            // Length-3 matches farther than this cost more than three literals
+            static constexpr size_t too_far = 4096;
+
+            struct symbol {
+                std::uint16_t length_or_literal;
+                std::uint16_t distance; ///< 0 for literals
+            };
+
+            struct level_config {
+                int max_chain;
+                size_t nice_length;
+                bool lazy;
+            };
+
+            [[nodiscard]] level_config config() const {
+                static constexpr level_config table[10] = {
+                    {0, 0, false}, {4, 8, false}, {8, 16, false}, {16, 32, false},
+                    {16, 32, true}, {32, 64, true}, {128, 128, true}, {256, 128, true},
+                    {1024, 258, true}, {4096, 258, true}
+                };
+                return table[level_];
+            }
+
+            void write_header(std::vector <std::uint8_t>& out) {
+                if (header_written_) {
+                    return;
+                }
+                header_written_ = true;
+                if (format_ == deflate_format::zlib) {
+                    const auto header = zlib_header(level_);
+                    out.insert(out.end(), header.begin(), header.end());
+                }
+            }
+
+            static size_t hash_at(const std::uint8_t* p) {
+                const std::uint32_t v = (static_cast<std::uint32_t>(p[0]) << 16) |
+                                        (static_cast<std::uint32_t>(p[1]) << 8) | p[2];
+                return (v * 2654435761u) >> (32 - hash_bits);
+            }
+
+            void compress_block(std::vector <std::uint8_t>& out, bool last) {
+                if (level_ == 0) {
+                    emit_stored(out, pending_.data(), pending_.size(), last);
+                } else {
+                    // Matches may reach back into the history window
+                    std::vector <std::uint8_t> data;
+                    data.reserve(history_.size() + pending_.size());
+                    data.insert(data.end(), history_.begin(), history_.end());
+                    data.insert(data.end(), pending_.begin(), pending_.end());
+                    const size_t start = history_.size();
+
+                    symbols_.clear();
+                    find_matches(data, start);
+                    emit_huffman(out, data.data() + start, data.size() - start, last);
+                }
+
+                const size_t keep = std::min(detail::deflate_window, history_.size() + pending_.size());
+                if (pending_.size() >= keep) {
+                    history_.assign(pending_.end() - static_cast<std::ptrdiff_t>(keep), pending_.end());
+                } else {
+                    history_.erase(history_.begin(),
+                                   history_.end() - static_cast<std::ptrdiff_t>(keep - pending_.size()));
+                    history_.insert(history_.end(), pending_.begin(), pending_.end());
+                }
+                pending_.clear();
+            }
+
+            void find_matches(const std::vector <std::uint8_t>& data, size_t start) {
+                const level_config cfg = config();
+                const size_t end = data.size();
+                head_.assign(size_t{1} << hash_bits, -1);
+                prev_.assign(end, -1);
+
+                const auto insert = [&](size_t pos) {
+                    if (pos + min_match <= end) {
+                        const size_t h = hash_at(&data[pos]);
+                        prev_[pos] = head_[h];
+                        head_[h] = static_cast<std::int32_t>(pos);
+                    }
+                };
+
+                const auto longest_match = [&](size_t pos, size_t& distance) {
+                    const size_t limit = std::min(max_match, end - pos);
+                    if (limit < min_match) {
+                        return size_t{0};
+                    }
+                    size_t best = 0;
+                    int chain = cfg.max_chain;
+                    for (std::int32_t candidate = head_[hash_at(&data[pos])];
+                         candidate >= 0 && chain-- > 0; candidate = prev_[static_cast<size_t>(candidate)]) {
+                        const auto cand = static_cast<size_t>(candidate);
+                        if (pos - cand > detail::deflate_window) {
+                            break;
+                        }
+                        if (data[cand + best] != data[pos + best]) {
+                            continue;
+                        }
+                        size_t len = 0;
+                        while (len < limit && data[cand + len] == data[pos + len]) {
+                            ++len;
+                        }
+                        if (len > best) {
+                            best = len;
+                            distance = pos - cand;
+                            if (len >= cfg.nice_length || len == limit) {
+                                break;
+                            }
+                        }
+                    }
+                    if (best == min_match && distance > too_far) {
+                        return size_t{0};
+                    }
+                    return best >= min_match ? best : size_t{0};
+                };
+
+                for (size_t pos = 0; pos < start; ++pos) {
+                    insert(pos);
+                }
+
+                size_t pos = start;
+                size_t prev_length = 0;
+                size_t prev_distance = 0;
+                while (pos < end) {
+                    size_t distance = 0;
+                    const size_t length = longest_match(pos, distance);
+                    insert(pos);
+
+                    if (prev_length > 0 && prev_length >= length) {
+                        // The match found one byte earlier wins
+                        add_match(prev_length, prev_distance);
+                        const size_t match_end = pos - 1 + prev_length;
+                        for (size_t p = pos + 1; p < match_end; ++p) {
+                            insert(p);
+                        }
+                        pos = match_end;
+                        prev_length = 0;
+                        continue;
+                    }
+                    if (prev_length > 0) {
+                        add_literal(data[pos - 1]);
+                        prev_length = 0;
+                    }
+
+                    if (length > 0 && cfg.lazy && length < cfg.nice_length) {
+                        prev_length = length;
+                        prev_distance = distance;
+                        ++pos;
+                    } else if (length > 0) {
+                        add_match(length, distance);
+                        for (size_t p = pos + 1; p < pos + length; ++p) {
+                            insert(p);
+                        }
+                        pos += length;
+                    } else {
+                        add_literal(data[pos]);
+                        ++pos;
+                    }
+                }
+                if (prev_length > 0) {
+                    add_match(prev_length, prev_distance);
+                }
+            }
+
+            void add_literal(std::uint8_t value) {
+                symbols_.push_back({value, 0});
+            }
+
+            void add_match(size_t length, size_t distance) {
+                symbols_.push_back({static_cast<std::uint16_t>(length), static_cast<std::uint16_t>(distance)});
+            }
+
+            static size_t length_code(size_t length) {
+                size_t code = 28;
+                while (detail::length_base[code] > length) {
+                    --code;
+                }
+                return code;
+            }
+
+            static size_t distance_code(size_t distance) {
+                size_t code = 29;
+                while (detail::distance_base[code] > distance) {
+                    --code;
+                }
+                return code;
+            }
+
+            void emit_stored(std::vector <std::uint8_t>& out, const std::uint8_t* data, size_t size, bool last) {
+                do {
+                    const size_t run = std::min <size_t>(size, 65535);
+                    const bool final_piece = last && run == size;
+                    bits_.put(out, final_piece ? 1u : 0u, 3);
+                    bits_.align(out);
+                    const auto len = static_cast<std::uint16_t>(run);
+                    const auto nlen = static_cast<std::uint16_t>(~len);
+                    out.insert(out.end(), {static_cast<std::uint8_t>(len), static_cast<std::uint8_t>(len >> 8),
+                                           static_cast<std::uint8_t>(nlen), static_cast<std::uint8_t>(nlen >> 8)});
+                    out.insert(out.end(), data, data + run);
+                    data += run;
+                    size -= run;
+                } while (size > 0);
+            }
+
+            void emit_huffman(std::vector <std::uint8_t>& out, const std::uint8_t* raw, size_t raw_size, bool last) {
+                std::uint32_t literal_freq[286] = {};
+                std::uint32_t distance_freq[30] = {};
+                std::uint64_t extra_bits = 0;
+                for (const symbol& s : symbols_) {
+                    if (s.distance == 0) {
+                        ++literal_freq[s.length_or_literal];
+                    } else {
+                        const size_t lc = length_code(s.length_or_literal);
+                        const size_t dc = distance_code(s.distance);
+                        ++literal_freq[257 + lc];
+                        ++distance_freq[dc];
+                        extra_bits += detail::length_extra[lc] + detail::distance_extra[dc];
+                    }
+                }
+                literal_freq[256] = 1;
+
+                std::uint8_t literal_lengths[288] = {};
+                std::uint8_t distance_lengths[30];
+                detail::build_code_lengths(literal_freq, 286, detail::max_code_bits, literal_lengths);
+                detail::build_code_lengths(distance_freq, 30, detail::max_code_bits, distance_lengths);
+                if (std::all_of(distance_lengths, distance_lengths + 30, [](std::uint8_t l) { return l == 0; })) {
+                    distance_lengths[0] = 1;
+                }
+
+                // Run-length code the lengths for the dynamic block header
+                size_t literal_count = 286;
+                while (literal_count > 257 && literal_lengths[literal_count - 1] == 0) {
+                    --literal_count;
+                }
+                size_t distance_count = 30;
+                while (distance_count > 1 && distance_lengths[distance_count - 1] == 0) {
+                    --distance_count;
+                }
+                std::vector <std::uint8_t> all_lengths(literal_lengths, literal_lengths + literal_count);
+                all_lengths.insert(all_lengths.end(), distance_lengths, distance_lengths + distance_count);
+
+                std::vector <std::pair <std::uint8_t, std::uint8_t>> rle; // symbol, extra value
+                std::uint32_t code_length_freq[19] = {};
+                for (size_t i = 0; i < all_lengths.size();) {
+                    const std::uint8_t value = all_lengths[i];
+                    size_t run = 1;
+                    while (i + run < all_lengths.size() && all_lengths[i + run] == value) {
+                        ++run;
+                    }
+                    i += run;
+                    if (value == 0) {
+                        while (run >= 11) {
+                            const size_t n = std::min <size_t>(run, 138);
+                            rle.emplace_back(18, static_cast<std::uint8_t>(n - 11));
+                            run -= n;
+                        }
+                        if (run >= 3) {
+                            rle.emplace_back(17, static_cast<std::uint8_t>(run - 3));
+                            run = 0;
+                        }
+                    } else {
+                        rle.emplace_back(value, 0);
+                        --run;
+                        while (run >= 3) {
+                            const size_t n = std::min <size_t>(run, 6);
+                            rle.emplace_back(16, static_cast<std::uint8_t>(n - 3));
+                            run -= n;
+                        }
+                    }
+                    for (; run > 0; --run) {
+                        rle.emplace_back(value, 0);
+                    }
+                }
+                for (const auto& [code, extra] : rle) {
+                    ++code_length_freq[code];
+                }
+                std::uint8_t code_length_lengths[19];
+                detail::build_code_lengths(code_length_freq, 19, 7, code_length_lengths);
+                size_t code_length_count = 19;
+                while (code_length_count > 4 &&
+                       code_length_lengths[detail::code_length_order[code_length_count - 1]] == 0) {
+                    --code_length_count;
+                }
+
+                // Pick the cheapest block type
+                // Symbols 286 and 287 never occur but take part in the fixed code
+                std::uint8_t fixed_lengths[288 + 30];
+                std::fill(fixed_lengths, fixed_lengths + 144, std::uint8_t{8});
+                std::fill(fixed_lengths + 144, fixed_lengths + 256, std::uint8_t{9});
+                std::fill(fixed_lengths + 256, fixed_lengths + 280, std::uint8_t{7});
+                std::fill(fixed_lengths + 280, fixed_lengths + 288, std::uint8_t{8});
+                std::fill(fixed_lengths + 288, fixed_lengths + 318, std::uint8_t{5});
+
+                std::uint64_t dynamic_bits = 3 + 14 + 3 * code_length_count + extra_bits;
+                std::uint64_t fixed_bits = 3 + extra_bits;
+                for (size_t i = 0; i < 286; ++i) {
+                    dynamic_bits += std::uint64_t{literal_freq[i]} * literal_lengths[i];
+                    fixed_bits += std::uint64_t{literal_freq[i]} * fixed_lengths[i];
+                }
+                for (size_t i = 0; i < 30; ++i) {
+                    dynamic_bits += std::uint64_t{distance_freq[i]} * distance_lengths[i];
+                    fixed_bits += std::uint64_t{distance_freq[i]} * 5;
+                }
+                for (const auto& [code, extra] : rle) {
+                    dynamic_bits += code_length_lengths[code] + (code == 16 ? 2u : code == 17 ? 3u : code == 18 ? 7u : 0u);
+                }
+                const std::uint64_t stored_bits = 3 + 7 + (raw_size / 65535 + 1) * 32 + std::uint64_t{raw_size} * 8;
+
+                if (stored_bits <= dynamic_bits && stored_bits <= fixed_bits) {
+                    emit_stored(out, raw, raw_size, last);
+                    return;
+                }
+
+                std::uint16_t literal_codes[288];
+                std::uint16_t distance_codes[30];
+                size_t literal_alphabet = 286;
+                if (fixed_bits <= dynamic_bits) {
+                    bits_.put(out, (last ? 1u : 0u) | (1u << 1), 3);
+                    std::copy(fixed_lengths, fixed_lengths + 288, literal_lengths);
+                    std::copy(fixed_lengths + 288, fixed_lengths + 318, distance_lengths);
+                    literal_alphabet = 288;
+                } else {
+                    bits_.put(out, (last ? 1u : 0u) | (2u << 1), 3);
+                    bits_.put(out, static_cast<std::uint32_t>(literal_count - 257), 5);
+                    bits_.put(out, static_cast<std::uint32_t>(distance_count - 1), 5);
+                    bits_.put(out, static_cast<std::uint32_t>(code_length_count - 4), 4);
+                    for (size_t i = 0; i < code_length_count; ++i) {
+                        bits_.put(out, code_length_lengths[detail::code_length_order[i]], 3);
+                    }
+                    std::uint16_t code_length_codes[19];
+                    detail::canonical_codes(code_length_lengths, 19, code_length_codes);
+                    for (const auto& [code, extra] : rle) {
+                        bits_.put(out, code_length_codes[code], code_length_lengths[code]);
+                        if (code >= 16) {
+                            bits_.put(out, extra, code == 16 ? 2 : code == 17 ? 3 : 7);
+                        }
+                    }
+                }
+                detail::canonical_codes(literal_lengths, literal_alphabet, literal_codes);
+                detail::canonical_codes(distance_lengths, 30, distance_codes);
+
+                for (const symbol& s : symbols_) {
+                    if (s.distance == 0) {
+                        bits_.put(out, literal_codes[s.length_or_literal], literal_lengths[s.length_or_literal]);
+                        continue;
+                    }
+                    const size_t lc = length_code(s.length_or_literal);
+                    const size_t dc = distance_code(s.distance);
+                    bits_.put(out, literal_codes[257 + lc], literal_lengths[257 + lc]);
+                    bits_.put(out, static_cast<std::uint32_t>(s.length_or_literal - detail::length_base[lc]),
+                              detail::length_extra[lc]);
+                    bits_.put(out, distance_codes[dc], distance_lengths[dc]);
+                    bits_.put(out, static_cast<std::uint32_t>(s.distance - detail::distance_base[dc]),
+                              detail::distance_extra[dc]);
+                }
+                bits_.put(out, literal_codes[256], literal_lengths[256]);
+            }
+
+            int level_;
+            deflate_format format_;
+            bool header_written_ = false;
+            std::uint32_t checksum_ = 1;
+            detail::bit_writer bits_;
+
+            std::vector <std::uint8_t> history_;
+            std::vector <std::uint8_t> pending_;
+            std::vector <symbol> symbols_;
+            std::vector <std::int32_t> head_;
+            std::vector <std::int32_t> prev_;
+    };
+
+} // namespace scaler::io
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <scaler/image_base.hh>
+#include <scaler/vec3.hh>
+#include <cstdint>
+#include <vector>
+
+namespace scaler::ipc {
+
+    /**
+     * Interleaved 8-bit RGB or RGBA image over memory it does not own,
+     * typically a slot of a shared frame ring
+     *
+     * Scalers read and write the color channels; alpha is left untouched.
+     * The (width, height, template) constructor allocates an owned buffer
+     * and exists only so the dispatcher can create scratch images for
+     * multi-pass algorithms.
+     */
+    class frame_image : public input_image_base <frame_image, vec3 <std::uint8_t>>,
+                        public output_image_base <frame_image, vec3 <std::uint8_t>> {
+        public:
+            using pixel_type = vec3 <std::uint8_t>;
+            using input_image_base <frame_image, pixel_type>::width;
+            using input_image_base <frame_image, pixel_type>::height;
+
+            frame_image(std::uint8_t* pixels, size_t width, size_t height, int channels)
+                : pixels_(pixels),
+                  width_(width),
+                  height_(height),
+                  channels_(static_cast<size_t>(channels)) {
+            }
+
+            template<typename Source>
+            frame_image(size_t width, size_t height, const Source&)
+                : storage_(width * height * 3),
+                  pixels_(storage_.data()),
+                  width_(width),
+                  height_(height),
+                  channels_(3) {
+            }
+
+            frame_image(frame_image&& other) noexcept = default;
+            frame_image& operator=(frame_image&& other) noexcept = default;
+            frame_image(const frame_image&) = delete;
+            frame_image& operator=(const frame_image&) = delete;
+
+            [[nodiscard]] size_t width_impl() const { return width_; }
+            [[nodiscard]] size_t height_impl() const { return height_; }
+
+            [[nodiscard]] pixel_type get_pixel_impl(size_t x, size_t y) const {
+                const std::uint8_t* p = pixels_ + (y * width_ + x) * channels_;
+                return {p[0], p[1], p[2]};
+            }
+
+            void set_pixel_impl(size_t x, size_t y, const pixel_type& pixel) {
+                std::uint8_t* p = pixels_ + (y * width_ + x) * channels_;
+                p[0] = pixel.x;
+                p[1] = pixel.y;
+                p[2] = pixel.z;
+            }
+
+            [[nodiscard]] int channels() const { return static_cast<int>(channels_); }
+            [[nodiscard]] size_t row_bytes() const { return width_ * channels_; }
+            [[nodiscard]] std::uint8_t* data() const { return pixels_; }
+            [[nodiscard]] std::uint8_t* row(size_t y) const { return pixels_ + y * row_bytes(); }
+
+        private:
+            std::vector <std::uint8_t> storage_;
+            std::uint8_t* pixels_;
+            size_t width_;
+            size_t height_;
+            size_t channels_;
+    };
+
+} // namespace scaler::ipc
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace scaler::ipc {
+
+    /**
+     * Exception for socket, shared memory and protocol errors of the
+     * scaling daemon and its clients
+     */
+    class ipc_error : public std::runtime_error {
+    public:
+        explicit ipc_error(const std::string& what)
+            : std::runtime_error("IPC Error: " + what) {}
+    };
+
+    /**
+     * ipc_error for a failed system call, with errno's description appended
+     */
+    class ipc_system_error : public ipc_error {
+    public:
+        ipc_system_error(const std::string& call, int error_number)
+            : ipc_error(call + ": " + std::strerror(error_number)),
+              error_number_(error_number) {}
+
+        [[nodiscard]] int error_number() const { return error_number_; }
+
+    private:
+        int error_number_;
+    };
+
+} // namespace scaler::ipc
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <scaler/algorithm.hh>
+#include <scaler/ipc/ipc_exceptions.hh>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+namespace scaler::ipc {
+
+    inline constexpr std::uint32_t protocol_version = 1;
+
+    /**
+     * Messages exchanged over the daemon socket
+     *
+     * hello (client -> server, carries the ring's memfd): slot_count,
+     *     slot_bytes, priority
+     * ready (server -> client): hello accepted
+     * scale (client -> server): slot, sequence, algorithm, scale, width,
+     *     height, channels of the input in that slot
+     * done / failed (server -> client): slot, sequence; failed has error
+     */
+    enum class message_type : std::uint32_t {
+        hello = 1,
+        ready,
+        scale,
+        done,
+        failed
+    };
+
+    /**
+     * The one fixed-size message of the protocol
+     */
+    struct message {
+        message_type type = message_type::hello;
+        std::uint32_t version = protocol_version;
+        std::uint64_t sequence = 0;
+        std::uint32_t slot = 0;
+        std::uint32_t slot_count = 0;
+        std::uint64_t slot_bytes = 0;
+        std::int32_t priority = 0;
+        std::uint32_t algo = 0;
+        float scale = 0.0f;
+        std::uint32_t width = 0;
+        std::uint32_t height = 0;
+        std::uint32_t channels = 0;
+        char error[128] = {};
+
+        void set_error(const std::string& text) {
+            const size_t size = std::min(text.size(), sizeof(error) - 1);
+            std::memcpy(error, text.data(), size);
+            error[size] = '\0';
+        }
+    };
+    static_assert(std::is_trivially_copyable_v <message>, "message is sent as raw bytes");
+
+    /**
+     * Placement of a request's input and output inside one ring slot
+     *
+     * Input rows come first; the output starts at the next 64-byte boundary
+     * so the two never share a cache line.
+     */
+    struct slot_layout {
+        size_t input_bytes = 0;
+        size_t output_offset = 0;
+        size_t output_width = 0;
+        size_t output_height = 0;
+        size_t output_bytes = 0;
+
+        [[nodiscard]] size_t total() const { return output_offset + output_bytes; }
+    };
+
+    namespace detail {
+        // a * b, refusing products that do not fit size_t
+        inline size_t checked_multiply(size_t a, size_t b) {
+            if (b != 0 && a > std::numeric_limits <size_t>::max() / b) {
+                throw ipc_error("frame size overflows");
+            }
+            return a * b;
+        }
+    }
+
+    /**
+     * Output size follows unified_scaler::calculate_output_dimensions()
+     *
+     * The arguments may come straight from an untrusted request, so every
+     * size is validated before it is used.
+     * @throws ipc_error for empty frames, a scale that is not finite and
+     *         positive, or sizes that overflow
+     */
+    inline slot_layout make_slot_layout(size_t width, size_t height, int channels, float scale_factor) {
+        if (width == 0 || height == 0 || channels <= 0) {
+            throw ipc_error("empty frame");
+        }
+        if (!std::isfinite(scale_factor) || scale_factor <= 0.0f) {
+            throw ipc_error("invalid scale factor");
+        }
+        // Output dimensions travel as 32-bit values; larger ones cannot be valid
+        constexpr double max_dimension = std::numeric_limits <std::uint32_t>::max();
+        const double output_width = static_cast<double>(static_cast<float>(width) * scale_factor);
+        const double output_height = static_cast<double>(static_cast<float>(height) * scale_factor);
+        if (!(output_width >= 1.0 && output_width <= max_dimension &&
+              output_height >= 1.0 && output_height <= max_dimension)) {
+            throw ipc_error("invalid output size");
+        }
+
+        const auto bytes_per_pixel = static_cast<size_t>(channels);
+        slot_layout layout;
+        layout.input_bytes = detail::checked_multiply(detail::checked_multiply(width, height), bytes_per_pixel);
+        if (layout.input_bytes > std::numeric_limits <size_t>::max() - 63) {
+            throw ipc_error("frame size overflows");
+        }
+        layout.output_offset = (layout.input_bytes + 63) & ~size_t{63};
+        layout.output_width = static_cast<size_t>(output_width);
+        layout.output_height = static_cast<size_t>(output_height);
+        layout.output_bytes = detail::checked_multiply(
+            detail::checked_multiply(layout.output_width, layout.output_height), bytes_per_pixel);
+        if (layout.output_bytes > std::numeric_limits <size_t>::max() - layout.output_offset) {
+            throw ipc_error("frame size overflows");
+        }
+        return layout;
+    }
+
+} // namespace scaler::ipc
@@ -0,0 +1,304 @@
+#pragma once
+
+#include <scaler/algorithm.hh>
+#include <scaler/unified_scaler.hh>
+#include <scaler/ipc/frame_image.hh>
+#include <scaler/ipc/ipc_exceptions.hh>
+#include <scaler/ipc/protocol.hh>
+#include <scaler/ipc/shared_memory.hh>
+#include <scaler/ipc/unix_socket.hh>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+namespace scaler::ipc {
+
+    struct client_options {
+        /// Frames that can be in flight at once
+        unsigned slot_count = 4;
+        /// Bytes per slot: input plus output of the largest frame
+        size_t slot_bytes = size_t{16} << 20;
+        /// Server-side queue priority of all requests (higher is served first)
+        std::int32_t priority = 0;
+    };
+
+    class scaler_client;
+
+    /**
+     * One slot of a client's frame ring
+     *
+     * Write the source pixels into input(), submit(), then read output()
+     * after wait(). The slot returns to the ring when the frame is destroyed.
+     */
+    class shared_frame {
+        public:
+            shared_frame(shared_frame&& other) noexcept
+                : client_(std::exchange(other.client_, nullptr)),
+                  slot_(other.slot_),
+                  width_(other.width_),
+                  height_(other.height_),
+                  channels_(other.channels_),
+                  sequence_(other.sequence_),
+                  layout_(other.layout_) {
+            }
+
+            shared_frame& operator=(shared_frame&&) = delete;
+            shared_frame(const shared_frame&) = delete;
+            shared_frame& operator=(const shared_frame&) = delete;
+
+            inline ~shared_frame();
+
+            /**
+             * Source pixels, width * height * channels bytes in the ring
+             */
+            [[nodiscard]] inline frame_image input() const;
+
+            /**
+             * Scaled pixels; valid after scaler_client::wait()
+             */
+            [[nodiscard]] inline frame_image output() const;
+
+            [[nodiscard]] unsigned slot() const { return slot_; }
+
+        private:
+            friend class scaler_client;
+
+            shared_frame(scaler_client* client, unsigned slot, size_t width, size_t height, int channels)
+                : client_(client), slot_(slot), width_(width), height_(height), channels_(channels) {
+            }
+
+            scaler_client* client_;
+            unsigned slot_;
+            size_t width_;
+            size_t height_;
+            int channels_;
+            std::uint64_t sequence_ = 0;
+            slot_layout layout_;
+    };
+
+    /**
+     * Connection to a scaler_server (scalerd)
+     *
+     * The client owns a ring of slot_count frame slots in a memfd that it
+     * shares with the server when connecting. Frames are written in place,
+     * so a request costs one small socket message each way.
+     *
+     * scale() mirrors unified_scaler for any image type, at the price of
+     * one copy into and out of the ring. The zero-copy path is
+     * acquire() / submit() / wait(), which also lets several frames be in
+     * flight at once.
+     *
+     * A client is not thread-safe; give each thread its own connection.
+     *
+     * @code
+     * ipc::scaler_client client("/run/user/1000/scalerd.sock");
+     * auto frame = client.acquire(256, 224);
+     * emulator.render_into(frame.input().data());
+     * client.submit(frame, algorithm::HQ, 3.0f);
+     * client.wait(frame);
+     * present(frame.output());
+     * @endcode
+     */
+    class scaler_client {
+        public:
+            /**
+             * Create the frame ring and register it with the server
+             * @throws ipc_error if the server cannot be reached or refuses the ring
+             */
+            explicit scaler_client(const std::string& socket_path, client_options options = {})
+                : options_(options),
+                  socket_(detail::connect_unix(socket_path)),
+                  ring_(shared_memory_region::create("scaler-frames", options.slot_count * options.slot_bytes)),
+                  slot_busy_(options.slot_count, false) {
+                message hello;
+                hello.type = message_type::hello;
+                hello.slot_count = options.slot_count;
+                hello.slot_bytes = options.slot_bytes;
+                hello.priority = options.priority;
+                detail::send_message(socket_.get(), hello, ring_.fd());
+
+                message reply;
+                if (!detail::receive_message(socket_.get(), reply) || reply.type != message_type::ready) {
+                    throw ipc_error("server refused the connection");
+                }
+            }
+
+            scaler_client(const scaler_client&) = delete;
+            scaler_client& operator=(const scaler_client&) = delete;
+
+            /**
+             * Reserve a free slot for a width x height frame
+             * @param channels 3 (RGB) or 4 (RGBA; alpha is not scaled)
+             * @throws ipc_error if every slot is in use
+             */
+            shared_frame acquire(size_t width, size_t height, int channels = 3) {
+                if (channels != 3 && channels != 4) {
+                    throw ipc_error("channels must be 3 or 4");
+                }
+                for (unsigned slot = 0; slot < slot_busy_.size(); ++slot) {
+                    if (!slot_busy_[slot]) {
+                        slot_busy_[slot] = true;
+                        return shared_frame(this, slot, width, height, channels);
+                    }
+                }
+                throw ipc_error("all " + std::to_string(slot_busy_.size()) + " frame slots are in use");
+            }
+
+            /**
+             * Queue the frame's input for scaling on the server
+             * @throws unsupported_scale_exception if algo does not support scale_factor
+             * @throws ipc_error if the output does not fit the slot
+             */
+            void submit(shared_frame& frame, algorithm algo, float scale_factor = 2.0f) {
+                if (!scaler_capabilities::is_scale_supported(algo, scale_factor)) {
+                    throw unsupported_scale_exception(algo, scale_factor,
+                                                      scaler_capabilities::get_supported_scales(algo));
+                }
+                frame.layout_ = make_slot_layout(frame.width_, frame.height_, frame.channels_, scale_factor);
+                if (frame.layout_.total() > options_.slot_bytes) {
+                    throw ipc_error("frame needs " + std::to_string(frame.layout_.total()) +
+                                    " bytes, slots have " + std::to_string(options_.slot_bytes));
+                }
+
+                message request;
+                request.type = message_type::scale;
+                request.sequence = frame.sequence_ = ++next_sequence_;
+                request.slot = frame.slot_;
+                request.algo = static_cast<std::uint32_t>(algo);
+                request.scale = scale_factor;
+                request.width = static_cast<std::uint32_t>(frame.width_);
+                request.height = static_cast<std::uint32_t>(frame.height_);
+                request.channels = static_cast<std::uint32_t>(frame.channels_);
+                detail::send_message(socket_.get(), request);
+            }
+
+            /**
+             * Block until the frame's request is complete
+             * @throws ipc_error if the server failed the request or went away
+             */
+            void wait(shared_frame& frame) {
+                if (frame.sequence_ == 0) {
+                    throw ipc_error("frame was not submitted");
+                }
+                while (finished_.find(frame.sequence_) == finished_.end()) {
+                    message reply;
+                    if (!detail::receive_message(socket_.get(), reply)) {
+                        throw ipc_error("server closed the connection");
+                    }
+                    finished_.emplace(reply.sequence, reply);
+                }
+
+                const message reply = finished_[frame.sequence_];
+                finished_.erase(frame.sequence_);
+                frame.sequence_ = 0;
+                if (reply.type != message_type::done) {
+                    throw ipc_error(std::string("server failed the request: ") + reply.error);
+                }
+            }
+
+            /**
+             * Scale through the server, like unified_scaler::scale(input, algo, scale)
+             */
+            template<typename OutputImage, typename InputImage>
+            OutputImage scale(const InputImage& input, algorithm algo, float scale_factor = 2.0f) {
+                shared_frame frame = run(input, algo, scale_factor);
+                OutputImage output(frame.layout_.output_width, frame.layout_.output_height, input);
+                copy_out(frame, output);
+                return output;
+            }
+
+            /**
+             * Scale into a preallocated image, like unified_scaler::scale(input, output, algo)
+             */
+            template<typename InputImage, typename OutputImage>
+            void scale(const InputImage& input, OutputImage& output, algorithm algo) {
+                const float scale_factor = static_cast<float>(output.width()) / static_cast<float>(input.width());
+                shared_frame frame = run(input, algo, scale_factor);
+                if (frame.layout_.output_width != output.width() || frame.layout_.output_height != output.height()) {
+                    throw dimension_mismatch_exception(algo, input.width(), input.height(),
+                                                       output.width(), output.height(),
+                                                       frame.layout_.output_width, frame.layout_.output_height);
+                }
+                copy_out(frame, output);
+            }
+
+            [[nodiscard]] unsigned slot_count() const { return static_cast<unsigned>(slot_busy_.size()); }
+            [[nodiscard]] size_t slot_bytes() const { return options_.slot_bytes; }
+
+        private:
+            friend class shared_frame;
+
+            template<typename InputImage>
+            shared_frame run(const InputImage& input, algorithm algo, float scale_factor) {
+                shared_frame frame = acquire(input.width(), input.height());
+                frame_image pixels = frame.input();
+                for (size_t y = 0; y < input.height(); ++y) {
+                    for (size_t x = 0; x < input.width(); ++x) {
+                        const auto p = input.get_pixel(x, y);
+                        pixels.set_pixel(x, y, {static_cast<std::uint8_t>(p.x), static_cast<std::uint8_t>(p.y),
+                                                static_cast<std::uint8_t>(p.z)});
+                    }
+                }
+                submit(frame, algo, scale_factor);
+                wait(frame);
+                return frame;
+            }
+
+            template<typename OutputImage>
+            static void copy_out(const shared_frame& frame, OutputImage& output) {
+                using pixel = typename OutputImage::pixel_type;
+                using component = std::decay_t <decltype(pixel{}.x)>;
+                const frame_image pixels = frame.output();
+                for (size_t y = 0; y < pixels.height(); ++y) {
+                    for (size_t x = 0; x < pixels.width(); ++x) {
+                        const auto p = pixels.get_pixel(x, y);
+                        output.set_pixel(x, y, pixel(static_cast<component>(p.x), static_cast<component>(p.y),
+                                                     static_cast<component>(p.z)));
+                    }
+                }
+            }
+
+            [[nodiscard]] std::uint8_t* slot_data(unsigned slot) const {
+                return ring_.data() + static_cast<size_t>(slot) * options_.slot_bytes;
+            }
+
+            void release(const shared_frame& frame) {
+                if (frame.sequence_ != 0) {
+                    // Still in flight: the server may be writing the slot
+                    try {
+                        shared_frame& pending = const_cast<shared_frame&>(frame);
+                        wait(pending);
+                    } catch (const ipc_error&) {
+                    }
+                }
+                slot_busy_[frame.slot_] = false;
+            }
+
+            client_options options_;
+            file_descriptor socket_;
+            shared_memory_region ring_;
+            std::vector <bool> slot_busy_;
+            std::uint64_t next_sequence_ = 0;
+            std::map <std::uint64_t, message> finished_;
+    };
+
+    inline shared_frame::~shared_frame() {
+        if (client_ != nullptr) {
+            client_->release(*this);
+        }
+    }
+
+    inline frame_image shared_frame::input() const {
+        return frame_image(client_->slot_data(slot_), width_, height_, channels_);
+    }
+
+    inline frame_image shared_frame::output() const {
+        return frame_image(client_->slot_data(slot_) + layout_.output_offset,
+                           layout_.output_width, layout_.output_height, channels_);
+    }
+
+} // namespace scaler::ipc
@@ -0,0 +1,465 @@
+#pragma once
+
+#include <scaler/algorithm.hh>
+#include <scaler/algorithm_capabilities.hh>
+#include <scaler/unified_scaler.hh>
+#include <scaler/ipc/frame_image.hh>
+#include <scaler/ipc/ipc_exceptions.hh>
+#include <scaler/ipc/protocol.hh>
+#include <scaler/ipc/shared_memory.hh>
+#include <scaler/ipc/unix_socket.hh>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace scaler::ipc {
+
+    struct server_options {
+        /// Worker threads shared by all clients, 0 = hardware concurrency
+        unsigned threads = 0;
+        /// Most requests one worker takes in a single batch
+        size_t max_batch = 8;
+        /// Largest ring a client may register (slot_count * slot_bytes)
+        size_t max_ring_bytes = size_t{1} << 30;
+        /// Highest priority honored for clients of another user (root and
+        /// the server's own user may register any priority)
+        std::int32_t max_foreign_priority = 0;
+    };
+
+    /**
+     * Counters for monitoring a running server
+     */
+    struct server_stats {
+        std::uint64_t clients_accepted = 0;
+        std::uint64_t requests = 0;
+        std::uint64_t failures = 0;
+        std::uint64_t batches = 0;
+    };
+
+    /**
+     * Scaling daemon: one worker pool serving many processes
+     *
+     * Clients connect to a Unix SOCK_SEQPACKET socket and register a ring of
+     * frame slots in a memfd (see scaler_client). A request names a slot;
+     * the server maps the ring once and scales the slot's input straight
+     * into the slot's output area, so pixel data is never copied between
+     * processes.
+     *
+     * Queued requests are ordered by the priority the client registered
+     * with (higher first), then by arrival. Clients running as another user
+     * (SO_PEERCRED) are clamped to max_foreign_priority. A worker that picks a request
+     * also takes up to max_batch - 1 further queued requests with the same
+     * algorithm, scale and frame size, from any client, and runs them back
+     * to back on a warm kernel.
+     *
+     * A client has at most slot_count requests in flight, counting replies
+     * it has not taken off its socket yet; beyond that the server stops
+     * reading from it. Replies are sent without blocking and wait in the
+     * client's outbox while its socket is full, so a client that stops
+     * reading only stalls itself.
+     *
+     * run() drives the socket on the calling thread until stop(), which is
+     * safe to call from any thread or a signal handler.
+     *
+     * @code
+     * ipc::scaler_server server("/run/user/1000/scalerd.sock");
+     * server.run();
+     * @endcode
+     */
+    class scaler_server {
+        public:
+            /**
+             * Bind the socket (an existing socket file at path is replaced)
+             * @throws ipc_error if the socket cannot be created
+             */
+            explicit scaler_server(const std::string& socket_path, server_options options = {})
+                : path_(socket_path),
+                  options_(options),
+                  listener_(detail::listen_unix(socket_path)),
+                  wake_(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+                if (!wake_.valid()) {
+                    throw ipc_system_error("eventfd", errno);
+                }
+                if (options_.threads == 0) {
+                    options_.threads = std::max(1u, std::thread::hardware_concurrency());
+                }
+                options_.max_batch = std::max <size_t>(options_.max_batch, 1);
+            }
+
+            scaler_server(const scaler_server&) = delete;
+            scaler_server& operator=(const scaler_server&) = delete;
+
+            ~scaler_server() {
+                stop_workers();
+                ::unlink(path_.c_str());
+            }
+
+            /**
+             * Serve clients until stop() is called
+             */
+            void run() {
+                start_workers();
+                while (!stopping_.load()) {
+                    std::vector <pollfd> fds;
+                    fds.push_back({listener_.get(), POLLIN, 0});
+                    fds.push_back({wake_.get(), POLLIN, 0});
+                    for (const auto& [fd, state] : clients_) {
+                        // Past its in-flight limit a client is not read from
+                        const bool readable = state->in_flight < std::max(state->slot_count, 1u);
+                        const bool writable = !state->outbox.empty();
+                        fds.push_back({fd, static_cast<short>((readable ? POLLIN : 0) | (writable ? POLLOUT : 0)), 0});
+                    }
+
+                    if (::poll(fds.data(), fds.size(), -1) < 0) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        throw ipc_system_error("poll", errno);
+                    }
+
+                    if (fds[1].revents != 0) {
+                        std::uint64_t count;
+                        [[maybe_unused]] const ssize_t n = ::read(wake_.get(), &count, sizeof(count));
+                        send_completions();
+                    }
+                    if ((fds[0].revents & POLLIN) != 0) {
+                        accept_client();
+                    }
+                    for (size_t i = 2; i < fds.size(); ++i) {
+                        if ((fds[i].revents & POLLOUT) != 0) {
+                            flush_client(fds[i].fd);
+                        }
+                        if ((fds[i].revents & POLLIN) != 0) {
+                            service_client(fds[i].fd);
+                        } else if ((fds[i].revents & (POLLHUP | POLLERR | POLLNVAL)) != 0) {
+                            clients_.erase(fds[i].fd);
+                        }
+                    }
+                }
+                stop_workers();
+                clients_.clear();
+            }
+
+            /**
+             * Make run() return; requests already being scaled are finished
+             */
+            void stop() {
+                stopping_.store(true);
+                const std::uint64_t one = 1;
+                [[maybe_unused]] const ssize_t n = ::write(wake_.get(), &one, sizeof(one));
+            }
+
+            [[nodiscard]] const std::string& socket_path() const { return path_; }
+            [[nodiscard]] unsigned threads() const { return options_.threads; }
+
+            [[nodiscard]] server_stats stats() const {
+                std::lock_guard <std::mutex> lock(mutex_);
+                return stats_;
+            }
+
+        private:
+            struct client_state {
+                std::uint64_t id = 0;
+                file_descriptor socket;
+                std::shared_ptr <shared_memory_region> ring;
+                std::uint32_t slot_count = 0;
+                std::uint64_t slot_bytes = 0;
+                std::int32_t priority = 0;
+                bool trusted = false;  ///< Root or the server's own user
+                std::uint32_t in_flight = 0;  ///< Queued, being scaled or in the outbox
+                std::deque <message> outbox;  ///< Replies the socket had no room for
+            };
+
+            struct job {
+                std::uint64_t client = 0;
+                std::shared_ptr <shared_memory_region> ring;  ///< Kept mapped until the job ends
+                std::uint32_t slot_count = 0;
+                std::uint64_t slot_bytes = 0;
+                message request;
+            };
+
+            struct completion {
+                std::uint64_t client;
+                message reply;
+            };
+
+            // Queue order: higher priority first, then arrival
+            using job_key = std::pair <std::int32_t, std::uint64_t>;
+
+            void start_workers() {
+                workers_stopping_ = false;
+                for (unsigned i = 0; i < options_.threads; ++i) {
+                    workers_.emplace_back([this] { worker_loop(); });
+                }
+            }
+
+            void stop_workers() {
+                {
+                    std::lock_guard <std::mutex> lock(mutex_);
+                    workers_stopping_ = true;
+                }
+                work_ready_.notify_all();
+                for (auto& worker : workers_) {
+                    worker.join();
+                }
+                workers_.clear();
+            }
+
+            void accept_client() {
+                file_descriptor fd(::accept4(listener_.get(), nullptr, nullptr, SOCK_CLOEXEC));
+                if (!fd.valid()) {
+                    return;
+                }
+                auto state = std::make_unique <client_state>();
+                state->id = ++next_client_;
+                ucred peer{};
+                socklen_t length = sizeof(peer);
+                if (::getsockopt(fd.get(), SOL_SOCKET, SO_PEERCRED, &peer, &length) == 0) {
+                    state->trusted = peer.uid == 0 || peer.uid == ::geteuid();
+                }
+                state->socket = std::move(fd);
+                clients_.emplace(state->socket.get(), std::move(state));
+                std::lock_guard <std::mutex> lock(mutex_);
+                ++stats_.clients_accepted;
+            }
+
+            void service_client(int fd) {
+                const auto it = clients_.find(fd);
+                if (it == clients_.end()) {
+                    return;
+                }
+                client_state& state = *it->second;
+
+                message request;
+                file_descriptor passed;
+                bool open = false;
+                try {
+                    open = detail::receive_message(fd, request, &passed);
+                    if (open) {
+                        handle(state, request, std::move(passed));
+                    }
+                } catch (const std::exception&) {
+                    open = false;
+                }
+                if (!open) {
+                    // Queued jobs keep the ring alive; their replies are dropped
+                    clients_.erase(it);
+                }
+            }
+
+            void handle(client_state& state, const message& request, file_descriptor passed) {
+                if (request.version != protocol_version) {
+                    throw ipc_error("protocol version mismatch");
+                }
+
+                if (request.type == message_type::hello) {
+                    if (!passed.valid() || request.slot_count == 0 || request.slot_bytes == 0 ||
+                        request.slot_bytes > options_.max_ring_bytes / request.slot_count) {
+                        throw ipc_error("invalid hello");
+                    }
+                    const std::uint64_t ring_bytes = request.slot_count * request.slot_bytes;
+                    state.ring = std::make_shared <shared_memory_region>(
+                        shared_memory_region::attach(std::move(passed), static_cast<size_t>(ring_bytes)));
+                    state.slot_count = request.slot_count;
+                    state.slot_bytes = request.slot_bytes;
+                    state.priority = state.trusted ? request.priority
+                                                   : std::min(request.priority, options_.max_foreign_priority);
+
+                    message reply;
+                    reply.type = message_type::ready;
+                    state.outbox.push_back(reply);
+                    flush(state);
+                    return;
+                }
+
+                if (request.type != message_type::scale || !state.ring || request.slot >= state.slot_count) {
+                    throw ipc_error("unexpected request");
+                }
+                ++state.in_flight;
+                {
+                    std::lock_guard <std::mutex> lock(mutex_);
+                    queue_.emplace(job_key{-state.priority, ++next_job_},
+                                   job{state.id, state.ring, state.slot_count, state.slot_bytes, request});
+                    ++stats_.requests;
+                }
+                work_ready_.notify_one();
+            }
+
+            void worker_loop() {
+                std::vector <job> batch;
+                while (true) {
+                    {
+                        std::unique_lock <std::mutex> lock(mutex_);
+                        work_ready_.wait(lock, [this] { return workers_stopping_ || !queue_.empty(); });
+                        if (queue_.empty()) {
+                            return;
+                        }
+                        take_batch(batch);
+                        ++stats_.batches;
+                    }
+
+                    std::vector <completion> results;
+                    results.reserve(batch.size());
+                    for (auto& item : batch) {
+                        results.push_back({item.client, process(item)});
+                    }
+                    batch.clear();
+
+                    {
+                        std::lock_guard <std::mutex> lock(mutex_);
+                        for (auto& result : results) {
+                            if (result.reply.type == message_type::failed) {
+                                ++stats_.failures;
+                            }
+                            completions_.push_back(std::move(result));
+                        }
+                    }
+                    const std::uint64_t one = 1;
+                    [[maybe_unused]] const ssize_t n = ::write(wake_.get(), &one, sizeof(one));
+                }
+            }
+
+            // Called with mutex_ held: the best job plus compatible followers
+            void take_batch(std::vector <job>& batch) {
+                auto first = queue_.begin();
+                const message& lead = first->second.request;
+                const auto kind = std::make_tuple(lead.algo, lead.scale, lead.width, lead.height, lead.channels);
+                batch.push_back(std::move(first->second));
+                queue_.erase(first);
+
+                for (auto it = queue_.begin(); it != queue_.end() && batch.size() < options_.max_batch;) {
+                    const message& r = it->second.request;
+                    if (std::make_tuple(r.algo, r.scale, r.width, r.height, r.channels) == kind) {
+                        batch.push_back(std::move(it->second));
+                        it = queue_.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+
+            static message process(const job& item) {
+                const message& request = item.request;
+                message reply;
+                reply.sequence = request.sequence;
+                reply.slot = request.slot;
+                try {
+                    const auto algo = static_cast<algorithm>(request.algo);
+                    const auto& all = algorithm_capabilities::get_all_algorithms();
+                    if (std::find(all.begin(), all.end(), algo) == all.end()) {
+                        throw ipc_error("unknown algorithm " + std::to_string(request.algo));
+                    }
+                    const int channels = static_cast<int>(request.channels);
+                    if ((channels != 3 && channels != 4) || request.width == 0 || request.height == 0) {
+                        throw ipc_error("invalid frame format");
+                    }
+                    if (request.slot >= item.slot_count) {
+                        throw ipc_error("invalid slot " + std::to_string(request.slot));
+                    }
+                    // Also rejects NaN and non-positive factors
+                    if (!scaler_capabilities::is_scale_supported(algo, request.scale)) {
+                        throw ipc_error("unsupported scale factor");
+                    }
+                    const slot_layout layout = make_slot_layout(request.width, request.height, channels, request.scale);
+                    if (layout.total() > item.slot_bytes) {
+                        throw ipc_error("frame does not fit the slot");
+                    }
+
+                    std::uint8_t* slot = item.ring->data() + request.slot * item.slot_bytes;
+                    const frame_image input(slot, request.width, request.height, channels);
+                    frame_image output(slot + layout.output_offset, layout.output_width, layout.output_height, channels);
+                    if (channels == 4) {
+                        // Alpha is not scaled; the output is opaque
+                        for (size_t i = 3; i < layout.output_bytes; i += 4) {
+                            output.data()[i] = 255;
+                        }
+                    }
+                    unified_scaler <frame_image, frame_image>::scale(input, output, algo);
+                    reply.type = message_type::done;
+                } catch (const std::exception& e) {
+                    reply.type = message_type::failed;
+                    reply.set_error(e.what());
+                }
+                return reply;
+            }
+
+            void send_completions() {
+                std::deque <completion> ready;
+                {
+                    std::lock_guard <std::mutex> lock(mutex_);
+                    ready.swap(completions_);
+                }
+                for (const auto& item : ready) {
+                    for (auto& [fd, state] : clients_) {
+                        if (state->id == item.client) {
+                            state->outbox.push_back(item.reply);
+                            break;
+                        }
+                    }
+                }
+                for (auto it = clients_.begin(); it != clients_.end();) {
+                    const auto current = it++;
+                    if (!current->second->outbox.empty()) {
+                        flush_client(current->first);
+                    }
+                }
+            }
+
+            // Send queued replies until the socket is full; a broken socket drops the client
+            void flush_client(int fd) {
+                const auto it = clients_.find(fd);
+                if (it == clients_.end()) {
+                    return;
+                }
+                try {
+                    flush(*it->second);
+                } catch (const ipc_error&) {
+                    clients_.erase(it);
+                }
+            }
+
+            static void flush(client_state& state) {
+                while (!state.outbox.empty() && detail::try_send_message(state.socket.get(), state.outbox.front())) {
+                    if (state.outbox.front().type != message_type::ready) {
+                        --state.in_flight;
+                    }
+                    state.outbox.pop_front();
+                }
+            }
+
+            std::string path_;
+            server_options options_;
+            file_descriptor listener_;
+            file_descriptor wake_;
+            std::atomic <bool> stopping_{false};
+
+            // Owned by the run() thread, keyed by socket descriptor
+            std::map <int, std::unique_ptr <client_state>> clients_;
+            std::uint64_t next_client_ = 0;
+
+            mutable std::mutex mutex_;
+            std::condition_variable work_ready_;
+            std::map <job_key, job> queue_;
+            std::uint64_t next_job_ = 0;
+            std::deque <completion> completions_;
+            bool workers_stopping_ = false;
+            server_stats stats_;
+            std::vector <std::thread> workers_;
+    };
+
+} // namespace scaler::ipc
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <scaler/ipc/ipc_exceptions.hh>
+#include <scaler/ipc/unix_socket.hh>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace scaler::ipc {
+
+    /**
+     * Anonymous shared memory (memfd) mapped into this process
+     *
+     * A region is created by one process and handed to another by passing
+     * its descriptor over a Unix socket; both map the same pages, so pixel
+     * data never travels through the socket.
+     *
+     * The creator seals the size of the memfd. A receiver only maps sealed
+     * regions, so the sender cannot truncate the file underneath the
+     * mapping and make the receiver fault on access.
+     */
+    class shared_memory_region {
+        public:
+            shared_memory_region() = default;
+
+            /// Seals a region must carry before it is attached
+            static constexpr int required_seals = F_SEAL_SHRINK | F_SEAL_GROW;
+
+            /**
+             * Create and map a new region of size bytes, sealed at that size
+             * @throws ipc_system_error if the memfd cannot be created, sealed or mapped
+             */
+            static shared_memory_region create(const std::string& name, size_t size) {
+                file_descriptor fd(::memfd_create(name.c_str(), MFD_CLOEXEC | MFD_ALLOW_SEALING));
+                if (!fd.valid()) {
+                    throw ipc_system_error("memfd_create", errno);
+                }
+                if (::ftruncate(fd.get(), static_cast<off_t>(size)) != 0) {
+                    throw ipc_system_error("ftruncate", errno);
+                }
+                if (::fcntl(fd.get(), F_ADD_SEALS, required_seals | F_SEAL_SEAL) != 0) {
+                    throw ipc_system_error("fcntl(F_ADD_SEALS)", errno);
+                }
+                return shared_memory_region(std::move(fd), size);
+            }
+
+            /**
+             * Map a region received from another process
+             * @throws ipc_error if the descriptor is not size-sealed or is smaller than size
+             */
+            static shared_memory_region attach(file_descriptor fd, size_t size) {
+                const int seals = ::fcntl(fd.get(), F_GET_SEALS);
+                if (seals < 0 || (seals & required_seals) != required_seals) {
+                    throw ipc_error("shared memory region is not sealed against resizing");
+                }
+                struct stat info{};
+                if (::fstat(fd.get(), &info) != 0) {
+                    throw ipc_system_error("fstat", errno);
+                }
+                if (info.st_size < 0 || static_cast<size_t>(info.st_size) < size) {
+                    throw ipc_error("shared memory region is smaller than announced");
+                }
+                return shared_memory_region(std::move(fd), size);
+            }
+
+            shared_memory_region(shared_memory_region&& other) noexcept
+                : fd_(std::move(other.fd_)),
+                  data_(std::exchange(other.data_, nullptr)),
+                  size_(std::exchange(other.size_, 0)) {
+            }
+
+            shared_memory_region& operator=(shared_memory_region&& other) noexcept {
+                if (this != &other) {
+                    unmap();
+                    fd_ = std::move(other.fd_);
+                    data_ = std::exchange(other.data_, nullptr);
+                    size_ = std::exchange(other.size_, 0);
+                }
+                return *this;
+            }
+
+            shared_memory_region(const shared_memory_region&) = delete;
+            shared_memory_region& operator=(const shared_memory_region&) = delete;
+
+            ~shared_memory_region() { unmap(); }
+
+            [[nodiscard]] std::uint8_t* data() const { return data_; }
+            [[nodiscard]] size_t size() const { return size_; }
+            [[nodiscard]] int fd() const { return fd_.get(); }
+
+        private:
+            shared_memory_region(file_descriptor fd, size_t size)
+                : fd_(std::move(fd)),
+                  size_(size) {
+                void* mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_.get(), 0);
+                if (mapping == MAP_FAILED) {
+                    throw ipc_system_error("mmap", errno);
+                }
+                data_ = static_cast<std::uint8_t*>(mapping);
+            }
+
+            void unmap() {
+                if (data_ != nullptr) {
+                    ::munmap(data_, size_);
+                    data_ = nullptr;
+                }
+            }
+
+            file_descriptor fd_;
+            std::uint8_t* data_ = nullptr;
+            size_t size_ = 0;
+    };
+
+} // namespace scaler::ipc
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <scaler/ipc/ipc_exceptions.hh>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace scaler::ipc {
+
+    /**
+     * Owning file descriptor, closed on destruction
+     */
+    class file_descriptor {
+        public:
+            file_descriptor() = default;
+            explicit file_descriptor(int fd) : fd_(fd) {}
+
+            file_descriptor(file_descriptor&& other) noexcept
+                : fd_(std::exchange(other.fd_, -1)) {
+            }
+
+            file_descriptor& operator=(file_descriptor&& other) noexcept {
+                if (this != &other) {
+                    reset(std::exchange(other.fd_, -1));
+                }
+                return *this;
+            }
+
+            file_descriptor(const file_descriptor&) = delete;
+            file_descriptor& operator=(const file_descriptor&) = delete;
+
+            ~file_descriptor() { reset(); }
+
+            [[nodiscard]] int get() const { return fd_; }
+            [[nodiscard]] bool valid() const { return fd_ >= 0; }
+
+            void reset(int fd = -1) {
+                if (fd_ >= 0) {
+                    ::close(fd_);
+                }
+                fd_ = fd;
+            }
+
+        private:
+            int fd_ = -1;
+    };
+
+    namespace detail {
+
+        inline sockaddr_un unix_address(const std::string& path) {
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+                throw ipc_error("invalid socket path '" + path + "'");
+            }
+            std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+            return address;
+        }
+
+        /**
+         * Unix SOCK_SEQPACKET socket: reliable and ordered like a stream
+         * socket, but every message arrives whole, so fixed-size protocol
+         * messages need no framing
+         */
+        inline file_descriptor make_seqpacket_socket() {
+            file_descriptor fd(::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0));
+            if (!fd.valid()) {
+                throw ipc_system_error("socket", errno);
+            }
+            return fd;
+        }
+
+        inline file_descriptor listen_unix(const std::string& path, int backlog = 16) {
+            const sockaddr_un address = unix_address(path);
+            file_descriptor fd = make_seqpacket_socket();
+            ::unlink(path.c_str());
+            if (::bind(fd.get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+                throw ipc_system_error("bind " + path, errno);
+            }
+            if (::listen(fd.get(), backlog) != 0) {
+                throw ipc_system_error("listen " + path, errno);
+            }
+            return fd;
+        }
+
+        inline file_descriptor connect_unix(const std::string& path) {
+            const sockaddr_un address = unix_address(path);
+            file_descriptor fd = make_seqpacket_socket();
+            if (::connect(fd.get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+                throw ipc_system_error("connect " + path, errno);
+            }
+            return fd;
+        }
+
+        /**
+         * Send one message, optionally passing a file descriptor (SCM_RIGHTS)
+         */
+        template<typename Message>
+        void send_message(int socket, const Message& message, int passed_fd = -1) {
+            iovec io{const_cast<Message*>(&message), sizeof(Message)};
+            msghdr header{};
+            header.msg_iov = &io;
+            header.msg_iovlen = 1;
+
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+            if (passed_fd >= 0) {
+                header.msg_control = control;
+                header.msg_controllen = sizeof(control);
+                cmsghdr* cmsg = CMSG_FIRSTHDR(&header);
+                cmsg->cmsg_level = SOL_SOCKET;
+                cmsg->cmsg_type = SCM_RIGHTS;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+                std::memcpy(CMSG_DATA(cmsg), &passed_fd, sizeof(int));
+            }
+
+            ssize_t sent;
+            do {
+                sent = ::sendmsg(socket, &header, MSG_NOSIGNAL);
+            } while (sent < 0 && errno == EINTR);
+            if (sent < 0) {
+                throw ipc_system_error("sendmsg", errno);
+            }
+            if (static_cast<size_t>(sent) != sizeof(Message)) {
+                throw ipc_error("short send");
+            }
+        }
+
+        /**
+         * Send one message unless the socket buffer is full
+         * @return false if sending would block
+         */
+        template<typename Message>
+        bool try_send_message(int socket, const Message& message) {
+            ssize_t sent;
+            do {
+                sent = ::send(socket, &message, sizeof(Message), MSG_NOSIGNAL | MSG_DONTWAIT);
+            } while (sent < 0 && errno == EINTR);
+            if (sent < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return false;
+                }
+                throw ipc_system_error("send", errno);
+            }
+            if (static_cast<size_t>(sent) != sizeof(Message)) {
+                throw ipc_error("short send");
+            }
+            return true;
+        }
+
+        /**
+         * Receive one message and a passed file descriptor, if any
+         * @return false if the peer closed the connection
+         */
+        template<typename Message>
+        bool receive_message(int socket, Message& message, file_descriptor* passed_fd = nullptr) {
+            iovec io{&message, sizeof(Message)};
+            msghdr header{};
+            header.msg_iov = &io;
+            header.msg_iovlen = 1;
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+            header.msg_control = control;
+            header.msg_controllen = sizeof(control);
+
+            ssize_t received;
+            do {
+                received = ::recvmsg(socket, &header, MSG_CMSG_CLOEXEC);
+            } while (received < 0 && errno == EINTR);
+            if (received == 0) {
+                return false;
+            }
+            if (received < 0) {
+                if (errno == ECONNRESET) {
+                    return false;
+                }
+                throw ipc_system_error("recvmsg", errno);
+            }
+
+            for (cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr; cmsg = CMSG_NXTHDR(&header, cmsg)) {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+                    int fd;
+                    std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+                    if (passed_fd != nullptr) {
+                        passed_fd->reset(fd);
+                    } else {
+                        ::close(fd);
+                    }
+                }
+            }
+            if (static_cast<size_t>(received) != sizeof(Message) || (header.msg_flags & MSG_TRUNC) != 0) {
+                throw ipc_error("malformed message");
+            }
+            return true;
+        }
+
+    } // namespace detail
+
+} // namespace scaler::ipc
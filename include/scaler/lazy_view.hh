@@ -0,0 +1,249 @@
+/**
+ * @file lazy_view.hh
+ * @brief Scaled image computed tile by tile, only where it is read
+ *
+ * A huge map scaled 4x is mostly never looked at. lazy_scaled_view is an
+ * input image whose pixels are those of the whole scaled image, but it
+ * scales a tile only when one of its pixels is first read, and keeps a
+ * bounded number of tiles in a least-recently-used cache. It can be drawn
+ * from directly or fed to another scaler; either way only the touched
+ * regions are ever computed.
+ *
+ * @code
+ * scaler::lazy_scaled_view<Map, scaler::algorithm::xBR, 4> scaled(world_map);
+ * for (size_t y = view.top; y < view.bottom; ++y) {
+ *     for (size_t x = view.left; x < view.right; ++x) {
+ *         draw(x, y, scaled.get_pixel(x, y));
+ *     }
+ * }
+ * @endcode
+ */
+#pragma once
+
+#include <scaler/algorithm.hh>
+#include <scaler/image.hh>
+#include <scaler/image_base.hh>
+#include <scaler/progressive.hh>
+#include <scaler/unified_scaler.hh>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace scaler {
+
+    struct lazy_view_options {
+        /// Tile edge in input pixels
+        size_t tile_size = 32;
+        /// Scaled tiles kept at most; the least recently read is dropped first
+        size_t max_tiles = 64;
+    };
+
+    namespace detail {
+        // Distinguishes views for the per-thread last-tile cache even when
+        // a new view reuses the address of a destroyed one
+        inline std::atomic <std::uint64_t> next_lazy_view_id{1};
+    }
+
+    /**
+     * Input image scaled by Factor with Algo, computed on demand
+     *
+     * The constructor copies the input. A tile is scaled with the halo its
+     * kernel needs (see progressive_scaler), so every pixel is identical to
+     * the same pixel of a whole-image scale, whatever the tile size.
+     *
+     * Reading is safe from any number of threads. A tile missing from the
+     * cache is scaled by the first thread that needs it; others reading it
+     * meanwhile wait for that result rather than scaling it again. Evicted
+     * tiles stay valid for whoever still holds them through tile(). Tiles
+     * still being scaled are never evicted, so the cache can briefly hold
+     * more than max_tiles.
+     *
+     * get_pixel() keeps the last tile each thread read, so reading the
+     * pixels of one tile in a row costs one lookup in the shared cache, not
+     * one per pixel. That tile stays alive until the thread reads another
+     * view of the same type. Consumers walking a tile's pixels can also
+     * take it once through tile() and read it directly.
+     *
+     * get_pixel() is noexcept as for every input image, so a failure to
+     * scale a tile (out of memory) terminates there; tile() reports it.
+     */
+    template<typename InputImage, algorithm Algo, size_t Factor>
+    class lazy_scaled_view : public input_image_base <lazy_scaled_view <InputImage, Algo, Factor>,
+                                                      typename InputImage::pixel_type> {
+        public:
+            using pixel_type = typename InputImage::pixel_type;
+            using tile_type = std::shared_ptr <const image <pixel_type>>;
+
+            /**
+             * @throws unsupported_scale_exception if Algo does not support Factor
+             */
+            explicit lazy_scaled_view(const InputImage& input, lazy_view_options options = {})
+                : options_(options), source_(input.width(), input.height()) {
+                const auto scale = static_cast <float>(Factor);
+                if (!scaler_capabilities::is_scale_supported(Algo, scale)) {
+                    throw unsupported_scale_exception(Algo, scale, scaler_capabilities::get_supported_scales(Algo));
+                }
+                options_.tile_size = std::max <size_t>(options_.tile_size, 1);
+                options_.max_tiles = std::max <size_t>(options_.max_tiles, 1);
+                for (size_t y = 0; y < input.height(); ++y) {
+                    const auto line = source_.row(y);
+                    for (size_t x = 0; x < input.width(); ++x) {
+                        line[x] = input.get_pixel(x, y);
+                    }
+                }
+                columns_ = (input.width() + options_.tile_size - 1) / options_.tile_size;
+            }
+
+            lazy_scaled_view(const lazy_scaled_view&) = delete;
+            lazy_scaled_view& operator=(const lazy_scaled_view&) = delete;
+
+            [[nodiscard]] size_t width_impl() const { return source_.width() * Factor; }
+            [[nodiscard]] size_t height_impl() const { return source_.height() * Factor; }
+
+            [[nodiscard]] pixel_type get_pixel_impl(size_t x, size_t y) const {
+                const size_t edge = tile_edge();
+                const size_t column = x / edge;
+                const size_t row = y / edge;
+                const size_t key = row * columns_ + column;
+
+                thread_local last_tile last;
+                if (last.view != id_ || last.key != key) {
+                    last.pixels = tile(column, row);
+                    last.view = id_;
+                    last.key = key;
+                }
+                return last.pixels->get_pixel(x - column * edge, y - row * edge);
+            }
+
+            /// Edge of a full tile in output pixels; tiles at the right and bottom may be smaller
+            [[nodiscard]] size_t tile_edge() const { return options_.tile_size * Factor; }
+
+            /**
+             * The scaled tile in column, row of the tile grid (output pixels
+             * [column * tile_edge(), ...)), scaling it if it is not cached
+             *
+             * Reading a tile's pixels directly saves a cache lookup per pixel.
+             */
+            [[nodiscard]] tile_type tile(size_t column, size_t row) const {
+                const size_t key = row * columns_ + column;
+                const std::uint64_t now = clock_.fetch_add(1, std::memory_order_relaxed);
+
+                std::shared_future <tile_type> pending;
+                {
+                    std::shared_lock <std::shared_mutex> lock(mutex_);
+                    const auto found = tiles_.find(key);
+                    if (found != tiles_.end()) {
+                        found->second.last_use.store(now, std::memory_order_relaxed);
+                        pending = found->second.pixels;
+                    }
+                }
+                if (!pending.valid()) {
+                    std::promise <tile_type> promise;
+                    bool scaling = false;
+                    {
+                        std::unique_lock <std::shared_mutex> lock(mutex_);
+                        auto [slot, inserted] = tiles_.try_emplace(key);
+                        slot->second.last_use.store(now, std::memory_order_relaxed);
+                        if (inserted) {
+                            slot->second.pixels = promise.get_future().share();
+                            slot->second.generation = now;
+                            scaling = true;
+                            evict(key);
+                        }
+                        pending = slot->second.pixels;
+                    }
+                    if (scaling) {
+                        scale(promise, column, row, key, now);
+                    }
+                }
+                return pending.get();
+            }
+
+            /// Tiles currently cached (including those being scaled)
+            [[nodiscard]] size_t cached_tiles() const {
+                std::shared_lock <std::shared_mutex> lock(mutex_);
+                return tiles_.size();
+            }
+
+            /// Tiles scaled so far, including ones scaled again after eviction
+            [[nodiscard]] size_t scaled_tiles() const {
+                return scaled_.load(std::memory_order_relaxed);
+            }
+
+        private:
+            struct entry {
+                std::shared_future <tile_type> pixels;
+                std::atomic <std::uint64_t> last_use{0};
+                std::uint64_t generation = 0;  // clock value of the read that inserted it
+            };
+
+            struct last_tile {
+                std::uint64_t view = 0;
+                size_t key = 0;
+                tile_type pixels;
+            };
+
+            void scale(std::promise <tile_type>& promise, size_t column, size_t row, size_t key,
+                       std::uint64_t generation) const {
+                const size_t tile_size = options_.tile_size;
+                const progressive_rect rect{column * tile_size, row * tile_size,
+                                            std::min(tile_size, source_.width() - column * tile_size),
+                                            std::min(tile_size, source_.height() - row * tile_size)};
+                try {
+                    promise.set_value(std::make_shared <const image <pixel_type>>(
+                        detail::scale_tile(source_, rect, Algo, Factor)));
+                    scaled_.fetch_add(1, std::memory_order_relaxed);
+                } catch (...) {
+                    // Waiting readers see the failure; the next read tries again.
+                    // Once failed, the entry can be evicted and the tile inserted
+                    // again before we lock, so only drop the entry we inserted.
+                    promise.set_exception(std::current_exception());
+                    std::unique_lock <std::shared_mutex> lock(mutex_);
+                    const auto found = tiles_.find(key);
+                    if (found != tiles_.end() && found->second.generation == generation) {
+                        tiles_.erase(found);
+                    }
+                }
+            }
+
+            // Called with mutex_ held exclusively: drop least recently read tiles other than keep.
+            // Tiles still being scaled stay, or a reader would start scaling them a second time.
+            void evict(size_t keep) const {
+                while (tiles_.size() > options_.max_tiles) {
+                    auto oldest = tiles_.end();
+                    for (auto it = tiles_.begin(); it != tiles_.end(); ++it) {
+                        if (it->first != keep &&
+                            (oldest == tiles_.end() ||
+                             it->second.last_use.load(std::memory_order_relaxed) <
+                             oldest->second.last_use.load(std::memory_order_relaxed)) &&
+                            it->second.pixels.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                            oldest = it;
+                        }
+                    }
+                    if (oldest == tiles_.end()) {
+                        break;
+                    }
+                    tiles_.erase(oldest);
+                }
+            }
+
+            lazy_view_options options_;
+            image <pixel_type> source_;
+            size_t columns_ = 0;
+            std::uint64_t id_ = detail::next_lazy_view_id.fetch_add(1, std::memory_order_relaxed);
+
+            mutable std::shared_mutex mutex_;
+            mutable std::unordered_map <size_t, entry> tiles_;
+            mutable std::atomic <std::uint64_t> clock_{0};
+            mutable std::atomic <size_t> scaled_{0};
+    };
+
+} // namespace scaler
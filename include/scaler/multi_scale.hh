@@ -0,0 +1,537 @@
+/**
+ * @file multi_scale.hh
+ * @brief Several scales of one image from a single sweep
+ *
+ * Exporting an image at 2x, 3x and 4x with one scale() call per density
+ * reads and classifies every source pixel once per call. HQ2x and HQ3x
+ * build their pattern from the same eight centre-to-neighbour colour
+ * differences, Scale2x and Scale3x from the same edge equalities, and
+ * OmniScale 2x and 3x from the very same four patterns; 4x is 2x applied
+ * to the 2x image in every one of these families. scale_multi() walks the
+ * source once, converts each pixel's colour once, classifies each
+ * neighbourhood once for all requested factors, and runs the 4x pass over
+ * the 2x rows as they are produced.
+ *
+ * @code
+ * std::vector<Image> densities;
+ * densities.emplace_back(sprite.width() * 2, sprite.height() * 2);
+ * densities.emplace_back(sprite.width() * 3, sprite.height() * 3);
+ * densities.emplace_back(sprite.width() * 4, sprite.height() * 4);
+ * scaler::scale_multi(sprite, densities, scaler::algorithm::HQ);
+ * @endcode
+ */
+#pragma once
+
+#include <scaler/algorithm.hh>
+#include <scaler/compiler_compat.hh>
+#include <scaler/unified_scaler.hh>
+#include <scaler/vec3.hh>
+#include <scaler/cpu/hq2x.hh>
+#include <scaler/cpu/hq3x.hh>
+#include <scaler/cpu/omniscale.hh>
+#include <scaler/cpu/scaler_common.hh>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace scaler {
+
+    namespace detail {
+
+        /**
+         * The 3x3 neighbourhood of one pixel, as pointers into the rows
+         * above, at and below it; i is row i / 3 and column i % 3
+         *
+         * Families read it in place: copying nine pixels per output block
+         * costs more than the Scale rules themselves.
+         */
+        template<typename Pixel, typename Analysis>
+        struct multi_scale_window {
+            std::array <const Pixel*, 3> rows;
+            std::array <const Analysis*, 3> analysis;
+
+            SCALER_FORCE_INLINE const Pixel& operator [](size_t i) const {
+                return rows[i / 3][i % 3];
+            }
+
+            SCALER_FORCE_INLINE const Analysis& analysed(size_t i) const {
+                return analysis[i / 3][i % 3];
+            }
+
+            SCALER_FORCE_INLINE std::array <Pixel, 9> pixels() const {
+                return {rows[0][0], rows[0][1], rows[0][2], rows[1][0], rows[1][1], rows[1][2],
+                        rows[2][0], rows[2][1], rows[2][2]};
+            }
+        };
+
+        /**
+         * HQ: rgb_to_yuv() for the HQ2x test, and HQ3x's Y, U and V sums
+         * before its >> 8, so that a difference of sums is its difference
+         */
+        template<typename Pixel>
+        struct hq_multi_family {
+            struct analysis {
+                uvec3 yuv;
+                int y;
+                int u;
+                int v;
+            };
+
+            using window = multi_scale_window <Pixel, analysis>;
+
+            struct classes {
+                std::array <Pixel, 9> w;
+                std::uint8_t diffs2;
+                int pattern3;
+            };
+
+            SCALER_FORCE_INLINE static analysis analyse(const Pixel& p) {
+                const int r = static_cast <int>(p.x);
+                const int g = static_cast <int>(p.y);
+                const int b = static_cast <int>(p.z);
+                return {rgb_to_yuv(uvec3(p)), 77 * r + 150 * g + 29 * b, -43 * r - 85 * g + 128 * b,
+                        128 * r - 107 * g - 21 * b};
+            }
+
+            SCALER_FORCE_INLINE static classes classify(const window& n, bool want2, bool want3) {
+                // Bit order of scale_hq2x (compute_differences()) and of scale_hq_3x
+                constexpr std::array <size_t, 8> neighbours2 = {1, 2, 3, 5, 6, 7, 8, 0};
+                constexpr std::array <size_t, 8> neighbours3 = {0, 1, 2, 3, 5, 6, 7, 8};
+                constexpr std::array <int, 8> bits3 = {1, 2, 4, 8, 32, 64, 128, 256};
+
+                classes result{n.pixels(), 0, 0};
+                const analysis& centre = n.analysed(4);
+                for (size_t i = 0; want2 && i < 8; ++i) {
+                    if (differs2(centre.yuv, n.analysed(neighbours2[i]).yuv)) {
+                        result.diffs2 = static_cast <std::uint8_t>(result.diffs2 | (1u << i));
+                    }
+                }
+                for (size_t i = 0; want3 && i < 8; ++i) {
+                    const size_t k = neighbours3[i];
+                    if (result.w[k] != result.w[4] && differs3(centre, n.analysed(k))) {
+                        result.pattern3 |= bits3[i];
+                    }
+                }
+                return result;
+            }
+
+            SCALER_FORCE_INLINE static void scale2(const window&, const classes& c, std::array <Pixel, 4>& out) {
+                out.fill(c.w[4]);
+                hq2x_blend(c.w, c.diffs2, out[0], out[1], out[2], out[3]);
+            }
+
+            SCALER_FORCE_INLINE static void scale3(const window&, const classes& c, std::array <Pixel, 9>& out) {
+                hq3x_detail::process_pattern(c.w, out.data(), c.pattern3);
+            }
+
+            SCALER_FORCE_INLINE static bool differs2(const uvec3& lhs, const uvec3& rhs) {
+                const auto dy = lhs.x > rhs.x ? lhs.x - rhs.x : rhs.x - lhs.x;
+                const auto du = lhs.y > rhs.y ? lhs.y - rhs.y : rhs.y - lhs.y;
+                const auto dv = lhs.z > rhs.z ? lhs.z - rhs.z : rhs.z - lhs.z;
+                return dy > Y_THRESHOLD || du > U_THRESHOLD || dv > V_THRESHOLD;
+            }
+
+            SCALER_FORCE_INLINE static bool differs3(const analysis& centre, const analysis& other) {
+                return static_cast <std::uint32_t>(std::abs((centre.y - other.y) >> 8)) > hq3x_detail::THRESHOLD_Y ||
+                       static_cast <std::uint32_t>(std::abs((centre.u - other.u) >> 8)) > hq3x_detail::THRESHOLD_U ||
+                       static_cast <std::uint32_t>(std::abs((centre.v - other.v) >> 8)) > hq3x_detail::THRESHOLD_V;
+            }
+        };
+
+        /**
+         * Scale: its edge tests are cheaper to evaluate lazily, as
+         * scale_adv_mame and scale_scale_3x do, than to share; what the
+         * outputs share is the source rows, and 4x the 2x rows
+         */
+        template<typename Pixel>
+        struct scale_multi_family {
+            struct analysis {
+            };
+
+            using window = multi_scale_window <Pixel, analysis>;
+
+            struct classes {
+            };
+
+            SCALER_FORCE_INLINE static analysis analyse(const Pixel&) {
+                return {};
+            }
+
+            SCALER_FORCE_INLINE static classes classify(const window&, bool, bool) {
+                return {};
+            }
+
+            SCALER_FORCE_INLINE static void scale2(const window& n, const classes&, std::array <Pixel, 4>& out) {
+                const Pixel top = n[1];
+                const Pixel left = n[3];
+                const Pixel centre = n[4];
+                const Pixel right = n[5];
+                const Pixel bottom = n[7];
+                out[0] = left == top && left != bottom && top != right ? top : centre;
+                out[1] = top == right && top != left && right != bottom ? right : centre;
+                out[2] = bottom == left && bottom != right && left != top ? left : centre;
+                out[3] = right == bottom && right != top && bottom != left ? bottom : centre;
+            }
+
+            SCALER_FORCE_INLINE static void scale3(const window& n, const classes&, std::array <Pixel, 9>& out) {
+                const Pixel b = n[1];
+                const Pixel d = n[3];
+                const Pixel e = n[4];
+                const Pixel f = n[5];
+                const Pixel h = n[7];
+                if (b == h || d == f) {
+                    out.fill(e);
+                    return;
+                }
+                const Pixel a = n[0];
+                const Pixel c = n[2];
+                const Pixel g = n[6];
+                const Pixel i = n[8];
+                out[0] = d == b ? d : e;
+                out[1] = (d == b && e != c) || (b == f && e != a) ? b : e;
+                out[2] = b == f ? f : e;
+                out[3] = (d == b && e != g) || (d == h && e != a) ? d : e;
+                out[4] = e;
+                out[5] = (b == f && e != i) || (h == f && e != c) ? f : e;
+                out[6] = d == h ? d : e;
+                out[7] = (d == h && e != i) || (h == f && e != g) ? h : e;
+                out[8] = h == f ? f : e;
+            }
+        };
+
+        /**
+         * OmniScale: the eight differences once, permuted into the four
+         * flipped patterns that scale_omni_scale_2x/3x build from them
+         */
+        template<typename Pixel>
+        struct omniscale_multi_family {
+            using analysis = omniscale_detail::color_diff;
+            using window = multi_scale_window <Pixel, analysis>;
+
+            struct classes {
+                std::array <Pixel, 9> w;
+                std::array <unsigned int, 4> patterns;
+            };
+
+            SCALER_FORCE_INLINE static analysis analyse(const Pixel& p) {
+                return omniscale_detail::rgb_to_hq_colorspace_fp(uvec3(p));
+            }
+
+            SCALER_FORCE_INLINE static classes classify(const window& n, bool, bool) {
+                classes result{n.pixels(), {}};
+                std::array <unsigned int, 9> d{};
+                for (size_t i = 0; i < 9; ++i) {
+                    d[i] = i != 4 && differs(result.w[i], result.w[4], n.analysed(i), n.analysed(4)) ? 1u : 0u;
+                }
+                const auto pattern = [&d](size_t b0, size_t b1, size_t b2, size_t b3, size_t b4, size_t b5, size_t b6,
+                                          size_t b7) {
+                    return d[b0] | d[b1] << 1 | d[b2] << 2 | d[b3] << 3 | d[b4] << 4 | d[b5] << 5 | d[b6] << 6 |
+                           d[b7] << 7;
+                };
+                result.patterns = {pattern(0, 1, 2, 3, 5, 6, 7, 8), pattern(2, 1, 0, 5, 3, 8, 7, 6),
+                                   pattern(6, 7, 8, 3, 5, 0, 1, 2), pattern(8, 7, 6, 5, 3, 2, 1, 0)};
+                return result;
+            }
+
+            SCALER_FORCE_INLINE static void scale2(const window&, const classes& c, std::array <Pixel, 4>& out) {
+                const auto& w = c.w;
+                omniscale_detail::omni_scale_core <Pixel> core;
+                for (size_t i = 0; i < 4; ++i) {
+                    core.load_neighborhood(w[0], w[1], w[2], w[3], w[4], w[5], w[6], w[7], w[8], i % 2 == 1, i >= 2);
+                    core.setPattern(c.patterns[i]);
+                    out[i] = core.interpolateCorner(0.25f, 0.25f);
+                }
+            }
+
+            SCALER_FORCE_INLINE static void scale3(const window&, const classes& c, std::array <Pixel, 9>& out) {
+                // Same positions and arithmetic as scale_omni_scale_3x
+                constexpr float positions[3] = {1.0f / 6.0f, 0.5f, 5.0f / 6.0f};
+                const auto& w = c.w;
+                omniscale_detail::omni_scale_core <Pixel> core;
+                for (size_t i = 0; i < 9; ++i) {
+                    float px = positions[i % 3];
+                    float py = positions[i / 3];
+                    const bool flip_x = px > 0.5f;
+                    const bool flip_y = py > 0.5f;
+                    if (flip_x) px = 1.0f - px;
+                    if (flip_y) py = 1.0f - py;
+                    core.load_neighborhood(w[0], w[1], w[2], w[3], w[4], w[5], w[6], w[7], w[8], flip_x, flip_y);
+                    core.setPattern(c.patterns[(flip_y ? 2u : 0u) + (flip_x ? 1u : 0u)]);
+                    out[i] = core.interpolateCorner(px, py);
+                }
+            }
+
+            SCALER_FORCE_INLINE static bool differs(const Pixel& lhs, const Pixel& rhs, const analysis& a,
+                                                    const analysis& b) {
+                if (lhs == rhs) {
+                    return false;
+                }
+                return std::abs(a.x - b.x) > omniscale_detail::FP_THRESH_X ||
+                       std::abs(a.y - b.y) > omniscale_detail::FP_THRESH_Y ||
+                       std::abs(a.z - b.z) > omniscale_detail::FP_THRESH_Z;
+            }
+        };
+
+        /**
+         * Rows of one resolution with a clamped one-pixel border, and the
+         * family's analysis of every pixel in them
+         */
+        template<typename Pixel, typename Family>
+        struct multi_scale_row {
+            std::vector <Pixel> pixels;
+            std::vector <typename Family::analysis> analysis;
+
+            explicit multi_scale_row(size_t width)
+                : pixels(width + 2), analysis(width + 2) {
+            }
+
+            /// Fill the border from the edge pixels and analyse the row
+            void finish() {
+                const size_t width = pixels.size() - 2;
+                pixels.front() = pixels[1];
+                pixels.back() = pixels[width];
+                for (size_t i = 0; i < pixels.size(); ++i) {
+                    analysis[i] = Family::analyse(pixels[i]);
+                }
+            }
+        };
+
+        /**
+         * Classify and scale the row mid (between top and bottom) of width
+         * pixels, passing each pixel's 2x and 3x blocks to the sinks
+         */
+        template<bool Want2, bool Want3, typename Pixel, typename Family, typename Sink2, typename Sink3>
+        void scale_multi_row(const multi_scale_row <Pixel, Family>& top, const multi_scale_row <Pixel, Family>& mid,
+                             const multi_scale_row <Pixel, Family>& bottom, size_t width, Sink2&& sink2,
+                             Sink3&& sink3) {
+            typename Family::window n{};
+            std::array <Pixel, 4> block2;
+            std::array <Pixel, 9> block3;
+
+            for (size_t x = 0; x < width; ++x) {
+                n.rows = {top.pixels.data() + x, mid.pixels.data() + x, bottom.pixels.data() + x};
+                if constexpr (!std::is_empty_v <typename Family::analysis>) {
+                    n.analysis = {top.analysis.data() + x, mid.analysis.data() + x, bottom.analysis.data() + x};
+                }
+                const auto classes = Family::classify(n, Want2, Want3);
+                if constexpr (Want2) {
+                    Family::scale2(n, classes, block2);
+                    sink2(x, block2);
+                }
+                if constexpr (Want3) {
+                    Family::scale3(n, classes, block3);
+                    sink3(x, block3);
+                }
+            }
+        }
+
+        /**
+         * The n x n block at block position (x, y) into every output of factor n
+         */
+        template<typename OutputImage, typename Pixel, size_t Size>
+        SCALER_FORCE_INLINE void write_multi_block(const std::vector <OutputImage*>& outputs, size_t x, size_t y,
+                               const std::array <Pixel, Size>& block) {
+            for (OutputImage* output : outputs) {
+                if constexpr (Size == 4) {
+                    output->set_pixel(2 * x, 2 * y, block[0]);
+                    output->set_pixel(2 * x + 1, 2 * y, block[1]);
+                    output->set_pixel(2 * x, 2 * y + 1, block[2]);
+                    output->set_pixel(2 * x + 1, 2 * y + 1, block[3]);
+                } else {
+                    output->set_pixel(3 * x, 3 * y, block[0]);
+                    output->set_pixel(3 * x + 1, 3 * y, block[1]);
+                    output->set_pixel(3 * x + 2, 3 * y, block[2]);
+                    output->set_pixel(3 * x, 3 * y + 1, block[3]);
+                    output->set_pixel(3 * x + 1, 3 * y + 1, block[4]);
+                    output->set_pixel(3 * x + 2, 3 * y + 1, block[5]);
+                    output->set_pixel(3 * x, 3 * y + 2, block[6]);
+                    output->set_pixel(3 * x + 1, 3 * y + 2, block[7]);
+                    output->set_pixel(3 * x + 2, 3 * y + 2, block[8]);
+                }
+            }
+        }
+
+        /**
+         * One sweep over src writing targets[f] (the outputs at factor f,
+         * 2 <= f <= 4); 4x runs the 2x rules over the 2x rows, one source
+         * row behind, keeping four 2x rows
+         */
+        template<typename Family, typename InputImage, typename OutputImage>
+        void scale_multi_sweep(const InputImage& src, const std::array <std::vector <OutputImage*>, 5>& targets) {
+            using pixel = std::decay_t <decltype(src.get_pixel(0, 0))>;
+            using row = multi_scale_row <pixel, Family>;
+
+            const size_t width = src.width();
+            const size_t height = src.height();
+            if (width == 0 || height == 0) {
+                return;
+            }
+            const bool want3 = !targets[3].empty();
+            const bool want4 = !targets[4].empty();
+            const bool want2 = !targets[2].empty() || want4;
+
+            const auto load = [&src, width](row& r, size_t y) {
+                for (size_t x = 0; x < width; ++x) {
+                    r.pixels[x + 1] = src.get_pixel(x, y);
+                }
+                r.finish();
+            };
+            row top(width), mid(width), bottom(width);
+            load(mid, 0);
+            top = mid;
+            load(bottom, std::min <size_t>(1, height - 1));
+
+            // 2x row r into the 4x outputs, from 2x rows r - 1 .. r + 1
+            std::vector <row> doubled(want2 ? 4 : 0, row(2 * width));
+            const size_t doubled_height = 2 * height;
+            const auto scale_4x_row = [&](size_t r) {
+                const row& above = doubled[(r > 0 ? r - 1 : 0) % 4];
+                const row& below = doubled[std::min(r + 1, doubled_height - 1) % 4];
+                scale_multi_row <true, false>(above, doubled[r % 4], below, 2 * width,
+                                [&](size_t x, const std::array <pixel, 4>& block) {
+                                    write_multi_block(targets[4], x, r, block);
+                                },
+                                [](size_t, const std::array <pixel, 9>&) {
+                                });
+            };
+
+            for (size_t y = 0; y < height; ++y) {
+                row* upper = want2 ? &doubled[(2 * y) % 4] : nullptr;
+                row* lower = want2 ? &doubled[(2 * y + 1) % 4] : nullptr;
+                const auto sink2 = [&](size_t x, const std::array <pixel, 4>& block) {
+                    write_multi_block(targets[2], x, y, block);
+                    if (want4) {
+                        upper->pixels[2 * x + 1] = block[0];
+                        upper->pixels[2 * x + 2] = block[1];
+                        lower->pixels[2 * x + 1] = block[2];
+                        lower->pixels[2 * x + 2] = block[3];
+                    }
+                };
+                const auto sink3 = [&](size_t x, const std::array <pixel, 9>& block) {
+                    write_multi_block(targets[3], x, y, block);
+                };
+                if (want2 && want3) {
+                    scale_multi_row <true, true>(top, mid, bottom, width, sink2, sink3);
+                } else if (want2) {
+                    scale_multi_row <true, false>(top, mid, bottom, width, sink2, sink3);
+                } else {
+                    scale_multi_row <false, true>(top, mid, bottom, width, sink2, sink3);
+                }
+
+                if (want4) {
+                    upper->finish();
+                    lower->finish();
+                    if (y > 0) {
+                        scale_4x_row(2 * y - 1);
+                    }
+                    scale_4x_row(2 * y);
+                }
+
+                std::swap(top, mid);
+                std::swap(mid, bottom);
+                if (y + 1 < height) {
+                    load(bottom, std::min(y + 2, height - 1));
+                }
+            }
+            if (want4) {
+                scale_4x_row(doubled_height - 1);
+            }
+        }
+
+    } // namespace detail
+
+    /**
+     * Whether scale_multi() shares one sweep between the outputs of algo;
+     * for other algorithms it scales each output on its own
+     */
+    inline bool is_multi_scale_shared(algorithm algo) {
+        return algo == algorithm::HQ || algo == algorithm::Scale || algo == algorithm::OmniScale;
+    }
+
+    /**
+     * Scale input into every output, the factor of each inferred from its size
+     *
+     * For HQ, Scale and OmniScale all outputs come from one sweep over
+     * input; otherwise, and for a single output, each is scaled with
+     * unified_scaler. Every output is identical to what
+     * unified_scaler::scale(input, output, algo) writes, and all outputs
+     * are checked before any is written. The shared sweep runs on the
+     * calling thread.
+     *
+     * @throws std::runtime_error if an output is not uniformly scaled
+     * @throws unsupported_scale_exception if algo does not support an output's scale
+     * @throws dimension_mismatch_exception if an output is not an exact multiple
+     */
+    template<typename InputImage, typename OutputImage>
+    void scale_multi(const InputImage& input, std::vector <OutputImage>& outputs, algorithm algo) {
+        using image_scaler = unified_scaler <InputImage, OutputImage>;
+        using pixel = std::decay_t <decltype(input.get_pixel(0, 0))>;
+
+        std::array <std::vector <OutputImage*>, 5> targets;
+        for (auto& output : outputs) {
+            const float scale_factor = image_scaler::infer_scale_factor(input, output);
+            if (!scaler_capabilities::is_scale_supported(algo, scale_factor)) {
+                throw unsupported_scale_exception(algo, scale_factor, scaler_capabilities::get_supported_scales(algo));
+            }
+            const auto expected = image_scaler::calculate_output_dimensions(input, algo, scale_factor);
+            if (output.width() != expected.width || output.height() != expected.height) {
+                throw dimension_mismatch_exception(algo, input.width(), input.height(),
+                                                   output.width(), output.height(),
+                                                   expected.width, expected.height);
+            }
+            if (is_multi_scale_shared(algo)) {
+                // Their factors are 2, 3 and 4
+                targets[static_cast <size_t>(scale_factor)].push_back(&output);
+            }
+        }
+
+        if (!is_multi_scale_shared(algo) || outputs.size() < 2) {
+            for (auto& output : outputs) {
+                image_scaler::scale(input, output, algo);
+            }
+            return;
+        }
+
+        switch (algo) {
+            case algorithm::HQ:
+                detail::scale_multi_sweep <detail::hq_multi_family <pixel>>(input, targets);
+                break;
+            case algorithm::Scale:
+                detail::scale_multi_sweep <detail::scale_multi_family <pixel>>(input, targets);
+                break;
+            default:
+                detail::scale_multi_sweep <detail::omniscale_multi_family <pixel>>(input, targets);
+                break;
+        }
+    }
+
+    /**
+     * Scale input by each of scale_factors with algo
+     *
+     * @return One image per factor, in the same order
+     * @throws unsupported_scale_exception if algo does not support a factor
+     */
+    template<typename InputImage, typename OutputImage>
+    std::vector <OutputImage> scale_multi(const InputImage& input, algorithm algo,
+                                          const std::vector <float>& scale_factors) {
+        using image_scaler = unified_scaler <InputImage, OutputImage>;
+
+        std::vector <OutputImage> outputs;
+        outputs.reserve(scale_factors.size());
+        for (float scale_factor : scale_factors) {
+            if (!scaler_capabilities::is_scale_supported(algo, scale_factor)) {
+                throw unsupported_scale_exception(algo, scale_factor, scaler_capabilities::get_supported_scales(algo));
+            }
+            const auto dims = image_scaler::calculate_output_dimensions(input, algo, scale_factor);
+            outputs.emplace_back(dims.width, dims.height, input);
+        }
+        scale_multi(input, outputs, algo);
+        return outputs;
+    }
+
+} // namespace scaler
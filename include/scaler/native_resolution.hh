@@ -0,0 +1,192 @@
+/**
+ * @file native_resolution.hh
+ * @brief Detection of pixel art that was already nearest-upscaled
+ *
+ * Pixel art is often distributed blown up 2x-8x with nearest-neighbour
+ * scaling. Running an edge-aware scaler on such an image costs block_width
+ * * block_height times more work than running it on the original pixels and
+ * looks worse, since the blocks hide the diagonal patterns the scalers
+ * look for. detect_native_grid() recovers the block size and grid offset;
+ * unified_scaler::scale_native() uses it to scale at native resolution.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+
+namespace scaler {
+
+    /**
+     * Grid of equal-colour blocks an image was upscaled with
+     *
+     * Block boundaries lie at offset + k * block along each axis; a non-zero
+     * offset means the image was cropped and its first block is partial.
+     */
+    struct native_grid {
+        size_t block_width = 1;
+        size_t block_height = 1;
+        size_t offset_x = 0;
+        size_t offset_y = 0;
+
+        /// True if the image is made of blocks larger than one pixel
+        [[nodiscard]] bool detected() const { return block_width > 1 || block_height > 1; }
+
+        /// Native pixels across an image this many pixels wide
+        [[nodiscard]] size_t native_width(size_t width) const {
+            return cells(width, block_width, offset_x);
+        }
+
+        /// Native pixels down an image this many pixels high
+        [[nodiscard]] size_t native_height(size_t height) const {
+            return cells(height, block_height, offset_y);
+        }
+
+        /// First image column of native column nx
+        [[nodiscard]] size_t cell_x(size_t nx) const { return cell_start(nx, block_width, offset_x); }
+
+        /// First image row of native row ny
+        [[nodiscard]] size_t cell_y(size_t ny) const { return cell_start(ny, block_height, offset_y); }
+
+        /// Image position where native cell 0 would start if it were whole (<= 0)
+        [[nodiscard]] double origin_x() const { return origin(block_width, offset_x); }
+        [[nodiscard]] double origin_y() const { return origin(block_height, offset_y); }
+
+        private:
+            static size_t cells(size_t size, size_t block, size_t offset) {
+                return (offset > 0 ? 1 : 0) + (size - std::min(offset, size) + block - 1) / block;
+            }
+
+            static size_t cell_start(size_t index, size_t block, size_t offset) {
+                if (offset == 0) {
+                    return index * block;
+                }
+                return index == 0 ? 0 : offset + (index - 1) * block;
+            }
+
+            static double origin(size_t block, size_t offset) {
+                return offset == 0 ? 0.0 : static_cast<double>(offset) - static_cast<double>(block);
+            }
+    };
+
+    namespace detail {
+
+        /**
+         * Block size and offset along one axis from run boundaries
+         *
+         * Every position where a sampled line changes colour must be a block
+         * boundary, so the block size divides the distance between any two
+         * of them: it is the gcd of the distances to the first boundary.
+         * Returns block 1 as soon as the gcd drops to 1.
+         *
+         * @param pixel_at (line, position) -> pixel
+         */
+        template<typename PixelAt>
+        void detect_axis(size_t length, size_t lines, size_t max_block, PixelAt&& pixel_at,
+                         size_t& block, size_t& offset) {
+            block = 1;
+            offset = 0;
+            if (length < 2 || lines == 0) {
+                return;
+            }
+
+            // Sample up to 64 evenly spaced lines
+            const size_t samples = std::min <size_t>(lines, 64);
+            size_t first = 0;
+            size_t divisor = 0;
+            for (size_t s = 0; s < samples; ++s) {
+                const size_t line = samples == 1 ? 0 : s * (lines - 1) / (samples - 1);
+                auto previous = pixel_at(line, 0);
+                for (size_t i = 1; i < length; ++i) {
+                    const auto current = pixel_at(line, i);
+                    if (!(current == previous)) {
+                        if (first == 0) {
+                            first = i;
+                        } else {
+                            divisor = std::gcd(divisor, i > first ? i - first : first - i);
+                            if (divisor == 1) {
+                                return;
+                            }
+                        }
+                        previous = current;
+                    }
+                }
+            }
+
+            // A single boundary position says nothing about the block size
+            if (divisor < 2 || divisor > max_block || length / divisor < 2) {
+                return;
+            }
+            block = divisor;
+            offset = first % divisor;
+        }
+
+        /**
+         * Check that every pixel equals the first pixel of its block
+         */
+        template<typename InputImage>
+        bool grid_matches(const InputImage& image, const native_grid& grid) {
+            const size_t width = image.width();
+            const size_t height = image.height();
+            const size_t native_w = grid.native_width(width);
+            const size_t native_h = grid.native_height(height);
+
+            for (size_t ny = 0; ny < native_h; ++ny) {
+                const size_t top = grid.cell_y(ny);
+                const size_t bottom = std::min(height, grid.cell_y(ny + 1));
+                for (size_t nx = 0; nx < native_w; ++nx) {
+                    const size_t left = grid.cell_x(nx);
+                    const size_t right = std::min(width, grid.cell_x(nx + 1));
+                    const auto anchor = image.get_pixel(left, top);
+                    for (size_t y = top; y < bottom; ++y) {
+                        for (size_t x = left; x < right; ++x) {
+                            if (!(image.get_pixel(x, y) == anchor)) {
+                                return false;
+                            }
+                        }
+                    }
+                }
+            }
+            return true;
+        }
+
+    } // namespace detail
+
+    /**
+     * Find the block grid of a nearest-upscaled image
+     *
+     * Run boundaries of up to 64 sampled rows give the block width and
+     * horizontal offset, sampled columns give the block height; one pass
+     * over the image then confirms every block is uniform. An image that
+     * fails the check, or whose blocks would exceed max_block, reports a
+     * 1x1 grid. The cost is about one read of each pixel, a small part of
+     * any edge-aware scale.
+     *
+     * @example
+     * @code
+     * auto grid = scaler::detect_native_grid(input);
+     * if (grid.detected()) {
+     *     std::cout << "upscaled " << grid.block_width << "x\n";
+     * }
+     * @endcode
+     */
+    template<typename InputImage>
+    native_grid detect_native_grid(const InputImage& image, size_t max_block = 16) {
+        native_grid grid;
+        const size_t width = image.width();
+        const size_t height = image.height();
+
+        detail::detect_axis(width, height, max_block,
+                            [&image](size_t y, size_t x) { return image.get_pixel(x, y); },
+                            grid.block_width, grid.offset_x);
+        detail::detect_axis(height, width, max_block,
+                            [&image](size_t x, size_t y) { return image.get_pixel(x, y); },
+                            grid.block_height, grid.offset_y);
+
+        if (grid.detected() && !detail::grid_matches(image, grid)) {
+            return {};
+        }
+        return grid;
+    }
+
+} // namespace scaler
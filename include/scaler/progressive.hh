@@ -0,0 +1,389 @@
+/**
+ * @file progressive.hh
+ * @brief Instant preview scaling refined tile by tile in the background
+ *
+ * An interactive view should not wait for xBR or HQ on a large canvas.
+ * progressive_scaler returns a cheap nearest (or bilinear) result right
+ * away and scales the requested algorithm in tiles on worker threads,
+ * visible tiles first. Each finished tile is handed to a callback; starting
+ * again with new parameters cancels whatever is still pending.
+ *
+ * @code
+ * scaler::progressive_scaler<> refiner;
+ * view.show(refiner.start(canvas, scaler::algorithm::xBR, 4, view.visible_rect(),
+ *                         [&](const scaler::progressive_tile<>& tile) {
+ *                             view.post_tile(tile);   // called on a worker thread
+ *                         }));
+ * // on scroll:
+ * refiner.set_viewport(view.visible_rect());
+ * @endcode
+ */
+#pragma once
+
+#include <scaler/algorithm.hh>
+#include <scaler/image.hh>
+#include <scaler/image_base.hh>
+#include <scaler/unified_scaler.hh>
+#include <scaler/cpu/band_parallel.hh>
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace scaler {
+
+    /**
+     * Rectangle in pixels
+     */
+    struct progressive_rect {
+        size_t x = 0;
+        size_t y = 0;
+        size_t width = 0;
+        size_t height = 0;
+
+        [[nodiscard]] bool empty() const { return width == 0 || height == 0; }
+
+        [[nodiscard]] bool intersects(const progressive_rect& other) const {
+            return !empty() && !other.empty() &&
+                   x < other.x + other.width && other.x < x + width &&
+                   y < other.y + other.height && other.y < y + height;
+        }
+    };
+
+    /**
+     * One refined tile of the scaled image
+     */
+    template<typename Pixel = uvec3>
+    struct progressive_tile {
+        /// start() call this tile belongs to
+        std::uint64_t generation = 0;
+        /// Where the tile goes, in output pixels
+        progressive_rect rect;
+        /// rect.width x rect.height pixels, identical to that part of a whole-image scale
+        image <Pixel> pixels;
+    };
+
+    struct progressive_options {
+        /// Worker threads, 0 = hardware concurrency
+        unsigned threads = 0;
+        /// Tile edge in input pixels
+        size_t tile_size = 64;
+        /// Algorithm of the immediate result; Nearest is used where it cannot scale
+        algorithm preview = algorithm::Nearest;
+    };
+
+    namespace detail {
+
+        /**
+         * The rect part of another input image, seen as an image of its own
+         */
+        template<typename InputImage>
+        class region_view : public input_image_base <region_view <InputImage>,
+                                                     typename InputImage::pixel_type> {
+            public:
+                using pixel_type = typename InputImage::pixel_type;
+
+                region_view(const InputImage& image, const progressive_rect& rect)
+                    : image_(image), rect_(rect) {
+                }
+
+                [[nodiscard]] size_t width_impl() const { return rect_.width; }
+                [[nodiscard]] size_t height_impl() const { return rect_.height; }
+
+                [[nodiscard]] pixel_type get_pixel_impl(size_t x, size_t y) const {
+                    return image_.get_pixel(x + rect_.x, y + rect_.y);
+                }
+
+            private:
+                const InputImage& image_;
+                progressive_rect rect_;
+        };
+
+        /**
+         * Scale the tile part of source exactly as a whole-image scale would
+         *
+         * The tile is scaled together with band_halo_rows() of context on
+         * every side, then cropped; the kernels reach as far sideways as
+         * they do vertically.
+         */
+        template<typename Pixel>
+        image <Pixel> scale_tile(const image <Pixel>& source, const progressive_rect& tile,
+                                 algorithm algo, size_t factor) {
+            const size_t halo = band_halo_rows(algo);
+            const size_t left = tile.x > halo ? tile.x - halo : 0;
+            const size_t top = tile.y > halo ? tile.y - halo : 0;
+            const size_t right = std::min(source.width(), tile.x + tile.width + halo);
+            const size_t bottom = std::min(source.height(), tile.y + tile.height + halo);
+
+            const region_view <image <Pixel>> view(source, {left, top, right - left, bottom - top});
+            image <Pixel> scaled((right - left) * factor, (bottom - top) * factor);
+            // Tiles already run on the refinement workers; scale each one serially
+            unified_scaler <region_view <image <Pixel>>, image <Pixel>>::scale(view, scaled, algo,
+                                                                                detail::band_plan{});
+
+            image <Pixel> pixels(tile.width * factor, tile.height * factor);
+            const size_t offset_x = (tile.x - left) * factor;
+            const size_t offset_y = (tile.y - top) * factor;
+            for (size_t y = 0; y < pixels.height(); ++y) {
+                const auto from = scaled.row(y + offset_y);
+                std::copy(from.begin() + offset_x, from.begin() + offset_x + pixels.width(), pixels.row(y).begin());
+            }
+            return pixels;
+        }
+
+    } // namespace detail
+
+    /**
+     * Preview-then-refine scaler for interactive views
+     *
+     * start() copies the input, scales it with the preview algorithm on the
+     * calling thread and returns that result; the requested algorithm then
+     * runs on the worker threads one tile of tile_size input pixels at a
+     * time. Pending tiles are taken in order of viewport visibility, then of
+     * distance from the viewport centre, and set_viewport() reorders them.
+     *
+     * Tiles are delivered through the callback on worker threads, one at a
+     * time per worker, and the first may arrive before start() has returned;
+     * a view typically posts them to its UI thread and paints them over the
+     * preview there. A new start() or cancel() drops all pending tiles and
+     * returns only once no callback of the old generation is running, so no
+     * stale tile arrives afterwards. Tiles being scaled at that moment are
+     * finished and discarded. Neither may be called from the callback.
+     *
+     * Interactive latency is the preview scale plus at most one callback.
+     */
+    template<typename Pixel = uvec3>
+    class progressive_scaler {
+        public:
+            using tile_callback = std::function <void(const progressive_tile <Pixel>&)>;
+
+            explicit progressive_scaler(progressive_options options = {})
+                : options_(options) {
+                if (options_.threads == 0) {
+                    options_.threads = std::max(1u, std::thread::hardware_concurrency());
+                }
+                options_.tile_size = std::max <size_t>(options_.tile_size, 1);
+                workers_.reserve(options_.threads);
+                for (unsigned i = 0; i < options_.threads; ++i) {
+                    workers_.emplace_back([this] { worker_loop(); });
+                }
+            }
+
+            progressive_scaler(const progressive_scaler&) = delete;
+            progressive_scaler& operator=(const progressive_scaler&) = delete;
+
+            ~progressive_scaler() {
+                {
+                    std::lock_guard <std::mutex> lock(mutex_);
+                    stopping_ = true;
+                    queue_.clear();
+                }
+                work_ready_.notify_all();
+                for (auto& worker : workers_) {
+                    worker.join();
+                }
+            }
+
+            /**
+             * Cancel pending work, return the preview of input scaled by
+             * factor and start refining it with algo
+             *
+             * @param viewport Visible part of the output, in output pixels
+             * @param on_tile Receives each refined tile (on a worker thread);
+             *                never called if algo is the preview algorithm
+             * @throws unsupported_scale_exception if algo does not support factor
+             */
+            template<typename InputImage>
+            image <Pixel> start(const InputImage& input, algorithm algo, size_t factor,
+                                const progressive_rect& viewport, tile_callback on_tile) {
+                const auto scale = static_cast<float>(factor);
+                if (!scaler_capabilities::is_scale_supported(algo, scale)) {
+                    throw unsupported_scale_exception(algo, scale, scaler_capabilities::get_supported_scales(algo));
+                }
+
+                auto source = std::make_shared <image <Pixel>>(input.width(), input.height());
+                for (size_t y = 0; y < input.height(); ++y) {
+                    const auto line = source->row(y);
+                    for (size_t x = 0; x < input.width(); ++x) {
+                        line[x] = input.get_pixel(x, y);
+                    }
+                }
+
+                cancel();
+
+                const algorithm preview = scaler_capabilities::is_scale_supported(options_.preview, scale)
+                                              ? options_.preview
+                                              : algorithm::Nearest;
+                image <Pixel> result(input.width() * factor, input.height() * factor);
+                unified_scaler <image <Pixel>, image <Pixel>>::scale(*source, result, preview);
+                if (algo == preview) {
+                    return result;
+                }
+
+                auto callback = std::make_shared <const tile_callback>(std::move(on_tile));
+                {
+                    std::lock_guard <std::mutex> lock(mutex_);
+                    failure_ = nullptr;
+                    viewport_ = viewport;
+                    const size_t tile = options_.tile_size;
+                    for (size_t y = 0; y < input.height(); y += tile) {
+                        for (size_t x = 0; x < input.width(); x += tile) {
+                            const progressive_rect rect{x, y, std::min(tile, input.width() - x),
+                                                        std::min(tile, input.height() - y)};
+                            queue_.push_back({generation_, source, callback, algo, factor, rect});
+                        }
+                    }
+                    sort_queue();
+                }
+                work_ready_.notify_all();
+                return result;
+            }
+
+            /**
+             * Reprioritize pending tiles for a new visible area (output pixels)
+             */
+            void set_viewport(const progressive_rect& viewport) {
+                std::lock_guard <std::mutex> lock(mutex_);
+                viewport_ = viewport;
+                sort_queue();
+            }
+
+            /**
+             * Drop pending tiles; returns once no callback of the current
+             * generation is running
+             */
+            void cancel() {
+                std::unique_lock <std::mutex> lock(mutex_);
+                ++generation_;
+                queue_.clear();
+                idle_.wait(lock, [this] { return delivering_ == 0; });
+            }
+
+            /**
+             * Block until every tile of the current generation was delivered
+             * @throws whatever scaling a tile or the callback threw
+             */
+            void wait() {
+                std::unique_lock <std::mutex> lock(mutex_);
+                idle_.wait(lock, [this] { return (queue_.empty() && active_ == 0) || failure_; });
+                if (failure_) {
+                    std::rethrow_exception(std::exchange(failure_, nullptr));
+                }
+            }
+
+            /// Identifies the latest start(); delivered tiles carry it
+            [[nodiscard]] std::uint64_t generation() const {
+                std::lock_guard <std::mutex> lock(mutex_);
+                return generation_;
+            }
+
+            /// Tiles of the current generation not yet taken by a worker
+            [[nodiscard]] size_t pending_tiles() const {
+                std::lock_guard <std::mutex> lock(mutex_);
+                return queue_.size();
+            }
+
+            [[nodiscard]] unsigned threads() const { return options_.threads; }
+
+        private:
+            struct job {
+                std::uint64_t generation = 0;
+                std::shared_ptr <const image <Pixel>> source;
+                std::shared_ptr <const tile_callback> callback;
+                algorithm algo = algorithm::Nearest;
+                size_t factor = 1;
+                progressive_rect rect;   ///< In input pixels
+            };
+
+            // Called with mutex_ held: the most urgent job goes to the back
+            void sort_queue() {
+                const auto centre_x = static_cast<double>(viewport_.x) + static_cast<double>(viewport_.width) / 2;
+                const auto centre_y = static_cast<double>(viewport_.y) + static_cast<double>(viewport_.height) / 2;
+                auto urgency = [&](const job& item) {
+                    const progressive_rect out{item.rect.x * item.factor, item.rect.y * item.factor,
+                                               item.rect.width * item.factor, item.rect.height * item.factor};
+                    const double dx = static_cast<double>(out.x) + static_cast<double>(out.width) / 2 - centre_x;
+                    const double dy = static_cast<double>(out.y) + static_cast<double>(out.height) / 2 - centre_y;
+                    return std::make_pair(!out.intersects(viewport_), dx * dx + dy * dy);
+                };
+                std::sort(queue_.begin(), queue_.end(),
+                          [&](const job& a, const job& b) { return urgency(b) < urgency(a); });
+            }
+
+            void worker_loop() {
+                while (true) {
+                    job item;
+                    {
+                        std::unique_lock <std::mutex> lock(mutex_);
+                        work_ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                        if (stopping_) {
+                            return;
+                        }
+                        item = std::move(queue_.back());
+                        queue_.pop_back();
+                        ++active_;
+                    }
+
+                    std::exception_ptr failure;
+                    try {
+                        progressive_tile <Pixel> tile;
+                        tile.generation = item.generation;
+                        tile.rect = {item.rect.x * item.factor, item.rect.y * item.factor,
+                                     item.rect.width * item.factor, item.rect.height * item.factor};
+                        tile.pixels = detail::scale_tile(*item.source, item.rect, item.algo, item.factor);
+
+                        bool current = false;
+                        {
+                            std::lock_guard <std::mutex> lock(mutex_);
+                            current = item.generation == generation_;
+                            if (current) {
+                                ++delivering_;
+                            }
+                        }
+                        if (current) {
+                            try {
+                                (*item.callback)(tile);
+                            } catch (...) {
+                                failure = std::current_exception();
+                            }
+                            std::lock_guard <std::mutex> lock(mutex_);
+                            --delivering_;
+                        }
+                    } catch (...) {
+                        failure = std::current_exception();
+                    }
+
+                    {
+                        std::lock_guard <std::mutex> lock(mutex_);
+                        --active_;
+                        if (failure && item.generation == generation_ && !failure_) {
+                            failure_ = failure;
+                        }
+                    }
+                    idle_.notify_all();
+                }
+            }
+
+            progressive_options options_;
+
+            mutable std::mutex mutex_;
+            std::condition_variable work_ready_;
+            std::condition_variable idle_;
+            std::vector <job> queue_;
+            progressive_rect viewport_;
+            std::uint64_t generation_ = 0;
+            size_t active_ = 0;
+            size_t delivering_ = 0;
+            std::exception_ptr failure_;
+            bool stopping_ = false;
+            std::vector <std::thread> workers_;
+    };
+
+} // namespace scaler
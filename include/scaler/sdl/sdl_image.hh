@@ -1,6 +1,7 @@
 #pragma once
 
 #include <scaler/sdl/sdl_compat.hh>
+#include <scaler/sdl/sdl_pixel_codec.hh>
 #include <scaler/image_base.hh>
 #include <scaler/vec3.hh>
 #include <algorithm>
@@ -19,7 +20,8 @@ namespace scaler {
                   m_bpp(static_cast<unsigned int>(surface->format->BytesPerPixel)),
                   m_details(surface->format),
         #endif
-                  m_palette(SDL_GetSurfacePalette(surface)) {}
+                  m_palette(SDL_GetSurfacePalette(surface)),
+                  m_codec(detail::sdl_surface_format(surface), m_details, m_palette) {}
 
             [[nodiscard]] size_t width_impl() const {
                 return static_cast<size_t>(m_surface->w);
@@ -33,34 +35,7 @@ namespace scaler {
                 const Uint8* const src_pixel = static_cast<const Uint8*>(m_surface->pixels)
                                                + y * static_cast<size_t>(m_surface->pitch)
                                                + x * m_bpp;
-
-                Uint32 pixel;
-                switch (m_bpp) {
-                    case 1:
-                        pixel = *src_pixel;
-                        break;
-                    case 2:
-                        pixel = *reinterpret_cast<const Uint16*>(src_pixel);
-                        break;
-                    case 3:
-                        if constexpr (SDL_BYTEORDER == SDL_BIG_ENDIAN) {
-                            pixel = static_cast<Uint32>(src_pixel[0]) << 16 | static_cast<Uint32>(src_pixel[1]) << 8 | static_cast<Uint32>(src_pixel[2]);
-                        } else {
-                            pixel = static_cast<Uint32>(src_pixel[0]) | static_cast<Uint32>(src_pixel[1]) << 8 | static_cast<Uint32>(src_pixel[2]) << 16;
-                        }
-                        break;
-                    case 4:
-                        pixel = *reinterpret_cast<const Uint32*>(src_pixel);
-                        break;
-                    default:
-                        return {0, 0, 0};
-                }
-
-                Uint8 r, g, b;
-                SDL_GetRGB(pixel, m_details, m_palette, &r, &g, &b);
-                return {static_cast<unsigned int>(r),
-                        static_cast<unsigned int>(g),
-                        static_cast<unsigned int>(b)};
+                return m_codec.decode(src_pixel);
             }
 
         private:
@@ -68,6 +43,7 @@ namespace scaler {
             unsigned int m_bpp;
             const SDL_PixelFormatDetails* m_details;
             SDL_Palette* m_palette;
+            sdl_pixel_codec m_codec;
     };
 
     class sdl_output_image : public output_image_base<sdl_output_image, uvec3> {
@@ -107,6 +83,8 @@ namespace scaler {
                 if (SDL_GetSurfaceColorKey(const_cast<SDL_Surface*>(template_surface), &color_key)) {
                     SDL_SetSurfaceColorKey(m_surface, true, color_key);
                 }
+
+                m_codec = sdl_pixel_codec(detail::sdl_surface_format(template_surface), m_details, m_palette);
             }
 
             // Constructor with sdl_input_image template
@@ -117,8 +95,27 @@ namespace scaler {
             sdl_output_image(size_t width, size_t height, const sdl_output_image& template_img)
                 : sdl_output_image(width, height, template_img.m_surface) {}
 
+            /**
+             * @brief Write into an existing surface without taking ownership
+             *
+             * The surface (and its palette) must outlive this image. Used to
+             * scale into caller-owned or cached surfaces without allocating.
+             */
+            explicit sdl_output_image(SDL_Surface* target)
+                : m_surface(target),
+                  m_palette(SDL_GetSurfacePalette(target)),
+        #ifdef SCALER_HAS_SDL3
+                  m_details(SDL_GetPixelFormatDetails(target->format)),
+                  m_bpp(static_cast<unsigned int>(SDL_BYTESPERPIXEL(target->format))),
+        #else
+                  m_details(target->format),
+                  m_bpp(static_cast<unsigned int>(target->format->BytesPerPixel)),
+        #endif
+                  m_codec(detail::sdl_surface_format(target), m_details, m_palette),
+                  m_owned(false) {}
+
             ~sdl_output_image() {
-                if (m_surface) {
+                if (m_surface && m_owned) {
                     SDL_DestroySurface(m_surface);
                 }
             }
@@ -128,20 +125,24 @@ namespace scaler {
                 : m_surface(other.m_surface),
                   m_palette(other.m_palette),
                   m_details(other.m_details),
-                  m_bpp(other.m_bpp) {
+                  m_bpp(other.m_bpp),
+                  m_codec(other.m_codec),
+                  m_owned(other.m_owned) {
                 other.m_surface = nullptr;
             }
 
             // Move assignment
             sdl_output_image& operator=(sdl_output_image&& other) noexcept {
                 if (this != &other) {
-                    if (m_surface) {
+                    if (m_surface && m_owned) {
                         SDL_DestroySurface(m_surface);
                     }
                     m_surface = other.m_surface;
                     m_palette = other.m_palette;
                     m_details = other.m_details;
                     m_bpp = other.m_bpp;
+                    m_codec = other.m_codec;
+                    m_owned = other.m_owned;
                     other.m_surface = nullptr;
                 }
                 return *this;
@@ -186,74 +187,17 @@ namespace scaler {
             }
 
             void set_pixel_impl(size_t x, size_t y, const uvec3& pixel) {
-                Uint32 color = SDL_MapRGB(m_details, m_palette,
-                                          static_cast<Uint8>(pixel.x),
-                                          static_cast<Uint8>(pixel.y),
-                                          static_cast<Uint8>(pixel.z));
-
                 Uint8* const target_pixel = static_cast<Uint8*>(m_surface->pixels)
                                            + y * static_cast<size_t>(m_surface->pitch)
                                            + x * m_bpp;
-
-                switch (m_bpp) {
-                    case 1:
-                        *target_pixel = static_cast<Uint8>(color);
-                        break;
-                    case 2:
-                        *reinterpret_cast<Uint16*>(target_pixel) = static_cast<Uint16>(color);
-                        break;
-                    case 3:
-                        if constexpr (SDL_BYTEORDER == SDL_BIG_ENDIAN) {
-                            target_pixel[0] = (color >> 16) & 0xff;
-                            target_pixel[1] = (color >> 8) & 0xff;
-                            target_pixel[2] = color & 0xff;
-                        } else {
-                            target_pixel[0] = color & 0xff;
-                            target_pixel[1] = (color >> 8) & 0xff;
-                            target_pixel[2] = (color >> 16) & 0xff;
-                        }
-                        break;
-                    case 4:
-                        *reinterpret_cast<Uint32*>(target_pixel) = color;
-                        break;
-                    default:
-                        // Should not happen with valid SDL surfaces
-                        break;
-                }
+                m_codec.encode(target_pixel, pixel);
             }
 
             [[nodiscard]] uvec3 get_pixel_impl(size_t x, size_t y) const {
                 const Uint8* const src_pixel = static_cast<const Uint8*>(m_surface->pixels)
                                                + y * static_cast<size_t>(m_surface->pitch)
                                                + x * m_bpp;
-
-                Uint32 pixel;
-                switch (m_bpp) {
-                    case 1:
-                        pixel = *src_pixel;
-                        break;
-                    case 2:
-                        pixel = *reinterpret_cast<const Uint16*>(src_pixel);
-                        break;
-                    case 3:
-                        if constexpr (SDL_BYTEORDER == SDL_BIG_ENDIAN) {
-                            pixel = static_cast<Uint32>(src_pixel[0]) << 16 | static_cast<Uint32>(src_pixel[1]) << 8 | static_cast<Uint32>(src_pixel[2]);
-                        } else {
-                            pixel = static_cast<Uint32>(src_pixel[0]) | static_cast<Uint32>(src_pixel[1]) << 8 | static_cast<Uint32>(src_pixel[2]) << 16;
-                        }
-                        break;
-                    case 4:
-                        pixel = *reinterpret_cast<const Uint32*>(src_pixel);
-                        break;
-                    default:
-                        return {0, 0, 0};
-                }
-
-                Uint8 r, g, b;
-                SDL_GetRGB(pixel, m_details, m_palette, &r, &g, &b);
-                return {static_cast<unsigned int>(r),
-                        static_cast<unsigned int>(g),
-                        static_cast<unsigned int>(b)};
+                return m_codec.decode(src_pixel);
             }
 
             [[nodiscard]] SDL_Surface* get_surface() const {
@@ -271,5 +215,7 @@ namespace scaler {
             SDL_Palette* m_palette;
             const SDL_PixelFormatDetails* m_details;
             unsigned int m_bpp;
+            sdl_pixel_codec m_codec;
+            bool m_owned = true;
     };
 }
\ No newline at end of file
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <scaler/sdl/sdl_compat.hh>
+#include <scaler/compiler_compat.hh>
+#include <scaler/vec3.hh>
+#include <cstddef>
+#include <cstring>
+
+namespace scaler {
+    namespace detail {
+        inline unsigned int mask_shift(Uint32 mask) {
+            if (mask == 0) {
+                return 0;
+            }
+            unsigned int shift = 0;
+            while ((mask & 1u) == 0) {
+                mask >>= 1;
+                ++shift;
+            }
+            return shift;
+        }
+
+        inline unsigned int mask_bits(Uint32 mask) {
+            unsigned int bits = 0;
+            while (mask) {
+                bits += mask & 1u;
+                mask >>= 1;
+            }
+            return bits;
+        }
+
+        inline Uint32 sdl_surface_format(const SDL_Surface* surface) {
+#ifdef SCALER_HAS_SDL3
+            return static_cast<Uint32>(surface->format);
+#else
+            return surface->format->format;
+#endif
+        }
+    }
+
+    /**
+     * @brief Format-specialized pixel encoder/decoder for SDL pixel memory
+     *
+     * Resolves the channel layout of an SDL pixel format once, so per-pixel
+     * access becomes a few shifts and a table lookup instead of an
+     * SDL_GetRGB/SDL_MapRGB call.
+     * The results are identical to SDL's own conversion for every format the
+     * codec specializes:
+     * - packed formats whose channels are at most 8 bits wide (8888, 888, 565, 555, 4444, ...)
+     * - 8-bit indexed formats (decoding through the palette)
+     *
+     * Everything else (10-bit channels, FOURCC, ...) and indexed encoding fall
+     * back to SDL_GetRGB/SDL_MapRGB.
+     */
+    class sdl_pixel_codec {
+        public:
+            enum class layout { packed, indexed, generic };
+
+            sdl_pixel_codec() = default;
+
+            sdl_pixel_codec(Uint32 format, const SDL_PixelFormatDetails* details, const SDL_Palette* palette)
+                : m_details(details),
+                  m_palette(palette),
+                  m_bpp(static_cast<unsigned int>(SDL_BYTESPERPIXEL(format))) {
+                if (m_bpp == 1 && palette) {
+                    m_layout = layout::indexed;
+                    return;
+                }
+
+                const Uint32 masks[4] = {details->Rmask, details->Gmask, details->Bmask, details->Amask};
+                bool packed = m_bpp >= 2 && m_bpp <= 4;
+                for (int i = 0; i < 4 && packed; ++i) {
+                    const unsigned int bits = detail::mask_bits(masks[i]);
+                    packed = i == 3 ? bits <= 8 : (bits > 0 && bits <= 8);
+                    m_shift[i] = detail::mask_shift(masks[i]);
+                    m_bits[i] = bits;
+                }
+                m_layout = packed ? layout::packed : layout::generic;
+                m_alpha_mask = details->Amask;
+
+                // Channels narrower than 8 bits are widened through SDL itself,
+                // so rounding matches SDL_GetRGB exactly
+                if (m_layout == layout::packed) {
+                    for (int c = 0; c < 3; ++c) {
+                        const unsigned int levels = 1u << m_bits[c];
+                        for (unsigned int v = 0; v < levels; ++v) {
+                            Uint8 rgb[3];
+                            SDL_GetRGB(static_cast<Uint32>(v) << m_shift[c], m_details, m_palette,
+                                       &rgb[0], &rgb[1], &rgb[2]);
+                            m_expand[c][v] = rgb[c];
+                        }
+                    }
+                }
+            }
+
+            [[nodiscard]] layout get_layout() const {
+                return m_layout;
+            }
+
+            [[nodiscard]] unsigned int bytes_per_pixel() const {
+                return m_bpp;
+            }
+
+            [[nodiscard]] SCALER_FORCE_INLINE uvec3 decode(const Uint8* src) const {
+                const Uint32 pixel = load(src);
+                switch (m_layout) {
+                    case layout::packed:
+                        return {expand(pixel, 0), expand(pixel, 1), expand(pixel, 2)};
+                    case layout::indexed: {
+                        const int index = static_cast<int>(pixel);
+                        if (index >= m_palette->ncolors) {
+                            return {0, 0, 0};
+                        }
+                        const SDL_Color& c = m_palette->colors[index];
+                        return {static_cast<unsigned int>(c.r),
+                                static_cast<unsigned int>(c.g),
+                                static_cast<unsigned int>(c.b)};
+                    }
+                    case layout::generic:
+                        break;
+                }
+
+                Uint8 r, g, b;
+                SDL_GetRGB(pixel, m_details, m_palette, &r, &g, &b);
+                return {static_cast<unsigned int>(r),
+                        static_cast<unsigned int>(g),
+                        static_cast<unsigned int>(b)};
+            }
+
+            SCALER_FORCE_INLINE void encode(Uint8* dst, const uvec3& pixel) const {
+                Uint32 color;
+                if (SCALER_LIKELY(m_layout == layout::packed)) {
+                    color = (narrow(pixel.x, 0) << m_shift[0]) |
+                            (narrow(pixel.y, 1) << m_shift[1]) |
+                            (narrow(pixel.z, 2) << m_shift[2]) |
+                            m_alpha_mask;
+                } else {
+                    color = SDL_MapRGB(m_details, m_palette,
+                                       static_cast<Uint8>(pixel.x),
+                                       static_cast<Uint8>(pixel.y),
+                                       static_cast<Uint8>(pixel.z));
+                }
+                store(dst, color);
+            }
+
+            void decode_row(const Uint8* src, uvec3* dst, size_t count) const {
+                for (size_t i = 0; i < count; ++i) {
+                    dst[i] = decode(src + i * m_bpp);
+                }
+            }
+
+            void encode_row(Uint8* dst, const uvec3* src, size_t count) const {
+                for (size_t i = 0; i < count; ++i) {
+                    encode(dst + i * m_bpp, src[i]);
+                }
+            }
+
+        private:
+            [[nodiscard]] SCALER_FORCE_INLINE Uint32 load(const Uint8* src) const {
+                switch (m_bpp) {
+                    case 1:
+                        return *src;
+                    case 2: {
+                        Uint16 v;
+                        std::memcpy(&v, src, sizeof(v));
+                        return v;
+                    }
+                    case 3:
+                        if constexpr (SDL_BYTEORDER == SDL_BIG_ENDIAN) {
+                            return static_cast<Uint32>(src[0]) << 16 | static_cast<Uint32>(src[1]) << 8 | static_cast<Uint32>(src[2]);
+                        } else {
+                            return static_cast<Uint32>(src[0]) | static_cast<Uint32>(src[1]) << 8 | static_cast<Uint32>(src[2]) << 16;
+                        }
+                    case 4: {
+                        Uint32 v;
+                        std::memcpy(&v, src, sizeof(v));
+                        return v;
+                    }
+                    default:
+                        return 0;
+                }
+            }
+
+            SCALER_FORCE_INLINE void store(Uint8* dst, Uint32 color) const {
+                switch (m_bpp) {
+                    case 1:
+                        *dst = static_cast<Uint8>(color);
+                        break;
+                    case 2: {
+                        const Uint16 v = static_cast<Uint16>(color);
+                        std::memcpy(dst, &v, sizeof(v));
+                        break;
+                    }
+                    case 3:
+                        if constexpr (SDL_BYTEORDER == SDL_BIG_ENDIAN) {
+                            dst[0] = (color >> 16) & 0xff;
+                            dst[1] = (color >> 8) & 0xff;
+                            dst[2] = color & 0xff;
+                        } else {
+                            dst[0] = color & 0xff;
+                            dst[1] = (color >> 8) & 0xff;
+                            dst[2] = (color >> 16) & 0xff;
+                        }
+                        break;
+                    case 4:
+                        std::memcpy(dst, &color, sizeof(color));
+                        break;
+                    default:
+                        break;
+                }
+            }
+
+            [[nodiscard]] SCALER_FORCE_INLINE unsigned int expand(Uint32 pixel, int channel) const {
+                const unsigned int v = (pixel >> m_shift[channel]) & ((1u << m_bits[channel]) - 1u);
+                return m_expand[channel][v];
+            }
+
+            [[nodiscard]] SCALER_FORCE_INLINE Uint32 narrow(unsigned int value, int channel) const {
+                return static_cast<Uint32>(static_cast<Uint8>(value) >> (8 - m_bits[channel]));
+            }
+
+            const SDL_PixelFormatDetails* m_details = nullptr;
+            const SDL_Palette* m_palette = nullptr;
+            unsigned int m_bpp = 0;
+            layout m_layout = layout::generic;
+            unsigned int m_shift[4] = {0, 0, 0, 0};
+            unsigned int m_bits[4] = {0, 0, 0, 0};
+            Uint32 m_alpha_mask = 0;
+            Uint8 m_expand[3][256] = {};
+    };
+}
@@ -20,6 +20,10 @@ namespace scaler {
     // NOTE: HQ3x uses an optimized fast path for images <= 4096 pixels wide.
     // For best performance with other algorithms, consider implementing similar
     // optimizations using fixed-size arrays instead of dynamic vectors.
+    // These helpers allocate a new surface per call. For per-frame use prefer
+    // sdl_scaling_context (sdl_scaling_context.hh), which caches its output
+    // surfaces, or sdl_streaming_texture (sdl_texture_image.hh), which scales
+    // straight into a reused streaming texture.
 
     inline SDL_Surface* scaleEpxSDL(SDL_Surface* src) {
         sdl_input_image input(src);
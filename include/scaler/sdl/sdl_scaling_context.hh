@@ -0,0 +1,204 @@
+#pragma once
+
+#include <scaler/sdl/sdl_compat.hh>
+#include <scaler/sdl/sdl_image.hh>
+#include <scaler/sdl/sdl_pixel_codec.hh>
+#include <scaler/unified_scaler.hh>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+namespace scaler {
+    /**
+     * @brief Reusable SDL surface scaling context
+     *
+     * Replacement for the allocate-per-call helpers in sdl_scalers.hh when
+     * scaling every frame. The algorithm is selected at runtime, and output
+     * surfaces are cached by (width, height, pixel format), so once the cache
+     * is warm no SDL_Surface is created, and palettes and color keys are only
+     * re-applied when they change.
+     *
+     * @code
+     * sdl_scaling_context ctx(algorithm::HQ, 3.0f);
+     * // per frame:
+     * SDL_Surface* scaled = ctx.scale(frame);   // owned by ctx
+     * // or into a surface you own:
+     * ctx.scale_into(frame, my_surface);
+     * @endcode
+     *
+     * @note Not thread-safe; use one context per thread.
+     */
+    class sdl_scaling_context {
+        public:
+            using scaler_type = unified_scaler<sdl_input_image, sdl_output_image>;
+
+            /**
+             * @throws unsupported_scale_exception if algorithm doesn't support the scale
+             */
+            explicit sdl_scaling_context(algorithm algo = algorithm::EPX, float scale_factor = 2.0f) {
+                set_algorithm(algo, scale_factor);
+            }
+
+            ~sdl_scaling_context() {
+                clear_cache();
+            }
+
+            sdl_scaling_context(const sdl_scaling_context&) = delete;
+            sdl_scaling_context& operator=(const sdl_scaling_context&) = delete;
+
+            /**
+             * @brief Select the algorithm and scale used by scale()
+             * @throws unsupported_scale_exception if algorithm doesn't support the scale
+             */
+            void set_algorithm(algorithm algo, float scale_factor) {
+                if (!scaler_capabilities::is_scale_supported(algo, scale_factor)) {
+                    throw unsupported_scale_exception(algo, scale_factor,
+                                                      scaler_capabilities::get_supported_scales(algo));
+                }
+                m_algorithm = algo;
+                m_scale = scale_factor;
+            }
+
+            [[nodiscard]] algorithm get_algorithm() const {
+                return m_algorithm;
+            }
+
+            [[nodiscard]] float get_scale() const {
+                return m_scale;
+            }
+
+            /**
+             * @brief Scale into a cached surface owned by the context
+             *
+             * The returned surface stays valid until clear_cache() or the
+             * context is destroyed; it is overwritten by the next scale() call
+             * that produces the same size and format.
+             */
+            SDL_Surface* scale(SDL_Surface* src) {
+                if (!src) {
+                    throw std::invalid_argument("sdl_scaling_context::scale: source surface is null");
+                }
+
+                sdl_input_image input(src);
+                auto dims = scaler_type::calculate_output_dimensions(input, m_algorithm, m_scale);
+                SDL_Surface* dst = acquire(dims.width, dims.height, src);
+                scale_locked(src, dst, m_algorithm);
+                return dst;
+            }
+
+            /**
+             * @brief Scale into a caller-owned surface
+             *
+             * The scale factor is inferred from the surface dimensions, as in
+             * unified_scaler::scale(input, output, algo); dst may use a
+             * different pixel format than src.
+             *
+             * @throws unsupported_scale_exception if the inferred scale is not supported
+             * @throws dimension_mismatch_exception if dst has the wrong size
+             */
+            void scale_into(SDL_Surface* src, SDL_Surface* dst) {
+                scale_into(src, dst, m_algorithm);
+            }
+
+            void scale_into(SDL_Surface* src, SDL_Surface* dst, algorithm algo) {
+                if (!src || !dst) {
+                    throw std::invalid_argument("sdl_scaling_context::scale_into: surface is null");
+                }
+                scale_locked(src, dst, algo);
+            }
+
+            // Number of cached output surfaces
+            [[nodiscard]] size_t cached_surface_count() const {
+                return m_cache.size();
+            }
+
+            // Number of surfaces created over the context lifetime
+            [[nodiscard]] size_t allocation_count() const {
+                return m_allocations;
+            }
+
+            void clear_cache() {
+                for (auto& entry : m_cache) {
+                    SDL_DestroySurface(entry.second);
+                }
+                m_cache.clear();
+            }
+
+        private:
+            using cache_key = std::tuple<size_t, size_t, Uint32>;
+
+            SDL_Surface* acquire(size_t width, size_t height, SDL_Surface* src) {
+                const cache_key key{width, height, detail::sdl_surface_format(src)};
+                SDL_Surface* dst;
+
+                auto it = m_cache.find(key);
+                if (it != m_cache.end()) {
+                    dst = it->second;
+                } else {
+                    sdl_output_image created(width, height, src);
+                    dst = created.release();
+                    if (!dst) {
+                        throw std::runtime_error(std::string("Failed to create output surface: ") + SDL_GetError());
+                    }
+                    m_cache.emplace(key, dst);
+                    ++m_allocations;
+                }
+
+                sync_palette_and_color_key(src, dst);
+                return dst;
+            }
+
+            static void sync_palette_and_color_key(SDL_Surface* src, SDL_Surface* dst) {
+                SDL_Palette* palette = SDL_GetSurfacePalette(src);
+                if (palette && SDL_GetSurfacePalette(dst) != palette) {
+                    SDL_SetSurfacePalette(dst, palette);
+                }
+
+                Uint32 src_key;
+                const bool src_has_key = SDL_GetSurfaceColorKey(src, &src_key);
+                Uint32 dst_key;
+                const bool dst_has_key = SDL_GetSurfaceColorKey(dst, &dst_key);
+                if (src_has_key != dst_has_key || (src_has_key && src_key != dst_key)) {
+                    SDL_SetSurfaceColorKey(dst, src_has_key, src_key);
+                }
+            }
+
+            static void scale_locked(SDL_Surface* src, SDL_Surface* dst, algorithm algo) {
+                const bool lock_src = SDL_MUSTLOCK(src);
+                const bool lock_dst = SDL_MUSTLOCK(dst);
+                if (lock_src) {
+                    SDL_LockSurface(src);
+                }
+                if (lock_dst) {
+                    SDL_LockSurface(dst);
+                }
+
+                try {
+                    sdl_input_image input(src);
+                    sdl_output_image output(dst);
+                    scaler_type::scale(input, output, algo);
+                } catch (...) {
+                    if (lock_dst) {
+                        SDL_UnlockSurface(dst);
+                    }
+                    if (lock_src) {
+                        SDL_UnlockSurface(src);
+                    }
+                    throw;
+                }
+
+                if (lock_dst) {
+                    SDL_UnlockSurface(dst);
+                }
+                if (lock_src) {
+                    SDL_UnlockSurface(src);
+                }
+            }
+
+            algorithm m_algorithm = algorithm::EPX;
+            float m_scale = 2.0f;
+            std::map<cache_key, SDL_Surface*> m_cache;
+            size_t m_allocations = 0;
+    };
+}
@@ -0,0 +1,396 @@
+#pragma once
+
+#include <scaler/sdl/sdl_compat.hh>
+#include <scaler/sdl/sdl_image.hh>
+#include <scaler/sdl/sdl_pixel_codec.hh>
+#include <scaler/unified_scaler.hh>
+#include <scaler/image_base.hh>
+#include <scaler/vec3.hh>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace scaler {
+    namespace detail {
+        /**
+         * @brief Owning reference to the pixel format details of an SDL pixel format enum
+         *
+         * SDL3 hands out cached details that must not be freed, SDL2 returns a
+         * reference-counted SDL_PixelFormat that must be released with SDL_FreeFormat.
+         */
+        class sdl_format_ref {
+            public:
+                sdl_format_ref() = default;
+
+                explicit sdl_format_ref(Uint32 format)
+                    : m_format(format) {
+#ifdef SCALER_HAS_SDL3
+                    m_details = SDL_GetPixelFormatDetails(static_cast<SDL_PixelFormat>(format));
+#else
+                    m_details = SDL_AllocFormat(format);
+#endif
+                    if (!m_details) {
+                        throw std::runtime_error(std::string("Unsupported SDL pixel format: ") + SDL_GetError());
+                    }
+                }
+
+                ~sdl_format_ref() {
+                    reset();
+                }
+
+                sdl_format_ref(sdl_format_ref&& other) noexcept
+                    : m_format(other.m_format),
+                      m_details(other.m_details) {
+                    other.m_details = nullptr;
+                }
+
+                sdl_format_ref& operator=(sdl_format_ref&& other) noexcept {
+                    if (this != &other) {
+                        reset();
+                        m_format = other.m_format;
+                        m_details = other.m_details;
+                        other.m_details = nullptr;
+                    }
+                    return *this;
+                }
+
+                sdl_format_ref(const sdl_format_ref&) = delete;
+                sdl_format_ref& operator=(const sdl_format_ref&) = delete;
+
+                [[nodiscard]] Uint32 format() const { return m_format; }
+                [[nodiscard]] const SDL_PixelFormatDetails* details() const { return m_details; }
+
+            private:
+                void reset() {
+#ifndef SCALER_HAS_SDL3
+                    if (m_details) {
+                        SDL_FreeFormat(const_cast<SDL_PixelFormat*>(m_details));
+                    }
+#endif
+                    m_details = nullptr;
+                }
+
+                Uint32 m_format = 0;
+                const SDL_PixelFormatDetails* m_details = nullptr;
+        };
+
+        inline bool sdl_is_indexed_format(Uint32 format) {
+#ifdef SCALER_HAS_SDL3
+            return SDL_ISPIXELFORMAT_INDEXED(static_cast<SDL_PixelFormat>(format));
+#else
+            return SDL_ISPIXELFORMAT_INDEXED(format);
+#endif
+        }
+    }
+
+    /**
+     * @brief Output image writing straight into caller-provided pixel memory
+     *
+     * Wraps a raw pixel buffer described by (pixels, pitch, SDL pixel format),
+     * typically the memory returned by SDL_LockTexture on a streaming texture,
+     * so kernels write the final frame in the texture's native format without
+     * an intermediate SDL_Surface. Only direct-color formats are supported;
+     * streaming textures are never indexed.
+     *
+     * The (width, height, template) constructors allocate an owned buffer and
+     * exist only so the dispatcher can create scratch images for multi-pass
+     * algorithms (xBR 3x/4x, 2xSaI, Trilinear).
+     */
+    class sdl_texture_output_image : public output_image_base<sdl_texture_output_image, uvec3> {
+        public:
+            // Scratch images use a 32-bit format so intermediate passes are lossless
+            static constexpr Uint32 scratch_format = SDL_PIXELFORMAT_ARGB8888;
+
+            sdl_texture_output_image(void* pixels, int pitch, Uint32 format, size_t width, size_t height)
+                : m_format(format),
+                  m_pixels(static_cast<Uint8*>(pixels)),
+                  m_pitch(static_cast<size_t>(pitch)),
+                  m_width(width),
+                  m_height(height) {
+                if (detail::sdl_is_indexed_format(format)) {
+                    throw std::runtime_error("sdl_texture_output_image does not support indexed pixel formats");
+                }
+                m_codec = sdl_pixel_codec(format, m_format.details(), nullptr);
+                m_bpp = m_codec.bytes_per_pixel();
+            }
+
+            // Scratch image with the same format as another texture image
+            sdl_texture_output_image(size_t width, size_t height, const sdl_texture_output_image& template_img)
+                : sdl_texture_output_image(width, height, template_img.m_format.format()) {}
+
+            // Scratch image for any other template (e.g. the source image)
+            template<typename AnyImage,
+                     typename = std::enable_if_t<!std::is_same_v<AnyImage, sdl_texture_output_image>>>
+            sdl_texture_output_image(size_t width, size_t height, [[maybe_unused]] const AnyImage& template_img)
+                : sdl_texture_output_image(width, height, scratch_format) {}
+
+            sdl_texture_output_image(sdl_texture_output_image&& other) noexcept
+                : m_format(std::move(other.m_format)),
+                  m_codec(other.m_codec),
+                  m_storage(std::move(other.m_storage)),
+                  m_pixels(other.m_pixels),
+                  m_pitch(other.m_pitch),
+                  m_width(other.m_width),
+                  m_height(other.m_height),
+                  m_bpp(other.m_bpp) {
+                other.m_pixels = nullptr;
+            }
+
+            sdl_texture_output_image& operator=(sdl_texture_output_image&& other) noexcept {
+                if (this != &other) {
+                    m_format = std::move(other.m_format);
+                    m_codec = other.m_codec;
+                    m_storage = std::move(other.m_storage);
+                    m_pixels = other.m_pixels;
+                    m_pitch = other.m_pitch;
+                    m_width = other.m_width;
+                    m_height = other.m_height;
+                    m_bpp = other.m_bpp;
+                    other.m_pixels = nullptr;
+                }
+                return *this;
+            }
+
+            sdl_texture_output_image(const sdl_texture_output_image&) = delete;
+            sdl_texture_output_image& operator=(const sdl_texture_output_image&) = delete;
+
+            [[nodiscard]] size_t width_impl() const {
+                return m_width;
+            }
+
+            [[nodiscard]] size_t height_impl() const {
+                return m_height;
+            }
+
+            // Add get_pixel method for algorithms that need to read from output
+            [[nodiscard]] uvec3 get_pixel(size_t x, size_t y) const {
+                return get_pixel_impl(x, y);
+            }
+
+            // Add safe_access for algorithms that use output as intermediate input
+            [[nodiscard]] uvec3 safe_access(int x, int y,
+                                           out_of_bounds_strategy strategy = NEAREST) const {
+                const int w = static_cast<int>(m_width);
+                const int h = static_cast<int>(m_height);
+
+                if (x < 0 || x >= w || y < 0 || y >= h) {
+                    switch (strategy) {
+                        case ZERO:
+                            return {0, 0, 0};
+                        case NEAREST:
+                            x = std::max(0, std::min(w - 1, x));
+                            y = std::max(0, std::min(h - 1, y));
+                            break;
+                    }
+                }
+
+                return get_pixel_impl(static_cast<size_t>(x), static_cast<size_t>(y));
+            }
+
+            void set_pixel_impl(size_t x, size_t y, const uvec3& pixel) {
+                m_codec.encode(m_pixels + y * m_pitch + x * m_bpp, pixel);
+            }
+
+            [[nodiscard]] uvec3 get_pixel_impl(size_t x, size_t y) const {
+                return m_codec.decode(m_pixels + y * m_pitch + x * m_bpp);
+            }
+
+            [[nodiscard]] Uint32 format() const {
+                return m_format.format();
+            }
+
+            [[nodiscard]] void* pixels() const {
+                return m_pixels;
+            }
+
+            [[nodiscard]] int pitch() const {
+                return static_cast<int>(m_pitch);
+            }
+
+        private:
+            sdl_texture_output_image(size_t width, size_t height, Uint32 format)
+                : m_format(format),
+                  m_width(width),
+                  m_height(height) {
+                m_codec = sdl_pixel_codec(format, m_format.details(), nullptr);
+                m_bpp = m_codec.bytes_per_pixel();
+                m_pitch = width * m_bpp;
+                m_storage.resize(m_pitch * height);
+                m_pixels = m_storage.data();
+            }
+
+            detail::sdl_format_ref m_format;
+            sdl_pixel_codec m_codec;
+            std::vector<Uint8> m_storage;
+            Uint8* m_pixels = nullptr;
+            size_t m_pitch = 0;
+            size_t m_width = 0;
+            size_t m_height = 0;
+            unsigned int m_bpp = 0;
+    };
+
+    /**
+     * @brief RAII lock of an SDL_TEXTUREACCESS_STREAMING texture
+     *
+     * Locks the whole texture on construction and unlocks (uploads) it on
+     * destruction. image() exposes the locked memory as an output image.
+     * Locked texture memory is write-only: every pixel must be written.
+     */
+    class sdl_texture_lock {
+        public:
+            explicit sdl_texture_lock(SDL_Texture* texture)
+                : m_texture(texture) {
+                Uint32 format = 0;
+                int w = 0;
+                int h = 0;
+#ifdef SCALER_HAS_SDL3
+                format = static_cast<Uint32>(texture->format);
+                w = texture->w;
+                h = texture->h;
+#else
+                if (SDL_QueryTexture(texture, &format, nullptr, &w, &h) != 0) {
+                    throw std::runtime_error(std::string("SDL_QueryTexture failed: ") + SDL_GetError());
+                }
+#endif
+                void* pixels = nullptr;
+                int pitch = 0;
+#ifdef SCALER_HAS_SDL3
+                if (!SDL_LockTexture(texture, nullptr, &pixels, &pitch)) {
+#else
+                if (SDL_LockTexture(texture, nullptr, &pixels, &pitch) != 0) {
+#endif
+                    throw std::runtime_error(std::string("SDL_LockTexture failed: ") + SDL_GetError());
+                }
+                m_image = std::make_unique<sdl_texture_output_image>(pixels, pitch, format,
+                                                                     static_cast<size_t>(w),
+                                                                     static_cast<size_t>(h));
+            }
+
+            ~sdl_texture_lock() {
+                SDL_UnlockTexture(m_texture);
+            }
+
+            sdl_texture_lock(const sdl_texture_lock&) = delete;
+            sdl_texture_lock& operator=(const sdl_texture_lock&) = delete;
+
+            [[nodiscard]] sdl_texture_output_image& image() {
+                return *m_image;
+            }
+
+        private:
+            SDL_Texture* m_texture;
+            std::unique_ptr<sdl_texture_output_image> m_image;
+    };
+
+    /**
+     * @brief Streaming texture reused across frames as a scaling target
+     *
+     * Keeps one SDL_TEXTUREACCESS_STREAMING texture and recreates it only when
+     * the required size or format changes. scale() locks the texture and runs
+     * the selected algorithm directly into the locked memory, so per-frame
+     * presentation costs neither a surface allocation nor an extra copy.
+     *
+     * @code
+     * sdl_streaming_texture target(renderer);
+     * // per frame:
+     * SDL_Texture* tex = target.scale(frame_surface, algorithm::HQ, 3.0f);
+     * SDL_RenderTexture(renderer, tex, nullptr, nullptr);
+     * @endcode
+     */
+    class sdl_streaming_texture {
+        public:
+            using scaler_type = unified_scaler<sdl_input_image, sdl_texture_output_image>;
+
+            explicit sdl_streaming_texture(SDL_Renderer* renderer,
+                                           Uint32 format = SDL_PIXELFORMAT_ARGB8888)
+                : m_renderer(renderer),
+                  m_format(format) {}
+
+            ~sdl_streaming_texture() {
+                if (m_texture) {
+                    SDL_DestroyTexture(m_texture);
+                }
+            }
+
+            sdl_streaming_texture(const sdl_streaming_texture&) = delete;
+            sdl_streaming_texture& operator=(const sdl_streaming_texture&) = delete;
+
+            /**
+             * @brief Make sure the texture exists with the given size and format
+             * @return The (possibly recreated) texture
+             * @throws std::runtime_error if SDL_CreateTexture fails
+             */
+            SDL_Texture* ensure(size_t width, size_t height, Uint32 format) {
+                if (m_texture && m_width == width && m_height == height && m_format == format) {
+                    return m_texture;
+                }
+
+                if (m_texture) {
+                    SDL_DestroyTexture(m_texture);
+                    m_texture = nullptr;
+                }
+
+#ifdef SCALER_HAS_SDL3
+                m_texture = SDL_CreateTexture(m_renderer, static_cast<SDL_PixelFormat>(format),
+                                              SDL_TEXTUREACCESS_STREAMING,
+                                              static_cast<int>(width), static_cast<int>(height));
+#else
+                m_texture = SDL_CreateTexture(m_renderer, format, SDL_TEXTUREACCESS_STREAMING,
+                                              static_cast<int>(width), static_cast<int>(height));
+#endif
+                if (!m_texture) {
+                    throw std::runtime_error(std::string("SDL_CreateTexture failed: ") + SDL_GetError());
+                }
+
+                m_width = width;
+                m_height = height;
+                m_format = format;
+                ++m_recreations;
+                return m_texture;
+            }
+
+            /**
+             * @brief Scale a surface into the streaming texture
+             *
+             * @param src Source surface
+             * @param algo Scaling algorithm
+             * @param scale_factor Scale factor supported by the algorithm
+             * @return The texture holding the scaled frame
+             * @throws unsupported_scale_exception if algorithm doesn't support the scale
+             */
+            SDL_Texture* scale(SDL_Surface* src, algorithm algo, float scale_factor) {
+                if (!scaler_capabilities::is_scale_supported(algo, scale_factor)) {
+                    throw unsupported_scale_exception(algo, scale_factor,
+                                                      scaler_capabilities::get_supported_scales(algo));
+                }
+
+                sdl_input_image input(src);
+                auto dims = scaler_type::calculate_output_dimensions(input, algo, scale_factor);
+                SDL_Texture* texture = ensure(dims.width, dims.height, m_format);
+
+                sdl_texture_lock lock(texture);
+                scaler_type::scale(input, lock.image(), algo);
+                return texture;
+            }
+
+            [[nodiscard]] SDL_Texture* texture() const {
+                return m_texture;
+            }
+
+            // Number of times the texture had to be (re)created
+            [[nodiscard]] size_t recreation_count() const {
+                return m_recreations;
+            }
+
+        private:
+            SDL_Renderer* m_renderer;
+            SDL_Texture* m_texture = nullptr;
+            size_t m_width = 0;
+            size_t m_height = 0;
+            Uint32 m_format;
+            size_t m_recreations = 0;
+    };
+}
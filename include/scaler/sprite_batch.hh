@@ -0,0 +1,383 @@
+/**
+ * @file sprite_batch.hh
+ * @brief Lane-batched scaling of many small images
+ *
+ * For 8x8 to 32x32 sprites, rows are too short for row-level vector code to
+ * pay off, and setting up the per-image row buffers costs more than the
+ * kernel itself. scale_sprites() instead interleaves up to a register's
+ * worth of same-sized sprites lane-major, so that lane k of every channel
+ * array holds the same pixel of sprite k. The EPX, Scale and HQ tests then
+ * run across all lanes at once, and the results are split back into one
+ * output per sprite.
+ *
+ * @code
+ * std::vector<Sprite> sprites = frame_sprites();           // thousands, 16x16
+ * auto scaled = scaler::scale_sprites<Sprite, Sprite>(sprites, scaler::algorithm::HQ, 2.0f);
+ * @endcode
+ */
+#pragma once
+
+#include <scaler/algorithm.hh>
+#include <scaler/compiler_compat.hh>
+#include <scaler/image_base.hh>
+#include <scaler/unified_scaler.hh>
+#include <scaler/vec3.hh>
+#include <scaler/cpu/hq2x.hh>
+#include <scaler/cpu/scaler_common.hh>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace scaler {
+
+    namespace detail {
+
+        /**
+         * Sprites per batch: one 256-bit register of channel values
+         */
+        template<typename T>
+        inline constexpr size_t sprite_lanes = std::max <size_t>(32 / sizeof(T), 4);
+
+        /**
+         * K images of equal size interleaved lane-major (AoSoA)
+         *
+         * Each pixel position holds K values of channel x, then K of y, then
+         * K of z. Positions are addressed with a one-pixel border, so
+         * pixel(x + 1, y + 1) is image pixel (x, y); refresh_border() fills
+         * the border with copies of the nearest edge pixels.
+         */
+        template<typename T, size_t K>
+        class lane_planes {
+            public:
+                static constexpr size_t lanes = K;
+                static constexpr size_t pixel_values = 3 * K;
+
+                lane_planes(size_t w, size_t h)
+                    : width_(w), height_(h), stride_(w + 2), data_((w + 2) * (h + 2) * pixel_values) {
+                }
+
+                [[nodiscard]] size_t width() const { return width_; }
+                [[nodiscard]] size_t height() const { return height_; }
+
+                /// Channel values of padded position (px, py)
+                [[nodiscard]] T* pixel(size_t px, size_t py) {
+                    return data_.data() + (py * stride_ + px) * pixel_values;
+                }
+
+                [[nodiscard]] const T* pixel(size_t px, size_t py) const {
+                    return data_.data() + (py * stride_ + px) * pixel_values;
+                }
+
+                void refresh_border() {
+                    for (size_t py = 1; py <= height_; ++py) {
+                        std::copy_n(pixel(1, py), pixel_values, pixel(0, py));
+                        std::copy_n(pixel(width_, py), pixel_values, pixel(width_ + 1, py));
+                    }
+                    std::copy_n(pixel(0, 1), stride_ * pixel_values, pixel(0, 0));
+                    std::copy_n(pixel(0, height_), stride_ * pixel_values, pixel(0, height_ + 1));
+                }
+
+            private:
+                size_t width_;
+                size_t height_;
+                size_t stride_;
+                std::vector <T> data_;
+        };
+
+        // eq[k] = all ones where pixels a and b are equal in lane k, else zero
+        template<typename T, size_t K>
+        inline void lanes_equal(const T* a, const T* b, std::array <T, K>& eq) {
+            for (size_t k = 0; k < K; ++k) {
+                const bool same = (a[k] == b[k]) & (a[K + k] == b[K + k]) & (a[2 * K + k] == b[2 * K + k]);
+                eq[k] = static_cast<T>(T{0} - static_cast<T>(same));
+            }
+        }
+
+        // out = a where take is set, else b, lane by lane
+        template<typename T, size_t K>
+        inline void lanes_select(const std::array <T, K>& take, const T* SCALER_RESTRICT a,
+                                 const T* SCALER_RESTRICT b, T* SCALER_RESTRICT out) {
+            for (size_t c = 0; c < 3 * K; c += K) {
+                for (size_t k = 0; k < K; ++k) {
+                    out[c + k] = static_cast<T>((a[c + k] & take[k]) | (b[c + k] & static_cast<T>(~take[k])));
+                }
+            }
+        }
+
+        /**
+         * The lane form of the EPX (epx = true) and Scale2x rules of epx.hh
+         */
+        template<typename T, size_t K>
+        void scale2x_lanes(const lane_planes <T, K>& in, lane_planes <T, K>& out, bool epx) {
+            std::array <T, K> ca, ab, dc, bd, ad, bc, m0, m1, m2, m3;
+            for (size_t y = 0; y < in.height(); ++y) {
+                for (size_t x = 0; x < in.width(); ++x) {
+                    const T* A = in.pixel(x + 1, y);      // top
+                    const T* B = in.pixel(x + 2, y + 1);  // right
+                    const T* C = in.pixel(x, y + 1);      // left
+                    const T* D = in.pixel(x + 1, y + 2);  // bottom
+                    const T* P = in.pixel(x + 1, y + 1);  // centre
+
+                    lanes_equal(C, A, ca);
+                    lanes_equal(A, B, ab);
+                    lanes_equal(D, C, dc);
+                    lanes_equal(B, D, bd);
+                    if (epx) {
+                        // Three or more of A, B, C, D equal: at least three equal pairs
+                        lanes_equal(A, D, ad);
+                        lanes_equal(B, C, bc);
+                        for (size_t k = 0; k < K; ++k) {
+                            const T pairs = static_cast<T>((ab[k] & 1) + (ca[k] & 1) + (ad[k] & 1) +
+                                                           (bc[k] & 1) + (bd[k] & 1) + (dc[k] & 1));
+                            const T differ = static_cast<T>(T{0} - static_cast<T>(pairs < 3));
+                            m0[k] = static_cast<T>(ca[k] & differ);
+                            m1[k] = static_cast<T>(ab[k] & differ);
+                            m2[k] = static_cast<T>(dc[k] & differ);
+                            m3[k] = static_cast<T>(bd[k] & differ);
+                        }
+                    } else {
+                        for (size_t k = 0; k < K; ++k) {
+                            m0[k] = static_cast<T>(ca[k] & ~dc[k] & ~ab[k]);
+                            m1[k] = static_cast<T>(ab[k] & ~ca[k] & ~bd[k]);
+                            m2[k] = static_cast<T>(dc[k] & ~bd[k] & ~ca[k]);
+                            m3[k] = static_cast<T>(bd[k] & ~ab[k] & ~dc[k]);
+                        }
+                    }
+
+                    lanes_select(m0, A, P, out.pixel(2 * x + 1, 2 * y + 1));
+                    lanes_select(m1, B, P, out.pixel(2 * x + 2, 2 * y + 1));
+                    lanes_select(m2, C, P, out.pixel(2 * x + 1, 2 * y + 2));
+                    lanes_select(m3, D, P, out.pixel(2 * x + 2, 2 * y + 2));
+                }
+            }
+        }
+
+        template<typename T, size_t K>
+        inline void store_lane(T* values, size_t k, const vec3 <T>& pixel) {
+            values[k] = pixel.x;
+            values[K + k] = pixel.y;
+            values[2 * K + k] = pixel.z;
+        }
+
+        /**
+         * The lane form of HQ2x: YUV conversion and the eight centre-to-neighbour
+         * difference tests run across lanes; the blend rules of hq2x_blend()
+         * then run per sprite on the resulting pattern
+         */
+        template<typename T, size_t K>
+        void hq2x_lanes(const lane_planes <T, K>& in, lane_planes <T, K>& out, size_t count) {
+            const size_t padded_width = in.width() + 2;
+            const size_t padded_height = in.height() + 2;
+
+            // Every padded pixel converted once, instead of once per test
+            std::vector <std::int32_t> yuv(padded_width * padded_height * 3 * K);
+            for (size_t py = 0; py < padded_height; ++py) {
+                for (size_t px = 0; px < padded_width; ++px) {
+                    const T* rgb = in.pixel(px, py);
+                    std::int32_t* out_yuv = yuv.data() + (py * padded_width + px) * 3 * K;
+                    for (size_t k = 0; k < K; ++k) {
+                        const uvec3 converted = rgb_to_yuv(uvec3(static_cast<unsigned>(rgb[k]),
+                                                                 static_cast<unsigned>(rgb[K + k]),
+                                                                 static_cast<unsigned>(rgb[2 * K + k])));
+                        out_yuv[k] = static_cast<std::int32_t>(converted.x);
+                        out_yuv[K + k] = static_cast<std::int32_t>(converted.y);
+                        out_yuv[2 * K + k] = static_cast<std::int32_t>(converted.z);
+                    }
+                }
+            }
+
+            // Neighbour order of the difference bits (see compute_differences())
+            constexpr std::array <size_t, 8> bit_neighbour = {1, 2, 3, 5, 6, 7, 8, 0};
+            std::array <std::uint8_t, K> diffs;
+            std::array <vec3 <T>, 9> w;
+            vec3 <T> d00, d01, d10, d11;
+
+            for (size_t y = 0; y < in.height(); ++y) {
+                for (size_t x = 0; x < in.width(); ++x) {
+                    std::array <const std::int32_t*, 9> n;
+                    for (size_t i = 0; i < 9; ++i) {
+                        n[i] = yuv.data() + ((y + i / 3) * padded_width + x + i % 3) * 3 * K;
+                    }
+                    diffs.fill(0);
+                    for (size_t bit = 0; bit < 8; ++bit) {
+                        const std::int32_t* c = n[4];
+                        const std::int32_t* o = n[bit_neighbour[bit]];
+                        for (size_t k = 0; k < K; ++k) {
+                            const std::int32_t dy = c[k] > o[k] ? c[k] - o[k] : o[k] - c[k];
+                            const std::int32_t du = c[K + k] > o[K + k] ? c[K + k] - o[K + k] : o[K + k] - c[K + k];
+                            const std::int32_t dv = c[2 * K + k] > o[2 * K + k] ? c[2 * K + k] - o[2 * K + k]
+                                                                                : o[2 * K + k] - c[2 * K + k];
+                            const bool differs = (dy > Y_THRESHOLD) | (du > U_THRESHOLD) | (dv > V_THRESHOLD);
+                            diffs[k] = static_cast<std::uint8_t>(diffs[k] | (differs << bit));
+                        }
+                    }
+
+                    T* out00 = out.pixel(2 * x + 1, 2 * y + 1);
+                    T* out01 = out.pixel(2 * x + 2, 2 * y + 1);
+                    T* out10 = out.pixel(2 * x + 1, 2 * y + 2);
+                    T* out11 = out.pixel(2 * x + 2, 2 * y + 2);
+                    for (size_t k = 0; k < count; ++k) {
+                        for (size_t i = 0; i < 9; ++i) {
+                            const T* p = in.pixel(x + i % 3, y + i / 3);
+                            w[i] = vec3 <T>(p[k], p[K + k], p[2 * K + k]);
+                        }
+                        d00 = d01 = d10 = d11 = w[4];
+                        hq2x_blend(w, diffs[k], d00, d01, d10, d11);
+                        store_lane <T, K>(out00, k, d00);
+                        store_lane <T, K>(out01, k, d01);
+                        store_lane <T, K>(out10, k, d10);
+                        store_lane <T, K>(out11, k, d11);
+                    }
+                }
+            }
+        }
+
+        /**
+         * Scale count (<= K) same-sized sprites, listed by index, lane-batched
+         */
+        template<typename T, size_t K, typename InputImage, typename OutputImage>
+        void scale_sprite_lanes(const std::vector <InputImage>& inputs, std::vector <OutputImage>& outputs,
+                                const size_t* indices, size_t count, algorithm algo,
+                                std::vector <lane_planes <T, K>>& passes) {
+            auto& source = passes[0];
+            for (size_t k = 0; k < count; ++k) {
+                const InputImage& sprite = inputs[indices[k]];
+                for (size_t y = 0; y < source.height(); ++y) {
+                    for (size_t x = 0; x < source.width(); ++x) {
+                        const auto p = sprite.get_pixel(x, y);
+                        T* values = source.pixel(x + 1, y + 1);
+                        values[k] = static_cast<T>(p.x);
+                        values[K + k] = static_cast<T>(p.y);
+                        values[2 * K + k] = static_cast<T>(p.z);
+                    }
+                }
+            }
+            source.refresh_border();
+
+            // 4x is 2x twice, as in unified_scaler
+            for (size_t pass = 1; pass < passes.size(); ++pass) {
+                if (pass > 1) {
+                    passes[pass - 1].refresh_border();
+                }
+                if (algo == algorithm::HQ) {
+                    hq2x_lanes(passes[pass - 1], passes[pass], count);
+                } else {
+                    scale2x_lanes(passes[pass - 1], passes[pass], algo == algorithm::EPX);
+                }
+            }
+
+            const auto& result = passes.back();
+            for (size_t k = 0; k < count; ++k) {
+                OutputImage& sprite = outputs[indices[k]];
+                for (size_t y = 0; y < result.height(); ++y) {
+                    for (size_t x = 0; x < result.width(); ++x) {
+                        const T* values = result.pixel(x + 1, y + 1);
+                        sprite.set_pixel(x, y, vec3 <T>(values[k], values[K + k], values[2 * K + k]));
+                    }
+                }
+            }
+        }
+
+    } // namespace detail
+
+    /**
+     * Whether scale_sprites() runs algo at scale_factor lane-batched; other
+     * combinations are scaled sprite by sprite with unified_scaler
+     */
+    inline bool is_sprite_batch_supported(algorithm algo, float scale_factor) {
+        switch (algo) {
+            case algorithm::EPX:
+                return scale_factor == 2.0f;
+            case algorithm::Scale:
+            case algorithm::HQ:
+                return scale_factor == 2.0f || scale_factor == 4.0f;
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * Scale each inputs[i] into outputs[i], batching same-sized sprites
+     *
+     * Sprites are grouped by size and scale, and each group is processed
+     * detail::sprite_lanes<channel type> sprites at a time. The output is
+     * identical to unified_scaler::scale() sprite by sprite, which is also
+     * what runs for combinations is_sprite_batch_supported() rejects, for
+     * pixels with non-integral channels, and for outputs that are not an
+     * integral multiple of their input.
+     *
+     * @throws std::invalid_argument if the vectors differ in length
+     * @throws whatever unified_scaler::scale() throws for a sprite
+     */
+    template<typename InputImage, typename OutputImage>
+    void scale_sprites(const std::vector <InputImage>& inputs, std::vector <OutputImage>& outputs, algorithm algo) {
+        using channel = typename std::decay_t <decltype(std::declval <const InputImage&>().get_pixel(0, 0))>::value_type;
+
+        if (inputs.size() != outputs.size()) {
+            throw std::invalid_argument("scale_sprites needs one output per input");
+        }
+
+        // (width, height, factor) -> sprites
+        std::map <std::tuple <size_t, size_t, size_t>, std::vector <size_t>> groups;
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            const size_t width = inputs[i].width();
+            const size_t height = inputs[i].height();
+            const size_t factor = width > 0 ? outputs[i].width() / width : 0;
+            const bool batched = std::is_integral_v <channel> && width > 0 && height > 0 &&
+                                 outputs[i].width() == width * factor && outputs[i].height() == height * factor &&
+                                 is_sprite_batch_supported(algo, static_cast<float>(factor));
+            if (batched) {
+                groups[{width, height, factor}].push_back(i);
+            } else {
+                unified_scaler <InputImage, OutputImage>::scale(inputs[i], outputs[i], algo);
+            }
+        }
+
+        if constexpr (std::is_integral_v <channel>) {
+            constexpr size_t lanes = detail::sprite_lanes <channel>;
+            for (const auto& [key, members] : groups) {
+                const auto [width, height, factor] = key;
+                std::vector <detail::lane_planes <channel, lanes>> passes;
+                for (size_t scale = 1; scale <= factor; scale *= 2) {
+                    passes.emplace_back(width * scale, height * scale);
+                }
+                for (size_t first = 0; first < members.size(); first += lanes) {
+                    const size_t count = std::min(lanes, members.size() - first);
+                    detail::scale_sprite_lanes(inputs, outputs, members.data() + first, count, algo, passes);
+                }
+            }
+        }
+    }
+
+    /**
+     * Scale every input by scale_factor, batching same-sized sprites
+     *
+     * @throws unsupported_scale_exception if algo does not support scale_factor
+     */
+    template<typename InputImage, typename OutputImage>
+    std::vector <OutputImage> scale_sprites(const std::vector <InputImage>& inputs, algorithm algo,
+                                            float scale_factor = 2.0f) {
+        std::vector <OutputImage> outputs;
+        outputs.reserve(inputs.size());
+        if (!is_sprite_batch_supported(algo, scale_factor)) {
+            for (const auto& sprite : inputs) {
+                outputs.push_back(unified_scaler <InputImage, OutputImage>::scale(sprite, algo, scale_factor));
+            }
+            return outputs;
+        }
+        const auto factor = static_cast<size_t>(scale_factor);
+        for (const auto& sprite : inputs) {
+            outputs.emplace_back(sprite.width() * factor, sprite.height() * factor, sprite);
+        }
+        scale_sprites(inputs, outputs, algo);
+        return outputs;
+    }
+
+} // namespace scaler
@@ -20,7 +20,11 @@
  * );
  * @endcode
  *
- * @note All methods are stateless and thread-safe.
+ * @note All methods are thread-safe. Integral scales may be split into bands
+ *       on several threads, as the auto-tuner last published (see
+ *       auto_tuner.hh); reading that choice takes no lock. The first
+ *       integral scale reads the tuning profile; nothing is tuned unless
+ *       the application asks for it or sets SCALER_AUTOTUNE=1.
  * @see algorithm.hh for available scaling algorithms
  * @see algorithm_capabilities.hh for querying algorithm support
  */
@@ -38,6 +42,8 @@
 #include <scaler/algorithm.hh>
 #include <scaler/algorithm_capabilities.hh>
 #include <scaler/warning_macros.hh>
+#include <scaler/cpu/band_parallel.hh>
+#include <scaler/native_resolution.hh>
 
 // Include all algorithm implementations
 #include <scaler/cpu/epx.hh>
@@ -365,6 +371,17 @@ namespace scaler {
                                                       scaler_capabilities::get_supported_scales(algo));
                 }
 
+                if constexpr (detail::supports_band_parallel <InputImage, OutputImage>::value) {
+                    const detail::band_plan plan = detail::tuned_band_plan(algo, scale_factor,
+                                                                           input.width(), input.height());
+                    if (plan.threads > 1) {
+                        auto dims = calculate_output_dimensions(input, algo, scale_factor);
+                        OutputImage output(dims.width, dims.height, input);
+                        scale_bands(input, output, algo, scale_factor, plan);
+                        return output;
+                    }
+                }
+
                 // Dispatch to appropriate implementation
                 return dispatch_scale_algorithm(input, algo, scale_factor);
             }
@@ -391,6 +408,125 @@ namespace scaler {
             static void scale(const InputImage& input,
                              OutputImage& output,
                              algorithm algo) {
+                scale_into(input, output, algo, nullptr);
+            }
+
+            /**
+             * @brief Scale into a preallocated output with an explicit band split
+             *
+             * @param input Source image to scale
+             * @param output Preallocated destination image
+             * @param algo Scaling algorithm to use
+             * @param plan Threads and band height; detail::band_plan{} scales serially
+             * @throws unsupported_scale_exception if inferred scale is not supported
+             * @throws dimension_mismatch_exception if output size doesn't match requirements
+             *
+             * As scale(input, output, algo), but the split is not taken from the
+             * auto-tuner. Callers that already scale on worker threads pass a
+             * serial plan so that no nested band threads are started. The plan
+             * is ignored for image types that cannot be split into bands.
+             */
+            static void scale(const InputImage& input,
+                             OutputImage& output,
+                             algorithm algo,
+                             const detail::band_plan& plan) {
+                scale_into(input, output, algo, &plan);
+            }
+
+            /**
+             * @brief Scale pre-upscaled pixel art at its native resolution
+             *
+             * @param input Source image, possibly nearest-upscaled already
+             * @param algo Scaling algorithm to use
+             * @param scale_factor Requested size relative to input
+             * @return Image of input size times scale_factor
+             * @throws unsupported_scale_exception if no block grid is found and
+             *         the algorithm doesn't support the scale
+             *
+             * The image is reduced to one pixel per block of the grid found by
+             * detect_native_grid(), scaled there with the smallest integral
+             * scale of algo that reaches the requested size (or its largest
+             * below it), and brought to the requested size with
+             * nearest-neighbour sampling. An image without a block grid is
+             * scaled exactly as scale() would.
+             *
+             * @note OutputImage must also be readable (get_pixel()), as it holds
+             *       the native and intermediate images
+             *
+             * @example
+             * @code
+             * // A sprite sheet saved at 4x: HQ runs on the original pixels
+             * auto scaled = unified_scaler<Image, Image>::scale_native(
+             *     input, algorithm::HQ, 2.0f
+             * );
+             * @endcode
+             */
+            static OutputImage scale_native(const InputImage& input,
+                                            algorithm algo,
+                                            float scale_factor = 2.0f) {
+                const native_grid grid = detect_native_grid(input);
+                if (!grid.detected()) {
+                    return scale(input, algo, scale_factor);
+                }
+
+                auto dims = calculate_output_dimensions(input, algo, scale_factor);
+                OutputImage output(dims.width, dims.height, input);
+                scale_native(input, output, algo, grid);
+                return output;
+            }
+
+            /**
+             * @brief Scale into a preallocated output at native resolution
+             *
+             * Like scale_native(input, algo, scale_factor) with the scale taken
+             * from the output size; each axis is fitted to the output on its own.
+             */
+            static void scale_native(const InputImage& input,
+                                     OutputImage& output,
+                                     algorithm algo) {
+                scale_native(input, output, algo, detect_native_grid(input));
+            }
+
+            /**
+             * @brief Scale at native resolution with a grid detected earlier
+             *
+             * Useful for a sequence of frames that share a grid.
+             */
+            static void scale_native(const InputImage& input,
+                                     OutputImage& output,
+                                     algorithm algo,
+                                     const native_grid& grid) {
+                if (!grid.detected()) {
+                    scale(input, output, algo);
+                    return;
+                }
+
+                // One pixel per block
+                const size_t native_w = grid.native_width(input.width());
+                const size_t native_h = grid.native_height(input.height());
+                OutputImage native(native_w, native_h, input);
+                for (size_t ny = 0; ny < native_h; ++ny) {
+                    for (size_t nx = 0; nx < native_w; ++nx) {
+                        native.set_pixel(nx, ny, input.get_pixel(grid.cell_x(nx), grid.cell_y(ny)));
+                    }
+                }
+
+                // Native pixels per output pixel, on the tighter axis
+                const float target = std::min(
+                    SCALER_SIZE_TO_FLOAT(output.width()) / SCALER_SIZE_TO_FLOAT(native_w),
+                    SCALER_SIZE_TO_FLOAT(output.height()) / SCALER_SIZE_TO_FLOAT(native_h));
+                const OutputImage scaled = unified_scaler <OutputImage, OutputImage>::scale(
+                    native, algo, native_algorithm_scale(algo, target));
+
+                resample_native(input, scaled, output, grid);
+            }
+
+        private:
+            // Preallocated scale with the given plan, or the tuned one if plan is null
+            static void scale_into(const InputImage& input,
+                                   OutputImage& output,
+                                   algorithm algo,
+                                   const detail::band_plan* plan) {
                 // Infer scale from dimensions
                 float scale_factor = infer_scale_factor(input, output);
 
@@ -409,11 +545,98 @@ namespace scaler {
                                                        expected.width, expected.height);
                 }
 
+                if constexpr (detail::supports_band_parallel <InputImage, OutputImage>::value) {
+                    const detail::band_plan chosen = plan != nullptr
+                                                         ? *plan
+                                                         : detail::tuned_band_plan(algo, scale_factor,
+                                                                                   input.width(), input.height());
+                    if (chosen.threads > 1) {
+                        scale_bands(input, output, algo, scale_factor, chosen);
+                        return;
+                    }
+                }
+
                 // Dispatch to appropriate implementation - writes directly to output
                 dispatch_scale_algorithm_into(input, output, algo, scale_factor);
             }
 
-        private:
+            // Whole scale that reaches target if algo has it, as integral scales
+            // keep native pixels whole in the intermediate image; otherwise the
+            // largest scale below target, or the smallest if all overshoot
+            static float native_algorithm_scale(algorithm algo, float target) {
+                const float whole = std::ceil(target);
+                if (scaler_capabilities::is_scale_supported(algo, whole)) {
+                    return whole;
+                }
+                std::vector <float> candidates = scaler_capabilities::get_supported_scales(algo);
+                if (candidates.empty()) {
+                    for (int s = 1; s <= 8; ++s) {
+                        candidates.push_back(static_cast <float>(s));
+                    }
+                }
+
+                float best = 0.0f;
+                float smallest = 0.0f;
+                for (float candidate : candidates) {
+                    if (!scaler_capabilities::is_scale_supported(algo, candidate)) {
+                        continue;
+                    }
+                    if (smallest == 0.0f || candidate < smallest) {
+                        smallest = candidate;
+                    }
+                    if (candidate <= target && candidate > best) {
+                        best = candidate;
+                    }
+                }
+                return best > 0.0f ? best : smallest;
+            }
+
+            // Nearest-neighbour sampling of the scaled native image at the
+            // output's pixel centres, following the grid offset of the input
+            static void resample_native(const InputImage& input,
+                                        const OutputImage& scaled,
+                                        OutputImage& output,
+                                        const native_grid& grid) {
+                const size_t native_w = grid.native_width(input.width());
+                const size_t native_h = grid.native_height(input.height());
+
+                auto source_index = [](size_t out, size_t out_size, size_t in_size, double origin,
+                                       size_t block, size_t native_size, size_t scaled_size) {
+                    const double u = (static_cast <double>(out) + 0.5) * static_cast <double>(in_size) /
+                                     static_cast <double>(out_size);
+                    const double v = (u - origin) / static_cast <double>(block);
+                    const double s = v * static_cast <double>(scaled_size) / static_cast <double>(native_size);
+                    return std::min(static_cast <size_t>(std::max(s, 0.0)), scaled_size - 1);
+                };
+
+                std::vector <size_t> columns(output.width());
+                for (size_t x = 0; x < output.width(); ++x) {
+                    columns[x] = source_index(x, output.width(), input.width(), grid.origin_x(),
+                                              grid.block_width, native_w, scaled.width());
+                }
+                for (size_t y = 0; y < output.height(); ++y) {
+                    const size_t sy = source_index(y, output.height(), input.height(), grid.origin_y(),
+                                                   grid.block_height, native_h, scaled.height());
+                    for (size_t x = 0; x < output.width(); ++x) {
+                        output.set_pixel(x, y, scaled.get_pixel(columns[x], sy));
+                    }
+                }
+            }
+
+            // Split an integral scale into bands scaled on plan.threads threads
+            static void scale_bands(const InputImage& input,
+                                    OutputImage& output,
+                                    algorithm algo,
+                                    float scale_factor,
+                                    const detail::band_plan& plan) {
+                using band_scaler = unified_scaler <band_view <InputImage>, OutputImage>;
+                detail::band_parallel_scale(input, output, static_cast <size_t>(scale_factor),
+                                            band_halo_rows(algo), plan,
+                                            [algo](const band_view <InputImage>& band, OutputImage& band_output) {
+                                                band_scaler::scale(band, band_output, algo);
+                                            });
+            }
+
             // Dispatch method that writes directly to output (efficient version)
             static void dispatch_scale_algorithm_into(const InputImage& input,
                                                      OutputImage& output,
@@ -878,3 +1101,6 @@ namespace scaler {
      */
 
 } // namespace scaler
+
+// The tuner includes this header; it registers itself to load its profile on the first scale
+#include <scaler/auto_tuner.hh>
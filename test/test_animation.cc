@@ -0,0 +1,339 @@
+#include <doctest/doctest.h>
+#include <scaler/io/animation.hh>
+#include <scaler/io/apng.hh>
+#include <scaler/io/gif.hh>
+#include <scaler/io/png_stream.hh>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "test_common.hh"
+
+using namespace scaler;
+
+namespace {
+    using rgba = std::array<std::uint8_t, 4>;
+
+    void set(io::packed_image& image, size_t x, size_t y, rgba color) {
+        std::memcpy(image.row(y) + x * 4, color.data(), 4);
+    }
+
+    rgba get(const io::packed_image& image, size_t x, size_t y) {
+        rgba color;
+        std::memcpy(color.data(), image.row(y) + x * 4, 4);
+        return color;
+    }
+
+    bool same_pixels(const io::packed_image& a, const io::packed_image& b) {
+        return a.width() == b.width() && a.height() == b.height() && a.channels() == b.channels() &&
+               std::memcmp(a.data(), b.data(), a.row_bytes() * a.height()) == 0;
+    }
+
+    // A 4-color sprite moving over a striped background; transparent background if requested
+    std::vector<io::packed_image> make_frames(size_t width, size_t height, size_t count, bool transparent) {
+        std::vector<io::packed_image> frames;
+        for (size_t f = 0; f < count; ++f) {
+            io::packed_image frame(width, height, 4);
+            for (size_t y = 0; y < height; ++y) {
+                for (size_t x = 0; x < width; ++x) {
+                    const auto stripe = static_cast<std::uint8_t>((y / 3) % 2 == 0 ? 40 : 90);
+                    set(frame, x, y, transparent ? rgba{0, 0, 0, 0} : rgba{stripe, stripe, 120, 255});
+                }
+            }
+            const size_t left = 2 + f * 2;
+            const size_t top = height / 2 - 2;
+            for (size_t y = top; y < top + 5; ++y) {
+                for (size_t x = left; x < left + 4 && x < width; ++x) {
+                    const bool edge = y == top || x == left;
+                    set(frame, x, y, edge ? rgba{250, 200, 10, 255} : rgba{200, 30, 30, 255});
+                }
+            }
+            frames.push_back(std::move(frame));
+        }
+        return frames;
+    }
+
+    // Replays a fixed list of frames
+    struct frame_list_reader {
+        std::vector<io::packed_image> frames;
+        size_t next = 0;
+
+        bool read_frame(io::animation_frame& frame) {
+            if (next == frames.size()) {
+                return false;
+            }
+            frame.image = frames[next++];
+            frame.delay_ms = 40;
+            return true;
+        }
+    };
+
+    // Collects the frames it is given
+    struct frame_collector {
+        std::vector<io::packed_image> frames;
+        bool finished = false;
+
+        void write_frame(const io::packed_image& image, unsigned) { frames.push_back(image); }
+        void finish() { finished = true; }
+    };
+
+    template<typename Reader>
+    std::vector<io::animation_frame> read_all(Reader& reader) {
+        std::vector<io::animation_frame> frames;
+        io::animation_frame frame;
+        while (reader.read_frame(frame)) {
+            frames.push_back(frame);
+        }
+        return frames;
+    }
+
+    // Whole-frame reference: color through algo, alpha too if the frame has any transparency
+    io::packed_image scale_whole_frame(const io::packed_image& frame, algorithm algo, size_t factor) {
+        const std::vector<bool> all(frame.height(), true);
+        return io::detail::scale_frame_rows(frame, all, algo, factor, io::detail::has_transparency(frame));
+    }
+}
+
+TEST_CASE("GIF LZW") {
+    SUBCASE("Round trip") {
+        std::uint32_t state = 99;
+        for (int min_code_size : {2, 4, 8}) {
+            for (size_t count : {size_t{1}, size_t{17}, size_t{20000}}) {
+                std::vector<std::uint8_t> indices(count);
+                for (auto& index : indices) {
+                    state = state * 1103515245u + 12345u;
+                    // Mostly runs, some noise: exercises long entries and table resets
+                    index = static_cast<std::uint8_t>(((state >> 24) < 200 ? 1u : (state >> 16)) %
+                                                      (1u << min_code_size));
+                }
+                std::vector<std::uint8_t> encoded;
+                io::detail::gif_lzw_encode(indices.data(), indices.size(), min_code_size, encoded);
+                std::vector<std::uint8_t> decoded(count);
+                CHECK(io::detail::gif_lzw_decode(encoded.data(), encoded.size(), min_code_size,
+                                                 decoded.data(), count) == count);
+                CHECK(decoded == indices);
+            }
+        }
+    }
+
+    SUBCASE("Reference 1x1 transparent GIF") {
+        const std::uint8_t file[] = {
+            'G', 'I', 'F', '8', '9', 'a', 1, 0, 1, 0, 0x80, 0, 0, 0, 0, 0, 0xFF, 0xFF, 0xFF,
+            0x21, 0xF9, 4, 1, 0, 0, 0, 0, 0x2C, 0, 0, 0, 0, 1, 0, 1, 0, 0, 2, 2, 0x44, 0x01, 0, 0x3B};
+        std::istringstream in(std::string(reinterpret_cast<const char*>(file), sizeof(file)));
+        io::gif_reader reader(in);
+        const auto frames = read_all(reader);
+        REQUIRE(frames.size() == 1);
+        CHECK(get(frames[0].image, 0, 0)[3] == 0);
+        CHECK(reader.loop_count() == 1);
+    }
+}
+
+TEST_CASE("GIF reader limits") {
+    SUBCASE("A screen beyond the canvas limit is rejected") {
+        const std::uint8_t file[] = {'G', 'I', 'F', '8', '9', 'a', 0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0x3B};
+        std::istringstream in(std::string(reinterpret_cast<const char*>(file), sizeof(file)));
+        CHECK_THROWS_AS(io::gif_reader{in}, io::gif_error);
+    }
+
+    SUBCASE("A frame larger than the screen is rejected") {
+        // The reference 1x1 GIF with a 65535-pixel wide image descriptor
+        std::uint8_t file[] = {
+            'G', 'I', 'F', '8', '9', 'a', 1, 0, 1, 0, 0x80, 0, 0, 0, 0, 0, 0xFF, 0xFF, 0xFF,
+            0x21, 0xF9, 4, 1, 0, 0, 0, 0, 0x2C, 0, 0, 0, 0, 1, 0, 1, 0, 0, 2, 2, 0x44, 0x01, 0, 0x3B};
+        file[32] = 0xFF;
+        file[33] = 0xFF;
+        std::istringstream in(std::string(reinterpret_cast<const char*>(file), sizeof(file)));
+        io::gif_reader reader(in);
+        io::animation_frame frame;
+        CHECK_THROWS_AS(reader.read_frame(frame), io::gif_error);
+    }
+}
+
+TEST_CASE("GIF round trip") {
+    auto frames = make_frames(24, 16, 5, true);
+    // Frame 3 repeats frame 2, frame 4 clears the sprite entirely
+    frames[3] = frames[2];
+    io::detail::clear_rect(frames[4], {0, 0, 24, 16});
+
+    std::stringstream file;
+    io::gif_writer writer(file, 24, 16, 3);
+    for (const auto& frame : frames) {
+        writer.write_frame(frame, 50);
+    }
+    writer.finish();
+    CHECK(writer.frames_written() == 4);
+
+    io::gif_reader reader(file);
+    CHECK(reader.width() == 24);
+    CHECK(reader.loop_count() == 3);
+    const auto decoded = read_all(reader);
+    REQUIRE(decoded.size() == 4);
+    CHECK(same_pixels(decoded[0].image, frames[0]));
+    CHECK(same_pixels(decoded[1].image, frames[1]));
+    CHECK(same_pixels(decoded[2].image, frames[2]));
+    CHECK(decoded[2].delay_ms == 100);
+    CHECK(same_pixels(decoded[3].image, frames[4]));
+
+    SUBCASE("Too many colors") {
+        io::packed_image noisy(32, 16, 4);
+        for (size_t i = 0; i < 32 * 16; ++i) {
+            set(noisy, i % 32, i / 32, {static_cast<std::uint8_t>(i), static_cast<std::uint8_t>(i >> 8), 7, 255});
+        }
+        std::stringstream out;
+        io::gif_writer noisy_writer(out, 32, 16);
+        noisy_writer.write_frame(noisy, 10);
+        CHECK_THROWS_AS(noisy_writer.finish(), io::gif_error);
+    }
+}
+
+TEST_CASE("APNG round trip") {
+    auto frames = make_frames(20, 12, 4, false);
+    // Translucent pixels force a "source" frame
+    set(frames[3], 1, 1, {10, 20, 30, 128});
+    frames[2] = frames[1];
+
+    std::stringstream file;
+    io::apng_writer writer(file, 20, 12, 0, 6);
+    for (const auto& frame : frames) {
+        writer.write_frame(frame, 40);
+    }
+    writer.finish();
+    CHECK(writer.frames_written() == 3);
+
+    io::apng_reader reader(file);
+    CHECK(reader.animated());
+    CHECK(reader.frame_count() == 3);
+    CHECK(reader.loop_count() == 0);
+    const auto decoded = read_all(reader);
+    REQUIRE(decoded.size() == 3);
+    CHECK(same_pixels(decoded[0].image, frames[0]));
+    CHECK(same_pixels(decoded[1].image, frames[1]));
+    CHECK(decoded[1].delay_ms == 80);
+    CHECK(same_pixels(decoded[2].image, frames[3]));
+
+    SUBCASE("A plain PNG is one frame") {
+        std::stringstream png;
+        io::png_row_writer still(png, 3, 2, 3);
+        const std::uint8_t row[9] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+        still.write_row(row);
+        still.write_row(row);
+        still.finish();
+
+        io::apng_reader plain(png);
+        CHECK_FALSE(plain.animated());
+        const auto still_frames = read_all(plain);
+        REQUIRE(still_frames.size() == 1);
+        CHECK(get(still_frames[0].image, 2, 1) == rgba{7, 8, 9, 255});
+    }
+
+    SUBCASE("A truncated chunk claiming a huge length is rejected") {
+        // Signature and IHDR, then an fdAT that claims 2 GiB but ends after a few bytes
+        std::string truncated = file.str().substr(0, 8 + 25);
+        std::uint8_t header[8];
+        io::detail::write_be32(header, 0x7FFFFFFFu);
+        std::memcpy(header + 4, "fdAT", 4);
+        truncated.append(reinterpret_cast<const char*>(header), 8);
+        truncated.append("abc");
+        std::istringstream in(truncated);
+        CHECK_THROWS_AS(io::apng_reader{in}, io::png_error);
+    }
+}
+
+TEST_CASE("Animation scaling") {
+    SUBCASE("Matches per-frame scaling and reuses static rows") {
+        for (algorithm algo : {algorithm::EPX, algorithm::HQ, algorithm::xBR, algorithm::Bilinear}) {
+            for (unsigned threads : {1u, 3u}) {
+                frame_list_reader reader{make_frames(40, 30, 6, false)};
+                frame_collector writer;
+                const auto stats = io::scale_animation(reader, writer, algo, 2, threads);
+                CHECK(writer.finished);
+                REQUIRE(writer.frames.size() == 6);
+                CHECK(stats.frames == 6);
+                CHECK(stats.rows_reused > 0);
+                CHECK(stats.rows_scaled + stats.rows_reused == 6 * 30);
+                for (size_t f = 0; f < 6; ++f) {
+                    CHECK(same_pixels(writer.frames[f], scale_whole_frame(reader.frames[f], algo, 2)));
+                }
+            }
+        }
+    }
+
+    SUBCASE("Transparent frames scale their alpha") {
+        frame_list_reader reader{make_frames(30, 20, 3, true)};
+        frame_collector writer;
+        io::scale_animation(reader, writer, algorithm::Scale, 3, 2);
+        REQUIRE(writer.frames.size() == 3);
+        CHECK(get(writer.frames[0], 0, 0)[3] == 0);
+        CHECK(get(writer.frames[0], 3 * 3 + 1, 3 * 10 + 1)[3] == 255);
+        for (size_t f = 0; f < 3; ++f) {
+            CHECK(same_pixels(writer.frames[f], scale_whole_frame(reader.frames[f], algorithm::Scale, 3)));
+        }
+    }
+
+    SUBCASE("Unsupported scales are rejected") {
+        frame_list_reader reader{make_frames(8, 8, 1, false)};
+        frame_collector writer;
+        CHECK_THROWS_AS(io::scale_animation(reader, writer, algorithm::EPX, 3), std::invalid_argument);
+    }
+}
+
+TEST_CASE("Animation file scaling") {
+    const std::string input = "/tmp/scaler_test_animation_in.gif";
+    const std::string output = "/tmp/scaler_test_animation_out.gif";
+    {
+        io::gif_writer writer(input, 24, 16);
+        for (const auto& frame : make_frames(24, 16, 3, false)) {
+            writer.write_frame(frame, 40);
+        }
+        writer.finish();
+    }
+
+    SUBCASE("GIF output keeps the palette") {
+        std::remove(output.c_str());
+        const auto stats = io::scale_animation_file(input, output, algorithm::EPX, 2);
+        CHECK(stats.frames == 3);
+        io::gif_reader reader(output);
+        CHECK(reader.width() == 48);
+        CHECK(read_all(reader).size() == 3);
+        CHECK_FALSE(std::ifstream(output + ".tmp").good());
+    }
+
+    SUBCASE("Interpolating algorithms cannot write GIF and leave the output alone") {
+        {
+            std::ofstream existing(output, std::ios::binary | std::ios::trunc);
+            existing << "previous";
+        }
+        CHECK_FALSE(io::keeps_palette(algorithm::HQ));
+        CHECK_THROWS_AS(io::scale_animation_file(input, output, algorithm::HQ, 2), io::io_error);
+        std::ifstream existing(output, std::ios::binary);
+        std::string content;
+        existing >> content;
+        CHECK(content == "previous");
+        CHECK_FALSE(std::ifstream(output + ".tmp").good());
+    }
+
+    SUBCASE("A failed scale leaves no partial file") {
+        std::remove(output.c_str());
+        const std::string broken = "/tmp/scaler_test_animation_broken.gif";
+        {
+            std::ofstream file(broken, std::ios::binary | std::ios::trunc);
+            std::ifstream source(input, std::ios::binary);
+            std::string bytes((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+            // Keep the header and first frame's descriptor, then garbage
+            file << bytes.substr(0, bytes.size() / 2) << std::string(16, '\x7f');
+        }
+        CHECK_THROWS_AS(io::scale_animation_file(broken, output, algorithm::EPX, 2), io::io_error);
+        CHECK_FALSE(std::ifstream(output).good());
+        CHECK_FALSE(std::ifstream(output + ".tmp").good());
+        std::remove(broken.c_str());
+    }
+
+    std::remove(input.c_str());
+    std::remove(output.c_str());
+}
@@ -0,0 +1,130 @@
+#include <doctest/doctest.h>
+#include <scaler/gpu/opengl_texture_scaler.hh>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gpu_test_context.hh"
+
+using namespace scaler;
+
+namespace {
+    GLuint make_input(int width, int height) {
+        std::vector<std::uint8_t> rgba(static_cast<size_t>(width * height * 4));
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const size_t i = static_cast<size_t>(y * width + x) * 4;
+                const bool edge = x == y || x + y == width - 1;
+                rgba[i] = edge ? 255 : static_cast<std::uint8_t>(x * 20);
+                rgba[i + 1] = edge ? 255 : static_cast<std::uint8_t>(y * 20);
+                rgba[i + 2] = static_cast<std::uint8_t>(edge ? 0 : 128);
+                rgba[i + 3] = 255;
+            }
+        }
+
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+
+    std::vector<std::uint8_t> scale(gpu::opengl_texture_scaler& scaler, GLuint input, int width, int height,
+                                    algorithm algo, int factor) {
+        const int out_w = width * factor;
+        const int out_h = height * factor;
+        GLuint output = gpu::opengl_texture_scaler::create_output_texture(out_w, out_h);
+        scaler.scale_texture_to_texture(input, width, height, output, out_w, out_h, algo);
+
+        std::vector<std::uint8_t> pixels(static_cast<size_t>(out_w * out_h * 4));
+        GLuint fbo;
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, output, 0);
+        glReadPixels(0, 0, out_w, out_h, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteTextures(1, &output);
+        return pixels;
+    }
+
+    // Pumps like a render loop would, one call per "frame"
+    size_t pump_until_done(gpu::opengl_texture_scaler& scaler) {
+        size_t pending = scaler.pump_shader_compiles();
+        for (int frame = 0; pending > 0 && frame < 2000; ++frame) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            pending = scaler.pump_shader_compiles();
+        }
+        return pending;
+    }
+}
+
+TEST_CASE("Asynchronous shader compilation") {
+    scaler::test::gpu_context::scoped_context gpu_ctx;
+    if (!gpu_ctx) {
+        INFO("Could not create/get OpenGL context - skipping GPU tests");
+        return;
+    }
+
+    constexpr int w = 16;
+    constexpr int h = 12;
+    GLuint input = make_input(w, h);
+
+    gpu::opengl_texture_scaler reference;
+    const auto nearest = scale(reference, input, w, h, algorithm::Nearest, 3);
+    const auto omniscale = scale(reference, input, w, h, algorithm::OmniScale, 3);
+    REQUIRE(nearest != omniscale);
+
+    SUBCASE("Draws fall back to nearest until the program is ready") {
+        gpu::opengl_texture_scaler scaler;
+        scaler.set_async_compile(true);
+
+        const auto first = scale(scaler, input, w, h, algorithm::OmniScale, 3);
+        CHECK((first == nearest || first == omniscale));
+
+        REQUIRE(pump_until_done(scaler) == 0);
+        CHECK(scale(scaler, input, w, h, algorithm::OmniScale, 3) == omniscale);
+    }
+
+    SUBCASE("One precompiled nearest program serves as fallback for every size") {
+        gpu::opengl_texture_scaler scaler;
+        gpu::shader_variant_options options;
+        options.specialize_size = true;
+        scaler.set_shader_variants(options);
+        scaler.set_async_compile(true);
+        const auto shaders = scaler.shaders();
+        CHECK(shaders->size() == 1);
+
+        const auto first = scale(scaler, input, w, h, algorithm::OmniScale, 3);
+        CHECK((first == nearest || first == omniscale));
+        (void)scale(scaler, input, w / 2, h / 2, algorithm::OmniScale, 3);
+        for (const auto& [width, height] : {std::pair{w, h}, std::pair{w / 2, h / 2}}) {
+            CHECK(shaders->find(gpu::shader_variant_key::make(algorithm::Nearest, 3.0f,
+                                                              width, height, width * 3, height * 3,
+                                                              options)) == nullptr);
+        }
+        REQUIRE(pump_until_done(scaler) == 0);
+    }
+
+    SUBCASE("Prewarm queues variants without compiling them") {
+        gpu::opengl_texture_scaler scaler;
+        scaler.set_async_compile(true);
+
+        scaler.prewarm({{algorithm::OmniScale, 3.0f}, {algorithm::Scale, 2.0f}, {algorithm::EPX, 2.0f}});
+        CHECK(scaler.pending_shaders() == 3);
+
+        REQUIRE(pump_until_done(scaler) == 0);
+        CHECK(scale(scaler, input, w, h, algorithm::OmniScale, 3) == omniscale);
+        CHECK(scale(scaler, input, w, h, algorithm::EPX, 2) == scale(reference, input, w, h, algorithm::EPX, 2));
+
+        CHECK_THROWS_AS(scaler.prewarm({{algorithm::EPX, 3.0f}}), gpu::unsupported_operation_error);
+    }
+
+    glDeleteTextures(1, &input);
+}
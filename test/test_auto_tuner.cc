@@ -0,0 +1,202 @@
+#include <doctest/doctest.h>
+#include <scaler/unified_scaler.hh>
+#include <scaler/auto_tuner.hh>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "test_common.hh"
+
+using namespace scaler;
+
+namespace {
+    using pixel = vec3<std::uint8_t>;
+    using input_image = test::TestInputImage<pixel>;
+    using output_image = test::TestOutputImage<pixel>;
+
+    // Points the tuner at a scratch profile for the duration of a test
+    class scratch_profile {
+        public:
+            explicit scratch_profile(const char* name)
+                : path_(std::string("/tmp/scaler_test_") + name + ".profile"),
+                  previous_(auto_tuner::instance().profile_path()) {
+                std::remove(path_.c_str());
+                auto_tuner::instance().set_profile_path(path_);
+            }
+
+            ~scratch_profile() {
+                auto_tuner::instance().set_profile_path(previous_);
+                std::remove(path_.c_str());
+            }
+
+            [[nodiscard]] const std::string& path() const { return path_; }
+
+        private:
+            std::string path_;
+            std::string previous_;
+    };
+}
+
+TEST_CASE("Band-parallel scaling matches serial scaling") {
+    const input_image image = test::create_sprite<pixel>(21, 37);
+
+    for (algorithm algo : scaler_capabilities::get_all_algorithms()) {
+        for (int factor : {2, 3, 4}) {
+            if (!scaler_capabilities::is_scale_supported(algo, static_cast<float>(factor))) {
+                continue;
+            }
+            CAPTURE(scaler_capabilities::get_algorithm_name(algo));
+            CAPTURE(factor);
+
+            const auto expected = unified_scaler<input_image, output_image>::scale(
+                image, algo, static_cast<float>(factor));
+            output_image parallel(expected.width(), expected.height());
+            detail::band_parallel_scale(image, parallel, static_cast<size_t>(factor), band_halo_rows(algo),
+                                        detail::band_plan{3, 5},
+                                        [algo](const band_view<input_image>& band, output_image& band_output) {
+                                            unified_scaler<band_view<input_image>, output_image>::scale(
+                                                band, band_output, algo);
+                                        });
+            CHECK(test::count_mismatches(parallel, expected) == 0);
+        }
+    }
+}
+
+TEST_CASE("Explicit band plans override the tuned one") {
+    const input_image image = test::create_sprite<pixel>(30, 20);
+    const auto serial = unified_scaler<input_image, output_image>::scale(image, algorithm::xBR, 2.0f);
+
+    output_image split(60, 40);
+    unified_scaler<input_image, output_image>::scale(image, split, algorithm::xBR, detail::band_plan{3, 4});
+    CHECK(test::count_mismatches(split, serial) == 0);
+
+    // Band views never split again, whatever the plan says
+    output_image band(60, 40);
+    unified_scaler<band_view<input_image>, output_image>::scale(band_view<input_image>(image, 0, 20), band,
+                                                                algorithm::xBR, detail::band_plan{3, 4});
+    CHECK(test::count_mismatches(band, serial) == 0);
+}
+
+TEST_CASE("Tuning profile format") {
+    tuning_profile profile;
+    profile.set("Test CPU x8", {algorithm::HQ, 3, size_class::medium}, {4, 32, 120.5});
+    profile.set("Test CPU x8", {algorithm::xBR, 2, size_class::small}, {1, 0, 40.0});
+    profile.set("Other CPU x2", {algorithm::HQ, 3, size_class::medium}, {2, 64, 30.0});
+
+    std::stringstream text;
+    profile.write(text);
+    tuning_profile loaded;
+    loaded.read(text);
+
+    REQUIRE(loaded.size() == 3);
+    const tuned_config* hq = loaded.find("Test CPU x8", {algorithm::HQ, 3, size_class::medium});
+    REQUIRE(hq != nullptr);
+    CHECK(hq->threads == 4);
+    CHECK(hq->band_rows == 32);
+    CHECK(hq->mpixels_per_second == doctest::Approx(120.5));
+    CHECK(loaded.find("Test CPU x8", {algorithm::HQ, 3, size_class::large}) == nullptr);
+    CHECK(loaded.keys("Other CPU x2").size() == 1);
+
+    loaded.erase("Test CPU x8");
+    CHECK(loaded.size() == 1);
+
+    SUBCASE("Malformed lines are rejected") {
+        std::istringstream bad("Test CPU\tHQ\tthree\tmedium\t4\t32\t1.0\n");
+        CHECK_THROWS_AS(loaded.read(bad), std::invalid_argument);
+        std::istringstream unknown("Test CPU\tNoSuchScaler\t2\tsmall\t4\t32\t1.0\n");
+        CHECK_THROWS_AS(loaded.read(unknown), std::invalid_argument);
+    }
+}
+
+TEST_CASE("Size classes") {
+    CHECK(classify_size(256, 224) == size_class::small);
+    CHECK(classify_size(640, 480) == size_class::medium);
+    CHECK(classify_size(1920, 1080) == size_class::large);
+}
+
+TEST_CASE("unified_scaler follows the tuning profile") {
+    scratch_profile scratch("follow");
+    auto& tuner = auto_tuner::instance();
+
+    std::ostringstream line;
+    line << tuner.cpu_model() << "\tHQ\t2\tsmall\t3\t4\t100\n";
+    std::istringstream imported(line.str());
+    tuner.import_profile(imported);
+
+    const auto plan = tuner.plan(algorithm::HQ, 2.0f, 30, 20);
+    CHECK(plan.threads == 3);
+    CHECK(plan.band_rows == 4);
+    CHECK(tuner.plan(algorithm::HQ, 3.0f, 30, 20).threads == 1);
+    CHECK(tuner.plan(algorithm::HQ, 2.0f, 2000, 2000).threads == 1);
+
+    // The import was saved
+    std::ifstream saved(scratch.path());
+    tuning_profile on_disk;
+    on_disk.read(saved);
+    CHECK(on_disk.find(tuner.cpu_model(), {algorithm::HQ, 2, size_class::small}) != nullptr);
+
+    const input_image image = test::create_sprite<pixel>(30, 20);
+    const auto parallel = unified_scaler<input_image, output_image>::scale(image, algorithm::HQ, 2.0f);
+    output_image preallocated(60, 40);
+    unified_scaler<input_image, output_image>::scale(image, preallocated, algorithm::HQ);
+
+    tuner.set_enabled(false);
+    CHECK(tuner.plan(algorithm::HQ, 2.0f, 30, 20).threads == 1);
+    const auto serial = unified_scaler<input_image, output_image>::scale(image, algorithm::HQ, 2.0f);
+    tuner.set_enabled(true);
+
+    CHECK(test::count_mismatches(parallel, serial) == 0);
+    CHECK(test::count_mismatches(preallocated, serial) == 0);
+}
+
+TEST_CASE("The first scale loads the profile") {
+    // Registered by including unified_scaler.hh, before any tuner exists
+    REQUIRE(detail::band_plan_loader != nullptr);
+
+    const input_image image = test::create_sprite<pixel>(30, 20);
+    (void) unified_scaler<input_image, output_image>::scale(image, algorithm::EPX, 2.0f);
+    CHECK(detail::published_band_plans.load() != nullptr);
+
+    // A profile the application chose is not replaced by the default one
+    scratch_profile scratch("first_scale");
+    auto& tuner = auto_tuner::instance();
+    std::ostringstream line;
+    line << tuner.cpu_model() << "\tEPX\t2\tsmall\t2\t8\t100\n";
+    std::istringstream imported(line.str());
+    tuner.import_profile(imported);
+    detail::band_plan_loader();
+    CHECK(tuner.profile_path() == scratch.path());
+    CHECK(tuner.plan(algorithm::EPX, 2.0f, 30, 20).threads == 2);
+    tuner.reset();
+}
+
+TEST_CASE("Tuning and re-tuning") {
+    scratch_profile scratch("tune");
+    auto& tuner = auto_tuner::instance();
+
+    const tuned_config config = tuner.tune(algorithm::Nearest, 2, size_class::small);
+    CHECK(config.threads >= 1);
+    CHECK(config.mpixels_per_second > 0.0);
+    REQUIRE(tuner.lookup({algorithm::Nearest, 2, size_class::small}).has_value());
+
+    CHECK_THROWS_AS(tuner.tune(algorithm::EPX, 3, size_class::small), unsupported_scale_exception);
+
+    tuner.retune();
+    CHECK(tuner.profile().keys(tuner.cpu_model()).size() == 1);
+
+    std::ostringstream exported;
+    tuner.export_profile(exported);
+    CHECK(exported.str().find(tuner.cpu_model() + "\tNearest\t2\tsmall") != std::string::npos);
+
+    SUBCASE("Tuning on first use") {
+        tuner.set_auto_tune(true);
+        (void) tuner.plan(algorithm::EPX, 2.0f, 16, 16);
+        tuner.set_auto_tune(false);
+        CHECK(tuner.lookup({algorithm::EPX, 2, size_class::small}).has_value());
+    }
+
+    tuner.reset();
+    CHECK(!tuner.lookup({algorithm::Nearest, 2, size_class::small}).has_value());
+}
@@ -5,7 +5,9 @@
 #include <scaler/algorithm_capabilities.hh>
 #include <scaler/warning_macros.hh>
 #include <vector>
+#include <cstdint>
 #include <functional>
+#include <limits>
 #include <string>
 #include <cmath>
 #include <algorithm>
@@ -164,6 +166,42 @@ namespace scaler::test {
         return img;
     }
 
+    // Pixel art for exactness tests: a few colours in no regular structure,
+    // so the pattern rules fire, plus a near-duplicate that exercises the YUV
+    // thresholds. A fixed seed makes every run scale the same image.
+    template <typename PixelType>
+    inline TestInputImage<PixelType> create_sprite(size_t width, size_t height, std::uint32_t seed = 4242) {
+        using channel = typename PixelType::value_type;
+        TestInputImage<PixelType> sprite(width, height);
+        std::uint32_t state = seed;
+        for (size_t y = 0; y < height; ++y) {
+            for (size_t x = 0; x < width; ++x) {
+                state = state * 1103515245u + 12345u;
+                const auto index = static_cast<channel>((state >> 16) % 5);
+                sprite.at(x, y) = index == 4 ? PixelType(60, 62, 61)
+                                             : PixelType(static_cast<channel>(index * 60),
+                                                         static_cast<channel>(200 - index * 45),
+                                                         static_cast<channel>(index * 25));
+            }
+        }
+        return sprite;
+    }
+
+    // Pixels of rows [first_row, last_row) of expected that actual does not reproduce
+    template <typename Actual, typename Expected>
+    size_t count_mismatches(const Actual& actual, const Expected& expected, size_t first_row = 0,
+                            size_t last_row = std::numeric_limits<size_t>::max()) {
+        size_t mismatches = 0;
+        for (size_t y = first_row; y < std::min(last_row, expected.height()); ++y) {
+            for (size_t x = 0; x < expected.width(); ++x) {
+                if (!(actual.get_pixel(x, y) == expected.get_pixel(x, y))) {
+                    ++mismatches;
+                }
+            }
+        }
+        return mismatches;
+    }
+
     // Common validation helpers
     inline bool validate_dimensions(const TestImage& output, const TestInputImageRGB& input, float scale) {
         size_t expected_width = static_cast<size_t>(SCALER_SIZE_TO_FLOAT(input.width()) * scale);
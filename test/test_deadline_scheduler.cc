@@ -0,0 +1,151 @@
+#include <doctest/doctest.h>
+#include <scaler/deadline_scheduler.hh>
+#include <scaler/unified_scaler.hh>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+
+#include "test_common.hh"
+
+using namespace scaler;
+
+namespace {
+    using pixel = vec3<std::uint8_t>;
+    using input_image = test::TestInputImage<pixel>;
+    using output_image = test::TestOutputImage<pixel>;
+    using image_scaler = unified_scaler<input_image, output_image>;
+    using namespace std::chrono_literals;
+
+    deadline_options make_options(std::chrono::nanoseconds budget, std::vector<algorithm> preference) {
+        deadline_options options;
+        options.budget = budget;
+        options.preference = std::move(preference);
+        return options;
+    }
+}
+
+TEST_CASE("Deadline scheduler") {
+    const input_image sprite = test::create_sprite<pixel>(31, 24);
+
+    SUBCASE("A generous budget keeps the first preference and matches scale()") {
+        deadline_scheduler scheduler(make_options(10s, {algorithm::xBR, algorithm::Nearest}));
+        for (int frame = 0; frame < 3; ++frame) {
+            output_image output(93, 72);
+            const auto report = scheduler.scale(sprite, output);
+            CHECK(report.planned == algorithm::xBR);
+            CHECK(report.finished == algorithm::xBR);
+            CHECK(report.bands == 4);
+            CHECK(report.fallback_bands == 0);
+            CHECK_FALSE(report.over_budget());
+            CHECK(test::count_mismatches(output, image_scaler::scale(sprite, algorithm::xBR, 3.0f), 0, 72) == 0);
+        }
+        CHECK(scheduler.predict(algorithm::xBR, 1000) > 0ns);
+        CHECK(scheduler.predict(algorithm::Nearest, 1000) == 0ns);
+    }
+
+    SUBCASE("An overrunning frame falls back for its remaining bands") {
+        deadline_scheduler scheduler(make_options(1ns, {algorithm::HQ, algorithm::Nearest}));
+        output_image output(62, 48);
+        // No timings yet: HQ is tried, and abandoned after its first band
+        const auto first = scheduler.scale(sprite, output);
+        CHECK(first.planned == algorithm::HQ);
+        CHECK(first.finished == algorithm::Nearest);
+        CHECK(first.fallback_bands == 3);
+        CHECK(first.over_budget());
+        CHECK(test::count_mismatches(output, image_scaler::scale(sprite, algorithm::HQ, 2.0f), 0, 12) == 0);
+        CHECK(test::count_mismatches(output, image_scaler::scale(sprite, algorithm::Nearest, 2.0f), 12, 48) == 0);
+
+        // Now HQ is known not to fit
+        const auto second = scheduler.scale(sprite, output);
+        CHECK(second.planned == algorithm::Nearest);
+        CHECK(second.fallback_bands == 0);
+    }
+
+    SUBCASE("Switching up needs a sustained margin, switching down is immediate") {
+        deadline_options options = make_options(1ms, {algorithm::xBR, algorithm::HQ, algorithm::Nearest});
+        options.headroom = 0.9;
+        options.upgrade_margin = 0.7;
+        options.upgrade_frames = 3;
+        options.smoothing = 1.0;
+        deadline_scheduler scheduler(options);
+        const size_t pixels = 10000;
+
+        scheduler.observe(algorithm::xBR, pixels, 1000us);
+        scheduler.observe(algorithm::HQ, pixels, 500us);
+        scheduler.observe(algorithm::Nearest, pixels, 10us);
+        CHECK(scheduler.choose(pixels, 2) == algorithm::HQ);
+
+        // Fits the budget, but not with margin: no flicker back to xBR
+        scheduler.observe(algorithm::xBR, pixels, 800us);
+        for (int frame = 0; frame < 10; ++frame) {
+            CHECK(scheduler.choose(pixels, 2) == algorithm::HQ);
+        }
+
+        // Comfortable for three frames in a row
+        scheduler.observe(algorithm::xBR, pixels, 600us);
+        CHECK(scheduler.choose(pixels, 2) == algorithm::HQ);
+        CHECK(scheduler.choose(pixels, 2) == algorithm::HQ);
+        CHECK(scheduler.choose(pixels, 2) == algorithm::xBR);
+
+        // One slow frame is enough to step down
+        scheduler.observe(algorithm::xBR, pixels, 950us);
+        CHECK(scheduler.choose(pixels, 2) == algorithm::HQ);
+        scheduler.observe(algorithm::HQ, pixels, 2000us);
+        CHECK(scheduler.choose(pixels, 2) == algorithm::Nearest);
+        CHECK(scheduler.current() == algorithm::Nearest);
+    }
+
+    SUBCASE("Quality recovers once load drops") {
+        deadline_options options = make_options(1ms, {algorithm::xBR, algorithm::Nearest});
+        options.upgrade_frames = 5;
+        options.stale_decay = 0.05;
+        deadline_scheduler scheduler(options);
+        const size_t pixels = 10000;
+
+        // Under load xBR takes twice the budget
+        scheduler.observe(algorithm::xBR, pixels, 2ms);
+        scheduler.observe(algorithm::Nearest, pixels, 10us);
+        CHECK(scheduler.choose(pixels, 2) == algorithm::Nearest);
+
+        // Still loaded: xBR is retried now and then, but does not stick
+        int xbr_frames = 0;
+        for (int frame = 0; frame < 200; ++frame) {
+            const algorithm algo = scheduler.choose(pixels, 2);
+            scheduler.observe(algo, pixels, algo == algorithm::xBR ? 2ms : 10us);
+            xbr_frames += algo == algorithm::xBR;
+        }
+        CHECK(xbr_frames > 0);
+        CHECK(xbr_frames < 20);
+
+        // Load drops: xBR now takes half the budget, and it is back within a few retries
+        int recovered_at = -1;
+        for (int frame = 0; frame < 200 && recovered_at < 0; ++frame) {
+            const algorithm algo = scheduler.choose(pixels, 2);
+            scheduler.observe(algo, pixels, algo == algorithm::xBR ? 500us : 10us);
+            if (algo == algorithm::xBR && scheduler.predict(algorithm::xBR, pixels) < 600us) {
+                recovered_at = frame;
+            }
+        }
+        REQUIRE(recovered_at >= 0);
+        for (int frame = 0; frame < 50; ++frame) {
+            CHECK(scheduler.choose(pixels, 2) == algorithm::xBR);
+            scheduler.observe(algorithm::xBR, pixels, 500us);
+        }
+    }
+
+    SUBCASE("Preferences that cannot do the scale are skipped") {
+        deadline_scheduler scheduler(make_options(10s, {algorithm::EPX, algorithm::HQ}));
+        output_image output(93, 72);
+        CHECK(scheduler.scale(sprite, output).planned == algorithm::HQ);
+    }
+
+    SUBCASE("Invalid setups are rejected") {
+        CHECK_THROWS_AS(deadline_scheduler(make_options(1ms, {})), std::invalid_argument);
+
+        deadline_scheduler scheduler(make_options(1ms, {algorithm::EPX, algorithm::Eagle}));
+        output_image triple(93, 72);
+        CHECK_THROWS_AS(scheduler.scale(sprite, triple), unsupported_scale_exception);
+        output_image stretched(62, 72);
+        CHECK_THROWS_AS(scheduler.scale(sprite, stretched), dimension_mismatch_exception);
+    }
+}
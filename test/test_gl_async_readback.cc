@@ -0,0 +1,87 @@
+#include <doctest/doctest.h>
+#include <scaler/gpu/gl_async_readback.hh>
+#include <scaler/gpu/opengl_texture_scaler.hh>
+#include <cstdint>
+#include <vector>
+
+#include "gpu_test_context.hh"
+
+using namespace scaler;
+
+namespace {
+    std::vector<std::uint8_t> make_frame(int width, int height, size_t pitch, int seed) {
+        std::vector<std::uint8_t> pixels(pitch * static_cast<size_t>(height), 0xEE);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                std::uint8_t* p = pixels.data() + static_cast<size_t>(y) * pitch + static_cast<size_t>(x) * 4;
+                p[0] = static_cast<std::uint8_t>(x * 13 + seed);
+                p[1] = static_cast<std::uint8_t>(y * 7 + seed * 3);
+                p[2] = static_cast<std::uint8_t>((x ^ y) + seed);
+                p[3] = 255;
+            }
+        }
+        return pixels;
+    }
+
+    // Drops the row padding of a pitched frame
+    std::vector<std::uint8_t> packed_rows(const std::vector<std::uint8_t>& frame, int width, int height, size_t pitch) {
+        const size_t row = static_cast<size_t>(width) * 4;
+        std::vector<std::uint8_t> packed;
+        for (int y = 0; y < height; ++y) {
+            const auto* begin = frame.data() + static_cast<size_t>(y) * pitch;
+            packed.insert(packed.end(), begin, begin + row);
+        }
+        return packed;
+    }
+}
+
+TEST_CASE("GL async readback") {
+    scaler::test::gpu_context::scoped_context gpu_ctx;
+    if (!gpu_ctx) {
+        INFO("Could not create/get OpenGL context - skipping GPU tests");
+        return;
+    }
+
+    constexpr int w = 9;
+    constexpr int h = 7;
+    constexpr size_t pitch = w * 4 + 12;
+    GLuint texture = gpu::opengl_texture_scaler::create_output_texture(w, h);
+
+    SUBCASE("Frames round-trip through the ring") {
+        gpu::gl_async_readback readback(2);
+
+        // More frames than ring slots, so every slot is reused
+        for (int frame = 0; frame < 5; ++frame) {
+            CAPTURE(frame);
+            const auto pixels = make_frame(w, h, pitch, frame);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(pitch / 4));
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            auto ticket = readback.submit(texture, w, h);
+            std::vector<std::uint8_t> result;
+            readback.read(ticket, result);
+            CHECK(result == packed_rows(pixels, w, h, pitch));
+        }
+
+        CHECK(readback.stats().transfers == 5);
+        CHECK(readback.stats().bytes == static_cast<size_t>(5 * w * h * 4));
+    }
+
+    SUBCASE("Tickets expire when their slot is reused") {
+        gpu::gl_async_readback readback(1);
+        auto first = readback.submit(texture, w, h);
+        auto second = readback.submit(texture, w, h);
+
+        std::vector<std::uint8_t> result;
+        CHECK_THROWS_AS(readback.read(first, result), std::invalid_argument);
+
+        glFinish();
+        CHECK(readback.try_read(second, result));
+        CHECK(result.size() == static_cast<size_t>(w * h * 4));
+    }
+
+    glDeleteTextures(1, &texture);
+}
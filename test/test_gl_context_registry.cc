@@ -0,0 +1,132 @@
+#include <doctest/doctest.h>
+#include <scaler/gpu/gl_context_registry.hh>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gpu_test_context.hh"
+
+using namespace scaler;
+
+namespace {
+    // Stands in for SDL_GL_GetCurrentContext(); every fake context maps to the
+    // one real test context, which is enough to exercise the bookkeeping
+    gpu::gl_context_handle fake_current = nullptr;
+
+    gpu::gl_context_handle query_fake_context() {
+        return fake_current;
+    }
+
+    std::vector<std::uint8_t> scale_2x(gpu::opengl_texture_scaler& scaler, GLuint input, int width, int height) {
+        GLuint output = gpu::opengl_texture_scaler::create_output_texture(width * 2, height * 2);
+        scaler.scale_texture_to_texture(input, width, height, output, width * 2, height * 2, algorithm::OmniScale);
+
+        std::vector<std::uint8_t> pixels(static_cast<size_t>(width * height * 16));
+        GLuint fbo;
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, output, 0);
+        glReadPixels(0, 0, width * 2, height * 2, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteTextures(1, &output);
+        return pixels;
+    }
+}
+
+TEST_CASE("GL context registry") {
+    SUBCASE("Without a context query every thread has its own scaler") {
+        gpu::gl_context_registry registry;
+        auto* main_scaler = &registry.scaler_for_current_context();
+        CHECK(&registry.scaler_for_current_context() == main_scaler);
+
+        gpu::opengl_texture_scaler* worker_scaler = nullptr;
+        std::thread worker([&] {
+            worker_scaler = &registry.scaler_for_current_context();
+            CHECK(worker_scaler->shaders() != main_scaler->shaders());
+            // No GL objects exist yet, so releasing needs no context
+            registry.release_current_context();
+        });
+        worker.join();
+
+        CHECK(worker_scaler != main_scaler);
+        CHECK(registry.context_count() == 1);
+        registry.release_current_context();
+        CHECK(registry.context_count() == 0);
+    }
+
+    SUBCASE("A thread's fallback scaler is released when the thread exits") {
+        gpu::gl_context_registry registry;
+        std::vector<std::shared_ptr<gpu::shader_cache>> caches;
+        for (int i = 0; i < 3; ++i) {
+            std::thread worker([&] {
+                caches.push_back(registry.scaler_for_current_context().shaders());
+            });
+            worker.join();
+            // A later thread may reuse the identity's address, so nothing may remain
+            CHECK(registry.context_count() == 0);
+        }
+        CHECK(caches[0] != caches[1]);
+        CHECK(caches[1] != caches[2]);
+    }
+
+    SUBCASE("Contexts of a share group compile each program once") {
+        scaler::test::gpu_context::scoped_context gpu_ctx;
+        if (!gpu_ctx) {
+            INFO("Could not create/get OpenGL context - skipping GPU tests");
+            return;
+        }
+
+        constexpr int w = 8;
+        constexpr int h = 6;
+        std::vector<std::uint8_t> rgba(static_cast<size_t>(w * h * 4));
+        for (size_t i = 0; i < rgba.size(); ++i) {
+            rgba[i] = static_cast<std::uint8_t>(i % 4 == 3 ? 255 : (i * 37) % 251);
+        }
+        GLuint input;
+        glGenTextures(1, &input);
+        glBindTexture(GL_TEXTURE_2D, input);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        int main_context = 0;
+        int worker_context = 0;
+        int unrelated_context = 0;
+
+        gpu::gl_context_registry registry;
+        registry.set_context_query(query_fake_context);
+        registry.add_to_share_group(&worker_context, &main_context);
+
+        fake_current = &main_context;
+        auto& main_scaler = registry.scaler_for_current_context();
+        const auto expected = scale_2x(main_scaler, input, w, h);
+        const size_t compiled = main_scaler.shaders()->size();
+
+        fake_current = &worker_context;
+        auto& worker_scaler = registry.scaler_for_current_context();
+        CHECK(&worker_scaler != &main_scaler);
+        CHECK(worker_scaler.shaders() == main_scaler.shaders());
+        CHECK(scale_2x(worker_scaler, input, w, h) == expected);
+        CHECK(worker_scaler.shaders()->size() == compiled);
+
+        fake_current = &unrelated_context;
+        auto& unrelated_scaler = registry.scaler_for_current_context();
+        CHECK(unrelated_scaler.shaders() != main_scaler.shaders());
+        CHECK(scale_2x(unrelated_scaler, input, w, h) == expected);
+
+        // A used context cannot move to another group
+        CHECK_THROWS_AS(registry.add_to_share_group(&unrelated_context, &main_context), std::logic_error);
+
+        CHECK(registry.context_count() == 3);
+        registry.release(&unrelated_context);
+        registry.release(&worker_context);
+        registry.release(&main_context);
+        CHECK(registry.context_count() == 0);
+
+        fake_current = nullptr;
+        glDeleteTextures(1, &input);
+    }
+}
@@ -0,0 +1,129 @@
+#include <doctest/doctest.h>
+#include <scaler/gpu/opengl_texture_scaler.hh>
+#include <scaler/gpu/gl_state_cache.hh>
+#include <vector>
+
+#include "gpu_test_context.hh"
+
+using namespace scaler;
+
+namespace {
+    GLuint create_pattern_texture(int width, int height) {
+        std::vector<unsigned char> pixels(static_cast<size_t>(width * height * 4));
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                size_t idx = static_cast<size_t>((y * width + x) * 4);
+                const bool on = ((x / 2) + (y / 3)) % 2 == 0;
+                pixels[idx] = on ? 240 : 20;
+                pixels[idx + 1] = static_cast<unsigned char>(x * 16);
+                pixels[idx + 2] = static_cast<unsigned char>(y * 16);
+                pixels[idx + 3] = 255;
+            }
+        }
+
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        // Deliberately linear: sampling state must come from the scaler's sampler object
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+
+    std::vector<unsigned char> read_pixels(GLuint texture, int width, int height) {
+        std::vector<unsigned char> pixels(static_cast<size_t>(width * height * 4));
+        GLuint fbo;
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &fbo);
+        return pixels;
+    }
+}
+
+TEST_CASE("GL state cache") {
+    scaler::test::gpu_context::scoped_context gpu_ctx;
+    if (!gpu_ctx) {
+        INFO("Could not create/get OpenGL context - skipping GPU tests");
+        return;
+    }
+
+    constexpr int in_w = 8;
+    constexpr int in_h = 8;
+    constexpr int out_w = 16;
+    constexpr int out_h = 16;
+    constexpr int frames = 8;
+
+    GLuint input = create_pattern_texture(in_w, in_h);
+
+    SUBCASE("Batched calls match unbatched output and skip redundant state") {
+        gpu::opengl_texture_scaler scaler;
+
+        GLuint single = gpu::opengl_texture_scaler::create_output_texture(out_w, out_h);
+        scaler.scale_texture_to_texture(input, in_w, in_h, single, out_w, out_h, algorithm::EPX);
+        const auto expected = read_pixels(single, out_w, out_h);
+        const size_t unbatched_changes = scaler.get_gl_stats().state_changes;
+
+        std::vector<GLuint> outputs;
+        for (int i = 0; i < frames; ++i) {
+            outputs.push_back(gpu::opengl_texture_scaler::create_output_texture(out_w, out_h));
+        }
+
+        scaler.reset_gl_stats();
+        {
+            gpu::scoped_gl_batch batch(scaler.state());
+            for (GLuint output : outputs) {
+                scaler.scale_texture_to_texture(input, in_w, in_h, output, out_w, out_h, algorithm::EPX);
+            }
+        }
+
+        const auto& stats = scaler.get_gl_stats();
+        CHECK(stats.draw_calls == frames);
+        // Sizes never change, so the parameter block is not re-uploaded
+        CHECK(stats.uniform_uploads == 0);
+        CHECK(stats.redundant_skipped > 0);
+        // Only the caller state is queried, once for the whole batch
+        CHECK(stats.state_queries == 2 + frames);
+        CHECK(stats.state_changes < unbatched_changes * frames);
+
+        for (GLuint output : outputs) {
+            CHECK(read_pixels(output, out_w, out_h) == expected);
+        }
+
+        glDeleteTextures(static_cast<GLsizei>(outputs.size()), outputs.data());
+        glDeleteTextures(1, &single);
+    }
+
+    SUBCASE("Caller framebuffer and viewport are restored") {
+        gpu::opengl_texture_scaler scaler;
+        GLuint target = gpu::opengl_texture_scaler::create_output_texture(out_w, out_h);
+
+        GLuint caller_fbo;
+        glGenFramebuffers(1, &caller_fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, caller_fbo);
+        glViewport(3, 5, 7, 11);
+
+        scaler.scale_texture_to_texture(input, in_w, in_h, target, out_w, out_h, algorithm::Scale);
+
+        GLint fbo = 0;
+        GLint viewport[4] = {0, 0, 0, 0};
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &fbo);
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        CHECK(static_cast<GLuint>(fbo) == caller_fbo);
+        CHECK(viewport[0] == 3);
+        CHECK(viewport[1] == 5);
+        CHECK(viewport[2] == 7);
+        CHECK(viewport[3] == 11);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &caller_fbo);
+        glDeleteTextures(1, &target);
+    }
+
+    glDeleteTextures(1, &input);
+}
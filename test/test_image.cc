@@ -0,0 +1,178 @@
+#include <doctest/doctest.h>
+#include <scaler/image.hh>
+#include <scaler/unified_scaler.hh>
+#include <cstdint>
+#include <utility>
+
+#include "test_common.hh"
+
+using namespace scaler;
+
+namespace {
+    using pixel = vec3<std::uint8_t>;
+    using rgb_image = scaler::image<pixel>;
+    using test_input = test::TestInputImage<pixel>;
+    using test_output = test::TestOutputImage<pixel>;
+
+    pixel pattern(size_t x, size_t y) {
+        return {static_cast<std::uint8_t>(((x / 3) ^ (y / 2)) % 3 * 90),
+                static_cast<std::uint8_t>(x * 11), static_cast<std::uint8_t>(y * 7)};
+    }
+
+    void fill_pattern(rgb_image& image) {
+        for (size_t y = 0; y < image.height(); ++y) {
+            for (size_t x = 0; x < image.width(); ++x) {
+                image.set_pixel(x, y, pattern(x, y));
+            }
+        }
+    }
+}
+
+TEST_CASE("image layout") {
+    SUBCASE("Rows are cache-line aligned and strides avoid 4K aliasing") {
+        for (size_t width : {size_t{1}, size_t{63}, size_t{256}, size_t{1024}, size_t{1365}, size_t{4096}}) {
+            for (size_t border : {size_t{0}, size_t{2}}) {
+                CAPTURE(width);
+                CAPTURE(border);
+                const scaler::image<uvec3> image(width, 3, border);
+                CHECK(image.stride() % 64 == 0);
+                CHECK(image.stride() % 4096 != 0);
+                CHECK(image.stride() >= (width + 2 * border) * sizeof(uvec3));
+                for (size_t y = 0; y < 3; ++y) {
+                    CHECK(reinterpret_cast<std::uintptr_t>(image.row(y).data()) % 64 == 0);
+                }
+            }
+        }
+        // 1024 uvec3 pixels are exactly 3 pages; the stride gets one more cache line
+        CHECK(scaler::image<uvec3>(1024, 1).stride() == 3 * 4096 + 64);
+        CHECK(scaler::image<pixel>(256, 1).stride() == 768);
+    }
+
+    SUBCASE("Large images start on a huge-page boundary") {
+        const scaler::image<uvec3> image(2048, 1024);
+        CHECK(reinterpret_cast<std::uintptr_t>(image.data()) % (size_t{2} << 20) == 0);
+    }
+
+    SUBCASE("New images are black") {
+        const rgb_image image(5, 4, 1);
+        CHECK(image.get_pixel(4, 3) == pixel());
+        CHECK(image.safe_access(-1, 7) == pixel());
+    }
+}
+
+TEST_CASE("image pixel and row access") {
+    rgb_image image(7, 5);
+    fill_pattern(image);
+    CHECK(image.get_pixel(6, 4) == pattern(6, 4));
+
+    auto row = image.row(2);
+    CHECK(row.size() == 7);
+    row[3] = pixel(1, 2, 3);
+    CHECK(image.get_pixel(3, 2) == pixel(1, 2, 3));
+
+    size_t count = 0;
+    for (const pixel& p : std::as_const(image).row(4)) {
+        CHECK(p == pattern(count, 4));
+        ++count;
+    }
+    CHECK(count == 7);
+
+    SUBCASE("Copies are deep") {
+        rgb_image copy = image;
+        copy.set_pixel(0, 0, pixel(9, 9, 9));
+        CHECK(image.get_pixel(0, 0) == pattern(0, 0));
+        CHECK(copy.get_pixel(6, 4) == pattern(6, 4));
+    }
+
+    SUBCASE("Moves take the pixels") {
+        rgb_image moved = std::move(image);
+        CHECK(moved.get_pixel(6, 4) == pattern(6, 4));
+        CHECK(image.width() == 0);
+    }
+}
+
+TEST_CASE("image border") {
+    rgb_image image(6, 4, 2);
+    fill_pattern(image);
+    CHECK_FALSE(image.border_valid());
+
+    auto check_clamped = [&image] {
+        for (coord_t y = -3; y < 7; ++y) {
+            for (coord_t x = -3; x < 9; ++x) {
+                const auto cx = static_cast<size_t>(clamp_coord(x, 0, 5));
+                const auto cy = static_cast<size_t>(clamp_coord(y, 0, 3));
+                if (!(image.safe_access(x, y) == pattern(cx, cy))) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    CHECK(check_clamped());
+    image.refresh_border();
+    CHECK(image.border_valid());
+    CHECK(check_clamped());
+    CHECK(image.safe_access(-1, -1, ZERO) == pixel());
+
+    image.set_pixel(0, 0, pixel(5, 5, 5));
+    CHECK_FALSE(image.border_valid());
+    CHECK(image.safe_access(-2, -2) == pixel(5, 5, 5));
+}
+
+TEST_CASE("image with unified_scaler") {
+    test_input reference_input(17, 13);
+    rgb_image input(17, 13, 3);
+    for (size_t y = 0; y < 13; ++y) {
+        for (size_t x = 0; x < 17; ++x) {
+            reference_input.at(x, y) = pattern(x, y);
+        }
+    }
+    fill_pattern(input);
+    input.refresh_border();
+
+    for (algorithm algo : {algorithm::EPX, algorithm::HQ, algorithm::xBR, algorithm::OmniScale, algorithm::Bilinear}) {
+        CAPTURE(scaler_capabilities::get_algorithm_name(algo));
+        const auto expected = unified_scaler<test_input, test_output>::scale(reference_input, algo, 2.0f);
+        const auto result = unified_scaler<rgb_image, rgb_image>::scale(input, algo, 2.0f);
+        REQUIRE(result.width() == expected.width());
+
+        size_t mismatches = 0;
+        for (size_t y = 0; y < expected.height(); ++y) {
+            for (size_t x = 0; x < expected.width(); ++x) {
+                if (!(result.get_pixel(x, y) == expected.at(x, y))) {
+                    ++mismatches;
+                }
+            }
+        }
+        CHECK(mismatches == 0);
+    }
+}
+
+TEST_CASE("image as a band-parallel output") {
+    rgb_image input(40, 64, 2);
+    fill_pattern(input);
+    input.refresh_border();
+
+    for (algorithm algo : {algorithm::EPX, algorithm::HQ, algorithm::Bilinear}) {
+        CAPTURE(scaler_capabilities::get_algorithm_name(algo));
+        rgb_image serial(80, 128);
+        unified_scaler<rgb_image, rgb_image>::scale(input, serial, algo, detail::band_plan{});
+
+        // Four threads writing one image; run under TSan to check the border flag
+        rgb_image banded(80, 128, 1);
+        banded.refresh_border();
+        unified_scaler<rgb_image, rgb_image>::scale(input, banded, algo, detail::band_plan{4, 16});
+        CHECK_FALSE(banded.border_valid());
+
+        size_t mismatches = 0;
+        for (size_t y = 0; y < serial.height(); ++y) {
+            for (size_t x = 0; x < serial.width(); ++x) {
+                if (!(banded.get_pixel(x, y) == serial.get_pixel(x, y))) {
+                    ++mismatches;
+                }
+            }
+        }
+        CHECK(mismatches == 0);
+    }
+}
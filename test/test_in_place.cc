@@ -0,0 +1,76 @@
+#include <doctest/doctest.h>
+#include <scaler/in_place.hh>
+#include <scaler/image.hh>
+#include <scaler/unified_scaler.hh>
+#include <cstdint>
+
+#include "test_common.hh"
+
+using namespace scaler;
+
+namespace {
+    using pixel = vec3<std::uint8_t>;
+    using input_image = test::TestInputImage<pixel>;
+    using output_image = test::TestOutputImage<pixel>;
+    using image_scaler = unified_scaler<input_image, output_image>;
+    using buffer_image = image<pixel>;
+
+    // Output-sized buffer with the source in its top-left corner
+    buffer_image make_buffer(const input_image& source, size_t factor) {
+        buffer_image buffer(source.width() * factor, source.height() * factor);
+        buffer.fill(pixel(9, 9, 9));
+        for (size_t y = 0; y < source.height(); ++y) {
+            for (size_t x = 0; x < source.width(); ++x) {
+                buffer.set_pixel(x, y, source.get_pixel(x, y));
+            }
+        }
+        return buffer;
+    }
+}
+
+TEST_CASE("In-place scaling") {
+    const input_image sprite = test::create_sprite<pixel>(23, 17);
+
+    SUBCASE("Matches scale() for every algorithm and integral scale") {
+        for (algorithm algo : scaler_capabilities::get_all_algorithms()) {
+            for (int factor : {2, 3, 4}) {
+                if (!scaler_capabilities::is_scale_supported(algo, static_cast<float>(factor))) {
+                    continue;
+                }
+                const auto expected = image_scaler::scale(sprite, algo, static_cast<float>(factor));
+                for (size_t band_rows : {size_t{1}, size_t{5}, size_t{32}}) {
+                    buffer_image buffer = make_buffer(sprite, static_cast<size_t>(factor));
+                    scale_in_place(buffer, sprite.width(), sprite.height(), algo, band_rows);
+                    INFO(scaler_capabilities::get_algorithm_name(algo), " ", factor, "x, band rows ", band_rows);
+                    CHECK(test::count_mismatches(buffer, expected) == 0);
+                }
+            }
+        }
+    }
+
+    SUBCASE("Single row and single column sources") {
+        for (const input_image& source : {test::create_sprite<pixel>(1, 9), test::create_sprite<pixel>(9, 1)}) {
+            const auto expected = image_scaler::scale(source, algorithm::xBR, 3.0f);
+            buffer_image buffer = make_buffer(source, 3);
+            scale_in_place(buffer, source.width(), source.height(), algorithm::xBR, 2);
+            CHECK(test::count_mismatches(buffer, expected) == 0);
+        }
+    }
+
+    SUBCASE("Scale factor 1 leaves the buffer alone") {
+        buffer_image buffer = make_buffer(sprite, 1);
+        scale_in_place(buffer, sprite.width(), sprite.height(), algorithm::Nearest);
+        CHECK(buffer.get_pixel(7, 5) == sprite.get_pixel(7, 5));
+    }
+
+    SUBCASE("Buffers that are not an integral multiple are rejected") {
+        buffer_image odd(50, 34);
+        CHECK_THROWS_AS(scale_in_place(odd, 23, 17, algorithm::EPX), unsupported_scale_exception);
+
+        buffer_image triple(69, 51);
+        CHECK_THROWS_AS(scale_in_place(triple, 23, 17, algorithm::EPX), unsupported_scale_exception);
+
+        buffer_image stretched(46, 51);
+        CHECK_THROWS_AS(scale_in_place(stretched, 23, 17, algorithm::EPX), dimension_mismatch_exception);
+    }
+}
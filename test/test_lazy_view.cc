@@ -0,0 +1,118 @@
+#include <doctest/doctest.h>
+#include <scaler/lazy_view.hh>
+#include <scaler/unified_scaler.hh>
+#include <cstdint>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "test_common.hh"
+
+using namespace scaler;
+
+namespace {
+    using pixel = vec3<std::uint8_t>;
+    using input_image = test::TestInputImage<pixel>;
+    using output_image = test::TestOutputImage<pixel>;
+
+    template<algorithm Algo, size_t Factor>
+    size_t count_view_mismatches(const input_image& map, size_t tile_size) {
+        lazy_view_options options;
+        options.tile_size = tile_size;
+        const lazy_scaled_view<input_image, Algo, Factor> view(map, options);
+        const auto expected = unified_scaler<input_image, output_image>::scale(map, Algo, static_cast<float>(Factor));
+        CHECK(view.width() == expected.width());
+        CHECK(view.height() == expected.height());
+        return test::count_mismatches(view, expected);
+    }
+}
+
+TEST_CASE("Lazy scaled view") {
+    const input_image map = test::create_sprite<pixel>(37, 23);
+
+    SUBCASE("Pixels match a whole-image scale whatever the tile size") {
+        for (const size_t tile_size : {size_t{1}, size_t{8}, size_t{64}}) {
+            INFO("tile size ", tile_size);
+            CHECK(count_view_mismatches<algorithm::xBR, 3>(map, tile_size) == 0);
+            CHECK(count_view_mismatches<algorithm::HQ, 4>(map, tile_size) == 0);
+            CHECK(count_view_mismatches<algorithm::Scale, 2>(map, tile_size) == 0);
+            CHECK(count_view_mismatches<algorithm::OmniScale, 3>(map, tile_size) == 0);
+        }
+    }
+
+    SUBCASE("Only touched tiles are scaled, and the cache is bounded") {
+        lazy_view_options options;
+        options.tile_size = 8;
+        options.max_tiles = 2;
+        const lazy_scaled_view<input_image, algorithm::xBR, 2> view(map, options);
+        CHECK(view.scaled_tiles() == 0);
+
+        (void)view.get_pixel(3, 5);
+        (void)view.get_pixel(15, 15);
+        CHECK(view.scaled_tiles() == 1);
+
+        (void)view.get_pixel(20, 0);
+        (void)view.get_pixel(0, 0);
+        CHECK(view.scaled_tiles() == 2);
+
+        // Evicts tile (1, 0), read longer ago than (0, 0)
+        (void)view.get_pixel(0, 20);
+        CHECK(view.cached_tiles() == 2);
+        (void)view.get_pixel(0, 0);
+        CHECK(view.scaled_tiles() == 3);
+        (void)view.get_pixel(20, 0);
+        CHECK(view.scaled_tiles() == 4);
+
+        // Bottom-right tile is partial
+        CHECK(view.tile(4, 2)->width() == 10);
+        CHECK(view.tile(4, 2)->height() == 14);
+    }
+
+    SUBCASE("Feeds another scaler") {
+        using view_type = lazy_scaled_view<input_image, algorithm::Scale, 2>;
+        const view_type view(map);
+        const auto twice = unified_scaler<view_type, output_image>::scale(view, algorithm::Scale, 2.0f);
+        const auto expected = unified_scaler<input_image, output_image>::scale(map, algorithm::Scale, 4.0f);
+        CHECK(twice.width() == expected.width());
+        CHECK(test::count_mismatches(twice, expected) == 0);
+    }
+
+    SUBCASE("Concurrent readers scale each tile once") {
+        lazy_view_options options;
+        options.tile_size = 8;
+        const lazy_scaled_view<input_image, algorithm::HQ, 2> view(map, options);
+        const auto expected = unified_scaler<input_image, output_image>::scale(map, algorithm::HQ, 2.0f);
+
+        std::vector<size_t> mismatches(4);
+        std::vector<std::thread> readers;
+        for (size_t i = 0; i < mismatches.size(); ++i) {
+            readers.emplace_back([&, i] { mismatches[i] = test::count_mismatches(view, expected); });
+        }
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        for (const size_t count : mismatches) {
+            CHECK(count == 0);
+        }
+        CHECK(view.scaled_tiles() == 15);
+    }
+
+    SUBCASE("A view at the address of a destroyed one reads its own tiles") {
+        using view_type = lazy_scaled_view<input_image, algorithm::Scale, 2>;
+        input_image other = map;
+        other.at(0, 0) = pixel(255, 255, 255);
+        const auto expected = unified_scaler<input_image, output_image>::scale(other, algorithm::Scale, 2.0f);
+
+        std::optional<view_type> view;
+        view.emplace(map);
+        CHECK_FALSE(view->get_pixel(0, 0) == expected.at(0, 0));
+        view.reset();
+        view.emplace(other);
+        CHECK(test::count_mismatches(*view, expected) == 0);
+    }
+
+    SUBCASE("Unsupported factors are rejected") {
+        using view_type = lazy_scaled_view<input_image, algorithm::EPX, 3>;
+        CHECK_THROWS_AS(view_type{map}, unsupported_scale_exception);
+    }
+}
@@ -0,0 +1,78 @@
+#include <doctest/doctest.h>
+#include <scaler/multi_scale.hh>
+#include <scaler/unified_scaler.hh>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "test_common.hh"
+
+using namespace scaler;
+
+namespace {
+    // Outputs of scale_multi() at factors that differ from scale() at the same factor
+    template<typename Pixel>
+    size_t count_mismatched_outputs(const test::TestInputImage<Pixel>& sprite, algorithm algo,
+                                    const std::vector<float>& factors) {
+        using input_image = test::TestInputImage<Pixel>;
+        using output_image = test::TestOutputImage<Pixel>;
+        const auto outputs = scale_multi<input_image, output_image>(sprite, algo, factors);
+        size_t mismatched = 0;
+        for (size_t i = 0; i < factors.size(); ++i) {
+            const auto expected = unified_scaler<input_image, output_image>::scale(sprite, algo, factors[i]);
+            const bool same = outputs[i].width() == expected.width() && outputs[i].height() == expected.height() &&
+                              test::count_mismatches(outputs[i], expected) == 0;
+            mismatched += same ? 0 : 1;
+        }
+        return mismatched;
+    }
+}
+
+TEST_CASE("Multi-output scaling") {
+    const std::pair<algorithm, std::vector<float>> exports[] = {
+        {algorithm::HQ, {2.0f, 3.0f, 4.0f}}, {algorithm::HQ, {4.0f, 3.0f}},
+        {algorithm::Scale, {2.0f, 3.0f, 4.0f}}, {algorithm::Scale, {4.0f, 4.0f}},
+        {algorithm::OmniScale, {3.0f, 2.0f}}, {algorithm::xBR, {2.0f, 3.0f}}};
+    const size_t sizes[][2] = {{31, 24}, {13, 7}, {1, 1}, {1, 5}, {6, 1}};
+
+    SUBCASE("Matches scale() at every factor, 8-bit channels") {
+        for (const auto& size : sizes) {
+            const auto sprite = test::create_sprite<vec3<std::uint8_t>>(size[0], size[1]);
+            for (const auto& [algo, factors] : exports) {
+                INFO(scaler_capabilities::get_algorithm_name(algo), " ", size[0], "x", size[1]);
+                CHECK(count_mismatched_outputs(sprite, algo, factors) == 0);
+            }
+        }
+    }
+
+    SUBCASE("Matches scale() at every factor, 32-bit channels") {
+        const auto sprite = test::create_sprite<uvec3>(17, 11);
+        for (const auto& [algo, factors] : exports) {
+            INFO(scaler_capabilities::get_algorithm_name(algo));
+            CHECK(count_mismatched_outputs(sprite, algo, factors) == 0);
+        }
+    }
+
+    SUBCASE("Shared families") {
+        CHECK(is_multi_scale_shared(algorithm::HQ));
+        CHECK(is_multi_scale_shared(algorithm::OmniScale));
+        CHECK_FALSE(is_multi_scale_shared(algorithm::xBR));
+    }
+
+    SUBCASE("Invalid outputs are rejected before any is written") {
+        using output_image = test::TestOutputImage<vec3<std::uint8_t>>;
+        const auto sprite = test::create_sprite<vec3<std::uint8_t>>(8, 6);
+
+        std::vector<output_image> outputs;
+        outputs.emplace_back(16, 12);
+        outputs.emplace_back(32, 24);
+        CHECK_THROWS_AS(scale_multi(sprite, outputs, algorithm::OmniScale), unsupported_scale_exception);
+        CHECK(outputs[0].at(0, 0) == vec3<std::uint8_t>());
+
+        outputs.emplace_back(16, 18);
+        CHECK_THROWS_AS(scale_multi(sprite, outputs, algorithm::HQ), std::runtime_error);
+        CHECK_THROWS_AS((scale_multi<test::TestInputImage<vec3<std::uint8_t>>, output_image>(
+                            sprite, algorithm::Scale, {2.0f, 5.0f})),
+                        unsupported_scale_exception);
+    }
+}
@@ -0,0 +1,129 @@
+#include <doctest/doctest.h>
+#include <scaler/unified_scaler.hh>
+#include <scaler/native_resolution.hh>
+#include <cstdint>
+
+#include "test_common.hh"
+
+using namespace scaler;
+
+namespace {
+    using pixel = vec3<std::uint8_t>;
+    using input_image = test::TestInputImage<pixel>;
+    using output_image = test::TestOutputImage<pixel>;
+    using image_scaler = unified_scaler<input_image, output_image>;
+
+    // Nearest upscale by (bw, bh), dropping the first crop_x columns and crop_y rows
+    input_image blow_up(const input_image& source, size_t bw, size_t bh, size_t crop_x = 0, size_t crop_y = 0) {
+        input_image image(source.width() * bw - crop_x, source.height() * bh - crop_y);
+        for (size_t y = 0; y < image.height(); ++y) {
+            for (size_t x = 0; x < image.width(); ++x) {
+                image.at(x, y) = source.get_pixel((x + crop_x) / bw, (y + crop_y) / bh);
+            }
+        }
+        return image;
+    }
+}
+
+TEST_CASE("Native grid detection") {
+    const input_image sprite = test::create_sprite<pixel>(20, 15);
+
+    SUBCASE("Square blocks") {
+        const auto grid = detect_native_grid(blow_up(sprite, 4, 4));
+        CHECK(grid.detected());
+        CHECK(grid.block_width == 4);
+        CHECK(grid.block_height == 4);
+        CHECK(grid.offset_x == 0);
+        CHECK(grid.offset_y == 0);
+        CHECK(grid.native_width(80) == 20);
+        CHECK(grid.native_height(60) == 15);
+    }
+
+    SUBCASE("Cropped, non-square blocks") {
+        const input_image image = blow_up(sprite, 3, 2, 1, 1);
+        const auto grid = detect_native_grid(image);
+        CHECK(grid.block_width == 3);
+        CHECK(grid.block_height == 2);
+        CHECK(grid.offset_x == 2);
+        CHECK(grid.offset_y == 1);
+        CHECK(grid.native_width(image.width()) == 20);
+        CHECK(grid.native_height(image.height()) == 15);
+        CHECK(grid.cell_x(0) == 0);
+        CHECK(grid.cell_x(1) == 2);
+        CHECK(grid.cell_x(2) == 5);
+    }
+
+    SUBCASE("Native images are left alone") {
+        CHECK_FALSE(detect_native_grid(sprite).detected());
+        CHECK_FALSE(detect_native_grid(input_image(32, 32)).detected());
+    }
+
+    SUBCASE("A single off-grid pixel defeats detection") {
+        input_image image = blow_up(sprite, 2, 2);
+        image.at(13, 9) = pixel(1, 2, 3);
+        CHECK_FALSE(detect_native_grid(image).detected());
+    }
+
+    SUBCASE("Blocks larger than max_block are ignored") {
+        CHECK_FALSE(detect_native_grid(blow_up(sprite, 6, 6), 4).detected());
+    }
+}
+
+TEST_CASE("Scaling at native resolution") {
+    const input_image sprite = test::create_sprite<pixel>(12, 10);
+
+    SUBCASE("Pre-upscaled input is scaled on its native grid") {
+        const input_image image = blow_up(sprite, 4, 4);
+        const auto result = image_scaler::scale_native(image, algorithm::HQ, 2.0f);
+        REQUIRE(result.width() == 96);
+        REQUIRE(result.height() == 80);
+
+        // HQ 4x on the 12x10 sprite, then nearest 2x
+        const auto native = image_scaler::scale(sprite, algorithm::HQ, 4.0f);
+        size_t mismatches = 0;
+        for (size_t y = 0; y < result.height(); ++y) {
+            for (size_t x = 0; x < result.width(); ++x) {
+                if (!(result.at(x, y) == native.at(x / 2, y / 2))) {
+                    ++mismatches;
+                }
+            }
+        }
+        CHECK(mismatches == 0);
+    }
+
+    SUBCASE("Exact fit") {
+        const input_image image = blow_up(sprite, 2, 2);
+        output_image output(48, 40);
+        image_scaler::scale_native(image, output, algorithm::xBR);
+
+        const auto native = image_scaler::scale(sprite, algorithm::xBR, 4.0f);
+        CHECK(output.at(17, 23) == native.at(17, 23));
+        CHECK(output.at(47, 39) == native.at(47, 39));
+    }
+
+    SUBCASE("Cropped grid keeps the image aligned") {
+        const input_image image = blow_up(sprite, 2, 2, 1, 0);
+        const auto result = image_scaler::scale_native(image, algorithm::Nearest, 2.0f);
+        REQUIRE(result.width() == image.width() * 2);
+        for (size_t x = 0; x < result.width(); ++x) {
+            CHECK(result.at(x, 5) == image.get_pixel(x / 2, 2));
+        }
+    }
+
+    SUBCASE("Native input falls back to scale()") {
+        const auto native = image_scaler::scale_native(sprite, algorithm::EPX, 2.0f);
+        const auto plain = image_scaler::scale(sprite, algorithm::EPX, 2.0f);
+        CHECK(native.at(5, 7) == plain.at(5, 7));
+        CHECK_THROWS_AS(image_scaler::scale_native(sprite, algorithm::EPX, 3.0f), unsupported_scale_exception);
+    }
+
+    SUBCASE("Scales the algorithm lacks are made up with nearest") {
+        const input_image image = blow_up(sprite, 3, 3);
+        const auto result = image_scaler::scale_native(image, algorithm::EPX, 2.0f);
+        REQUIRE(result.width() == 72);
+        const auto native = image_scaler::scale(sprite, algorithm::EPX, 2.0f);
+        CHECK(result.at(0, 0) == native.at(0, 0));
+        CHECK(result.at(71, 59) == native.at(23, 19));
+        CHECK(result.at(36, 30) == native.at(12, 10));
+    }
+}
@@ -0,0 +1,391 @@
+#include <doctest/doctest.h>
+#include <scaler/io/parallel_png_writer.hh>
+#include <scaler/io/png_stream.hh>
+#include <scaler/io/streaming_scaler.hh>
+#include <scaler/io/zlib_codec.hh>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "test_common.hh"
+
+using namespace scaler;
+
+namespace {
+    std::vector<std::uint8_t> bytes_of(const std::string& text) {
+        return {text.begin(), text.end()};
+    }
+
+    std::vector<std::uint8_t> inflate_all(const std::vector<std::uint8_t>& compressed) {
+        size_t pos = 0;
+        io::inflater inflate([&](std::uint8_t* buffer, size_t capacity) {
+            const size_t n = std::min(capacity, compressed.size() - pos);
+            std::copy_n(compressed.begin() + static_cast<std::ptrdiff_t>(pos), n, buffer);
+            pos += n;
+            return n;
+        });
+
+        std::vector<std::uint8_t> result;
+        std::uint8_t chunk[333];
+        while (size_t n = inflate.read(chunk, sizeof(chunk))) {
+            result.insert(result.end(), chunk, chunk + n);
+        }
+        CHECK(inflate.finished());
+        return result;
+    }
+
+    // Pixel-art-like content: flat runs with a few distinct colors
+    std::vector<std::uint8_t> make_pixels(size_t width, size_t height, size_t channels) {
+        std::vector<std::uint8_t> pixels(width * height * channels);
+        for (size_t y = 0; y < height; ++y) {
+            for (size_t x = 0; x < width; ++x) {
+                const auto cell = static_cast<std::uint8_t>(((x / 3) ^ (y / 2)) % 4);
+                for (size_t c = 0; c < channels; ++c) {
+                    pixels[(y * width + x) * channels + c] = static_cast<std::uint8_t>(cell * 60 + c * 17);
+                }
+            }
+        }
+        return pixels;
+    }
+
+    std::string encode_png(const std::vector<std::uint8_t>& pixels, size_t width, size_t height,
+                           int channels, int level) {
+        std::ostringstream out;
+        io::png_row_writer writer(out, width, height, channels, level);
+        const size_t row = width * static_cast<size_t>(channels);
+        for (size_t y = 0; y < height; ++y) {
+            writer.write_row(pixels.data() + y * row);
+        }
+        writer.finish();
+        return out.str();
+    }
+}
+
+TEST_CASE("zlib checksums") {
+    const auto digits = bytes_of("123456789");
+    CHECK(io::crc32(digits.data(), digits.size()) == 0xCBF43926u);
+
+    const auto word = bytes_of("Wikipedia");
+    CHECK(io::adler32(word.data(), word.size()) == 0x11E60398u);
+
+    // Checksumming in pieces matches one pass
+    CHECK(io::crc32(digits.data() + 4, 5, io::crc32(digits.data(), 4)) == 0xCBF43926u);
+    CHECK(io::adler32(word.data() + 2, 7, io::adler32(word.data(), 2)) == 0x11E60398u);
+}
+
+TEST_CASE("zlib checksum combination") {
+    const auto text = bytes_of("The quick brown fox jumps over the lazy dog, twice over.");
+    for (size_t split : {size_t{0}, size_t{1}, size_t{17}, text.size()}) {
+        CAPTURE(split);
+        const size_t rest = text.size() - split;
+        CHECK(io::crc32_combine(io::crc32(text.data(), split), io::crc32(text.data() + split, rest), rest) ==
+              io::crc32(text.data(), text.size()));
+        CHECK(io::adler32_combine(io::adler32(text.data(), split), io::adler32(text.data() + split, rest), rest) ==
+              io::adler32(text.data(), text.size()));
+    }
+}
+
+TEST_CASE("Inflate reference streams") {
+    // zlib.compress(b"hello")
+    const std::vector<std::uint8_t> hello = {0x78, 0x9c, 0xcb, 0x48, 0xcd, 0xc9, 0xc9, 0x07,
+                                             0x00, 0x06, 0x2c, 0x02, 0x15};
+    CHECK(inflate_all(hello) == bytes_of("hello"));
+
+    SUBCASE("Corrupt checksum") {
+        auto corrupt = hello;
+        corrupt.back() ^= 1;
+        CHECK_THROWS_AS(inflate_all(corrupt), io::zlib_error);
+    }
+
+    SUBCASE("Truncated stream") {
+        const std::vector<std::uint8_t> truncated(hello.begin(), hello.begin() + 6);
+        CHECK_THROWS_AS(inflate_all(truncated), io::zlib_error);
+    }
+}
+
+TEST_CASE("Deflate round trip") {
+    std::vector<std::uint8_t> data = make_pixels(97, 61, 3);
+    // An incompressible tail exercises stored blocks
+    std::uint32_t state = 12345;
+    for (int i = 0; i < 70000; ++i) {
+        state = state * 1103515245u + 12345u;
+        data.push_back(static_cast<std::uint8_t>(state >> 16));
+    }
+
+    for (int level : {0, 1, 6, 9}) {
+        CAPTURE(level);
+        io::deflater deflate(level);
+        std::vector<std::uint8_t> compressed;
+        // Uneven pieces with a sync flush in the middle
+        const size_t pieces[] = {1, 4000, 17, 30000};
+        size_t pos = 0;
+        for (size_t i = 0; pos < data.size(); i = (i + 1) % 4) {
+            const size_t n = std::min(pieces[i], data.size() - pos);
+            deflate.write(data.data() + pos, n, compressed,
+                          i == 2 ? io::deflate_flush::sync : io::deflate_flush::none);
+            pos += n;
+        }
+        deflate.write(nullptr, 0, compressed, io::deflate_flush::finish);
+
+        CHECK(deflate.checksum() == io::adler32(data.data(), data.size()));
+        CHECK(inflate_all(compressed) == data);
+        if (level > 0) {
+            CHECK(compressed.size() < data.size());
+        }
+    }
+}
+
+TEST_CASE("PNG row writer and reader round trip") {
+    constexpr size_t w = 37;
+    constexpr size_t h = 23;
+
+    for (int channels : {1, 2, 3, 4}) {
+        CAPTURE(channels);
+        const auto pixels = make_pixels(w, h, static_cast<size_t>(channels));
+        std::istringstream in(encode_png(pixels, w, h, channels, 6));
+
+        io::png_row_reader reader(in);
+        REQUIRE(reader.width() == w);
+        REQUIRE(reader.height() == h);
+        CHECK(reader.channels() == (channels % 2 == 0 ? 4 : 3));
+
+        std::vector<std::uint8_t> row(w * 4);
+        for (size_t y = 0; y < h; ++y) {
+            REQUIRE(reader.read_row(row.data(), 4));
+            for (size_t x = 0; x < w; ++x) {
+                const std::uint8_t* expected = pixels.data() + (y * w + x) * static_cast<size_t>(channels);
+                const std::uint8_t* actual = row.data() + x * 4;
+                if (channels <= 2) {
+                    CHECK(actual[0] == expected[0]);
+                    CHECK(actual[2] == expected[0]);
+                } else {
+                    CHECK(actual[0] == expected[0]);
+                    CHECK(actual[1] == expected[1]);
+                    CHECK(actual[2] == expected[2]);
+                }
+                CHECK(actual[3] == (channels % 2 == 0 ? expected[channels - 1] : 255));
+            }
+        }
+        CHECK_FALSE(reader.read_row(row.data(), 4));
+    }
+}
+
+TEST_CASE("Parallel PNG writer") {
+    constexpr size_t w = 53;
+    constexpr size_t h = 71;
+
+    for (int channels : {1, 3, 4}) {
+        for (int level : {0, 1, 6}) {
+            CAPTURE(channels);
+            CAPTURE(level);
+            const auto pixels = make_pixels(w, h, static_cast<size_t>(channels));
+            const size_t row_bytes = w * static_cast<size_t>(channels);
+
+            // Tiny blocks: many deflate stream joins, some inside one IDAT chunk
+            std::ostringstream out;
+            io::parallel_png_writer writer(out, w, h, channels, level, 3, 300);
+            CHECK(writer.threads() == 3);
+            for (size_t y = 0; y < h; ++y) {
+                writer.write_row(pixels.data() + y * row_bytes);
+            }
+            writer.finish();
+
+            std::istringstream in(out.str());
+            io::png_row_reader reader(in);
+            std::vector<std::uint8_t> row(w * 4);
+            size_t mismatches = 0;
+            for (size_t y = 0; y < h; ++y) {
+                REQUIRE(reader.read_row(row.data(), 4));
+                for (size_t x = 0; x < w; ++x) {
+                    const std::uint8_t* expected = pixels.data() + y * row_bytes + x * static_cast<size_t>(channels);
+                    mismatches += row[x * 4] != expected[0];
+                    mismatches += row[x * 4 + 2] != expected[channels >= 3 ? 2 : 0];
+                    mismatches += row[x * 4 + 3] != (channels == 4 ? expected[3] : 255);
+                }
+            }
+            CHECK(mismatches == 0);
+        }
+    }
+
+    SUBCASE("Size stays close to the serial encoder") {
+        // Priming each block with its predecessor keeps most matches
+        constexpr size_t big_w = 200;
+        constexpr size_t big_h = 200;
+        auto pixels = make_pixels(big_w, big_h, 3);
+        std::uint32_t state = 99;
+        for (auto& value : pixels) {
+            state = state * 1103515245u + 12345u;
+            value = static_cast<std::uint8_t>(value + ((state >> 16) & 7u));
+        }
+        std::ostringstream out;
+        io::parallel_png_writer writer(out, big_w, big_h, 3, 6, 4, 16384);
+        for (size_t y = 0; y < big_h; ++y) {
+            writer.write_row(pixels.data() + y * big_w * 3);
+        }
+        writer.finish();
+
+        const auto serial = encode_png(pixels, big_w, big_h, 3, 6);
+        CHECK(out.str().size() < serial.size() + serial.size() / 10);
+    }
+
+    SUBCASE("Incomplete image") {
+        std::ostringstream out;
+        io::parallel_png_writer writer(out, 4, 4, 3, 6, 2);
+        const std::vector<std::uint8_t> row(12, 0);
+        writer.write_row(row.data());
+        CHECK_THROWS_AS(writer.finish(), io::png_error);
+    }
+}
+
+TEST_CASE("PNG reader handles palettes, low bit depths and split IDAT") {
+    // 5x3 image, 2-bit palette indices, tRNS, data spread over 1-byte IDAT chunks
+    constexpr size_t w = 5;
+    constexpr size_t h = 3;
+    const std::uint8_t palette[] = {255, 0, 0, 0, 255, 0, 0, 0, 255, 9, 9, 9};
+    const std::uint8_t alpha[] = {255, 128};
+
+    std::vector<std::uint8_t> raw;
+    for (size_t y = 0; y < h; ++y) {
+        std::uint8_t packed[2] = {};
+        for (size_t x = 0; x < w; ++x) {
+            const auto index = static_cast<std::uint8_t>((x + y) % 4);
+            packed[x / 4] = static_cast<std::uint8_t>(packed[x / 4] | index << (6 - 2 * (x % 4)));
+        }
+        raw.push_back(0);
+        raw.insert(raw.end(), packed, packed + 2);
+    }
+    io::deflater deflate(9);
+    std::vector<std::uint8_t> compressed;
+    deflate.write(raw.data(), raw.size(), compressed, io::deflate_flush::finish);
+
+    std::ostringstream out;
+    out.write(reinterpret_cast<const char*>(io::detail::png_signature), 8);
+    std::uint8_t ihdr[13] = {};
+    io::detail::write_be32(ihdr, w);
+    io::detail::write_be32(ihdr + 4, h);
+    ihdr[8] = 2;
+    ihdr[9] = 3;
+    io::detail::write_png_chunk(out, "IHDR", ihdr, sizeof(ihdr));
+    io::detail::write_png_chunk(out, "PLTE", palette, sizeof(palette));
+    io::detail::write_png_chunk(out, "tRNS", alpha, sizeof(alpha));
+    for (std::uint8_t byte : compressed) {
+        io::detail::write_png_chunk(out, "IDAT", &byte, 1);
+    }
+    io::detail::write_png_chunk(out, "IEND", nullptr, 0);
+
+    std::istringstream in(out.str());
+    io::png_row_reader reader(in);
+    CHECK(reader.color_type() == io::png_color_type::palette);
+    CHECK(reader.channels() == 4);
+
+    std::vector<std::uint8_t> row(w * 4);
+    for (size_t y = 0; y < h; ++y) {
+        REQUIRE(reader.read_row(row.data(), 4));
+        for (size_t x = 0; x < w; ++x) {
+            const size_t index = (x + y) % 4;
+            CHECK(row[x * 4] == palette[index * 3]);
+            CHECK(row[x * 4 + 1] == palette[index * 3 + 1]);
+            CHECK(row[x * 4 + 2] == palette[index * 3 + 2]);
+            CHECK(row[x * 4 + 3] == (index < 2 ? alpha[index] : 255));
+        }
+    }
+}
+
+TEST_CASE("PNG reader rejects what it cannot stream") {
+    auto png = encode_png(make_pixels(4, 4, 3), 4, 4, 3, 6);
+
+    SUBCASE("Interlaced") {
+        // Set the interlace byte and fix the IHDR CRC
+        png[8 + 8 + 12] = 1;
+        const auto* ihdr = reinterpret_cast<const std::uint8_t*>(png.data() + 12);
+        std::uint8_t crc[4];
+        io::detail::write_be32(crc, io::crc32(ihdr, 17));
+        png.replace(8 + 8 + 13, 4, reinterpret_cast<const char*>(crc), 4);
+
+        std::istringstream in(png);
+        CHECK_THROWS_AS(io::png_row_reader{in}, io::png_error);
+    }
+
+    SUBCASE("Corrupt chunk") {
+        png[8 + 8 + 2] ^= 0x40;
+        std::istringstream in(png);
+        CHECK_THROWS_AS(io::png_row_reader{in}, io::png_error);
+    }
+
+    SUBCASE("Not a PNG") {
+        std::istringstream in("GIF89a...");
+        CHECK_THROWS_AS(io::png_row_reader{in}, io::png_error);
+    }
+
+    SUBCASE("Truncated chunk claiming a huge length") {
+        // Signature and IHDR, then a chunk that claims 2 GiB but ends after a few bytes
+        for (const char* type : {"tEXt", "PLTE", "tRNS"}) {
+            CAPTURE(type);
+            std::string truncated = png.substr(0, 8 + 25);
+            std::uint8_t header[8];
+            io::detail::write_be32(header, 0x7FFFFFFFu);
+            std::copy_n(type, 4, header + 4);
+            truncated.append(reinterpret_cast<const char*>(header), 8);
+            truncated.append("abc");
+            std::istringstream in(truncated);
+            CHECK_THROWS_AS(io::png_row_reader{in}, io::png_error);
+        }
+    }
+}
+
+TEST_CASE("Streaming scale matches whole-image scale") {
+    using pixel = vec3<std::uint8_t>;
+    using input_image = test::TestInputImage<pixel>;
+    using output_image = test::TestOutputImage<pixel>;
+
+    constexpr size_t w = 21;
+    constexpr size_t h = 33;
+    const auto pixels = make_pixels(w, h, 3);
+    input_image image(w, h);
+    for (size_t y = 0; y < h; ++y) {
+        for (size_t x = 0; x < w; ++x) {
+            const std::uint8_t* p = pixels.data() + (y * w + x) * 3;
+            image.at(x, y) = pixel(p[0], p[1], p[2]);
+        }
+    }
+
+    for (auto algo : algorithm_capabilities::get_all_algorithms()) {
+        for (int factor = 2; factor <= 4; ++factor) {
+            if (!scaler_capabilities::is_scale_supported(algo, static_cast<float>(factor))) {
+                continue;
+            }
+            CAPTURE(algorithm_capabilities::get_algorithm_name(algo));
+            CAPTURE(factor);
+
+            const auto expected = unified_scaler<input_image, output_image>::scale(
+                image, algo, static_cast<float>(factor));
+
+            // Small bands put band edges on every kind of row
+            std::istringstream in(encode_png(pixels, w, h, 3, 1));
+            io::png_row_reader reader(in);
+            const size_t out_w = w * static_cast<size_t>(factor);
+            size_t y = 0;
+            size_t mismatches = 0;
+            io::scale_rows(reader, algo, factor, [&](const std::uint8_t* row) {
+                for (size_t x = 0; x < out_w; ++x) {
+                    const pixel& p = expected.at(x, y);
+                    if (row[x * 3] != p.x || row[x * 3 + 1] != p.y || row[x * 3 + 2] != p.z) {
+                        ++mismatches;
+                    }
+                }
+                ++y;
+            }, 3);
+
+            CHECK(y == h * static_cast<size_t>(factor));
+            CHECK(mismatches == 0);
+        }
+    }
+
+    SUBCASE("Unsupported scale") {
+        std::istringstream in(encode_png(pixels, w, h, 3, 1));
+        io::png_row_reader reader(in);
+        CHECK_THROWS_AS(io::scale_rows(reader, algorithm::EPX, 3, [](const std::uint8_t*) {}),
+                        std::invalid_argument);
+    }
+}
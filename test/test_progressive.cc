@@ -0,0 +1,140 @@
+#include <doctest/doctest.h>
+#include <scaler/progressive.hh>
+#include <scaler/image.hh>
+#include <scaler/unified_scaler.hh>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "test_common.hh"
+
+using namespace scaler;
+
+namespace {
+    using pixel = vec3<std::uint8_t>;
+    using input_image = test::TestInputImage<pixel>;
+    using output_image = test::TestOutputImage<pixel>;
+    using image_scaler = unified_scaler<input_image, output_image>;
+
+    // Collects delivered tiles, as a view would post them to its UI thread
+    struct canvas {
+        std::mutex mutex;
+        std::vector<progressive_tile<pixel>> tiles;
+
+        void post(const progressive_tile<pixel>& tile) {
+            std::lock_guard<std::mutex> lock(mutex);
+            tiles.push_back(tile);
+        }
+
+        // The preview with every tile painted over it
+        image<pixel> compose(image<pixel> preview) const {
+            for (const auto& tile : tiles) {
+                for (size_t y = 0; y < tile.rect.height; ++y) {
+                    for (size_t x = 0; x < tile.rect.width; ++x) {
+                        preview.set_pixel(tile.rect.x + x, tile.rect.y + y, tile.pixels.get_pixel(x, y));
+                    }
+                }
+            }
+            return preview;
+        }
+    };
+}
+
+TEST_CASE("Progressive scaling") {
+    const input_image sprite = test::create_sprite<pixel>(29, 21);
+
+    SUBCASE("Refined tiles add up to scale() for every algorithm and integral scale") {
+        progressive_scaler<pixel> refiner({3, 8, algorithm::Nearest});
+        for (algorithm algo : scaler_capabilities::get_all_algorithms()) {
+            for (int factor : {2, 3, 4}) {
+                if (!scaler_capabilities::is_scale_supported(algo, static_cast<float>(factor))) {
+                    continue;
+                }
+                const auto f = static_cast<size_t>(factor);
+                canvas view;
+                const auto preview = refiner.start(sprite, algo, f, {0, 0, 40, 40},
+                                                   [&view](const progressive_tile<pixel>& tile) { view.post(tile); });
+                refiner.wait();
+                INFO(scaler_capabilities::get_algorithm_name(algo), " ", factor, "x");
+                const auto expected = image_scaler::scale(sprite, algo, static_cast<float>(factor));
+                CHECK(test::count_mismatches(view.compose(preview), expected) == 0);
+                CHECK(view.tiles.size() == (algo == algorithm::Nearest ? 0u : 12u));
+            }
+        }
+    }
+
+    SUBCASE("The preview is the cheap algorithm") {
+        progressive_scaler<pixel> refiner({1, 8, algorithm::Bilinear});
+        const auto preview = refiner.start(sprite, algorithm::xBR, 2, {}, [](const progressive_tile<pixel>&) {});
+        CHECK(test::count_mismatches(preview, image_scaler::scale(sprite, algorithm::Bilinear, 2.0f)) == 0);
+        refiner.wait();
+    }
+
+    SUBCASE("Visible tiles come first") {
+        // One worker, so delivery follows the queue order exactly
+        progressive_scaler<pixel> refiner({1, 4, algorithm::Nearest});
+        canvas view;
+        const progressive_rect viewport{60, 48, 16, 16};
+        refiner.start(sprite, algorithm::HQ, 4, viewport,
+                      [&view](const progressive_tile<pixel>& tile) { view.post(tile); });
+        refiner.wait();
+        REQUIRE(view.tiles.size() == 48);
+        // The viewport touches the tiles at output (48..63 | 64..79) x (48..63)
+        CHECK(view.tiles[0].rect.intersects(viewport));
+        CHECK(view.tiles[1].rect.intersects(viewport));
+        CHECK_FALSE(view.tiles[2].rect.intersects(viewport));
+    }
+
+    SUBCASE("Restarting cancels the previous generation") {
+        progressive_scaler<pixel> refiner({2, 2, algorithm::Nearest});
+        // Latest generation whose start() has returned; older tiles must not arrive after that
+        std::atomic<std::uint64_t> settled{0};
+        std::atomic<size_t> stale{0};
+        std::atomic<size_t> delivered{0};
+        std::atomic<std::uint64_t> counted{0};
+
+        auto on_tile = [&](const progressive_tile<pixel>& tile) {
+            if (tile.generation < settled.load()) {
+                ++stale;
+            }
+            if (tile.generation == counted.load()) {
+                ++delivered;
+            }
+        };
+        refiner.start(sprite, algorithm::xBR, 4, {}, on_tile);
+        settled = refiner.generation();
+        refiner.start(sprite, algorithm::HQ, 3, {}, on_tile);
+        settled = refiner.generation();
+        counted = settled + 1;
+        refiner.start(sprite, algorithm::EPX, 2, {}, on_tile);
+        settled = refiner.generation();
+        refiner.wait();
+        CHECK(counted == settled);
+        CHECK(delivered == 15 * 11);
+        CHECK(refiner.pending_tiles() == 0);
+
+        refiner.start(sprite, algorithm::xBR, 4, {}, on_tile);
+        refiner.cancel();
+        settled = refiner.generation();
+        const size_t after_cancel = delivered;
+        refiner.wait();
+        CHECK(delivered == after_cancel);
+        CHECK(stale == 0);
+    }
+
+    SUBCASE("Failures reach wait()") {
+        progressive_scaler<pixel> refiner({2, 16, algorithm::Nearest});
+        refiner.start(sprite, algorithm::EPX, 2, {}, [](const progressive_tile<pixel>&) {
+            throw std::runtime_error("view closed");
+        });
+        CHECK_THROWS_AS(refiner.wait(), std::runtime_error);
+    }
+
+    SUBCASE("Unsupported scales are rejected") {
+        progressive_scaler<pixel> refiner({1, 16, algorithm::Nearest});
+        CHECK_THROWS_AS(refiner.start(sprite, algorithm::EPX, 3, {}, [](const progressive_tile<pixel>&) {}),
+                        unsupported_scale_exception);
+    }
+}
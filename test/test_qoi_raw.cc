@@ -0,0 +1,258 @@
+#include <doctest/doctest.h>
+#include <scaler/io/packed_image.hh>
+#include <scaler/io/qoi.hh>
+#include <scaler/io/raw_image.hh>
+#include <scaler/io/streaming_scaler.hh>
+#include <scaler/unified_scaler.hh>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace scaler;
+
+namespace {
+    // Flat areas, gradients, noise and alpha changes exercise every QOI op
+    std::vector<std::uint8_t> make_pixels(size_t width, size_t height, size_t channels) {
+        std::vector<std::uint8_t> pixels(width * height * channels);
+        std::uint32_t state = 7;
+        for (size_t y = 0; y < height; ++y) {
+            for (size_t x = 0; x < width; ++x) {
+                state = state * 1103515245u + 12345u;
+                std::uint8_t* p = &pixels[(y * width + x) * channels];
+                const size_t region = (x * 4 / width) + 4 * (y * 2 / height);
+                for (size_t c = 0; c < channels; ++c) {
+                    switch (region % 4) {
+                        case 0: p[c] = static_cast<std::uint8_t>(((x / 5) ^ (y / 3)) % 3 * 90); break;
+                        case 1: p[c] = static_cast<std::uint8_t>(x + y * 2 + c); break;
+                        case 2: p[c] = static_cast<std::uint8_t>((state >> (8 + c * 5)) & 0xff); break;
+                        default: p[c] = static_cast<std::uint8_t>(x * 7 + (state >> 29) + c * 40); break;
+                    }
+                }
+                if (channels == 4 && region >= 4) {
+                    p[3] = static_cast<std::uint8_t>(x % 3 == 0 ? 255 : x * 11);
+                }
+            }
+        }
+        return pixels;
+    }
+
+    std::string encode_qoi(const std::vector<std::uint8_t>& pixels, size_t width, size_t height, int channels) {
+        std::ostringstream out;
+        io::qoi_row_writer writer(out, width, height, channels);
+        const size_t row = width * static_cast<size_t>(channels);
+        for (size_t y = 0; y < height; ++y) {
+            writer.write_row(pixels.data() + y * row);
+        }
+        writer.finish();
+        return out.str();
+    }
+
+    template<typename Reader>
+    std::vector<std::uint8_t> decode_all(Reader& reader, int channels) {
+        const size_t row = reader.width() * static_cast<size_t>(channels);
+        std::vector<std::uint8_t> pixels(row * reader.height());
+        for (size_t y = 0; y < reader.height(); ++y) {
+            REQUIRE(reader.read_row(pixels.data() + y * row, channels));
+        }
+        CHECK_FALSE(reader.read_row(pixels.data(), channels));
+        return pixels;
+    }
+}
+
+TEST_CASE("QOI decodes a hand-made stream") {
+    // 6x1 RGB: literal, diff, luma, run of 2, index
+    const std::vector<std::uint8_t> file = {
+        'q', 'o', 'i', 'f', 0, 0, 0, 6, 0, 0, 0, 1, 3, 0,
+        0xfe, 100, 150, 200,   // RGB (100, 150, 200)
+        0x40 | 3 << 4 | 1 << 2 | 2,  // DIFF +1 -1 0
+        0x80 | 40, 0x9 << 4 | 0x6,   // LUMA dg +8, dr-dg +1, db-dg -2
+        0xc0 | 1,              // RUN 2
+        static_cast<std::uint8_t>((100 * 3 + 150 * 5 + 200 * 7 + 255 * 11) % 64),  // INDEX
+        0, 0, 0, 0, 0, 0, 0, 1
+    };
+    std::istringstream in(std::string(file.begin(), file.end()));
+    io::qoi_row_reader reader(in);
+    CHECK(reader.width() == 6);
+    CHECK(reader.channels() == 3);
+
+    const std::vector<std::uint8_t> expected = {
+        100, 150, 200,  101, 149, 200,  110, 157, 206,  110, 157, 206,  110, 157, 206,  100, 150, 200
+    };
+    CHECK(decode_all(reader, 3) == expected);
+}
+
+TEST_CASE("QOI round trip") {
+    for (int channels : {3, 4}) {
+        for (size_t width : {size_t{1}, size_t{7}, size_t{64}, size_t{150}}) {
+            CAPTURE(channels);
+            CAPTURE(width);
+            const size_t height = 37;
+            const auto pixels = make_pixels(width, height, static_cast<size_t>(channels));
+            const std::string file = encode_qoi(pixels, width, height, channels);
+            CHECK(file.size() < 14 + pixels.size() + pixels.size() / 3 + 8);
+
+            std::istringstream in(file);
+            io::qoi_row_reader reader(in);
+            CHECK(reader.channels() == channels);
+            CHECK(decode_all(reader, channels) == pixels);
+        }
+    }
+
+    SUBCASE("Runs longer than a row and than one op") {
+        const std::vector<std::uint8_t> pixels(200 * 5 * 3, 42);
+        const std::string file = encode_qoi(pixels, 200, 5, 3);
+        CHECK(file.size() < 60);
+        std::istringstream in(file);
+        io::qoi_row_reader reader(in);
+        CHECK(decode_all(reader, 3) == pixels);
+    }
+
+    SUBCASE("RGB rows from an RGBA file") {
+        const auto pixels = make_pixels(20, 10, 4);
+        std::istringstream in(encode_qoi(pixels, 20, 10, 4));
+        io::qoi_row_reader reader(in);
+        const auto rgb = decode_all(reader, 3);
+        for (size_t i = 0; i < 200; ++i) {
+            CHECK(rgb[i * 3 + 2] == pixels[i * 4 + 2]);
+        }
+    }
+}
+
+TEST_CASE("QOI reader rejects malformed files") {
+    const auto pixels = make_pixels(30, 30, 3);
+    const std::string file = encode_qoi(pixels, 30, 30, 3);
+    std::vector<std::uint8_t> row(30 * 3);
+
+    SUBCASE("Truncated") {
+        std::istringstream in(file.substr(0, file.size() - 20));
+        io::qoi_row_reader reader(in);
+        CHECK_THROWS_AS(while (reader.read_row(row.data())) {}, io::qoi_error);
+    }
+
+    SUBCASE("Missing end marker") {
+        std::string broken = file;
+        broken.back() = 0;
+        std::istringstream in(broken);
+        io::qoi_row_reader reader(in);
+        CHECK_THROWS_AS(while (reader.read_row(row.data())) {}, io::qoi_error);
+    }
+
+    SUBCASE("Not a QOI file") {
+        std::istringstream in("qoix0000000000000000");
+        CHECK_THROWS_AS(io::qoi_row_reader reader(in), io::qoi_error);
+    }
+
+    SUBCASE("Zero size") {
+        std::ostringstream out;
+        CHECK_THROWS_AS(io::qoi_row_writer(out, 0, 10), io::qoi_error);
+    }
+}
+
+TEST_CASE("Raw image round trip") {
+    for (int channels = 1; channels <= 4; ++channels) {
+        CAPTURE(channels);
+        const auto pixels = make_pixels(13, 9, static_cast<size_t>(channels));
+        std::ostringstream out;
+        io::raw_row_writer writer(out, 13, 9, channels);
+        for (size_t y = 0; y < 9; ++y) {
+            writer.write_row(pixels.data() + y * 13 * static_cast<size_t>(channels));
+        }
+        writer.finish();
+        CHECK(out.str().size() == 16 + pixels.size());
+
+        std::istringstream in(out.str());
+        io::raw_row_reader reader(in);
+        CHECK(reader.stored_channels() == channels);
+        const int decoded = reader.channels();
+        CHECK(decoded == (channels % 2 == 0 ? 4 : 3));
+        const auto result = decode_all(reader, decoded);
+        for (size_t i = 0; i < 13 * 9; ++i) {
+            const std::uint8_t* s = &pixels[i * static_cast<size_t>(channels)];
+            const std::uint8_t* d = &result[i * static_cast<size_t>(decoded)];
+            CHECK(d[0] == s[0]);
+            CHECK(d[2] == (channels >= 3 ? s[2] : s[0]));
+            if (decoded == 4) {
+                CHECK(d[3] == s[channels - 1]);
+            }
+        }
+    }
+
+    SUBCASE("Truncated") {
+        std::ostringstream out;
+        io::raw_row_writer writer(out, 4, 4, 3);
+        const std::vector<std::uint8_t> row(12, 1);
+        for (int y = 0; y < 4; ++y) {
+            writer.write_row(row.data());
+        }
+        std::istringstream in(out.str().substr(0, out.str().size() - 1));
+        io::raw_row_reader reader(in);
+        std::vector<std::uint8_t> buffer(12);
+        CHECK_THROWS_AS(while (reader.read_row(buffer.data())) {}, io::raw_image_error);
+    }
+}
+
+TEST_CASE("Packed image adapter") {
+    const auto pixels = make_pixels(16, 12, 4);
+    std::istringstream in(encode_qoi(pixels, 16, 12, 4));
+    io::qoi_row_reader reader(in);
+    const io::packed_image image = io::read_image(reader);
+    CHECK(image.channels() == 4);
+    CHECK(std::vector<std::uint8_t>(image.data(), image.data() + pixels.size()) == pixels);
+
+    // Scaling keeps color exactly with Nearest; the copy to QOI round trips
+    const auto scaled = unified_scaler<io::packed_image, io::packed_image>::scale(image, algorithm::Nearest, 2.0f);
+    CHECK(scaled.width() == 32);
+    CHECK(scaled.get_pixel(5, 7) == image.get_pixel(2, 3));
+
+    std::ostringstream out;
+    io::qoi_row_writer writer(out, scaled.width(), scaled.height(), scaled.channels());
+    io::write_image(writer, scaled);
+    std::istringstream again(out.str());
+    io::qoi_row_reader reader2(again);
+    const io::packed_image reloaded = io::read_image(reader2);
+    CHECK(reloaded.get_pixel(31, 23) == scaled.get_pixel(31, 23));
+}
+
+TEST_CASE("Streaming from QOI and raw matches PNG") {
+    constexpr size_t w = 40;
+    constexpr size_t h = 25;
+    const auto pixels = make_pixels(w, h, 3);
+
+    std::ostringstream png_out;
+    std::ostringstream raw_out;
+    {
+        io::png_row_writer png(png_out, w, h, 3, 1);
+        io::raw_row_writer raw(raw_out, w, h, 3);
+        for (size_t y = 0; y < h; ++y) {
+            png.write_row(pixels.data() + y * w * 3);
+            raw.write_row(pixels.data() + y * w * 3);
+        }
+        png.finish();
+        raw.finish();
+    }
+
+    const auto scale_all = [](auto& reader) {
+        std::vector<std::uint8_t> result;
+        io::scale_rows(reader, algorithm::HQ, 3, [&result](const std::uint8_t* row) {
+            result.insert(result.end(), row, row + w * 3 * 3);
+        }, 4);
+        return result;
+    };
+
+    std::istringstream png_in(png_out.str());
+    io::png_row_reader png_reader(png_in);
+    const auto expected = scale_all(png_reader);
+
+    std::istringstream qoi_in(encode_qoi(pixels, w, h, 3));
+    io::qoi_row_reader qoi_reader(qoi_in);
+    CHECK(scale_all(qoi_reader) == expected);
+
+    std::istringstream raw_in(raw_out.str());
+    io::raw_row_reader raw_reader(raw_in);
+    CHECK(scale_all(raw_reader) == expected);
+
+    CHECK(io::image_file_format_of("a/b.QOI") == io::image_file_format::qoi);
+    CHECK(io::image_file_format_of("x.raw") == io::image_file_format::raw);
+    CHECK(io::image_file_format_of("x.jpg") == io::image_file_format::unknown);
+}
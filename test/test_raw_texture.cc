@@ -0,0 +1,133 @@
+#include <doctest/doctest.h>
+#include <scaler/gpu/opengl_texture_scaler.hh>
+#include <scaler/gpu/raw_texture.hh>
+#include <cstdint>
+#include <vector>
+
+#include "gpu_test_context.hh"
+
+using namespace scaler;
+
+namespace {
+    GLuint upload_rgba(const std::vector<std::uint8_t>& rgba, int width, int height) {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+
+    std::vector<std::uint8_t> read_pixels(GLuint texture, int width, int height) {
+        std::vector<std::uint8_t> pixels(static_cast<size_t>(width * height * 4));
+        GLuint fbo;
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &fbo);
+        return pixels;
+    }
+
+    // Scales both textures with the same algorithm and compares the results
+    void check_same_result(gpu::opengl_texture_scaler& scaler, const gpu::raw_texture& raw,
+                           GLuint reference, algorithm algo, int factor) {
+        const int out_w = raw.width() * factor;
+        const int out_h = raw.height() * factor;
+        GLuint expected_tex = gpu::opengl_texture_scaler::create_output_texture(out_w, out_h);
+        GLuint actual_tex = gpu::opengl_texture_scaler::create_output_texture(out_w, out_h);
+
+        scaler.scale_texture_to_texture(reference, raw.width(), raw.height(),
+                                        expected_tex, out_w, out_h, algo);
+        scaler.scale_raw_to_texture(raw, actual_tex, out_w, out_h, algo);
+
+        CHECK(read_pixels(actual_tex, out_w, out_h) == read_pixels(expected_tex, out_w, out_h));
+
+        glDeleteTextures(1, &expected_tex);
+        glDeleteTextures(1, &actual_tex);
+    }
+}
+
+TEST_CASE("Raw texture upload and GPU decode") {
+    scaler::test::gpu_context::scoped_context gpu_ctx;
+    if (!gpu_ctx) {
+        INFO("Could not create/get OpenGL context - skipping GPU tests");
+        return;
+    }
+
+    constexpr int w = 12;
+    constexpr int h = 10;
+    gpu::opengl_texture_scaler scaler;
+
+    SUBCASE("Indexed pixels are expanded through the palette") {
+        // Four colors, one unused index past the palette end
+        const std::uint8_t palette[] = {
+            10, 20, 30, 255,
+            250, 240, 0, 255,
+            0, 128, 255, 255,
+            90, 90, 90, 255
+        };
+
+        std::vector<std::uint8_t> indices(static_cast<size_t>(w * h));
+        std::vector<std::uint8_t> rgba(static_cast<size_t>(w * h * 4));
+        for (int y = 0; y < h; ++y) {
+            for (int x = 0; x < w; ++x) {
+                const size_t i = static_cast<size_t>(y * w + x);
+                const auto index = static_cast<std::uint8_t>(x == 0 && y == 0 ? 7 : ((x / 2) + (y / 3)) % 4);
+                indices[i] = index;
+                for (size_t c = 0; c < 4; ++c) {
+                    rgba[i * 4 + c] = index < 4 ? palette[index * 4 + c] : (c == 3 ? 255 : 0);
+                }
+            }
+        }
+
+        gpu::raw_texture raw(gpu::raw_pixel_format::indexed8, w, h);
+        raw.upload_palette(palette, 4);
+        raw.upload(indices.data());
+        CHECK(raw.uploaded_bytes() == indices.size() + sizeof(palette));
+
+        GLuint reference = upload_rgba(rgba, w, h);
+        check_same_result(scaler, raw, reference, algorithm::EPX, 2);
+        check_same_result(scaler, raw, reference, algorithm::OmniScale, 3);
+        glDeleteTextures(1, &reference);
+
+        CHECK_THROWS_AS(gpu::raw_texture(gpu::raw_pixel_format::rgb565, w, h).upload_palette(palette, 4),
+                        gpu::unsupported_operation_error);
+    }
+
+    SUBCASE("RGB565 pixels honour the pitch and widen like UNORM") {
+        constexpr size_t pitch_pixels = w + 4;
+        std::vector<std::uint16_t> packed(pitch_pixels * h, 0xFFFF);
+        std::vector<std::uint8_t> rgba(static_cast<size_t>(w * h * 4));
+        for (int y = 0; y < h; ++y) {
+            for (int x = 0; x < w; ++x) {
+                const unsigned r = static_cast<unsigned>(x * 3) & 31u;
+                const unsigned g = static_cast<unsigned>(x * 5 + y * 7) & 63u;
+                const unsigned b = static_cast<unsigned>(y * 3) & 31u;
+                packed[static_cast<size_t>(y) * pitch_pixels + static_cast<size_t>(x)] =
+                    static_cast<std::uint16_t>(r << 11 | g << 5 | b);
+
+                const size_t i = static_cast<size_t>(y * w + x) * 4;
+                rgba[i] = static_cast<std::uint8_t>((r * 255 + 15) / 31);
+                rgba[i + 1] = static_cast<std::uint8_t>((g * 255 + 31) / 63);
+                rgba[i + 2] = static_cast<std::uint8_t>((b * 255 + 15) / 31);
+                rgba[i + 3] = 255;
+            }
+        }
+
+        gpu::raw_texture raw(gpu::raw_pixel_format::rgb565, w, h);
+        raw.upload(packed.data(), pitch_pixels * sizeof(std::uint16_t));
+        CHECK(raw.uploaded_bytes() == static_cast<size_t>(w * h) * 2);
+
+        GLuint reference = upload_rgba(rgba, w, h);
+        check_same_result(scaler, raw, reference, algorithm::Scale, 2);
+        check_same_result(scaler, raw, reference, algorithm::Nearest, 2);
+        glDeleteTextures(1, &reference);
+
+        CHECK_THROWS_AS(raw.upload(packed.data(), 3), std::invalid_argument);
+    }
+}
@@ -0,0 +1,201 @@
+#include <doctest/doctest.h>
+#include <scaler/gpu/gl_async_readback.hh>
+#include <scaler/gpu/opengl_texture_scaler.hh>
+#include <scaler/gpu/pack_format.hh>
+#include <scaler/gpu/raw_texture.hh>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "gpu_test_context.hh"
+
+using namespace scaler;
+
+namespace {
+    GLuint upload_rgba(const std::vector<std::uint8_t>& rgba, int width, int height) {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+
+    std::vector<std::uint8_t> make_palette() {
+        std::vector<std::uint8_t> palette;
+        for (int i = 0; i < 16; ++i) {
+            const int rgba[] = {i * 17, 255 - i * 13, (i * 97) % 256, 255};
+            for (const int channel : rgba) {
+                palette.push_back(static_cast<std::uint8_t>(channel));
+            }
+        }
+        return palette;
+    }
+
+    // CPU conversions of an RGBA8 readback, as the pack passes define them
+    struct reference {
+        std::vector<std::uint8_t> rgba;  // rows in readback order
+        int width;
+        int height;
+
+        [[nodiscard]] const std::uint8_t* pixel(int x, int y, bool flip) const {
+            x = std::min(x, width - 1);
+            y = std::min(y, height - 1);
+            const int row = flip ? height - 1 - y : y;
+            return rgba.data() + (static_cast<size_t>(row) * static_cast<size_t>(width) + static_cast<size_t>(x)) * 4;
+        }
+
+        [[nodiscard]] std::vector<std::uint8_t> bgra(bool flip) const {
+            std::vector<std::uint8_t> out;
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    const auto* p = pixel(x, y, flip);
+                    out.insert(out.end(), {p[2], p[1], p[0], p[3]});
+                }
+            }
+            return out;
+        }
+
+        [[nodiscard]] std::vector<std::uint8_t> rgb565() const {
+            std::vector<std::uint8_t> out;
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    const auto* p = pixel(x, y, false);
+                    const auto value = static_cast<std::uint16_t>(((p[0] * 31 + 127) / 255) << 11 |
+                                                                  ((p[1] * 63 + 127) / 255) << 5 |
+                                                                  (p[2] * 31 + 127) / 255);
+                    std::uint8_t bytes[2];
+                    std::memcpy(bytes, &value, 2);
+                    out.insert(out.end(), bytes, bytes + 2);
+                }
+            }
+            return out;
+        }
+
+        [[nodiscard]] std::vector<std::uint8_t> indexed(const std::vector<std::uint8_t>& palette) const {
+            std::vector<std::uint8_t> out;
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    const auto* p = pixel(x, y, false);
+                    size_t best = 0;
+                    int best_distance = 1 << 30;
+                    for (size_t i = 0; i < palette.size() / 4; ++i) {
+                        const int dr = palette[i * 4] - p[0];
+                        const int dg = palette[i * 4 + 1] - p[1];
+                        const int db = palette[i * 4 + 2] - p[2];
+                        const int distance = dr * dr + dg * dg + db * db;
+                        if (distance < best_distance) {
+                            best = i;
+                            best_distance = distance;
+                        }
+                    }
+                    out.push_back(static_cast<std::uint8_t>(best));
+                }
+            }
+            return out;
+        }
+
+        [[nodiscard]] std::vector<std::uint8_t> yuv420(bool flip) const {
+            std::vector<std::uint8_t> out;
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    const auto* p = pixel(x, y, flip);
+                    out.push_back(static_cast<std::uint8_t>(((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) >> 8) + 16));
+                }
+            }
+            for (int plane = 1; plane <= 2; ++plane) {
+                for (int y = 0; y < (height + 1) / 2; ++y) {
+                    for (int x = 0; x < (width + 1) / 2; ++x) {
+                        int c[3] = {2, 2, 2};
+                        for (int i = 0; i < 4; ++i) {
+                            const auto* p = pixel(x * 2 + i % 2, y * 2 + i / 2, flip);
+                            for (int k = 0; k < 3; ++k) {
+                                c[k] += p[k];
+                            }
+                        }
+                        const int r = c[0] / 4;
+                        const int g = c[1] / 4;
+                        const int b = c[2] / 4;
+                        const int value = plane == 1 ? ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128
+                                                     : ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+                        out.push_back(static_cast<std::uint8_t>(value));
+                    }
+                }
+            }
+            return out;
+        }
+    };
+}
+
+TEST_CASE("GPU pack pass before readback") {
+    scaler::test::gpu_context::scoped_context gpu_ctx;
+    if (!gpu_ctx) {
+        INFO("Could not create/get OpenGL context - skipping GPU tests");
+        return;
+    }
+
+    // Odd sizes, so the chroma planes have a partial last row and column
+    constexpr int w = 7;
+    constexpr int h = 5;
+    constexpr int out_w = w * 3;
+    constexpr int out_h = h * 3;
+    std::vector<std::uint8_t> pixels;
+    for (int i = 0; i < w * h; ++i) {
+        pixels.insert(pixels.end(), {static_cast<std::uint8_t>(i * 37), static_cast<std::uint8_t>(i * 11 + 40),
+                                     static_cast<std::uint8_t>(255 - i * 5), 255});
+    }
+    GLuint input = upload_rgba(pixels, w, h);
+    GLuint output = gpu::opengl_texture_scaler::create_output_texture(out_w, out_h);
+
+    gpu::opengl_texture_scaler scaler;
+    scaler.scale_texture_to_texture(input, w, h, output, out_w, out_h, algorithm::Bilinear);
+
+    gpu::gl_async_readback readback(2);
+    reference expected{{}, out_w, out_h};
+    readback.read(readback.submit(output, out_w, out_h), expected.rgba);
+
+    auto read_packed = [&](gpu::pack_format format, bool flip, GLuint palette = 0, GLint palette_size = 256) {
+        const auto layout = gpu::make_pack_layout(format, out_w, out_h, flip);
+        std::vector<std::uint8_t> result;
+        readback.read(readback.submit(scaler.pack_texture(output, layout, palette, palette_size), layout), result);
+        CHECK(result.size() == layout.bytes());
+        return result;
+    };
+
+    SUBCASE("Packed formats match a CPU conversion of the RGBA8 readback") {
+        CHECK(read_packed(gpu::pack_format::rgba8, false) == expected.rgba);
+        CHECK(read_packed(gpu::pack_format::bgra8, false) == expected.bgra(false));
+        CHECK(read_packed(gpu::pack_format::bgra8, true) == expected.bgra(true));
+        CHECK(read_packed(gpu::pack_format::rgb565, false) == expected.rgb565());
+        CHECK(read_packed(gpu::pack_format::yuv420, false) == expected.yuv420(false));
+        CHECK(read_packed(gpu::pack_format::yuv420, true) == expected.yuv420(true));
+
+        const auto palette = make_palette();
+        gpu::raw_texture indexed(gpu::raw_pixel_format::indexed8, 1, 1);
+        indexed.upload_palette(palette.data(), palette.size() / 4);
+        CHECK(read_packed(gpu::pack_format::indexed8, false, indexed.palette_id(), 16) == expected.indexed(palette));
+    }
+
+    SUBCASE("Layouts shrink the transfer") {
+        const size_t rgba = static_cast<size_t>(out_w * out_h * 4);
+        CHECK(gpu::make_pack_layout(gpu::pack_format::rgb565, out_w, out_h).bytes() == rgba / 2);
+        CHECK(gpu::make_pack_layout(gpu::pack_format::indexed8, out_w, out_h).bytes() == rgba / 4);
+        const auto yuv = gpu::make_pack_layout(gpu::pack_format::yuv420, out_w, out_h);
+        CHECK(yuv.bytes() == static_cast<size_t>(out_w * out_h + 2 * 11 * 8));
+        CHECK_FALSE(gpu::make_pack_layout(gpu::pack_format::bgra8, out_w, out_h).needs_pass());
+        CHECK(gpu::make_pack_layout(gpu::pack_format::bgra8, out_w, out_h, true).needs_pass());
+    }
+
+    SUBCASE("Invalid requests are rejected") {
+        CHECK_THROWS_AS(gpu::make_pack_layout(gpu::pack_format::rgb565, 0, 4), std::invalid_argument);
+        const auto layout = gpu::make_pack_layout(gpu::pack_format::indexed8, out_w, out_h);
+        CHECK_THROWS_AS((void)scaler.pack_texture(output, layout), std::invalid_argument);
+    }
+
+    glDeleteTextures(1, &output);
+    glDeleteTextures(1, &input);
+}
@@ -0,0 +1,303 @@
+#include <doctest/doctest.h>
+#include <scaler/ipc/scaler_client.hh>
+#include <scaler/ipc/scaler_server.hh>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "test_common.hh"
+
+using namespace scaler;
+
+namespace {
+    using pixel = vec3<std::uint8_t>;
+    using input_image = test::TestInputImage<pixel>;
+    using output_image = test::TestOutputImage<pixel>;
+
+    std::string socket_path(const char* name) {
+        return "/tmp/scaler_test_" + std::to_string(::getpid()) + "_" + name + ".sock";
+    }
+
+    input_image make_image(size_t width, size_t height) {
+        input_image image(width, height);
+        for (size_t y = 0; y < height; ++y) {
+            for (size_t x = 0; x < width; ++x) {
+                const auto cell = static_cast<std::uint8_t>(((x / 2) ^ (y / 3)) % 3 * 100);
+                image.at(x, y) = pixel(cell, static_cast<std::uint8_t>(x * 9), static_cast<std::uint8_t>(y * 7));
+            }
+        }
+        return image;
+    }
+
+    // Runs a server on a background thread for the lifetime of the object
+    class running_server {
+        public:
+            explicit running_server(const std::string& path, ipc::server_options options = {})
+                : server_(path, options),
+                  thread_([this] { server_.run(); }) {
+            }
+
+            ~running_server() {
+                server_.stop();
+                thread_.join();
+            }
+
+            ipc::scaler_server& get() { return server_; }
+
+        private:
+            ipc::scaler_server server_;
+            std::thread thread_;
+    };
+}
+
+TEST_CASE("Scaling daemon matches local scaling") {
+    const std::string path = socket_path("match");
+    ipc::server_options options;
+    options.threads = 2;
+    running_server server(path, options);
+
+    ipc::client_options client_options;
+    client_options.slot_bytes = 1 << 20;
+    ipc::scaler_client client(path, client_options);
+
+    const input_image image = make_image(19, 14);
+    for (auto algo : {algorithm::Nearest, algorithm::EPX, algorithm::HQ, algorithm::xBR, algorithm::Bilinear}) {
+        for (float factor : {2.0f, 3.0f}) {
+            if (!scaler_capabilities::is_scale_supported(algo, factor)) {
+                continue;
+            }
+            CAPTURE(scaler_capabilities::get_algorithm_name(algo));
+            const auto expected = unified_scaler<input_image, output_image>::scale(image, algo, factor);
+            const auto remote = client.scale<output_image>(image, algo, factor);
+            REQUIRE(remote.width() == expected.width());
+            REQUIRE(remote.height() == expected.height());
+
+            size_t mismatches = 0;
+            for (size_t y = 0; y < expected.height(); ++y) {
+                for (size_t x = 0; x < expected.width(); ++x) {
+                    if (!(remote.at(x, y) == expected.at(x, y))) {
+                        ++mismatches;
+                    }
+                }
+            }
+            CHECK(mismatches == 0);
+        }
+    }
+
+    SUBCASE("Preallocated output") {
+        output_image output(19 * 2, 14 * 2);
+        client.scale(image, output, algorithm::Eagle);
+        const auto expected = unified_scaler<input_image, output_image>::scale(image, algorithm::Eagle, 2.0f);
+        CHECK(output.at(11, 17) == expected.at(11, 17));
+    }
+
+    CHECK(server.get().stats().requests >= 8);
+    CHECK(server.get().stats().failures == 0);
+}
+
+TEST_CASE("Scaling daemon zero-copy frames") {
+    const std::string path = socket_path("frames");
+    running_server server(path);
+
+    ipc::client_options client_options;
+    client_options.slot_count = 2;
+    client_options.slot_bytes = 64 * 1024;
+    client_options.priority = 5;
+    ipc::scaler_client client(path, client_options);
+
+    // Two frames in flight, waited for in reverse order
+    auto first = client.acquire(16, 16, 4);
+    auto second = client.acquire(16, 16, 3);
+    CHECK_THROWS_AS(client.acquire(4, 4), ipc::ipc_error);
+
+    for (size_t i = 0; i < 16 * 16; ++i) {
+        std::uint8_t* a = first.input().data() + i * 4;
+        a[0] = static_cast<std::uint8_t>(i);
+        a[1] = 10;
+        a[2] = 20;
+        a[3] = 7;
+        std::uint8_t* b = second.input().data() + i * 3;
+        b[0] = b[1] = b[2] = static_cast<std::uint8_t>(255 - i);
+    }
+    client.submit(first, algorithm::Nearest, 2.0f);
+    client.submit(second, algorithm::Scale, 3.0f);
+    client.wait(second);
+    client.wait(first);
+
+    const ipc::frame_image a = first.output();
+    CHECK(a.width() == 32);
+    CHECK(a.get_pixel(3, 0) == pixel(1, 10, 20));
+    CHECK(a.data()[3] == 255);  // alpha is not scaled, output is opaque
+
+    const ipc::frame_image b = second.output();
+    CHECK(b.width() == 48);
+    CHECK(b.get_pixel(0, 0) == pixel(255, 255, 255));
+
+    SUBCASE("Frame larger than a slot") {
+        ipc::scaler_client small(path, {1, 1024, 0});
+        auto frame = small.acquire(32, 32);
+        CHECK_THROWS_AS(small.submit(frame, algorithm::EPX, 2.0f), ipc::ipc_error);
+    }
+
+    SUBCASE("Unsupported scale") {
+        ipc::scaler_client other(path, {1, 4096, 0});
+        auto frame = other.acquire(8, 8);
+        CHECK_THROWS_AS(other.submit(frame, algorithm::EPX, 3.0f), unsupported_scale_exception);
+    }
+}
+
+TEST_CASE("Scaling daemon serves concurrent clients") {
+    const std::string path = socket_path("concurrent");
+    ipc::server_options options;
+    options.threads = 2;
+    options.max_batch = 4;
+    running_server server(path, options);
+
+    const input_image image = make_image(24, 18);
+    const auto expected = unified_scaler<input_image, output_image>::scale(image, algorithm::HQ, 2.0f);
+
+    std::vector<std::thread> threads;
+    std::vector<int> failures(4, 0);
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            ipc::scaler_client client(path, {2, 1 << 16, t});
+            for (int i = 0; i < 10; ++i) {
+                const auto out = client.scale<output_image>(image, algorithm::HQ, 2.0f);
+                if (!(out.at(20, 30) == expected.at(20, 30)) || !(out.at(47, 35) == expected.at(47, 35))) {
+                    ++failures[static_cast<size_t>(t)];
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    CHECK(failures == std::vector<int>(4, 0));
+    const auto stats = server.get().stats();
+    CHECK(stats.clients_accepted == 4);
+    CHECK(stats.requests == 40);
+    CHECK(stats.batches <= 40);
+}
+
+TEST_CASE("Scaling daemon slot layout rejects hostile sizes") {
+    CHECK_THROWS_AS(ipc::make_slot_layout(size_t{1} << 31, size_t{1} << 31, 4, 1.0f), ipc::ipc_error);
+    CHECK_THROWS_AS(ipc::make_slot_layout(0, 16, 3, 2.0f), ipc::ipc_error);
+    CHECK_THROWS_AS(ipc::make_slot_layout(16, 16, 3, std::nanf("")), ipc::ipc_error);
+    CHECK_THROWS_AS(ipc::make_slot_layout(16, 16, 3, -2.0f), ipc::ipc_error);
+    CHECK_THROWS_AS(ipc::make_slot_layout(16, 16, 3, 1e30f), ipc::ipc_error);
+
+    const auto layout = ipc::make_slot_layout(10, 3, 3, 2.0f);
+    CHECK(layout.input_bytes == 90);
+    CHECK(layout.output_offset == 128);
+    CHECK(layout.total() == 128 + 20 * 6 * 3);
+}
+
+TEST_CASE("Scaling daemon refuses unsealed rings and malformed requests") {
+    const std::string path = socket_path("hostile");
+    running_server server(path);
+
+    SUBCASE("Ring without size seals") {
+        const ipc::file_descriptor socket = ipc::detail::connect_unix(path);
+        const ipc::file_descriptor ring(::memfd_create("unsealed", MFD_CLOEXEC));
+        REQUIRE(ring.valid());
+        REQUIRE(::ftruncate(ring.get(), 4096) == 0);
+
+        ipc::message hello;
+        hello.type = ipc::message_type::hello;
+        hello.slot_count = 1;
+        hello.slot_bytes = 4096;
+        ipc::detail::send_message(socket.get(), hello, ring.get());
+
+        // The server drops the connection instead of answering ready
+        ipc::message reply;
+        CHECK_FALSE(ipc::detail::receive_message(socket.get(), reply));
+    }
+
+    SUBCASE("Oversized frame in a sealed ring") {
+        const ipc::file_descriptor socket = ipc::detail::connect_unix(path);
+        const auto ring = ipc::shared_memory_region::create("sealed", 4096);
+
+        ipc::message hello;
+        hello.type = ipc::message_type::hello;
+        hello.slot_count = 1;
+        hello.slot_bytes = 4096;
+        ipc::detail::send_message(socket.get(), hello, ring.fd());
+        ipc::message reply;
+        REQUIRE(ipc::detail::receive_message(socket.get(), reply));
+        REQUIRE(reply.type == ipc::message_type::ready);
+
+        ipc::message request;
+        request.type = ipc::message_type::scale;
+        request.sequence = 1;
+        request.algo = static_cast<std::uint32_t>(algorithm::Nearest);
+        request.scale = 1.0f;
+        request.width = 1u << 31;
+        request.height = 1u << 31;
+        request.channels = 4;
+        for (float factor : {1.0f, 2.0f, std::nanf("")}) {
+            request.scale = factor;
+            ipc::detail::send_message(socket.get(), request);
+            REQUIRE(ipc::detail::receive_message(socket.get(), reply));
+            CHECK(reply.type == ipc::message_type::failed);
+        }
+    }
+}
+
+TEST_CASE("Scaling daemon keeps serving while a client stops reading") {
+    const std::string path = socket_path("stalled");
+    running_server server(path);
+
+    // A client that floods requests on its single slot and never reads a reply
+    ipc::file_descriptor stalled = ipc::detail::connect_unix(path);
+    const auto ring = ipc::shared_memory_region::create("stalled", 4096);
+    ipc::message hello;
+    hello.type = ipc::message_type::hello;
+    hello.slot_count = 1;
+    hello.slot_bytes = 4096;
+    ipc::detail::send_message(stalled.get(), hello, ring.fd());
+    ipc::message reply;
+    REQUIRE(ipc::detail::receive_message(stalled.get(), reply));
+    REQUIRE(reply.type == ipc::message_type::ready);
+
+    ipc::message request;
+    request.type = ipc::message_type::scale;
+    request.algo = static_cast<std::uint32_t>(algorithm::Nearest);
+    request.scale = 2.0f;
+    request.width = 4;
+    request.height = 4;
+    request.channels = 3;
+    constexpr std::uint64_t flood = 20000;
+    std::uint64_t sent = 0;
+    for (auto stalls = 0; sent < flood && stalls < 50;) {
+        request.sequence = sent + 1;
+        if (ipc::detail::try_send_message(stalled.get(), request)) {
+            ++sent;
+        } else {
+            // Give the server time to drain what it still accepts
+            ++stalls;
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+
+    // The server stopped taking requests once its replies had nowhere to go
+    CHECK(sent < flood);
+    CHECK(server.get().stats().requests < sent + 1);
+
+    auto served = std::async(std::launch::async, [&path] {
+        ipc::scaler_client client(path, {1, 4096, 0});
+        const input_image image = make_image(8, 8);
+        return client.scale<output_image>(image, algorithm::EPX, 2.0f).width();
+    });
+    const bool ready = served.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+    CHECK(ready);
+    stalled.reset();
+    CHECK(served.get() == 16);
+}
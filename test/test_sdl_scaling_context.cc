@@ -0,0 +1,170 @@
+#include <doctest/doctest.h>
+#include <scaler/sdl/sdl_scaling_context.hh>
+#include <scaler/sdl/sdl_scalers.hh>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+using namespace scaler;
+
+namespace {
+    using surface_ptr = std::unique_ptr<SDL_Surface, decltype(&SDL_DestroySurface)>;
+
+    surface_ptr make_surface(int w, int h, Uint32 format) {
+        surface_ptr surface(SDL_CreateSurface(w, h, format), SDL_DestroySurface);
+        REQUIRE(surface != nullptr);
+        return surface;
+    }
+
+    void fill_pattern(SDL_Surface* surface) {
+        sdl_output_image view(surface);
+        for (size_t y = 0; y < view.height(); ++y) {
+            for (size_t x = 0; x < view.width(); ++x) {
+                const bool on = ((x / 2) + (y / 3)) % 2 == 0;
+                view.set_pixel(x, y, on ? uvec3{250, static_cast<unsigned int>(x * 20), 10}
+                                        : uvec3{15, 90, static_cast<unsigned int>(y * 20)});
+            }
+        }
+    }
+
+    bool same_pixels(SDL_Surface* a, SDL_Surface* b) {
+        if (a->w != b->w || a->h != b->h) {
+            return false;
+        }
+        sdl_input_image ia(a);
+        sdl_input_image ib(b);
+        for (size_t y = 0; y < ia.height(); ++y) {
+            for (size_t x = 0; x < ia.width(); ++x) {
+                if (!(ia.get_pixel(x, y) == ib.get_pixel(x, y))) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+TEST_CASE("sdl_pixel_codec matches SDL conversions") {
+    const Uint32 formats[] = {
+        SDL_PIXELFORMAT_RGB565, SDL_PIXELFORMAT_RGB24, SDL_PIXELFORMAT_BGR24,
+        SDL_PIXELFORMAT_ARGB8888, SDL_PIXELFORMAT_RGBA8888, SDL_PIXELFORMAT_ABGR8888
+    };
+
+    for (Uint32 format : formats) {
+        CAPTURE(format);
+        auto surface = make_surface(1, 1, format);
+        auto* details = SDL_GetPixelFormatDetails(surface->format);
+        sdl_pixel_codec codec(format, details, nullptr);
+        CHECK(codec.get_layout() == sdl_pixel_codec::layout::packed);
+
+        bool decode_ok = true;
+        bool encode_ok = true;
+        for (unsigned int v = 0; v < 4096 && decode_ok && encode_ok; ++v) {
+            // Spread the test values over all channels
+            const Uint8 r = static_cast<Uint8>(v * 37);
+            const Uint8 g = static_cast<Uint8>(v * 11 + 3);
+            const Uint8 b = static_cast<Uint8>(v >> 4);
+
+            // Little-endian byte image of the mapped pixel
+            Uint8 expected[4] = {0, 0, 0, 0};
+            const Uint32 mapped = SDL_MapRGB(details, nullptr, r, g, b);
+            std::memcpy(expected, &mapped, static_cast<size_t>(codec.bytes_per_pixel()));
+
+            Uint8 encoded[4] = {0, 0, 0, 0};
+            codec.encode(encoded, uvec3{r, g, b});
+            encode_ok = std::memcmp(encoded, expected, 4) == 0;
+
+            Uint8 er, eg, eb;
+            SDL_GetRGB(mapped, details, nullptr, &er, &eg, &eb);
+            decode_ok = codec.decode(expected) == uvec3{er, eg, eb};
+        }
+        CHECK(encode_ok);
+        CHECK(decode_ok);
+    }
+
+    SUBCASE("Indexed surfaces decode through the palette") {
+        auto surface = make_surface(4, 1, SDL_PIXELFORMAT_INDEX8);
+        SDL_Palette* palette = SDL_GetSurfacePalette(surface.get());
+        REQUIRE(palette != nullptr);
+        SDL_Color colors[2] = {{10, 20, 30, 255}, {200, 100, 50, 255}};
+        SDL_SetPaletteColors(palette, colors, 0, 2);
+
+        sdl_pixel_codec codec(SDL_PIXELFORMAT_INDEX8,
+                              SDL_GetPixelFormatDetails(surface->format), palette);
+        CHECK(codec.get_layout() == sdl_pixel_codec::layout::indexed);
+        const Uint8 index = 1;
+        CHECK(codec.decode(&index) == uvec3{200, 100, 50});
+    }
+}
+
+TEST_CASE("sdl_scaling_context reuses output surfaces") {
+    auto frame = make_surface(10, 8, SDL_PIXELFORMAT_RGBA8888);
+    fill_pattern(frame.get());
+
+    SUBCASE("Cached output matches the convenience helper") {
+        sdl_scaling_context ctx(algorithm::EPX, 2.0f);
+        SDL_Surface* first = ctx.scale(frame.get());
+        SDL_Surface* second = ctx.scale(frame.get());
+        CHECK(first == second);
+        CHECK(ctx.allocation_count() == 1);
+
+        surface_ptr reference(scaleEpxSDL(frame.get()), SDL_DestroySurface);
+        CHECK(same_pixels(second, reference.get()));
+    }
+
+    SUBCASE("Runtime algorithm switch only allocates for new sizes") {
+        sdl_scaling_context ctx(algorithm::HQ, 2.0f);
+        ctx.scale(frame.get());
+        ctx.set_algorithm(algorithm::OmniScale, 2.0f);
+        SDL_Surface* omni = ctx.scale(frame.get());
+        CHECK(ctx.allocation_count() == 1);
+
+        surface_ptr reference(scaleOmniScale2xSDL(frame.get()), SDL_DestroySurface);
+        CHECK(same_pixels(omni, reference.get()));
+
+        ctx.set_algorithm(algorithm::HQ, 3.0f);
+        ctx.scale(frame.get());
+        CHECK(ctx.allocation_count() == 2);
+        CHECK(ctx.cached_surface_count() == 2);
+
+        CHECK_THROWS_AS(ctx.set_algorithm(algorithm::EPX, 3.0f), unsupported_scale_exception);
+    }
+
+    SUBCASE("scale_into writes caller surfaces of another format") {
+        sdl_scaling_context ctx(algorithm::Scale, 2.0f);
+        auto target = make_surface(30, 24, SDL_PIXELFORMAT_RGB24);
+        ctx.scale_into(frame.get(), target.get());
+        CHECK(ctx.allocation_count() == 0);
+
+        auto reference = make_surface(30, 24, SDL_PIXELFORMAT_RGB24);
+        sdl_input_image input(frame.get());
+        sdl_output_image out(reference.get());
+        unified_scaler<sdl_input_image, sdl_output_image>::scale(input, out, algorithm::Scale);
+        CHECK(same_pixels(target.get(), reference.get()));
+
+        auto wrong = make_surface(25, 24, SDL_PIXELFORMAT_RGB24);
+        CHECK_THROWS(ctx.scale_into(frame.get(), wrong.get()));
+    }
+
+    SUBCASE("Indexed surfaces keep their palette") {
+        auto indexed = make_surface(6, 6, SDL_PIXELFORMAT_INDEX8);
+        SDL_Palette* palette = SDL_GetSurfacePalette(indexed.get());
+        REQUIRE(palette != nullptr);
+        SDL_Color colors[2] = {{0, 0, 0, 255}, {255, 255, 255, 255}};
+        SDL_SetPaletteColors(palette, colors, 0, 2);
+        auto* pixels = static_cast<Uint8*>(indexed->pixels);
+        for (int y = 0; y < 6; ++y) {
+            for (int x = 0; x < 6; ++x) {
+                pixels[y * indexed->pitch + x] = static_cast<Uint8>((x + y) % 2);
+            }
+        }
+
+        sdl_scaling_context ctx(algorithm::EPX, 2.0f);
+        SDL_Surface* scaled = ctx.scale(indexed.get());
+        REQUIRE(scaled != nullptr);
+        CHECK(SDL_GetSurfacePalette(scaled) == palette);
+
+        surface_ptr reference(scaleEpxSDL(indexed.get()), SDL_DestroySurface);
+        CHECK(same_pixels(scaled, reference.get()));
+    }
+}
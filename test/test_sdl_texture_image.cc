@@ -0,0 +1,111 @@
+#include <doctest/doctest.h>
+#include <scaler/sdl/sdl_texture_image.hh>
+#include <scaler/unified_scaler.hh>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using namespace scaler;
+
+namespace {
+    using surface_ptr = std::unique_ptr<SDL_Surface, decltype(&SDL_DestroySurface)>;
+
+    surface_ptr make_pattern_surface(int w, int h) {
+        surface_ptr surface(SDL_CreateSurface(w, h, SDL_PIXELFORMAT_RGBA8888), SDL_DestroySurface);
+        REQUIRE(surface != nullptr);
+        auto* details = SDL_GetPixelFormatDetails(surface->format);
+        for (int y = 0; y < h; ++y) {
+            auto* row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(surface->pixels) + y * surface->pitch);
+            for (int x = 0; x < w; ++x) {
+                const bool on = ((x / 2) + (y / 3)) % 2 == 0;
+                row[x] = on ? SDL_MapRGB(details, nullptr, 240, static_cast<Uint8>(x * 16), 30)
+                            : SDL_MapRGB(details, nullptr, 20, 60, static_cast<Uint8>(y * 16));
+            }
+        }
+        return surface;
+    }
+
+    // Scales into a padded raw buffer and compares with a reference sdl_output_image
+    // produced by the same unified_scaler dispatch
+    void check_matches_reference(SDL_Surface* src, algorithm algo, float factor, Uint32 format) {
+        sdl_input_image input(src);
+        auto reference = unified_scaler<sdl_input_image, sdl_output_image>::scale(input, algo, factor);
+
+        const size_t w = reference.width();
+        const size_t h = reference.height();
+        const int bpp = SDL_BYTESPERPIXEL(format);
+        // Pad the pitch like a driver would, to make sure it is honoured
+        const int pitch = static_cast<int>(w) * bpp + 64;
+        std::vector<Uint8> memory(static_cast<size_t>(pitch) * h, 0xCD);
+
+        sdl_texture_output_image output(memory.data(), pitch, format, w, h);
+        unified_scaler<sdl_input_image, sdl_texture_output_image>::scale(input, output, algo);
+
+        bool identical = true;
+        for (size_t y = 0; y < h && identical; ++y) {
+            for (size_t x = 0; x < w && identical; ++x) {
+                identical = reference.get_pixel(x, y) == output.get_pixel(x, y);
+            }
+            // Padding bytes past the row must be untouched
+            const Uint8* pad = memory.data() + y * static_cast<size_t>(pitch) + w * static_cast<size_t>(bpp);
+            for (int i = 0; i < 64 && identical; ++i) {
+                identical = pad[i] == 0xCD;
+            }
+        }
+        CHECK(identical);
+    }
+}
+
+TEST_CASE("sdl_texture_output_image writes native formats with pitch") {
+    auto src = make_pattern_surface(12, 9);
+
+    SUBCASE("ARGB8888 single-pass algorithms") {
+        check_matches_reference(src.get(), algorithm::EPX, 2.0f, SDL_PIXELFORMAT_ARGB8888);
+        check_matches_reference(src.get(), algorithm::HQ, 3.0f, SDL_PIXELFORMAT_ARGB8888);
+        check_matches_reference(src.get(), algorithm::OmniScale, 2.0f, SDL_PIXELFORMAT_ARGB8888);
+    }
+
+    SUBCASE("Multi-pass algorithms use scratch images") {
+        check_matches_reference(src.get(), algorithm::xBR, 4.0f, SDL_PIXELFORMAT_ARGB8888);
+        check_matches_reference(src.get(), algorithm::Super2xSaI, 2.0f, SDL_PIXELFORMAT_ABGR8888);
+    }
+
+    SUBCASE("24-bit format") {
+        check_matches_reference(src.get(), algorithm::Scale, 3.0f, SDL_PIXELFORMAT_RGB24);
+    }
+
+    SUBCASE("Indexed formats are rejected") {
+        std::vector<Uint8> memory(16);
+        CHECK_THROWS_AS(sdl_texture_output_image(memory.data(), 4, SDL_PIXELFORMAT_INDEX8, 4, 4),
+                        std::runtime_error);
+    }
+}
+
+TEST_CASE("sdl_streaming_texture reuses its texture across frames") {
+    surface_ptr target(SDL_CreateSurface(64, 64, SDL_PIXELFORMAT_ARGB8888), SDL_DestroySurface);
+    REQUIRE(target != nullptr);
+    SDL_Renderer* renderer = SDL_CreateSoftwareRenderer(target.get());
+    if (!renderer) {
+        MESSAGE("Software renderer not available, skipping");
+        return;
+    }
+
+    {
+        sdl_streaming_texture streaming(renderer);
+        auto frame = make_pattern_surface(8, 8);
+
+        SDL_Texture* first = streaming.scale(frame.get(), algorithm::EPX, 2.0f);
+        REQUIRE(first != nullptr);
+        SDL_Texture* second = streaming.scale(frame.get(), algorithm::AAScale, 2.0f);
+        CHECK(second == first);
+        CHECK(streaming.recreation_count() == 1);
+
+        // A different output size forces a new texture
+        streaming.scale(frame.get(), algorithm::HQ, 3.0f);
+        CHECK(streaming.recreation_count() == 2);
+
+        CHECK_THROWS_AS(streaming.scale(frame.get(), algorithm::EPX, 3.0f), unsupported_scale_exception);
+    }
+
+    SDL_DestroyRenderer(renderer);
+}
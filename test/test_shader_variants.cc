@@ -0,0 +1,200 @@
+#include <doctest/doctest.h>
+#include <scaler/gpu/opengl_texture_scaler.hh>
+#include <scaler/gpu/shader_variant.hh>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "gpu_test_context.hh"
+
+using namespace scaler;
+
+namespace {
+    GLuint upload_rgba(const std::vector<std::uint8_t>& rgba, int width, int height) {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+
+    std::vector<std::uint8_t> make_pattern(int width, int height, std::uint8_t alpha) {
+        std::vector<std::uint8_t> rgba(static_cast<size_t>(width * height * 4));
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const size_t i = static_cast<size_t>(y * width + x) * 4;
+                const bool line = (x + y) % 4 == 0 || x == height - 1 - y;
+                rgba[i] = line ? 250 : static_cast<std::uint8_t>(x * 9);
+                rgba[i + 1] = line ? 30 : static_cast<std::uint8_t>((y / 2) * 25);
+                rgba[i + 2] = static_cast<std::uint8_t>((x ^ y) & 1 ? 200 : 60);
+                rgba[i + 3] = alpha;
+            }
+        }
+        return rgba;
+    }
+
+    std::vector<std::uint8_t> scale(gpu::opengl_texture_scaler& scaler, GLuint input, int width, int height,
+                                    algorithm algo, int factor) {
+        const int out_w = width * factor;
+        const int out_h = height * factor;
+        GLuint output = gpu::opengl_texture_scaler::create_output_texture(out_w, out_h);
+        scaler.scale_texture_to_texture(input, width, height, output, out_w, out_h, algo);
+
+        std::vector<std::uint8_t> pixels(static_cast<size_t>(out_w * out_h * 4));
+        GLuint fbo;
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, output, 0);
+        glReadPixels(0, 0, out_w, out_h, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteTextures(1, &output);
+        return pixels;
+    }
+}
+
+TEST_CASE("Shader variant keys") {
+    gpu::shader_variant_options options;
+    options.specialize_size = true;
+    options.gamma = gpu::gamma_mode::linear;
+
+    SUBCASE("Specializations only apply where they are valid") {
+        auto key = gpu::shader_variant_key::make(algorithm::OmniScale, 3.0f, 320, 200, 960, 600, options);
+        CHECK(key.integral_scale);
+        CHECK(key.texture_width == 320);
+        CHECK(key.texture_height == 200);
+        CHECK(key.gamma == gpu::gamma_mode::linear);
+
+        // Non-uniform output: neither the scale nor the sizes are constants
+        key = gpu::shader_variant_key::make(algorithm::OmniScale, 3.0f, 320, 200, 960, 601, options);
+        CHECK_FALSE(key.integral_scale);
+        CHECK(key.texture_width == 0);
+
+        // EPX only copies pixels, so gamma does not create another program
+        key = gpu::shader_variant_key::make(algorithm::EPX, 2.0f, 320, 200, 640, 400, options);
+        CHECK(key.gamma == gpu::gamma_mode::none);
+        CHECK(key == gpu::shader_variant_key::make(algorithm::EPX, 2.0f, 320, 200, 640, 400,
+                                                   gpu::shader_variant_options{true, false, gpu::gamma_mode::none}));
+
+        // Precompile keys know the scale but not the size
+        key = gpu::shader_variant_key::make(algorithm::Scale, 3.0f, 0, 0, 0, 0, options);
+        CHECK(key.integral_scale);
+        CHECK(key.texture_width == 0);
+    }
+
+    SUBCASE("Specialized source") {
+        const auto key = gpu::shader_variant_key::make(algorithm::OmniScale, 4.0f, 16, 8, 64, 32, options);
+        const std::string source = gpu::specialize_shader(gpu::shader_source::omniscale_fragment_shader, key);
+
+        CHECK(source.find("#version 330 core\n#define SCALER_SCALE 4\n") != std::string::npos);
+        CHECK(source.find("const vec2 u_texture_size = vec2(16.0, 8.0);") != std::string::npos);
+        CHECK(source.find("const vec2 u_output_size = vec2(64.0, 32.0);") != std::string::npos);
+        CHECK(source.find("uniform scaler_params") == std::string::npos);
+        CHECK(source.find("scaler_variant_main();") != std::string::npos);
+
+        // The generic variant is the source unchanged
+        const std::string generic = gpu::specialize_shader(
+            gpu::shader_source::omniscale_fragment_shader,
+            gpu::shader_variant_key::make(algorithm::OmniScale, 2.5f, 16, 8, 40, 20, gpu::shader_variant_options{}));
+        CHECK(generic == gpu::shader_source::omniscale_fragment_shader);
+
+        CHECK_THROWS_AS(gpu::specialize_shader("void main() {}", key), gpu::shader_error);
+    }
+}
+
+TEST_CASE("Shader variants on the GPU") {
+    scaler::test::gpu_context::scoped_context gpu_ctx;
+    if (!gpu_ctx) {
+        INFO("Could not create/get OpenGL context - skipping GPU tests");
+        return;
+    }
+
+    gpu::opengl_texture_scaler scaler;
+    constexpr int w = 21;
+    constexpr int h = 15;
+
+    SUBCASE("Size and scale constants do not change the output") {
+        GLuint input = upload_rgba(make_pattern(w, h, 255), w, h);
+        const struct {
+            algorithm algo;
+            int factor;
+        } cases[] = {
+            {algorithm::EPX, 2},
+            {algorithm::Scale, 3},
+            {algorithm::AAScale, 4},
+            {algorithm::OmniScale, 3},
+            {algorithm::OmniScale, 5}
+        };
+
+        for (const auto& c : cases) {
+            CAPTURE(algorithm_capabilities::get_algorithm_name(c.algo));
+            CAPTURE(c.factor);
+            scaler.set_shader_variants({});
+            const auto generic = scale(scaler, input, w, h, c.algo, c.factor);
+            scaler.set_shader_variants({true, false, gpu::gamma_mode::none});
+            CHECK(scale(scaler, input, w, h, c.algo, c.factor) == generic);
+        }
+        glDeleteTextures(1, &input);
+    }
+
+    SUBCASE("Opaque variants drop source alpha") {
+        GLuint input = upload_rgba(make_pattern(w, h, 128), w, h);
+        scaler.set_shader_variants({false, true, gpu::gamma_mode::none});
+        const auto pixels = scale(scaler, input, w, h, algorithm::EPX, 2);
+        bool all_opaque = true;
+        for (size_t i = 3; i < pixels.size(); i += 4) {
+            all_opaque = all_opaque && pixels[i] == 255;
+        }
+        CHECK(all_opaque);
+        glDeleteTextures(1, &input);
+    }
+
+    SUBCASE("Linear gamma brightens blends between dark and light") {
+        std::vector<std::uint8_t> checker(static_cast<size_t>(w * h * 4), 255);
+        for (int y = 0; y < h; ++y) {
+            for (int x = 0; x < w; ++x) {
+                const size_t i = static_cast<size_t>(y * w + x) * 4;
+                const std::uint8_t v = (x + y) % 2 ? 255 : 0;
+                checker[i] = checker[i + 1] = checker[i + 2] = v;
+            }
+        }
+        GLuint input = upload_rgba(checker, w, h);
+
+        scaler.set_shader_variants({});
+        const auto srgb = scale(scaler, input, w, h, algorithm::Bilinear, 2);
+        scaler.set_shader_variants({false, false, gpu::gamma_mode::linear});
+        const auto linear = scale(scaler, input, w, h, algorithm::Bilinear, 2);
+
+        REQUIRE(srgb.size() == linear.size());
+        int brighter = 0;
+        int darker = 0;
+        for (size_t i = 0; i < srgb.size(); i += 4) {
+            brighter += linear[i] > srgb[i] + 1;
+            darker += linear[i] + 1 < srgb[i];
+        }
+        CHECK(brighter > 0);
+        CHECK(darker == 0);
+        glDeleteTextures(1, &input);
+    }
+
+    SUBCASE("Uniform locations are resolved when the program links") {
+        GLuint input = upload_rgba(make_pattern(w, h, 255), w, h);
+        scaler.set_shader_variants({});
+        (void)scale(scaler, input, w, h, algorithm::EPX, 2);
+        const auto* program = scaler.shaders()->find(gpu::shader_variant_key::make(
+            algorithm::EPX, 2.0f, w, h, w * 2, h * 2, {}));
+        REQUIRE(program != nullptr);
+        // Shared across threads, so lookups must not add entries
+        const size_t resolved = program->uniform_locations.size();
+        CHECK(program->uniform_location("u_texture") == program->u_texture);
+        CHECK(program->uniform_location("u_texture") >= 0);
+        CHECK(program->uniform_location("u_not_declared") == -1);
+        CHECK(program->uniform_locations.size() == resolved);
+        glDeleteTextures(1, &input);
+    }
+}
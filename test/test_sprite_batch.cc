@@ -0,0 +1,87 @@
+#include <doctest/doctest.h>
+#include <scaler/sprite_batch.hh>
+#include <scaler/unified_scaler.hh>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "test_common.hh"
+
+using namespace scaler;
+
+namespace {
+    template<typename Pixel>
+    std::vector<test::TestInputImage<Pixel>> make_sprites(size_t count) {
+        // Mixed sizes, so several groups and partial batches form
+        const size_t sizes[][2] = {{8, 8}, {13, 7}, {1, 1}, {16, 16}, {8, 8}, {32, 3}};
+        std::vector<test::TestInputImage<Pixel>> sprites;
+        for (size_t i = 0; i < count; ++i) {
+            sprites.push_back(test::create_sprite<Pixel>(sizes[i % 6][0], sizes[i % 6][1],
+                                                         static_cast<std::uint32_t>(2024 + i)));
+        }
+        return sprites;
+    }
+
+    template<typename Pixel>
+    size_t count_mismatched_sprites(const std::vector<test::TestInputImage<Pixel>>& sprites, algorithm algo,
+                                    float factor) {
+        using input_image = test::TestInputImage<Pixel>;
+        using output_image = test::TestOutputImage<Pixel>;
+        const auto batched = scale_sprites<input_image, output_image>(sprites, algo, factor);
+        size_t mismatched = 0;
+        for (size_t i = 0; i < sprites.size(); ++i) {
+            const auto expected = unified_scaler<input_image, output_image>::scale(sprites[i], algo, factor);
+            const bool same = batched[i].width() == expected.width() && batched[i].height() == expected.height() &&
+                              test::count_mismatches(batched[i], expected) == 0;
+            mismatched += same ? 0 : 1;
+        }
+        return mismatched;
+    }
+}
+
+TEST_CASE("Sprite batch scaling") {
+    const std::pair<algorithm, float> modes[] = {
+        {algorithm::EPX, 2.0f}, {algorithm::Scale, 2.0f}, {algorithm::Scale, 4.0f},
+        {algorithm::HQ, 2.0f}, {algorithm::HQ, 4.0f}, {algorithm::xBR, 3.0f}, {algorithm::Nearest, 1.5f}};
+
+    SUBCASE("Matches scale() sprite by sprite, 8-bit channels") {
+        const auto sprites = make_sprites<vec3<std::uint8_t>>(75);
+        for (const auto& [algo, factor] : modes) {
+            INFO(scaler_capabilities::get_algorithm_name(algo), " ", factor, "x");
+            CHECK(count_mismatched_sprites(sprites, algo, factor) == 0);
+        }
+    }
+
+    SUBCASE("Matches scale() sprite by sprite, 32-bit channels") {
+        const auto sprites = make_sprites<uvec3>(21);
+        for (const auto& [algo, factor] : modes) {
+            INFO(scaler_capabilities::get_algorithm_name(algo), " ", factor, "x");
+            CHECK(count_mismatched_sprites(sprites, algo, factor) == 0);
+        }
+    }
+
+    SUBCASE("Batch support") {
+        CHECK(is_sprite_batch_supported(algorithm::EPX, 2.0f));
+        CHECK(is_sprite_batch_supported(algorithm::HQ, 4.0f));
+        CHECK_FALSE(is_sprite_batch_supported(algorithm::HQ, 3.0f));
+        CHECK_FALSE(is_sprite_batch_supported(algorithm::xBR, 2.0f));
+    }
+
+    SUBCASE("Invalid requests are rejected") {
+        using input_image = test::TestInputImage<vec3<std::uint8_t>>;
+        using output_image = test::TestOutputImage<vec3<std::uint8_t>>;
+        const auto sprites = make_sprites<vec3<std::uint8_t>>(3);
+
+        std::vector<output_image> too_few;
+        CHECK_THROWS_AS(scale_sprites(sprites, too_few, algorithm::EPX), std::invalid_argument);
+
+        std::vector<output_image> stretched;
+        for (const auto& sprite : sprites) {
+            stretched.emplace_back(sprite.width() * 2, sprite.height() * 3);
+        }
+        // Non-uniform outputs fail as they do in unified_scaler
+        CHECK_THROWS_AS(scale_sprites(sprites, stretched, algorithm::EPX), std::runtime_error);
+        CHECK_THROWS_AS((scale_sprites<input_image, output_image>(sprites, algorithm::EPX, 3.0f)),
+                        unsupported_scale_exception);
+    }
+}